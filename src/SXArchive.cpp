@@ -0,0 +1,1041 @@
+/**
+ * @file SXArchive.hpp
+ * @brief Implementation of the SXArchive, SXArchivedArray and SXArchivedDictionary classes.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SXArchive.hpp"
+#include "SXCommon.hpp"
+#include "SXDictionary.hpp"
+#include "SXFrozenDictionary.hpp"
+#include "SXHashTable.hpp"
+#include "SXNull.hpp"
+#include "SXNumber.hpp"
+#include "SXOrderedDictionary.hpp"
+#include "SXSortedDictionary.hpp"
+#include "SXString.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace spalx {
+
+/*
+ * Archive layout, with all integers little-endian:
+ *
+ *   header   magic[8] "SXARCHIV", uint32 version, uint32 reserved (0)
+ *   records  unaligned, each one written after the records it refers to, and written once when identical
+ *   trailer  8-byte slot of the root object, magic[8]
+ *
+ * A record starts with its type byte, followed by:
+ *
+ *   number      SXNumber type byte, 8-byte value
+ *   string      varint length, characters
+ *   data        varint length, bytes
+ *   array       slot width byte (4 or 8), varint count, the slots of the elements
+ *   dictionary  slot width byte (4 or 8), varint count, pairs of slots (key, object), sorted by key bytes
+ *
+ * A slot is a tag byte followed by width - 1 payload bytes, unused ones 0:
+ *
+ *   0x00           reference: payload is the offset of the record
+ *   0x01           null
+ *   0x10 | type    number of an SXNumber type: payload is the integer, sign-extended, or the float bits of a floating-point number in an 8-byte slot
+ *   0x20 | length  string shorter than the slot: payload is the characters
+ */
+
+// Size of the archive header, which is also the offset of the first record.
+#define SX_ARCHIVE_HEADER_SIZE 16
+
+// Size of the archive trailer.
+#define SX_ARCHIVE_TRAILER_SIZE 16
+
+// Size of a slot that can hold any value, used when one child of a container does not fit in SX_ARCHIVE_NARROW_SLOT_SIZE bytes.
+#define SX_ARCHIVE_WIDE_SLOT_SIZE 8
+
+// Size of the slots of containers whose children all fit: 3-byte offsets and integers, strings of up to 3 bytes.
+#define SX_ARCHIVE_NARROW_SLOT_SIZE 4
+
+// Size of the value of a number record.
+#define SX_ARCHIVE_NUMBER_SIZE 8
+
+static const char kArchiveMagic[8] = {'S', 'X', 'A', 'R', 'C', 'H', 'I', 'V'};
+
+/**
+ * @brief Type of an archive record.
+ */
+enum SXArchiveRecordType : uint8_t
+{
+    SXArchiveRecordNumber = 1,
+    SXArchiveRecordString = 2,
+    SXArchiveRecordData = 3,
+    SXArchiveRecordArray = 4,
+    SXArchiveRecordDictionary = 5
+};
+
+/**
+ * @brief Tag of a slot, in its first byte.
+ * @details Number tags hold the SXArchiveNumberType in their low 4 bits, string tags the length in their low 3 bits.
+ */
+enum SXArchiveSlotTag : uint8_t
+{
+    SXArchiveSlotReference = 0x00,
+    SXArchiveSlotNull = 0x01,
+    SXArchiveSlotNumber = 0x10,
+    SXArchiveSlotString = 0x20
+};
+
+/**
+ * @brief SXNumber type of a number.
+ * @details Signed integers are stored as int64_t, unsigned integers as uint64_t and floating-point numbers as double, so archives do not depend on the size of long.
+ */
+enum SXArchiveNumberType : uint8_t
+{
+    SXArchiveNumberChar = 0,
+    SXArchiveNumberUnsignedChar,
+    SXArchiveNumberShort,
+    SXArchiveNumberUnsignedShort,
+    SXArchiveNumberInt,
+    SXArchiveNumberUnsignedInt,
+    SXArchiveNumberLong,
+    SXArchiveNumberUnsignedLong,
+    SXArchiveNumberLongLong,
+    SXArchiveNumberUnsignedLongLong,
+    SXArchiveNumberFloat,
+    SXArchiveNumberDouble,
+    SXArchiveNumberBool
+};
+
+/**
+ * @brief Fields of a record, checked against the archive bounds by SXArchive::recordAtOffset().
+ */
+struct SXArchiveRecord
+{
+    uint8_t type; /**< SXArchiveRecordType. */
+    uint8_t subtype; /**< SXArchiveNumberType of a number, slot width of a container. */
+    uint64_t length; /**< Number of bytes of a string or data, number of elements of a container. */
+    uint64_t payloadOffset; /**< Offset of the value, characters, bytes or slots. */
+};
+
+/**
+ * @brief Read a little-endian integer of 1 to 8 bytes from a possibly unaligned address.
+ */
+static inline uint64_t readLittleEndian(const char* pBytes, unsigned int length)
+{
+    uint64_t value = 0;
+    for (unsigned int i = length; i > 0; i--) {
+        value = (value << 8) | static_cast<uint8_t>(pBytes[i - 1]);
+    }
+    return value;
+}
+
+/**
+ * @brief Convert the 64-bit value of a number to a number object.
+ */
+template <typename T>
+static SXObject* createNumber(uint64_t bits)
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        return new SXNumber<bool>(bits != 0);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return new SXNumber<T>(static_cast<T>(value));
+    } else if constexpr (std::is_signed_v<T>) {
+        return new SXNumber<T>(static_cast<T>(static_cast<int64_t>(bits)));
+    } else {
+        return new SXNumber<T>(static_cast<T>(bits));
+    }
+}
+
+/**
+ * @brief Convert the 64-bit value of a number of a given SXArchiveNumberType to a number object.
+ * @return The number, with a reference count of 1. nullptr if the type is unknown.
+ */
+static SXObject* createNumber(uint8_t type, uint64_t bits)
+{
+    switch (type) {
+        case SXArchiveNumberChar: return createNumber<char>(bits);
+        case SXArchiveNumberUnsignedChar: return createNumber<unsigned char>(bits);
+        case SXArchiveNumberShort: return createNumber<short>(bits);
+        case SXArchiveNumberUnsignedShort: return createNumber<unsigned short>(bits);
+        case SXArchiveNumberInt: return createNumber<int>(bits);
+        case SXArchiveNumberUnsignedInt: return createNumber<unsigned int>(bits);
+        case SXArchiveNumberLong: return createNumber<long>(bits);
+        case SXArchiveNumberUnsignedLong: return createNumber<unsigned long>(bits);
+        case SXArchiveNumberLongLong: return createNumber<long long>(bits);
+        case SXArchiveNumberUnsignedLongLong: return createNumber<unsigned long long>(bits);
+        case SXArchiveNumberFloat: return createNumber<float>(bits);
+        case SXArchiveNumberDouble: return createNumber<double>(bits);
+        case SXArchiveNumberBool: return createNumber<bool>(bits);
+        default: return nullptr;
+    }
+}
+
+/**
+ * @brief Slot of a child, in its 8-byte form.
+ * @details A container uses 4-byte slots, the first 4 bytes of this form, when none of its children is wide.
+ */
+struct SXArchiveSlot
+{
+    char bytes[SX_ARCHIVE_WIDE_SLOT_SIZE]{}; /**< Tag and payload. */
+    bool wide{false}; /**< Whether the payload needs more than 3 bytes. */
+};
+
+/**
+ * @class SXArchiveWriter
+ * @brief Appends the records of an object graph to a data object.
+ * @details Records are built in a buffer first, so that a record identical to one already written (same string, number or container contents) is replaced by a reference to it.
+ */
+class SXArchiveWriter
+{
+public:
+    explicit SXArchiveWriter(SXData* pData)
+        : m_pData(pData), m_records(SXArchiveRecordEntryHash(), SXArchiveRecordEntryEqual{pData})
+    {
+    }
+    
+    /**
+     * @brief Write the header, the records of the graph and the trailer.
+     * @return Whether the whole graph could be archived.
+     */
+    bool write(const SXObject* pObject)
+    {
+        std::string header(kArchiveMagic, sizeof(kArchiveMagic));
+        appendLittleEndian(header, SX_ARCHIVE_VERSION, 4);
+        appendLittleEndian(header, 0, 4);
+        m_pData->appendBytes(header.data(), header.length());
+        
+        SXArchiveSlot root;
+        if (!writeObject(pObject, 0, root)) {
+            return false;
+        }
+        
+        m_pData->appendBytes(root.bytes, sizeof(root.bytes));
+        m_pData->appendBytes(kArchiveMagic, sizeof(kArchiveMagic));
+        return true;
+    }
+
+private:
+    struct SXArchiveRecordEntry
+    {
+        uint64_t offset; /**< Offset of the record. */
+        size_t length; /**< Number of bytes of the record. */
+        size_t hash; /**< Hash of the bytes of the record. */
+    };
+    
+    struct SXArchiveRecordEntryHash
+    {
+        size_t operator()(const SXArchiveRecordEntry& rEntry) const { return rEntry.hash; }
+        size_t operator()(std::string_view record) const { return SXHashString(record); }
+    };
+    
+    struct SXArchiveRecordEntryEqual
+    {
+        const SXData* pData; /**< Data object the records are written to, read at each comparison since it moves as it grows. */
+        
+        bool operator()(const SXArchiveRecordEntry& rEntry, std::string_view record) const
+        {
+            return rEntry.length == record.length() && memcmp(pData->bytes() + rEntry.offset, record.data(), record.length()) == 0;
+        }
+    };
+    
+    SXData* m_pData; /**< Destination data object. */
+    SXHashTable<SXArchiveRecordEntry, void, SXArchiveRecordEntryHash, SXArchiveRecordEntryEqual> m_records; /**< Records written so far, found by their bytes. */
+    std::string m_record; /**< Buffer of the record being built. */
+    
+    static void appendLittleEndian(std::string& rBytes, uint64_t value, unsigned int length)
+    {
+        for (unsigned int i = 0; i < length; i++) {
+            rBytes.push_back(static_cast<char>(value >> (i * 8)));
+        }
+    }
+    
+    static void appendLength(std::string& rBytes, uint64_t value)
+    {
+        // Unsigned LEB128: 7 bits per byte, high bit set on all bytes but the last.
+        while (value >= 0x80) {
+            rBytes.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        rBytes.push_back(static_cast<char>(value));
+    }
+    
+    static void setPayload(SXArchiveSlot& rSlot, uint8_t tag, uint64_t payload)
+    {
+        rSlot.bytes[0] = static_cast<char>(tag);
+        for (unsigned int i = 1; i < SX_ARCHIVE_WIDE_SLOT_SIZE; i++) {
+            rSlot.bytes[i] = static_cast<char>(payload >> ((i - 1) * 8));
+        }
+    }
+    
+    /**
+     * @brief Look for a record identical to m_record among the records written so far.
+     * @return Whether there is one. rOffset receives its offset.
+     */
+    bool findRecord(size_t hash, uint64_t& rOffset) const
+    {
+        auto it = m_records.find(std::string_view(m_record), hash);
+        if (it == m_records.end()) {
+            return false;
+        }
+        rOffset = it->offset;
+        return true;
+    }
+    
+    /**
+     * @brief Append m_record to the data, unless an identical record was already written.
+     * @return A reference slot to the record.
+     */
+    SXArchiveSlot appendRecord()
+    {
+        size_t hash = SXHashString(m_record);
+        uint64_t offset = m_pData->length();
+        if (!findRecord(hash, offset)) {
+            m_pData->appendBytes(m_record.data(), m_record.length());
+            m_records.emplaceUnique(hash, SXArchiveRecordEntry{offset, m_record.length(), hash});
+        }
+        
+        SXArchiveSlot slot;
+        setPayload(slot, SXArchiveSlotReference, offset);
+        slot.wide = offset >> 24 != 0;
+        return slot;
+    }
+    
+    SXArchiveSlot writeString(std::string_view string)
+    {
+        SXArchiveSlot slot;
+        if (string.length() < SX_ARCHIVE_WIDE_SLOT_SIZE) {
+            slot.bytes[0] = static_cast<char>(SXArchiveSlotString | string.length());
+            string.copy(slot.bytes + 1, string.length());
+            slot.wide = string.length() >= SX_ARCHIVE_NARROW_SLOT_SIZE;
+            return slot;
+        }
+        
+        m_record.clear();
+        m_record.push_back(static_cast<char>(SXArchiveRecordString));
+        appendLength(m_record, string.length());
+        m_record.append(string.data(), string.length());
+        return appendRecord();
+    }
+    
+    /**
+     * @brief Write the object if it is an SXNumber<T>.
+     * @details Integers of up to 56 bits and floating-point numbers that are exact as float are stored in the slot, others in a number record.
+     * @return Whether the object was an SXNumber<T>. rSlot receives its slot.
+     */
+    template <typename T>
+    bool writeNumber(const SXObject* pObject, SXArchiveNumberType type, SXArchiveSlot& rSlot)
+    {
+        const SXNumber<T>* pNumber = dynamic_cast<const SXNumber<T>*>(pObject);
+        if (!pNumber) {
+            return false;
+        }
+        
+        uint64_t bits;
+        if constexpr (std::is_floating_point_v<T>) {
+            double value = pNumber->getValue();
+            if (std::fabs(value) <= FLT_MAX && static_cast<double>(static_cast<float>(value)) == value) {
+                float narrowValue = static_cast<float>(value);
+                uint32_t narrowBits;
+                memcpy(&narrowBits, &narrowValue, sizeof(narrowBits));
+                setPayload(rSlot, SXArchiveSlotNumber | type, narrowBits);
+                rSlot.wide = true;
+                return true;
+            }
+            memcpy(&bits, &value, sizeof(bits));
+        } else {
+            if constexpr (std::is_signed_v<T> && !std::is_same_v<T, bool>) {
+                bits = static_cast<uint64_t>(static_cast<int64_t>(pNumber->getValue()));
+            } else {
+                bits = static_cast<uint64_t>(pNumber->getValue());
+            }
+            
+            // Inline when sign-extending the low 7 bytes gives the value back.
+            int64_t value = static_cast<int64_t>(bits);
+            if (value >= -(INT64_C(1) << 55) && value < (INT64_C(1) << 55)) {
+                setPayload(rSlot, SXArchiveSlotNumber | type, bits);
+                rSlot.wide = value < -(INT64_C(1) << 23) || value >= (INT64_C(1) << 23);
+                return true;
+            }
+        }
+        
+        m_record.clear();
+        m_record.push_back(static_cast<char>(SXArchiveRecordNumber));
+        m_record.push_back(static_cast<char>(type));
+        appendLittleEndian(m_record, bits, SX_ARCHIVE_NUMBER_SIZE);
+        rSlot = appendRecord();
+        return true;
+    }
+    
+    /**
+     * @brief Build in m_record the record of a value stored inline in a wide slot.
+     */
+    void buildRecordOfSlot(const SXArchiveSlot& rSlot)
+    {
+        uint8_t tag = static_cast<uint8_t>(rSlot.bytes[0]);
+        uint64_t payload = readLittleEndian(rSlot.bytes + 1, SX_ARCHIVE_WIDE_SLOT_SIZE - 1);
+        m_record.clear();
+        if ((tag & 0xf0) == SXArchiveSlotString) {
+            m_record.push_back(static_cast<char>(SXArchiveRecordString));
+            appendLength(m_record, tag & 0x07);
+            m_record.append(rSlot.bytes + 1, tag & 0x07);
+            return;
+        }
+        
+        uint8_t type = tag & 0x0f;
+        if (type == SXArchiveNumberFloat || type == SXArchiveNumberDouble) {
+            uint32_t narrowBits = static_cast<uint32_t>(payload);
+            float narrowValue;
+            memcpy(&narrowValue, &narrowBits, sizeof(narrowValue));
+            double value = narrowValue;
+            memcpy(&payload, &value, sizeof(payload));
+        } else {
+            payload = static_cast<uint64_t>(static_cast<int64_t>(payload << 8) >> 8);
+        }
+        m_record.push_back(static_cast<char>(SXArchiveRecordNumber));
+        m_record.push_back(static_cast<char>(type));
+        appendLittleEndian(m_record, payload, SX_ARCHIVE_NUMBER_SIZE);
+    }
+    
+    /**
+     * @brief Write a container record holding the slots of its children.
+     * @details Inline values that need a wide slot (strings of 4 to 7 bytes, larger integers, floating-point numbers) are moved to records when that lets the container use narrow slots and takes less space. Most of them are dictionary keys, whose records are written once for the whole archive.
+     */
+    SXArchiveSlot writeContainer(SXArchiveRecordType type, std::vector<SXArchiveSlot>& rSlots, uint64_t count)
+    {
+        bool narrow = true;
+        uint64_t recordsLength = 0;
+        for (const SXArchiveSlot& rSlot : rSlots) {
+            if (!rSlot.wide) {
+                continue;
+            }
+            uint64_t offset;
+            if (rSlot.bytes[0] == SXArchiveSlotReference) {
+                narrow = false; // The record is too far to be referred to by a narrow slot.
+                break;
+            }
+            buildRecordOfSlot(rSlot);
+            if (!findRecord(SXHashString(m_record), offset)) {
+                recordsLength += m_record.length();
+            }
+        }
+        narrow = narrow && recordsLength < rSlots.size() * (SX_ARCHIVE_WIDE_SLOT_SIZE - SX_ARCHIVE_NARROW_SLOT_SIZE) && ((m_pData->length() + recordsLength) >> 24) == 0;
+        if (narrow) {
+            for (SXArchiveSlot& rSlot : rSlots) {
+                if (rSlot.wide) {
+                    buildRecordOfSlot(rSlot);
+                    rSlot = appendRecord();
+                }
+            }
+        }
+        size_t width = narrow ? SX_ARCHIVE_NARROW_SLOT_SIZE : SX_ARCHIVE_WIDE_SLOT_SIZE;
+        
+        m_record.clear();
+        m_record.push_back(static_cast<char>(type));
+        m_record.push_back(static_cast<char>(width));
+        appendLength(m_record, count);
+        for (const SXArchiveSlot& rSlot : rSlots) {
+            m_record.append(rSlot.bytes, width);
+        }
+        return appendRecord();
+    }
+    
+    template <typename Array>
+    bool writeArray(const Array* pArray, unsigned int depth, SXArchiveSlot& rSlot)
+    {
+        std::vector<SXArchiveSlot> slots(pArray->count());
+        for (unsigned int i = 0; i < pArray->count(); i++) {
+            if (!writeObject(pArray->objectAtIndex(i), depth + 1, slots[i])) {
+                return false;
+            }
+        }
+        
+        rSlot = writeContainer(SXArchiveRecordArray, slots, slots.size());
+        return true;
+    }
+    
+    template <typename Dictionary>
+    bool writeDictionary(const Dictionary* pDictionary, unsigned int depth, SXArchiveSlot& rSlot)
+    {
+        std::vector<std::pair<std::string_view, SXObject*>> entries;
+        entries.reserve(pDictionary->count());
+        pDictionary->enumerateKeysAndObjects([&entries](std::string_view key, SXObject* pObject, bool&) {
+            entries.emplace_back(key, pObject);
+        });
+        std::sort(entries.begin(), entries.end(), [](const auto& rA, const auto& rB) { return rA.first < rB.first; });
+        
+        std::vector<SXArchiveSlot> slots(entries.size() * 2);
+        for (size_t i = 0; i < entries.size(); i++) {
+            slots[i * 2] = writeString(entries[i].first);
+            if (!writeObject(entries[i].second, depth + 1, slots[i * 2 + 1])) {
+                return false;
+            }
+        }
+        
+        rSlot = writeContainer(SXArchiveRecordDictionary, slots, entries.size());
+        return true;
+    }
+    
+    bool writeObject(const SXObject* pObject, unsigned int depth, SXArchiveSlot& rSlot)
+    {
+        if (!pObject || depth > SX_ARCHIVE_MAX_DEPTH) {
+            return false;
+        }
+        
+        // Most common types first.
+        if (const SXString* pString = dynamic_cast<const SXString*>(pObject)) {
+            rSlot = writeString(pString->view());
+            return true;
+        }
+        if (const SXDictionary* pDictionary = dynamic_cast<const SXDictionary*>(pObject)) {
+            return writeDictionary(pDictionary, depth, rSlot);
+        }
+        if (const SXArray* pArray = dynamic_cast<const SXArray*>(pObject)) {
+            return writeArray(pArray, depth, rSlot);
+        }
+        if (pObject == SXNull::null()) {
+            setPayload(rSlot, SXArchiveSlotNull, 0);
+            return true;
+        }
+        
+        if (writeNumber<long long>(pObject, SXArchiveNumberLongLong, rSlot) || writeNumber<double>(pObject, SXArchiveNumberDouble, rSlot) ||
+            writeNumber<bool>(pObject, SXArchiveNumberBool, rSlot) || writeNumber<int>(pObject, SXArchiveNumberInt, rSlot) ||
+            writeNumber<unsigned int>(pObject, SXArchiveNumberUnsignedInt, rSlot) || writeNumber<long>(pObject, SXArchiveNumberLong, rSlot) ||
+            writeNumber<unsigned long>(pObject, SXArchiveNumberUnsignedLong, rSlot) ||
+            writeNumber<unsigned long long>(pObject, SXArchiveNumberUnsignedLongLong, rSlot) || writeNumber<float>(pObject, SXArchiveNumberFloat, rSlot) ||
+            writeNumber<short>(pObject, SXArchiveNumberShort, rSlot) || writeNumber<unsigned short>(pObject, SXArchiveNumberUnsignedShort, rSlot) ||
+            writeNumber<char>(pObject, SXArchiveNumberChar, rSlot) || writeNumber<unsigned char>(pObject, SXArchiveNumberUnsignedChar, rSlot)) {
+            return true;
+        }
+        
+        if (const SXData* pData = dynamic_cast<const SXData*>(pObject)) {
+            m_record.clear();
+            m_record.push_back(static_cast<char>(SXArchiveRecordData));
+            appendLength(m_record, pData->length());
+            m_record.append(pData->bytes(), pData->length());
+            rSlot = appendRecord();
+            return true;
+        }
+        if (const SXArchivedDictionary* pDictionary = dynamic_cast<const SXArchivedDictionary*>(pObject)) {
+            return writeDictionary(pDictionary, depth, rSlot);
+        }
+        if (const SXArchivedArray* pArray = dynamic_cast<const SXArchivedArray*>(pObject)) {
+            return writeArray(pArray, depth, rSlot);
+        }
+        if (const SXOrderedDictionary* pDictionary = dynamic_cast<const SXOrderedDictionary*>(pObject)) {
+            return writeDictionary(pDictionary, depth, rSlot);
+        }
+        if (const SXSortedDictionary* pDictionary = dynamic_cast<const SXSortedDictionary*>(pObject)) {
+            return writeDictionary(pDictionary, depth, rSlot);
+        }
+        if (const SXFrozenDictionary* pDictionary = dynamic_cast<const SXFrozenDictionary*>(pObject)) {
+            return writeDictionary(pDictionary, depth, rSlot);
+        }
+        
+        return false; // Not archivable.
+    }
+};
+
+SXArchive::SXArchive()
+{
+}
+
+SXArchive::~SXArchive()
+{
+#if !defined(_WIN32)
+    if (m_mapped) {
+        munmap(const_cast<char*>(m_pBytes), m_length);
+    }
+#endif
+    delete m_pBuffer;
+    m_pBuffer = nullptr;
+    if (m_pData) {
+        m_pData->release();
+        m_pData = nullptr;
+    }
+}
+
+SXArchive* SXArchive::createWithContentsOfFile(const char* pFilePath)
+{
+    SXArchive* pArchive = new SXArchive();
+
+#if !defined(_WIN32)
+    int fileDescriptor = open(pFilePath, O_RDONLY);
+    if (fileDescriptor >= 0) {
+        // Only files that should not change are mapped: a mapping sees later writes, and faults once the file is truncated below it.
+        struct stat status;
+        if (fstat(fileDescriptor, &status) == 0 && S_ISREG(status.st_mode) && (status.st_mode & (S_IWUSR | S_IWGRP | S_IWOTH)) == 0 && status.st_size >= SX_ARCHIVE_MAP_MIN_LENGTH) {
+            void* pMapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+            if (pMapping != MAP_FAILED) {
+                pArchive->m_pBytes = static_cast<const char*>(pMapping);
+                pArchive->m_length = static_cast<size_t>(status.st_size);
+                pArchive->m_mapped = true;
+            }
+        }
+        close(fileDescriptor);
+    }
+#endif
+
+    if (!pArchive->m_mapped) {
+        // The file is small, may change or cannot be mapped (or this platform has no mmap): read it with one read into a buffer of its size.
+        std::FILE* pFile = std::fopen(pFilePath, "rb");
+        if (pFile) {
+            if (std::fseek(pFile, 0, SEEK_END) == 0) {
+                long length = std::ftell(pFile);
+                if (length > 0 && std::fseek(pFile, 0, SEEK_SET) == 0) {
+                    pArchive->m_pBuffer = new std::vector<char>(static_cast<size_t>(length));
+                    if (std::fread(pArchive->m_pBuffer->data(), 1, pArchive->m_pBuffer->size(), pFile) == pArchive->m_pBuffer->size()) {
+                        pArchive->m_pBytes = pArchive->m_pBuffer->data();
+                        pArchive->m_length = pArchive->m_pBuffer->size();
+                    }
+                }
+            }
+            std::fclose(pFile);
+        }
+    }
+    
+    if (!pArchive->validate()) {
+        delete pArchive;
+        return nullptr;
+    }
+    
+    pArchive->autorelease();
+    return pArchive;
+}
+
+SXArchive* SXArchive::createWithData(SXData* pData)
+{
+    if (!pData) {
+        return nullptr;
+    }
+    
+    SXArchive* pArchive = new SXArchive();
+    pData->retain();
+    pArchive->m_pData = pData;
+    pArchive->m_pBytes = pData->bytes();
+    pArchive->m_length = pData->length();
+    
+    if (!pArchive->validate()) {
+        delete pArchive;
+        return nullptr;
+    }
+    
+    pArchive->autorelease();
+    return pArchive;
+}
+
+SXData* SXArchive::archivedDataWithRootObject(const SXObject* pObject)
+{
+    SXData* pData = SXData::create();
+    SXArchiveWriter writer(pData);
+    return writer.write(pObject) ? pData : nullptr;
+}
+
+bool SXArchive::writeRootObject(const SXObject* pObject, const char* pFilePath)
+{
+    SXData* pData = archivedDataWithRootObject(pObject);
+    return pData && pData->writeToFile(pFilePath);
+}
+
+SXObject* SXArchive::rootObject()
+{
+    SXObject* pObject = createObjectForSlot(m_pBytes + m_recordsEnd, SX_ARCHIVE_WIDE_SLOT_SIZE, m_recordsEnd, 0, false);
+    return pObject ? pObject->autorelease() : nullptr;
+}
+
+size_t SXArchive::length() const
+{
+    return m_length;
+}
+
+bool SXArchive::isMapped() const
+{
+    return m_mapped;
+}
+
+bool SXArchive::validate()
+{
+    if (!m_pBytes || m_length < SX_ARCHIVE_HEADER_SIZE + SX_ARCHIVE_TRAILER_SIZE) {
+        return false;
+    }
+    
+    const char* pTrailer = m_pBytes + m_length - SX_ARCHIVE_TRAILER_SIZE;
+    if (memcmp(m_pBytes, kArchiveMagic, sizeof(kArchiveMagic)) != 0 || memcmp(pTrailer + SX_ARCHIVE_WIDE_SLOT_SIZE, kArchiveMagic, sizeof(kArchiveMagic)) != 0) {
+        return false;
+    }
+    if (readLittleEndian(m_pBytes + 8, 4) != SX_ARCHIVE_VERSION || readLittleEndian(m_pBytes + 12, 4) != 0) {
+        return false;
+    }
+    
+    m_recordsEnd = m_length - SX_ARCHIVE_TRAILER_SIZE;
+    return true;
+}
+
+bool SXArchive::readLength(uint64_t& rOffset, uint64_t limit, uint64_t& rLength) const
+{
+    rLength = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+        if (rOffset >= limit) {
+            return false;
+        }
+        uint8_t byte = static_cast<uint8_t>(m_pBytes[rOffset++]);
+        rLength |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SXArchive::recordAtOffset(uint64_t offset, uint64_t limit, SXArchiveRecord& rRecord) const
+{
+    if (offset < SX_ARCHIVE_HEADER_SIZE || limit > m_recordsEnd || offset >= limit) {
+        return false;
+    }
+    
+    rRecord.type = static_cast<uint8_t>(m_pBytes[offset]);
+    rRecord.subtype = 0;
+    rRecord.length = 0;
+    uint64_t position = offset + 1;
+    switch (rRecord.type) {
+        case SXArchiveRecordNumber:
+            if (limit - position < 1 + SX_ARCHIVE_NUMBER_SIZE) {
+                return false;
+            }
+            rRecord.subtype = static_cast<uint8_t>(m_pBytes[position]);
+            rRecord.payloadOffset = position + 1;
+            return true;
+        case SXArchiveRecordString:
+        case SXArchiveRecordData:
+            if (!readLength(position, limit, rRecord.length) || rRecord.length > limit - position) {
+                return false;
+            }
+            rRecord.payloadOffset = position;
+            return true;
+        case SXArchiveRecordArray:
+        case SXArchiveRecordDictionary: {
+            if (position >= limit) {
+                return false;
+            }
+            rRecord.subtype = static_cast<uint8_t>(m_pBytes[position++]);
+            if (rRecord.subtype != SX_ARCHIVE_NARROW_SLOT_SIZE && rRecord.subtype != SX_ARCHIVE_WIDE_SLOT_SIZE) {
+                return false;
+            }
+            uint64_t slotsPerElement = (rRecord.type == SXArchiveRecordDictionary) ? 2 : 1;
+            if (!readLength(position, limit, rRecord.length) || rRecord.length > UINT_MAX || rRecord.length > (limit - position) / (slotsPerElement * rRecord.subtype)) {
+                return false; // The slots do not fit.
+            }
+            rRecord.payloadOffset = position;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+bool SXArchive::stringForSlot(const char* pSlot, unsigned int width, uint64_t limit, std::string_view& rString) const
+{
+    uint8_t tag = static_cast<uint8_t>(pSlot[0]);
+    if ((tag & 0xf8) == SXArchiveSlotString) {
+        size_t length = tag & 0x07;
+        if (length >= width) {
+            return false;
+        }
+        rString = std::string_view(pSlot + 1, length);
+        return true;
+    }
+    
+    SXArchiveRecord record;
+    if (tag != SXArchiveSlotReference || !recordAtOffset(readLittleEndian(pSlot + 1, width - 1), limit, record) || record.type != SXArchiveRecordString) {
+        return false;
+    }
+    rString = std::string_view(m_pBytes + record.payloadOffset, static_cast<size_t>(record.length));
+    return true;
+}
+
+SXObject* SXArchive::createObjectForSlot(const char* pSlot, unsigned int width, uint64_t limit, unsigned int depth, bool copy)
+{
+    uint8_t tag = static_cast<uint8_t>(pSlot[0]);
+    uint64_t payload = readLittleEndian(pSlot + 1, width - 1);
+    if (tag == SXArchiveSlotReference) {
+        return createObjectAtOffset(payload, limit, depth, copy);
+    }
+    if (tag == SXArchiveSlotNull) {
+        SXNull* pNull = SXNull::null();
+        pNull->retain();
+        return pNull;
+    }
+    if ((tag & 0xf0) == SXArchiveSlotNumber) {
+        uint8_t type = tag & 0x0f;
+        if (type == SXArchiveNumberFloat || type == SXArchiveNumberDouble) {
+            if (width != SX_ARCHIVE_WIDE_SLOT_SIZE) {
+                return nullptr;
+            }
+            // The slot holds float bits: widen them to the double bits of number records.
+            uint32_t narrowBits = static_cast<uint32_t>(payload);
+            float narrowValue;
+            memcpy(&narrowValue, &narrowBits, sizeof(narrowValue));
+            double value = narrowValue;
+            memcpy(&payload, &value, sizeof(payload));
+        } else {
+            unsigned int shift = 64 - (width - 1) * 8;
+            payload = static_cast<uint64_t>(static_cast<int64_t>(payload << shift) >> shift);
+        }
+        return createNumber(type, payload);
+    }
+    
+    std::string_view string;
+    if (!stringForSlot(pSlot, width, limit, string)) {
+        return nullptr;
+    }
+    return SXString::newWithCharacters(string.data(), string.length());
+}
+
+SXObject* SXArchive::createObjectAtOffset(uint64_t offset, uint64_t limit, unsigned int depth, bool copy)
+{
+    SXArchiveRecord record;
+    if (depth > SX_ARCHIVE_MAX_DEPTH || !recordAtOffset(offset, limit, record)) {
+        return nullptr;
+    }
+    
+    const char* pPayload = m_pBytes + record.payloadOffset;
+    unsigned int width = record.subtype;
+    unsigned int count = static_cast<unsigned int>(record.length);
+    switch (record.type) {
+        case SXArchiveRecordNumber:
+            return createNumber(record.subtype, readLittleEndian(pPayload, SX_ARCHIVE_NUMBER_SIZE));
+        case SXArchiveRecordString:
+            return SXString::newWithCharacters(pPayload, static_cast<size_t>(record.length));
+        case SXArchiveRecordData: {
+            SXData* pData = new SXData();
+            pData->appendBytes(pPayload, static_cast<size_t>(record.length));
+            return pData;
+        }
+        case SXArchiveRecordArray: {
+            if (!copy) {
+                return new SXArchivedArray(this, offset, record.payloadOffset, width, count);
+            }
+            
+            // Copies read the slots straight from the record, without going through views.
+            SXArray* pArray = new SXArray();
+            pArray->initWithCapacity(count);
+            for (unsigned int i = 0; i < count; i++) {
+                SXObject* pTmpObject = createObjectForSlot(pPayload + i * width, width, offset, depth + 1, true);
+                if (!pTmpObject) {
+                    pArray->release();
+                    return nullptr;
+                }
+                pArray->addObject(pTmpObject);
+                pTmpObject->release();
+            }
+            return pArray;
+        }
+        case SXArchiveRecordDictionary: {
+            if (!copy) {
+                return new SXArchivedDictionary(this, offset, record.payloadOffset, width, count);
+            }
+            
+            SXDictionary* pDictionary = new SXDictionary();
+            pDictionary->reserve(count);
+            for (unsigned int i = 0; i < count; i++) {
+                std::string_view key;
+                SXObject* pTmpObject = nullptr;
+                if (stringForSlot(pPayload + i * 2 * width, width, offset, key)) {
+                    pTmpObject = createObjectForSlot(pPayload + (i * 2 + 1) * width, width, offset, depth + 1, true);
+                }
+                if (!pTmpObject) {
+                    pDictionary->release();
+                    return nullptr;
+                }
+                pDictionary->setObject(pTmpObject, key);
+                pTmpObject->release();
+            }
+            return pDictionary;
+        }
+        default:
+            return nullptr;
+    }
+}
+
+SXArchivedArray::SXArchivedArray(SXArchive* pArchive, uint64_t offset, uint64_t slotsOffset, unsigned int slotWidth, unsigned int count)
+    : m_pArchive(pArchive), m_offset(offset), m_slotsOffset(slotsOffset), m_slotWidth(slotWidth), m_count(count)
+{
+    m_pArchive->retain();
+}
+
+SXArchivedArray::~SXArchivedArray()
+{
+    if (m_pObjects) {
+        for (SXObject* pObject: *m_pObjects) {
+            if (pObject) {
+                pObject->release();
+            }
+        }
+        delete m_pObjects;
+        m_pObjects = nullptr;
+    }
+    m_pArchive->release();
+}
+
+SXObject* SXArchivedArray::operator[](unsigned int index) const
+{
+    return objectAtIndex(index);
+}
+
+unsigned int SXArchivedArray::count() const
+{
+    return m_count;
+}
+
+SXObject* SXArchivedArray::objectAtIndex(unsigned int index) const
+{
+    if (index >= m_count) {
+        return nullptr;
+    }
+    
+    if (!m_pObjects) {
+        m_pObjects = new std::vector<SXObject*>(m_count, nullptr);
+    }
+    
+    SXObject*& rObject = (*m_pObjects)[index];
+    if (!rObject) {
+        const char* pSlot = m_pArchive->m_pBytes + m_slotsOffset + static_cast<uint64_t>(index) * m_slotWidth;
+        rObject = m_pArchive->createObjectForSlot(pSlot, m_slotWidth, m_offset, 0, false);
+    }
+    return rObject;
+}
+
+SXObject* SXArchivedArray::copy() const
+{
+    return m_pArchive->createObjectAtOffset(m_offset, m_pArchive->m_recordsEnd, 0, true);
+}
+
+SXArchivedDictionary::SXArchivedDictionary(SXArchive* pArchive, uint64_t offset, uint64_t slotsOffset, unsigned int slotWidth, unsigned int count)
+    : m_pArchive(pArchive), m_offset(offset), m_slotsOffset(slotsOffset), m_slotWidth(slotWidth), m_count(count)
+{
+    m_pArchive->retain();
+}
+
+SXArchivedDictionary::~SXArchivedDictionary()
+{
+    if (m_pObjects) {
+        for (SXObject* pObject: *m_pObjects) {
+            if (pObject) {
+                pObject->release();
+            }
+        }
+        delete m_pObjects;
+        m_pObjects = nullptr;
+    }
+    m_pArchive->release();
+}
+
+SXObject* SXArchivedDictionary::operator[](std::string_view key) const
+{
+    return objectForKey(key);
+}
+
+unsigned int SXArchivedDictionary::count() const
+{
+    return m_count;
+}
+
+SXArray* SXArchivedDictionary::allKeys() const
+{
+    SXArray* pKeys = SXArray::createWithCapacity(m_count);
+    for (unsigned int i = 0; i < m_count; i++) {
+        std::string_view key = keyAtIndex(i);
+        SXString* pKey = SXString::newWithCharacters(key.data(), key.length());
+        pKeys->addObject(pKey);
+        pKey->release();
+    }
+    return pKeys;
+}
+
+SXObject* SXArchivedDictionary::objectForKey(std::string_view key) const
+{
+    // Binary search over the sorted keys, compared in place.
+    unsigned int low = 0;
+    unsigned int high = m_count;
+    while (low < high) {
+        unsigned int middle = low + (high - low) / 2;
+        int comparison = keyAtIndex(middle).compare(key);
+        if (comparison == 0) {
+            return objectAtIndex(middle);
+        }
+        if (comparison < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return nullptr;
+}
+
+std::string_view SXArchivedDictionary::keyAtIndex(unsigned int index) const
+{
+    std::string_view key;
+    if (index < m_count) {
+        const char* pSlot = m_pArchive->m_pBytes + m_slotsOffset + static_cast<uint64_t>(index) * 2 * m_slotWidth;
+        m_pArchive->stringForSlot(pSlot, m_slotWidth, m_offset, key);
+    }
+    return key;
+}
+
+SXObject* SXArchivedDictionary::objectAtIndex(unsigned int index) const
+{
+    if (index >= m_count) {
+        return nullptr;
+    }
+    
+    if (!m_pObjects) {
+        m_pObjects = new std::vector<SXObject*>(m_count, nullptr);
+    }
+    
+    SXObject*& rObject = (*m_pObjects)[index];
+    if (!rObject) {
+        const char* pSlot = m_pArchive->m_pBytes + m_slotsOffset + (static_cast<uint64_t>(index) * 2 + 1) * m_slotWidth;
+        rObject = m_pArchive->createObjectForSlot(pSlot, m_slotWidth, m_offset, 0, false);
+    }
+    return rObject;
+}
+
+SXObject* SXArchivedDictionary::copy() const
+{
+    return m_pArchive->createObjectAtOffset(m_offset, m_pArchive->m_recordsEnd, 0, true);
+}
+
+}
@@ -0,0 +1,347 @@
+/**
+ * @file SXArchive.hpp
+ * @brief Declaration of the SXArchive, SXArchivedArray and SXArchivedDictionary classes.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SXArchive_hpp
+#define SXArchive_hpp
+
+#include "SXObject.hpp"
+#include "SXArray.hpp"
+#include "SXData.hpp"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace spalx {
+
+struct SXArchiveRecord;
+
+// Version of the archive format written by SXArchive.
+#define SX_ARCHIVE_VERSION 2
+
+// Maximum nesting of containers accepted when archiving, which also stops cyclic graphs.
+#define SX_ARCHIVE_MAX_DEPTH 1024
+
+// Size from which SXArchive::createWithContentsOfFile() may map a read-only file instead of reading it. Below it, copying costs little next to the risk of depending on the file.
+#define SX_ARCHIVE_MAP_MIN_LENGTH 1048576
+
+/**
+ * @class SXArchive
+ * @brief Read-only binary archive of an object graph, loaded without parsing.
+ * @details The format is versioned, position-independent and compact, similar to binary plists. Containers hold a 4 or 8-byte slot per child: null, booleans, integers of up to 56 bits, floating-point numbers that are exact as float and strings of up to 7 bytes are stored in the slot itself, and other objects in a record the slot refers to. Containers whose children all fit in 3 bytes use 4-byte slots. Records are unaligned, their lengths are variable-width, and identical records (strings, numbers, data, even whole containers) are written once. Dictionaries store their entries sorted by key. Large read-only files are mapped into memory (mmap), other files are read with a single read into an exactly sized buffer.
+ *
+ * Nothing is decoded when the archive is opened. rootObject() returns a view, and views decode a child only the first time it is accessed. Strings, data and numbers become regular objects, while arrays and dictionaries become SXArchivedArray and SXArchivedDictionary views. Calling copy() on a view builds a regular, mutable SXArray or SXDictionary graph.
+ *
+ * Archives are little-endian and read the same on every machine. Offsets are checked against the archive bounds on each access, and a child always precedes its parent, so a damaged archive cannot make a view read outside the archive or loop. Its objects come back as nullptr.
+ */
+class SXArchive : public SXObject
+{
+public:
+    /**
+     * @brief Destructor.
+     * @details Unmaps the file, or releases the buffer or data object holding the archive.
+     */
+    ~SXArchive();
+    
+    /**
+     * @brief Open an archive file.
+     * @details Regular files of at least SX_ARCHIVE_MAP_MIN_LENGTH bytes that nobody has write permission on are memory mapped, and views read the mapping. Such a file must not be modified or truncated while the archive or any of its views exists: they would see the changes, and reading past the new end of the file raises SIGBUS. Other files, which may change, are read into memory.
+     * @param pFilePath The path of the file written by writeRootObject().
+     * @return The new archive object. nullptr if the file cannot be read or is not an archive of a supported version.
+     */
+    static SXArchive* createWithContentsOfFile(const char* pFilePath);
+    
+    /**
+     * @brief Open an archive held by a data object.
+     * @details The data object is retained, not copied, and must not be modified while the archive is in use.
+     * @param pData The bytes returned by archivedDataWithRootObject().
+     * @return The new archive object. nullptr if the bytes are not an archive of a supported version.
+     */
+    static SXArchive* createWithData(SXData* pData);
+    
+    /**
+     * @brief Archive an object graph into a new data object.
+     * @details Supported objects are SXString, SXData, all SXNumber types, SXNull, SXArray, the dictionary classes with string keys, and archive views. Every dictionary class is archived as a dictionary.
+     * @param pObject The root object.
+     * @return The data object, autoreleased. nullptr if the graph contains an unsupported object or is nested deeper than SX_ARCHIVE_MAX_DEPTH.
+     */
+    static SXData* archivedDataWithRootObject(const SXObject* pObject);
+    
+    /**
+     * @brief Archive an object graph into a file.
+     * @param pObject The root object.
+     * @param pFilePath The path of the file to write to.
+     * @return Whether the graph could be archived and the file written.
+     */
+    static bool writeRootObject(const SXObject* pObject, const char* pFilePath);
+    
+    /**
+     * @brief Get the root object.
+     * @details Each call decodes the root again, so keep the result rather than calling this repeatedly. The views keep the archive alive.
+     * @return The root object, autoreleased. nullptr if the root slot or record is damaged.
+     */
+    SXObject* rootObject();
+    
+    /**
+     * @brief Get the size of the archive.
+     * @return The number of bytes.
+     */
+    size_t length() const;
+    
+    /**
+     * @brief Check whether the archive file is memory mapped.
+     * @return Whether the bytes are mapped from the file, rather than read into memory.
+     */
+    bool isMapped() const;
+
+private:
+    friend class SXArchivedArray;
+    friend class SXArchivedDictionary;
+    
+    const char* m_pBytes{nullptr}; /**< First byte of the archive. */
+    size_t m_length{0}; /**< Number of bytes of the archive. */
+    size_t m_recordsEnd{0}; /**< Offset of the trailer, which starts with the root slot. */
+    bool m_mapped{false}; /**< Whether m_pBytes is a file mapping. */
+    std::vector<char>* m_pBuffer{nullptr}; /**< Buffer holding the file when it could not be mapped. */
+    SXData* m_pData{nullptr}; /**< Data object holding the archive, retained. */
+    
+    /**
+     * @brief Default constructor.
+     * @details Use createWithContentsOfFile() or createWithData().
+     */
+    SXArchive();
+    
+    /**
+     * @brief Check the header and the trailer.
+     * @return Whether the bytes are an archive of a supported version.
+     */
+    bool validate();
+    
+    /**
+     * @brief Read a variable-width length.
+     * @param rOffset The offset of the length, advanced past it.
+     * @param limit Offset the length must precede.
+     * @param rLength Receives the length.
+     * @return Whether the length is valid.
+     */
+    bool readLength(uint64_t& rOffset, uint64_t limit, uint64_t& rLength) const;
+    
+    /**
+     * @brief Read the fields of a record and check that it fits in the archive, before a given offset.
+     * @param offset The offset of the record.
+     * @param limit Offset the record must precede (the parent's offset).
+     * @param rRecord Receives the fields.
+     * @return Whether the record can be read.
+     */
+    bool recordAtOffset(uint64_t offset, uint64_t limit, SXArchiveRecord& rRecord) const;
+    
+    /**
+     * @brief Read the string of a slot without copying it.
+     * @param pSlot The slot, held inline or referring to a string record.
+     * @param width The size of the slot.
+     * @param limit Offset a referred record must precede.
+     * @param rString Receives a view of the characters.
+     * @return Whether the slot holds a valid string.
+     */
+    bool stringForSlot(const char* pSlot, unsigned int width, uint64_t limit, std::string_view& rString) const;
+    
+    /**
+     * @brief Decode the object of a slot.
+     * @param pSlot The slot.
+     * @param width The size of the slot.
+     * @param limit Offset a referred record must precede (the parent's offset).
+     * @param depth Nesting level of the slot, limited to SX_ARCHIVE_MAX_DEPTH.
+     * @param copy Whether containers are decoded with all the objects they contain, rather than as views.
+     * @return The object, with a reference count of 1. nullptr if the slot or a record is damaged.
+     */
+    SXObject* createObjectForSlot(const char* pSlot, unsigned int width, uint64_t limit, unsigned int depth, bool copy);
+    
+    /**
+     * @brief Decode the object of a record.
+     * @param offset The offset of the record.
+     * @param limit Offset the record must precede (the parent's offset).
+     * @param depth Nesting level of the record, limited to SX_ARCHIVE_MAX_DEPTH.
+     * @param copy Whether containers are decoded with all the objects they contain, into regular containers, rather than as views.
+     * @return The object, with a reference count of 1. nullptr if a record is damaged.
+     */
+    SXObject* createObjectAtOffset(uint64_t offset, uint64_t limit, unsigned int depth, bool copy);
+};
+
+/**
+ * @class SXArchivedArray
+ * @brief Read-only view of an array in an archive.
+ * @details Elements are decoded on first access and kept. The view retains its archive.
+ */
+class SXArchivedArray : public SXObject
+{
+public:
+    /**
+     * @brief Destructor.
+     * @details Releases the decoded elements and the archive.
+     */
+    ~SXArchivedArray();
+    
+    /**
+     * @brief Overloaded subscript operator to access elements by index.
+     * @param index The index of the element to access.
+     * @return The element. nullptr if the index is out of bounds or the record is damaged.
+     */
+    SXObject* operator[](unsigned int index) const;
+    
+    /**
+     * @brief Get the number of elements in the array.
+     * @return The number of elements.
+     */
+    unsigned int count() const;
+    
+    /**
+     * @brief Get the object at a specific index.
+     * @details The element is decoded the first time it is accessed.
+     * @param index The index of the element.
+     * @return The element, owned by the view. nullptr if the index is out of bounds or the record is damaged.
+     */
+    SXObject* objectAtIndex(unsigned int index) const;
+    
+    /**
+     * @brief Build a regular array with the contents of the view.
+     * @details Nested views are turned into SXArray and SXDictionary objects too.
+     * @return The new array. nullptr if a record is damaged.
+     */
+    virtual SXObject* copy() const override;
+
+private:
+    friend class SXArchive;
+    
+    SXArchive* m_pArchive; /**< The archive, retained. */
+    uint64_t m_offset; /**< Offset of the array record. */
+    uint64_t m_slotsOffset; /**< Offset of the slots of the elements. */
+    unsigned int m_slotWidth; /**< Size of a slot. */
+    unsigned int m_count; /**< Number of elements. */
+    mutable std::vector<SXObject*>* m_pObjects{nullptr}; /**< Decoded elements, allocated on first access. */
+    
+    /**
+     * @brief Constructor.
+     * @details Views are created by SXArchive.
+     */
+    SXArchivedArray(SXArchive* pArchive, uint64_t offset, uint64_t slotsOffset, unsigned int slotWidth, unsigned int count);
+};
+
+/**
+ * @class SXArchivedDictionary
+ * @brief Read-only view of a dictionary in an archive.
+ * @details Lookups are a binary search over the keys, which are compared in place without being copied. Objects are decoded on first access and kept. The view retains its archive.
+ */
+class SXArchivedDictionary : public SXObject
+{
+public:
+    /**
+     * @brief Destructor.
+     * @details Releases the decoded objects and the archive.
+     */
+    ~SXArchivedDictionary();
+    
+    /**
+     * @brief Overloaded subscript operator to access elements by key.
+     * @param key The key of the element to access.
+     * @return The object for the specified key. nullptr if the key is not in the dictionary.
+     */
+    SXObject* operator[](std::string_view key) const;
+    
+    /**
+     * @brief Get the number of elements in the dictionary.
+     * @return The number of elements.
+     */
+    unsigned int count() const;
+    
+    /**
+     * @brief Get all the keys from the dictionary.
+     * @return Array of strings (the keys), in ascending order.
+     */
+    SXArray* allKeys() const;
+    
+    /**
+     * @brief Get the object with the specific key.
+     * @param key The key of the object to retrieve.
+     * @return The object, owned by the view. nullptr if the key is not in the dictionary.
+     */
+    SXObject* objectForKey(std::string_view key) const;
+    
+    /**
+     * @brief Get the key of an entry.
+     * @param index The entry, less than count(). Entries are sorted by key.
+     * @return A view of the key characters in the archive. Empty if the record is damaged.
+     */
+    std::string_view keyAtIndex(unsigned int index) const;
+    
+    /**
+     * @brief Get the object of an entry.
+     * @param index The entry, less than count(). Entries are sorted by key.
+     * @return The object, owned by the view. nullptr if the record is damaged.
+     */
+    SXObject* objectAtIndex(unsigned int index) const;
+    
+    /**
+     * @brief Call a function for each entry of the dictionary, in ascending key order.
+     * @details The keys are views of the archive, nothing is copied. Objects are decoded as they are visited.
+     * @param function Callable invoked as function(std::string_view key, SXObject* pObject, bool& rStop). Set rStop to true to stop the enumeration.
+     */
+    template <typename Function>
+    void enumerateKeysAndObjects(Function&& function) const
+    {
+        bool stop = false;
+        for (unsigned int i = 0; i < m_count; i++) {
+            function(keyAtIndex(i), objectAtIndex(i), stop);
+            if (stop) {
+                return;
+            }
+        }
+    }
+    
+    /**
+     * @brief Build a regular dictionary with the contents of the view.
+     * @details Nested views are turned into SXArray and SXDictionary objects too.
+     * @return The new dictionary. nullptr if a record is damaged.
+     */
+    virtual SXObject* copy() const override;
+
+private:
+    friend class SXArchive;
+    
+    SXArchive* m_pArchive; /**< The archive, retained. */
+    uint64_t m_offset; /**< Offset of the dictionary record. */
+    uint64_t m_slotsOffset; /**< Offset of the slots of the entries, a key slot followed by an object slot. */
+    unsigned int m_slotWidth; /**< Size of a slot. */
+    unsigned int m_count; /**< Number of entries. */
+    mutable std::vector<SXObject*>* m_pObjects{nullptr}; /**< Decoded objects, allocated on first access. */
+    
+    /**
+     * @brief Constructor.
+     * @details Views are created by SXArchive.
+     */
+    SXArchivedDictionary(SXArchive* pArchive, uint64_t offset, uint64_t slotsOffset, unsigned int slotWidth, unsigned int count);
+};
+
+} // namespace spalx
+
+#endif // SXArchive_hpp
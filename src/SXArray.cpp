@@ -25,6 +25,7 @@
 
 #include "SXArray.hpp"
 #include "SXString.hpp"
+#include <climits>
 #include <fstream>
 #include <string>
 
@@ -38,6 +39,7 @@ SXArray::SXArray()
 
 SXArray::~SXArray()
 {
+    m_immutable = false; // An immutable array still releases its objects.
     removeAllObjects();
     
     if (m_pArray) {
@@ -54,7 +56,7 @@ SXArray* SXArray::create()
 SXArray* SXArray::createWithCapacity(unsigned int capacity)
 {
     SXArray* pArray = new SXArray();
-
+    
     if (pArray) {
         if (pArray->initWithCapacity(capacity)) {
             pArray->autorelease();
@@ -63,14 +65,14 @@ SXArray* SXArray::createWithCapacity(unsigned int capacity)
             pArray = nullptr;
         }
     }
-        
+    
     return pArray;
 }
 
 SXArray* SXArray::createWithArray(SXArray* pOtherArray)
 {
     SXArray* pArray = static_cast<SXArray*>(pOtherArray->copy());
-
+    
     if (pArray) {
         pArray->autorelease();
     }
@@ -157,11 +159,15 @@ bool SXArray::containsObject(SXObject* pObject) const
 
 void SXArray::addObject(SXObject* pObject)
 {
+    if (!checkMutable()) {
+        return;
+    }
+    
     if (pObject) {
         if (m_count == m_capacity) {
             resizeArray(m_capacity + SX_ARRAY_DEFAULT_CAPACITY_INCREMENT);
         }
-
+        
         pObject->retain();
         m_pArray[m_count++] = pObject;
     }
@@ -176,6 +182,10 @@ void SXArray::addObjectsFromArray(SXArray* pOtherArray)
 
 void SXArray::insertObject(SXObject* pObject, unsigned int index)
 {
+    if (!checkMutable()) {
+        return;
+    }
+    
     if (index > m_count) {
         return;
     }
@@ -196,6 +206,10 @@ void SXArray::insertObject(SXObject* pObject, unsigned int index)
 
 void SXArray::removeObject(SXObject* pObject)
 {
+    if (!checkMutable()) {
+        return;
+    }
+    
     unsigned int index = indexOfObject(pObject);
     if (index != UINT_MAX) {
         pObject->release();
@@ -207,6 +221,10 @@ void SXArray::removeObject(SXObject* pObject)
 
 void SXArray::removeObjectAtIndex(unsigned int index)
 {
+    if (!checkMutable()) {
+        return;
+    }
+    
     if (index < m_count) {
         SXObject* pObject = m_pArray[index];
         pObject->release();
@@ -218,6 +236,10 @@ void SXArray::removeObjectAtIndex(unsigned int index)
 
 void SXArray::removeLastObject()
 {
+    if (!checkMutable()) {
+        return;
+    }
+    
     if (m_count > 0) {
         SXObject* pObject = m_pArray[m_count - 1];
         pObject->release();
@@ -235,6 +257,10 @@ void SXArray::removeObjectsInArray(SXArray* pOtherArray)
 
 void SXArray::removeAllObjects()
 {
+    if (!checkMutable()) {
+        return;
+    }
+    
     for (unsigned int i = 0; i < m_count; i++) {
         SXObject* pObject = m_pArray[i];
         if (pObject) {
@@ -247,13 +273,24 @@ void SXArray::removeAllObjects()
 
 bool SXArray::isEqual(const SXObject* pObject) const
 {
+    if (pObject == this) {
+        return true;
+    }
+    
     const SXArray* pOtherArray = dynamic_cast<const SXArray*>(pObject);
     if (!pOtherArray || pOtherArray->count() != m_count) {
         return false;
     }
     
+    // Cached hashes of immutable arrays reject most unequal arrays without visiting the elements.
+    if (m_immutable && pOtherArray->m_immutable && m_hash != pOtherArray->m_hash) {
+        return false;
+    }
+    
     for (unsigned int i = 0; i < m_count; i++) {
-        if (!(*this)[i]->isEqual((*pOtherArray)[i])) {
+        SXObject* pElement = m_pArray[i];
+        SXObject* pOtherElement = pOtherArray->m_pArray[i];
+        if (pElement != pOtherElement && !pElement->isEqual(pOtherElement)) {
             return false;
         }
     }
@@ -261,6 +298,32 @@ bool SXArray::isEqual(const SXObject* pObject) const
     return true;
 }
 
+size_t SXArray::hash() const
+{
+    if (m_immutable) {
+        return m_hash;
+    }
+    
+    size_t hash = m_count;
+    for (unsigned int i = 0; i < m_count; i++) {
+        hash = hash * 31 + m_pArray[i]->hash();
+    }
+    return hash;
+}
+
+void SXArray::makeImmutable()
+{
+    if (m_immutable) {
+        return;
+    }
+    
+    for (unsigned int i = 0; i < m_count; i++) {
+        m_pArray[i]->makeImmutable();
+    }
+    m_hash = hash();
+    m_immutable = true;
+}
+
 SXObject* SXArray::copy() const
 {
     SXArray* pArray = new SXArray();
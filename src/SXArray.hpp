@@ -199,22 +199,36 @@ public:
     
     /**
      * @brief Compare array with another array.
-     * @details All objects at each index of both arrays are compared (by calling isEqual()) against each other.
+     * @details All objects at each index of both arrays are compared (by calling isEqual()) against each other. When both arrays are immutable, arrays with different hashes are rejected without comparing any element.
      * @return Whether the elements of both arrays are equal.
      */
     virtual bool isEqual(const SXObject* pObject) const override;
     
+    /**
+     * @brief Get a hash value for the array.
+     * @details Combines the hash of each element in order, so arrays that are equal according to isEqual() have the same hash. The hash of an immutable array is computed once.
+     * @return The hash value.
+     */
+    virtual size_t hash() const override;
+    
+    /**
+     * @brief Make the array and all its elements immutable.
+     * @details Afterwards the methods that add or remove objects do nothing.
+     */
+    virtual void makeImmutable() override;
+    
     /**
      * @brief Perform a deep copy of the array.
      * @details Create a new array by copying (copy() is called) each element inside the array.
      * @return The new copied array.
      */
     virtual SXObject* copy() const override;
-    
+
 private:
     unsigned int m_capacity{SX_ARRAY_DEFAULT_CAPACITY_INCREMENT}; /**< Capacity of the array. */
     unsigned int m_count{0}; /**< Number of objects in the array. */
     SXObject** m_pArray{nullptr}; /**< A pointer to the array of pointers of the objects in the array. */
+    size_t m_hash{0}; /**< Hash cached by makeImmutable(). */
     
     /**
      * @brief Resize array to the new capacity.
@@ -0,0 +1,150 @@
+/**
+ * @file SXAtom.hpp
+ * @brief Implementation of the SXAtom class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SXAtom.hpp"
+#include "SXHashTable.hpp"
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+
+namespace spalx {
+
+/**
+ * @class SXAtomTable
+ * @brief The global interning table.
+ * @details Lookups of strings that are already interned only take a shared lock, so concurrent readers do not block each other.
+ */
+class SXAtomTable
+{
+public:
+    typedef SXAtom::SXAtomEntry SXAtomEntry;
+    
+    static SXAtomTable* sharedTable()
+    {
+        // Never deleted, so atoms stay valid during static destruction.
+        static SXAtomTable* pInstance = new SXAtomTable();
+        return pInstance;
+    }
+    
+    SXAtom find(std::string_view string, size_t hash)
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_entries.find(string, hash);
+        return SXAtom((it != m_entries.end()) ? *it : nullptr);
+    }
+    
+    SXAtom intern(std::string_view string)
+    {
+        size_t hash = SXHashString(string);
+        
+        SXAtom atom = find(string, hash);
+        if (!atom.isNull()) {
+            return atom;
+        }
+        
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        
+        // Another thread may have interned the string while the lock was released.
+        auto it = m_entries.find(string, hash);
+        if (it != m_entries.end()) {
+            return SXAtom(*it);
+        }
+        
+        SXAtomEntry* pEntry = static_cast<SXAtomEntry*>(::operator new(sizeof(SXAtomEntry) + string.length()));
+        pEntry->hash = hash;
+        pEntry->length = static_cast<unsigned long>(string.length());
+        memcpy(pEntry->string, string.data(), string.length());
+        pEntry->string[string.length()] = '\0';
+        
+        m_entries.emplaceUnique(hash, pEntry);
+        return SXAtom(pEntry);
+    }
+
+private:
+    struct SXAtomEntryHash
+    {
+        size_t operator()(const SXAtomEntry* pEntry) const { return pEntry->hash; }
+        size_t operator()(std::string_view string) const { return SXHashString(string); }
+    };
+    
+    struct SXAtomEntryEqual
+    {
+        bool operator()(const SXAtomEntry* pEntry, std::string_view string) const
+        {
+            return std::string_view(pEntry->string, pEntry->length) == string;
+        }
+    };
+    
+    SXHashTable<const SXAtomEntry*, void, SXAtomEntryHash, SXAtomEntryEqual> m_entries; /**< All interned entries. */
+    std::shared_mutex m_mutex; /**< Guards m_entries. */
+};
+
+SXAtom::SXAtom()
+:m_pEntry(nullptr)
+{
+}
+
+SXAtom::SXAtom(const SXAtomEntry* pEntry)
+:m_pEntry(pEntry)
+{
+}
+
+SXAtom SXAtom::intern(std::string_view string)
+{
+    return SXAtomTable::sharedTable()->intern(string);
+}
+
+SXAtom SXAtom::existingAtom(std::string_view string)
+{
+    return SXAtomTable::sharedTable()->find(string, SXHashString(string));
+}
+
+bool SXAtom::isNull() const
+{
+    return m_pEntry == nullptr;
+}
+
+const char* SXAtom::getCString() const
+{
+    return m_pEntry ? m_pEntry->string : "";
+}
+
+unsigned long SXAtom::length() const
+{
+    return m_pEntry ? m_pEntry->length : 0;
+}
+
+size_t SXAtom::hash() const
+{
+    return m_pEntry ? m_pEntry->hash : SXHashString(std::string_view());
+}
+
+std::string_view SXAtom::view() const
+{
+    return m_pEntry ? std::string_view(m_pEntry->string, m_pEntry->length) : std::string_view();
+}
+
+}
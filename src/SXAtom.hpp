@@ -0,0 +1,119 @@
+/**
+ * @file SXAtom.hpp
+ * @brief Declaration of the SXAtom class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SXAtom_hpp
+#define SXAtom_hpp
+
+#include "SXCommon.hpp"
+#include <string_view>
+
+namespace spalx {
+
+/**
+ * @class SXAtom
+ * @brief Handle to an interned string.
+ * @details Interning the same characters always returns the same handle, so two atoms are equal exactly when they point to the same entry, and comparing them is a pointer comparison. Each entry stores its hash, computed once with SXHashString(), so string-keyed collections can use an atom as a key without hashing it again. Interned strings live until the end of the program. The interning table is shared by all threads.
+ */
+class SXAtom
+{
+public:
+    /**
+     * @brief Default constructor.
+     * @details Creates a null atom, which is not equal to any interned string.
+     */
+    SXAtom();
+    
+    /**
+     * @brief Get the atom for a string, interning it if needed.
+     * @param string The characters to intern.
+     * @return The atom.
+     */
+    static SXAtom intern(std::string_view string);
+    
+    /**
+     * @brief Get the atom for a string only if it was already interned.
+     * @details Never grows the interning table, so it is safe to call with untrusted input.
+     * @param string The characters to look for.
+     * @return The atom. A null atom if the string was never interned.
+     */
+    static SXAtom existingAtom(std::string_view string);
+    
+    /**
+     * @brief Check whether this is the null atom.
+     * @return Whether the atom does not refer to any string.
+     */
+    bool isNull() const;
+    
+    /**
+     * @brief Get the C-style string value.
+     * @return The null-terminated characters. An empty string for the null atom.
+     */
+    const char* getCString() const;
+    
+    /**
+     * @brief Get length of the string.
+     * @return The length.
+     */
+    unsigned long length() const;
+    
+    /**
+     * @brief Get the precomputed hash of the string.
+     * @return The value SXHashString() returns for the string.
+     */
+    size_t hash() const;
+    
+    /**
+     * @brief Get a view of the interned characters.
+     * @return The string view.
+     */
+    std::string_view view() const;
+    
+    bool operator==(const SXAtom& rOther) const { return m_pEntry == rOther.m_pEntry; }
+    bool operator!=(const SXAtom& rOther) const { return m_pEntry != rOther.m_pEntry; }
+
+private:
+    /**
+     * @brief Interned string storage. The characters follow the header in the same allocation.
+     */
+    struct SXAtomEntry
+    {
+        size_t hash; /**< Hash of the characters. */
+        unsigned long length; /**< Number of characters, excluding the terminating null. */
+        char string[1]; /**< Null-terminated characters. */
+    };
+    
+    const SXAtomEntry* m_pEntry{nullptr}; /**< The interned entry. nullptr for the null atom. */
+    
+    /**
+     * @brief Private constructor used by the interning table.
+     */
+    explicit SXAtom(const SXAtomEntry* pEntry);
+    
+    friend class SXAtomTable;
+};
+
+} // namespace spalx
+
+#endif // SXAtom_hpp
@@ -0,0 +1,293 @@
+/**
+ * @file SXBloomFilter.hpp
+ * @brief Implementation of the SXBloomFilter class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SXBloomFilter.hpp"
+#include "SXCommon.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace spalx {
+
+static const char kBloomFilterMagic[8] = {'S', 'X', 'B', 'L', 'O', 'O', 'M', 'F'};
+
+static const uint32_t kBloomFilterByteOrderMark = 0x01020304; /**< Reads back as 0x04030201 on a machine of the other byte order. */
+
+/**
+ * @brief Header of the serialized form, followed by the blocks.
+ */
+struct SXBloomFilterHeader
+{
+    char magic[8]; /**< kBloomFilterMagic. */
+    uint32_t version; /**< SX_BLOOM_FILTER_VERSION. */
+    uint32_t byteOrderMark; /**< kBloomFilterByteOrderMark. */
+    uint32_t bitsPerHash; /**< Number of bits set for each hash. */
+    uint32_t hashWidth; /**< sizeof(size_t) of the build that added the hashes. */
+    uint64_t hashFingerprint; /**< hashFingerprint() of the build that added the hashes. */
+    uint64_t blockCount; /**< Number of blocks that follow. */
+    uint64_t capacity; /**< Number of members the filter is sized for. */
+    uint64_t count; /**< Number of hashes added. */
+    double falsePositiveRate; /**< Target false positive rate. */
+};
+
+/**
+ * @brief Fingerprint the hash functions of this build.
+ * @details Hashes of known strings and numbers, which differ between standard libraries and between 32-bit and 64-bit builds. A filter written by a build with other hash functions would answer false for its own members.
+ * @return The fingerprint.
+ */
+static uint64_t hashFingerprint()
+{
+    uint64_t fingerprint = SXHashMix64(SXHashString("SXBloomFilter"));
+    fingerprint = SXHashMix64(fingerprint ^ std::hash<long long>()(1234567890123LL));
+    fingerprint = SXHashMix64(fingerprint ^ std::hash<double>()(0.1));
+    return fingerprint;
+}
+
+// Largest number of bits set for each hash.
+#define SX_BLOOM_FILTER_MAX_BITS_PER_HASH 16
+
+/**
+ * @brief Visit the bits of a hash: the block, then each bit in the block.
+ * @details The hash is scrambled first, since some hashes (addresses, small integers) have few random bits. The high half picks the block, then 9-bit slices of further scrambled values pick the bits.
+ * @param visit Called as visit(size_t block, unsigned int word, uint64_t bit) for each bit. Returns false to stop.
+ * @return Whether every call returned true.
+ */
+template <typename Visit>
+static inline bool visitBits(size_t hash, size_t blockCount, unsigned int bitsPerHash, Visit visit)
+{
+    uint64_t mixed = SXHashMix64(hash);
+    size_t block = static_cast<size_t>(((mixed >> 32) * static_cast<uint64_t>(blockCount)) >> 32);
+    uint64_t bits = SXHashMix64(mixed ^ 0x9e3779b97f4a7c15ull);
+    for (unsigned int i = 0; i < bitsPerHash; i++) {
+        if (i > 0 && i % 7 == 0) {
+            bits = SXHashMix64(bits);
+        }
+        unsigned int bitIndex = static_cast<unsigned int>((bits >> ((i % 7) * 9)) & (SX_BLOOM_FILTER_BLOCK_BITS - 1));
+        if (!visit(block, bitIndex >> 6, 1ull << (bitIndex & 63))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+SXBloomFilter::SXBloomFilter(size_t capacity, double falsePositiveRate)
+:m_pBlocks(new std::vector<SXBloomFilterBlock>())
+{
+    configure(capacity, falsePositiveRate);
+}
+
+SXBloomFilter::~SXBloomFilter()
+{
+    delete m_pBlocks;
+    m_pBlocks = nullptr;
+}
+
+SXBloomFilter* SXBloomFilter::createWithCapacity(size_t capacity, double falsePositiveRate)
+{
+    SXBloomFilter* pFilter = new SXBloomFilter(capacity, falsePositiveRate);
+    
+    if (pFilter) {
+        pFilter->autorelease();
+    }
+    
+    return pFilter;
+}
+
+SXBloomFilter* SXBloomFilter::createWithData(const SXData* pData)
+{
+    if (!pData || pData->length() < sizeof(SXBloomFilterHeader)) {
+        return nullptr;
+    }
+    
+    SXBloomFilterHeader header;
+    memcpy(&header, pData->bytes(), sizeof(header));
+    if (memcmp(header.magic, kBloomFilterMagic, sizeof(kBloomFilterMagic)) != 0 || header.version != SX_BLOOM_FILTER_VERSION || header.byteOrderMark != kBloomFilterByteOrderMark || header.hashWidth != sizeof(size_t) || header.hashFingerprint != hashFingerprint()) {
+        return nullptr;
+    }
+    
+    if (header.bitsPerHash < 1 || header.bitsPerHash > SX_BLOOM_FILTER_MAX_BITS_PER_HASH || header.blockCount < 1 || header.blockCount > UINT32_MAX || header.blockCount != (pData->length() - sizeof(header)) / sizeof(SXBloomFilterBlock) || (pData->length() - sizeof(header)) % sizeof(SXBloomFilterBlock) != 0) {
+        return nullptr;
+    }
+    
+    SXBloomFilter* pFilter = new SXBloomFilter(0, header.falsePositiveRate);
+    pFilter->m_pBlocks->resize(static_cast<size_t>(header.blockCount));
+    memcpy(pFilter->m_pBlocks->data(), pData->bytes() + sizeof(header), static_cast<size_t>(header.blockCount) * sizeof(SXBloomFilterBlock));
+    pFilter->m_bitsPerHash = header.bitsPerHash;
+    pFilter->m_capacity = static_cast<size_t>(header.capacity);
+    pFilter->m_count = static_cast<size_t>(header.count);
+    pFilter->autorelease();
+    return pFilter;
+}
+
+void SXBloomFilter::addHash(size_t hash)
+{
+    SXBloomFilterBlock* pBlocks = m_pBlocks->data();
+    visitBits(hash, m_pBlocks->size(), m_bitsPerHash, [pBlocks](size_t block, unsigned int word, uint64_t bit) {
+        pBlocks[block].words[word] |= bit;
+        return true;
+    });
+    m_count++;
+}
+
+void SXBloomFilter::addObject(const SXObject* pObject)
+{
+    if (pObject) {
+        addHash(pObject->hash());
+    }
+}
+
+void SXBloomFilter::addKey(std::string_view key)
+{
+    addHash(SXHashString(key));
+}
+
+bool SXBloomFilter::mightContainHash(size_t hash) const
+{
+    const SXBloomFilterBlock* pBlocks = m_pBlocks->data();
+    return visitBits(hash, m_pBlocks->size(), m_bitsPerHash, [pBlocks](size_t block, unsigned int word, uint64_t bit) {
+        return (pBlocks[block].words[word] & bit) != 0;
+    });
+}
+
+bool SXBloomFilter::mightContainObject(const SXObject* pObject) const
+{
+    return pObject && mightContainHash(pObject->hash());
+}
+
+bool SXBloomFilter::mightContainKey(std::string_view key) const
+{
+    return mightContainHash(SXHashString(key));
+}
+
+void SXBloomFilter::resetWithCapacity(size_t capacity)
+{
+    configure(capacity, m_falsePositiveRate);
+}
+
+void SXBloomFilter::noteRemovedMembers(size_t count)
+{
+    m_removedCount += count;
+}
+
+bool SXBloomFilter::needsRebuild() const
+{
+    return m_removedCount * 2 > m_count || m_count > m_capacity;
+}
+
+size_t SXBloomFilter::count() const
+{
+    return m_count;
+}
+
+size_t SXBloomFilter::capacity() const
+{
+    return m_capacity;
+}
+
+double SXBloomFilter::falsePositiveRate() const
+{
+    return m_falsePositiveRate;
+}
+
+double SXBloomFilter::estimatedFalsePositiveRate() const
+{
+    // Probability that the bits of a hash are all set, with (1 - e^(-kn/m))^k where m is the number of bits.
+    double bits = static_cast<double>(m_pBlocks->size()) * SX_BLOOM_FILTER_BLOCK_BITS;
+    return std::pow(1.0 - std::exp(-static_cast<double>(m_bitsPerHash) * static_cast<double>(m_count) / bits), static_cast<double>(m_bitsPerHash));
+}
+
+size_t SXBloomFilter::length() const
+{
+    return m_pBlocks->size() * sizeof(SXBloomFilterBlock);
+}
+
+SXData* SXBloomFilter::data() const
+{
+    SXBloomFilterHeader header;
+    memcpy(header.magic, kBloomFilterMagic, sizeof(kBloomFilterMagic));
+    header.version = SX_BLOOM_FILTER_VERSION;
+    header.byteOrderMark = kBloomFilterByteOrderMark;
+    header.bitsPerHash = m_bitsPerHash;
+    header.hashWidth = sizeof(size_t);
+    header.hashFingerprint = hashFingerprint();
+    header.blockCount = m_pBlocks->size();
+    header.capacity = m_capacity;
+    header.count = m_count;
+    header.falsePositiveRate = m_falsePositiveRate;
+    
+    SXData* pData = SXData::create();
+    pData->reserve(sizeof(header) + length());
+    pData->appendBytes(&header, sizeof(header));
+    pData->appendBytes(m_pBlocks->data(), length());
+    return pData;
+}
+
+bool SXBloomFilter::isEqual(const SXObject* pObject) const
+{
+    if (pObject == this) {
+        return true;
+    }
+    
+    const SXBloomFilter* pOtherFilter = dynamic_cast<const SXBloomFilter*>(pObject);
+    return pOtherFilter && pOtherFilter->m_bitsPerHash == m_bitsPerHash && pOtherFilter->m_pBlocks->size() == m_pBlocks->size() && memcmp(pOtherFilter->m_pBlocks->data(), m_pBlocks->data(), length()) == 0;
+}
+
+size_t SXBloomFilter::hash() const
+{
+    size_t hash = m_pBlocks->size() * 31 + m_bitsPerHash;
+    for (const SXBloomFilterBlock& rBlock : *m_pBlocks) {
+        for (uint64_t word : rBlock.words) {
+            hash = hash * 31 + static_cast<size_t>(word);
+        }
+    }
+    return SXHashMix(hash);
+}
+
+SXObject* SXBloomFilter::copy() const
+{
+    SXBloomFilter* pFilter = new SXBloomFilter(0, m_falsePositiveRate);
+    *pFilter->m_pBlocks = *m_pBlocks;
+    pFilter->m_bitsPerHash = m_bitsPerHash;
+    pFilter->m_capacity = m_capacity;
+    pFilter->m_count = m_count;
+    pFilter->m_removedCount = m_removedCount;
+    return pFilter;
+}
+
+void SXBloomFilter::configure(size_t capacity, double falsePositiveRate)
+{
+    m_falsePositiveRate = std::min(std::max(falsePositiveRate, 1e-9), 0.5);
+    m_capacity = capacity;
+    
+    // A classic filter needs -ln(p) / ln(2)^2 bits per member, ln(2) times as many of them set for each member. Keeping a member's bits in one block makes some blocks fuller than others, which is compensated by 15% more bits.
+    double bitsPerMember = -std::log(m_falsePositiveRate) / (std::log(2.0) * std::log(2.0));
+    m_bitsPerHash = static_cast<unsigned int>(std::min(std::max(std::lround(bitsPerMember * std::log(2.0)), 1l), static_cast<long>(SX_BLOOM_FILTER_MAX_BITS_PER_HASH)));
+    double blockCount = std::ceil(static_cast<double>(std::max<size_t>(capacity, 1)) * bitsPerMember * 1.15 / SX_BLOOM_FILTER_BLOCK_BITS);
+    m_pBlocks->assign(static_cast<size_t>(std::min(blockCount, static_cast<double>(UINT32_MAX))), SXBloomFilterBlock{});
+    m_count = 0;
+    m_removedCount = 0;
+}
+
+}
@@ -0,0 +1,225 @@
+/**
+ * @file SXBloomFilter.hpp
+ * @brief Declaration of the SXBloomFilter class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SXBloomFilter_hpp
+#define SXBloomFilter_hpp
+
+#include "SXObject.hpp"
+#include "SXData.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace spalx {
+
+// Version of the serialized form written by SXBloomFilter::data().
+#define SX_BLOOM_FILTER_VERSION 2
+
+// Number of bits of a block. All the bits of a hash are in one block, the size of a cache line.
+#define SX_BLOOM_FILTER_BLOCK_BITS 512
+
+// Smallest number of members a filter attached to a collection is sized for.
+#define SX_BLOOM_FILTER_MIN_CAPACITY 1024
+
+/**
+ * @brief Block of a Bloom filter, aligned on a cache line.
+ */
+struct alignas(64) SXBloomFilterBlock
+{
+    uint64_t words[SX_BLOOM_FILTER_BLOCK_BITS / 64]; /**< Bits of the block. */
+};
+
+/**
+ * @class SXBloomFilter
+ * @brief Probabilistic set of hashes that answers "definitely not a member" or "maybe a member".
+ * @details A blocked Bloom filter: each hash selects one 64-byte block and sets a few bits in it, so a query reads a single cache line, whatever the number of bits per member. A query never answers false for a hash that was added; it answers true for a hash that was not added with about the false positive rate the filter was created with, as long as no more members than its capacity are added.
+ *
+ * Filters work on hashes, so a collection can feed the hashes it already has. Strings are hashed with SXHashString(), the hash SXString and the string-keyed dictionaries use, so a filter of dictionary keys can be queried with strings or string views. Members cannot be removed: collections with an attached filter count their removals and rebuild the filter once it holds too many stale members (see SXSet::enableBloomFilter() and SXDictionary::enableBloomFilter()).
+ *
+ * data() serializes the filter, for example to store it in an SXArchive. Hashes of strings and numbers depend on the standard library the program is built with and on the width of size_t, so the serialized form records a fingerprint of them, and createWithData() rejects filters written by a build that hashes differently: the filter must then be rebuilt from its members. Hashes of identity sets are addresses and must not be serialized.
+ */
+class SXBloomFilter : public SXObject
+{
+public:
+    /**
+     * @brief Constructor.
+     * @param capacity The number of members the filter is sized for.
+     * @param falsePositiveRate The rate of false positives once capacity members are added, between 0 and 1.
+     */
+    SXBloomFilter(size_t capacity, double falsePositiveRate);
+    
+    /**
+     * @brief Destructor.
+     */
+    ~SXBloomFilter();
+    
+    /**
+     * @brief Create a new empty filter.
+     * @param capacity The number of members the filter is sized for.
+     * @param falsePositiveRate The rate of false positives once capacity members are added, between 0 and 1. A rate of 0.01 takes about 10 bits per member.
+     * @return The new filter object, autoreleased.
+     */
+    static SXBloomFilter* createWithCapacity(size_t capacity, double falsePositiveRate);
+    
+    /**
+     * @brief Create a filter from its serialized form.
+     * @param pData The bytes returned by data().
+     * @return The new filter object, autoreleased. nullptr if the bytes are not a filter of a supported version, or were written by a build with other hash functions.
+     */
+    static SXBloomFilter* createWithData(const SXData* pData);
+    
+    /**
+     * @brief Add a hash to the filter.
+     * @param hash The hash of the member.
+     */
+    void addHash(size_t hash);
+    
+    /**
+     * @brief Add an object to the filter.
+     * @param pObject The object, added by its hash().
+     */
+    void addObject(const SXObject* pObject);
+    
+    /**
+     * @brief Add a string to the filter.
+     * @param key The string, added by its SXHashString() hash.
+     */
+    void addKey(std::string_view key);
+    
+    /**
+     * @brief Check whether a hash may have been added.
+     * @details Reads one block.
+     * @param hash The hash to look up.
+     * @return false if the hash was definitely not added, true if it may have been.
+     */
+    bool mightContainHash(size_t hash) const;
+    
+    /**
+     * @brief Check whether an object may have been added.
+     * @param pObject The object, looked up by its hash().
+     * @return false if the object was definitely not added, true if it may have been.
+     */
+    bool mightContainObject(const SXObject* pObject) const;
+    
+    /**
+     * @brief Check whether a string may have been added.
+     * @param key The string, looked up by its SXHashString() hash.
+     * @return false if the string was definitely not added, true if it may have been.
+     */
+    bool mightContainKey(std::string_view key) const;
+    
+    /**
+     * @brief Remove all members and size the filter for a new capacity, keeping its false positive rate.
+     * @param capacity The number of members the filter is sized for.
+     */
+    void resetWithCapacity(size_t capacity);
+    
+    /**
+     * @brief Count members removed from the collection the filter describes.
+     * @details Their bits stay set, so they are still reported as possible members until the filter is rebuilt.
+     * @param count The number of removed members.
+     */
+    void noteRemovedMembers(size_t count);
+    
+    /**
+     * @brief Check whether the filter should be rebuilt.
+     * @return Whether more members than the capacity were added, or more than half of them were removed, so that false positives are more frequent than intended.
+     */
+    bool needsRebuild() const;
+    
+    /**
+     * @brief Get the number of hashes added since the filter was created or reset.
+     * @return The number of additions.
+     */
+    size_t count() const;
+    
+    /**
+     * @brief Get the number of members the filter is sized for.
+     * @return The capacity.
+     */
+    size_t capacity() const;
+    
+    /**
+     * @brief Get the false positive rate the filter was created with.
+     * @return The rate, between 0 and 1.
+     */
+    double falsePositiveRate() const;
+    
+    /**
+     * @brief Estimate the current false positive rate from the number of additions.
+     * @return The rate, between 0 and 1.
+     */
+    double estimatedFalsePositiveRate() const;
+    
+    /**
+     * @brief Get the number of bytes of the bit array.
+     * @return The size of the blocks.
+     */
+    size_t length() const;
+    
+    /**
+     * @brief Serialize the filter.
+     * @details A header with the parameters, the byte order and a fingerprint of the hash functions, followed by the blocks.
+     * @return The data object, autoreleased.
+     */
+    SXData* data() const;
+    
+    /**
+     * @brief Compare with other object.
+     * @param pObject The object to compare with.
+     * @return Whether the object is a filter with the same parameters and bits.
+     */
+    virtual bool isEqual(const SXObject* pObject) const override;
+    
+    /**
+     * @brief Get a hash value of the bits.
+     * @return The hash value.
+     */
+    virtual size_t hash() const override;
+    
+    /**
+     * @brief Perform a deep copy of the filter.
+     * @return The new copied object.
+     */
+    virtual SXObject* copy() const override;
+
+private:
+    std::vector<SXBloomFilterBlock>* m_pBlocks; /**< Bit array, one cache line per block. */
+    unsigned int m_bitsPerHash{1}; /**< Number of bits set in a block for each hash. */
+    size_t m_capacity{0}; /**< Number of members the filter is sized for. */
+    double m_falsePositiveRate{0.01}; /**< Target false positive rate at capacity. */
+    size_t m_count{0}; /**< Number of hashes added. */
+    size_t m_removedCount{0}; /**< Number of members removed from the described collection since the filter was reset. */
+    
+    /**
+     * @brief Size the blocks and choose the number of bits per hash for the capacity and rate.
+     */
+    void configure(size_t capacity, double falsePositiveRate);
+};
+
+} // namespace spalx
+
+#endif // SXBloomFilter_hpp
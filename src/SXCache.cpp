@@ -0,0 +1,395 @@
+/**
+ * @file SXCache.hpp
+ * @brief Implementation of the SXCache class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SXCache.hpp"
+#include "SXDictionary.hpp"
+#include "SXHashTable.hpp"
+#include "SXNotificationCenter.hpp"
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace spalx {
+
+/**
+ * @brief Entry of a cache, linked into the recency list.
+ */
+struct SXCacheEntry
+{
+    template <typename... KeyArgs>
+    SXCacheEntry(SXObject* pObject, size_t cost, KeyArgs&&... keyArgs)
+    :key(std::forward<KeyArgs>(keyArgs)...), pObject(pObject), cost(cost)
+    {
+    }
+    
+    SXDictionaryKey key; /**< The key. */
+    SXObject* pObject; /**< The object, retained by the entry. */
+    size_t cost; /**< Cost given when the object was added. */
+    SXCacheEntry* pPrevious{nullptr}; /**< More recently used entry. */
+    SXCacheEntry* pNext{nullptr}; /**< Less recently used entry. */
+};
+
+/**
+ * @brief Hash functor of the cache table: entries are hashed by their key.
+ */
+struct SXCacheEntryHash
+{
+    size_t operator()(const SXCacheEntry* pEntry) const { return pEntry->key.hash(); }
+    size_t operator()(std::string_view key) const { return SXHashString(key); }
+    size_t operator()(SXAtom atom) const { return atom.hash(); }
+};
+
+/**
+ * @brief Key equality functor of the cache table.
+ */
+struct SXCacheEntryEqual
+{
+    bool operator()(const SXCacheEntry* pStoredEntry, const SXCacheEntry* pEntry) const
+    {
+        return pStoredEntry == pEntry;
+    }
+    
+    bool operator()(const SXCacheEntry* pStoredEntry, std::string_view key) const
+    {
+        return pStoredEntry->key.view() == key;
+    }
+    
+    bool operator()(const SXCacheEntry* pStoredEntry, SXAtom atom) const
+    {
+        // Two different atoms never hold the same characters.
+        return (pStoredEntry->key.atom() == atom) || (pStoredEntry->key.atom().isNull() && pStoredEntry->key.view() == atom.view());
+    }
+};
+
+/**
+ * @brief Entries of a cache: a set of entries indexed by key, and a list from most to least recently used.
+ */
+struct SXCacheStorage
+{
+    SXHashTable<SXCacheEntry*, void, SXCacheEntryHash, SXCacheEntryEqual> table; /**< All entries. */
+    SXCacheEntry* pHead{nullptr}; /**< Most recently used entry. */
+    SXCacheEntry* pTail{nullptr}; /**< Least recently used entry. */
+    
+    void unlink(SXCacheEntry* pEntry)
+    {
+        (pEntry->pPrevious ? pEntry->pPrevious->pNext : pHead) = pEntry->pNext;
+        (pEntry->pNext ? pEntry->pNext->pPrevious : pTail) = pEntry->pPrevious;
+        pEntry->pPrevious = nullptr;
+        pEntry->pNext = nullptr;
+    }
+    
+    void pushFront(SXCacheEntry* pEntry)
+    {
+        pEntry->pNext = pHead;
+        (pHead ? pHead->pPrevious : pTail) = pEntry;
+        pHead = pEntry;
+    }
+    
+    void moveToFront(SXCacheEntry* pEntry)
+    {
+        if (pEntry != pHead) {
+            unlink(pEntry);
+            pushFront(pEntry);
+        }
+    }
+};
+
+/**
+ * @brief Link from the memory pressure observer of a cache to the cache.
+ * @details A post on another thread may call the observer after the cache removed it from the notification center. The observer uses the cache under the mutex, and the destructor cuts the link under it, so the cache is never used once destroyed.
+ */
+struct SXCacheObserverLink
+{
+    std::mutex mutex; /**< Held while the cache is used by the observer. */
+    SXCache* pCache; /**< The cache. nullptr once it is being destroyed. */
+};
+
+SXCache::SXCache()
+:m_pStorage(new SXCacheStorage())
+{
+    // The observer owns the link, and does not retain the cache: the destructor removes the observer and cuts the link.
+    std::shared_ptr<SXCacheObserverLink> pLink = std::make_shared<SXCacheObserverLink>();
+    pLink->pCache = this;
+    m_pObserverLink = pLink.get();
+    m_pMemoryPressureObserver = new SXSelector<void(SXDictionary*)>([pLink](SXDictionary*) {
+        std::lock_guard<std::mutex> lock(pLink->mutex);
+        if (pLink->pCache) {
+            pLink->pCache->removeAllObjects();
+        }
+    });
+    SXNotificationCenter::defaultCenter()->addObserver(m_pMemoryPressureObserver, SX_MEMORY_PRESSURE_NOTIFICATION);
+}
+
+SXCache::~SXCache()
+{
+    SXNotificationCenter::defaultCenter()->removeObserver(m_pMemoryPressureObserver, SX_MEMORY_PRESSURE_NOTIFICATION);
+    {
+        std::lock_guard<std::mutex> lock(m_pObserverLink->mutex);
+        m_pObserverLink->pCache = nullptr;
+    }
+    m_pObserverLink = nullptr;
+    m_pMemoryPressureObserver->release();
+    m_pMemoryPressureObserver = nullptr;
+    
+    for (SXCacheEntry* pEntry = m_pStorage->pHead; pEntry;) {
+        SXCacheEntry* pNext = pEntry->pNext;
+        pEntry->pObject->release();
+        delete pEntry;
+        pEntry = pNext;
+    }
+    delete m_pStorage;
+    m_pStorage = nullptr;
+}
+
+SXCache* SXCache::create()
+{
+    SXCache* pCache = new SXCache();
+    
+    if (pCache) {
+        pCache->autorelease();
+    }
+    
+    return pCache;
+}
+
+SXCache* SXCache::createWithLimits(unsigned int countLimit, size_t totalCostLimit)
+{
+    SXCache* pCache = create();
+    
+    if (pCache) {
+        pCache->m_countLimit = countLimit;
+        pCache->m_totalCostLimit = totalCostLimit;
+    }
+    
+    return pCache;
+}
+
+unsigned int SXCache::countLimit() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_countLimit;
+}
+
+void SXCache::setCountLimit(unsigned int countLimit)
+{
+    std::vector<SXObject*> evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_countLimit = countLimit;
+        evictToLimits(evicted);
+    }
+    for (SXObject* pObject : evicted) {
+        pObject->release();
+    }
+}
+
+size_t SXCache::totalCostLimit() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_totalCostLimit;
+}
+
+void SXCache::setTotalCostLimit(size_t totalCostLimit)
+{
+    std::vector<SXObject*> evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_totalCostLimit = totalCostLimit;
+        evictToLimits(evicted);
+    }
+    for (SXObject* pObject : evicted) {
+        pObject->release();
+    }
+}
+
+unsigned int SXCache::count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<unsigned int>(m_pStorage->table.size());
+}
+
+size_t SXCache::totalCost() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_totalCost;
+}
+
+SXObject* SXCache::retainedObjectForKey(std::string_view key)
+{
+    return retainedObjectForLookupKey(key, SXHashString(key));
+}
+
+SXObject* SXCache::retainedObjectForKey(SXAtom atom)
+{
+    return retainedObjectForLookupKey(atom, atom.hash());
+}
+
+template <typename LookupKey>
+SXObject* SXCache::retainedObjectForLookupKey(const LookupKey& rKey, size_t hash)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_pStorage->table.find(rKey, hash);
+    if (it == m_pStorage->table.end()) {
+        m_missCount++;
+        return nullptr;
+    }
+    
+    m_hitCount++;
+    SXCacheEntry* pEntry = *it;
+    m_pStorage->moveToFront(pEntry);
+    pEntry->pObject->retain();
+    return pEntry->pObject;
+}
+
+void SXCache::setObject(SXObject* pObject, std::string_view key, size_t cost)
+{
+    setObjectForLookupKey(pObject, key, SXHashString(key), cost);
+}
+
+void SXCache::setObject(SXObject* pObject, SXAtom atom, size_t cost)
+{
+    setObjectForLookupKey(pObject, atom, atom.hash(), cost);
+}
+
+template <typename LookupKey>
+void SXCache::setObjectForLookupKey(SXObject* pObject, const LookupKey& rKey, size_t hash, size_t cost)
+{
+    if (!pObject) {
+        return;
+    }
+    
+    std::vector<SXObject*> evicted;
+    pObject->retain();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_pStorage->table.find(rKey, hash);
+        if (it != m_pStorage->table.end()) {
+            SXCacheEntry* pEntry = *it;
+            evicted.push_back(pEntry->pObject); // Released below, outside the lock.
+            pEntry->pObject = pObject;
+            m_totalCost = m_totalCost - pEntry->cost + cost;
+            pEntry->cost = cost;
+            m_pStorage->moveToFront(pEntry);
+        } else {
+            SXCacheEntry* pEntry;
+            if constexpr (std::is_same_v<LookupKey, SXAtom>) {
+                pEntry = new SXCacheEntry(pObject, cost, rKey);
+            } else {
+                pEntry = new SXCacheEntry(pObject, cost, rKey, hash);
+            }
+            m_pStorage->table.emplaceUnique(hash, pEntry);
+            m_pStorage->pushFront(pEntry);
+            m_totalCost += cost;
+        }
+        evictToLimits(evicted);
+    }
+    for (SXObject* pEvicted : evicted) {
+        pEvicted->release();
+    }
+}
+
+void SXCache::removeObjectForKey(std::string_view key)
+{
+    SXObject* pObject = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_pStorage->table.find(key, SXHashString(key));
+        if (it == m_pStorage->table.end()) {
+            return;
+        }
+        
+        SXCacheEntry* pEntry = *it;
+        m_pStorage->table.erase(it);
+        m_pStorage->unlink(pEntry);
+        m_totalCost -= pEntry->cost;
+        pObject = pEntry->pObject;
+        delete pEntry;
+    }
+    pObject->release();
+}
+
+void SXCache::removeAllObjects()
+{
+    std::vector<SXObject*> evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        evicted.reserve(m_pStorage->table.size());
+        for (SXCacheEntry* pEntry = m_pStorage->pHead; pEntry;) {
+            SXCacheEntry* pNext = pEntry->pNext;
+            evicted.push_back(pEntry->pObject);
+            delete pEntry;
+            pEntry = pNext;
+        }
+        m_pStorage->table.clear();
+        m_pStorage->pHead = nullptr;
+        m_pStorage->pTail = nullptr;
+        m_totalCost = 0;
+        m_evictionCount += evicted.size();
+    }
+    for (SXObject* pObject : evicted) {
+        pObject->release();
+    }
+}
+
+size_t SXCache::hitCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hitCount;
+}
+
+size_t SXCache::missCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_missCount;
+}
+
+size_t SXCache::evictionCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_evictionCount;
+}
+
+void SXCache::resetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hitCount = 0;
+    m_missCount = 0;
+    m_evictionCount = 0;
+}
+
+void SXCache::evictToLimits(std::vector<SXObject*>& rEvicted)
+{
+    while (m_pStorage->pTail && ((m_countLimit > 0 && m_pStorage->table.size() > m_countLimit) || (m_totalCostLimit > 0 && m_totalCost > m_totalCostLimit))) {
+        SXCacheEntry* pEntry = m_pStorage->pTail;
+        m_pStorage->table.erase(pEntry);
+        m_pStorage->unlink(pEntry);
+        m_totalCost -= pEntry->cost;
+        rEvicted.push_back(pEntry->pObject);
+        delete pEntry;
+        m_evictionCount++;
+    }
+}
+
+}
@@ -0,0 +1,223 @@
+/**
+ * @file SXCache.hpp
+ * @brief Declaration of the SXCache class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SXCache_hpp
+#define SXCache_hpp
+
+#include "SXObject.hpp"
+#include "SXAtom.hpp"
+#include "SXSelector.hpp"
+#include <cstddef>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace spalx {
+
+// Name of the notification telling caches to release their objects, posted on SXNotificationCenter::defaultCenter().
+#define SX_MEMORY_PRESSURE_NOTIFICATION "SXMemoryPressureNotification"
+
+class SXDictionary;
+struct SXCacheStorage;
+struct SXCacheObserverLink;
+
+/**
+ * @class SXCache
+ * @brief Thread-safe collection of key-value pairs that evicts its least recently used objects.
+ * @details Like a dictionary with string keys, but bounded by a count limit and a total cost limit (each object is given a cost when added). When a limit is exceeded, the least recently used objects are evicted until the cache fits again. Lookups and insertions are O(1): entries are kept in an intrusive list ordered by last use, indexed by a hash table. Evicted and replaced objects are released after the cache lock is dropped, so their destructors may use the cache.
+ *
+ * Every cache observes SX_MEMORY_PRESSURE_NOTIFICATION and removes all its objects when it is posted, on the posting thread. Caches can be created and destroyed on any thread while the notification is posted: the destructor waits for a removal started by a post on another thread to finish. Hits, misses and evictions are counted.
+ * @note Like SXConcurrentDictionary, lookups return retained objects, because another thread may evict an object as soon as the lock is released. The cache itself must be kept alive (retained) by every thread using it.
+ */
+class SXCache : public SXObject
+{
+public:
+    /**
+     * @brief Default constructor.
+     * @details The cache has no limits until setCountLimit() or setTotalCostLimit() is called.
+     */
+    SXCache();
+    
+    /**
+     * @brief Destructor.
+     * @details Stops observing SX_MEMORY_PRESSURE_NOTIFICATION, waiting for a removal in progress on another thread, and releases all objects.
+     */
+    ~SXCache();
+    
+    /**
+     * @brief Create a new cache.
+     * @return The new cache object, autoreleased.
+     */
+    static SXCache* create();
+    
+    /**
+     * @brief Create a new cache with limits.
+     * @param countLimit The maximum number of objects. 0 for no limit.
+     * @param totalCostLimit The maximum sum of the object costs. 0 for no limit.
+     * @return The new cache object, autoreleased.
+     */
+    static SXCache* createWithLimits(unsigned int countLimit, size_t totalCostLimit);
+    
+    /**
+     * @brief Get the maximum number of objects.
+     * @return The limit. 0 if there is no limit.
+     */
+    unsigned int countLimit() const;
+    
+    /**
+     * @brief Set the maximum number of objects.
+     * @details Objects are evicted right away if the cache holds more.
+     * @param countLimit The limit. 0 for no limit.
+     */
+    void setCountLimit(unsigned int countLimit);
+    
+    /**
+     * @brief Get the maximum sum of the object costs.
+     * @return The limit. 0 if there is no limit.
+     */
+    size_t totalCostLimit() const;
+    
+    /**
+     * @brief Set the maximum sum of the object costs.
+     * @details Objects are evicted right away if the cache costs more.
+     * @param totalCostLimit The limit. 0 for no limit.
+     */
+    void setTotalCostLimit(size_t totalCostLimit);
+    
+    /**
+     * @brief Get the number of objects in the cache.
+     * @return The number of objects.
+     */
+    unsigned int count() const;
+    
+    /**
+     * @brief Get the sum of the costs of the objects in the cache.
+     * @return The total cost.
+     */
+    size_t totalCost() const;
+    
+    /**
+     * @brief Get the object with the specific key.
+     * @details A hit makes the object the most recently used.
+     * @param key The key of the object to retrieve.
+     * @return The object, which the caller must release. nullptr if the key is not in the cache.
+     */
+    SXObject* retainedObjectForKey(std::string_view key);
+    
+    /**
+     * @brief Get the object with the specific key, given as an atom.
+     * @details A hit makes the object the most recently used.
+     * @param atom The key of the object to retrieve.
+     * @return The object, which the caller must release. nullptr if the key is not in the cache.
+     */
+    SXObject* retainedObjectForKey(SXAtom atom);
+    
+    /**
+     * @brief Add an object to the cache, or replace the object of a key.
+     * @details The object becomes the most recently used, then least recently used objects are evicted while a limit is exceeded. An object costing more than the total cost limit is evicted at once.
+     * @param pObject The object to add. nullptr does nothing.
+     * @param key The key of the object.
+     * @param cost The cost of the object, counted against the total cost limit.
+     */
+    void setObject(SXObject* pObject, std::string_view key, size_t cost = 0);
+    
+    /**
+     * @brief Add an object to the cache with an atom key, or replace the object of the key.
+     * @details The key keeps a reference to the atom's characters instead of copying them.
+     * @param pObject The object to add. nullptr does nothing.
+     * @param atom The key of the object.
+     * @param cost The cost of the object, counted against the total cost limit.
+     */
+    void setObject(SXObject* pObject, SXAtom atom, size_t cost = 0);
+    
+    /**
+     * @brief Remove the object with the specific key.
+     * @param key The key of the object to remove.
+     */
+    void removeObjectForKey(std::string_view key);
+    
+    /**
+     * @brief Remove all objects from the cache.
+     * @details Removed objects are counted as evictions.
+     */
+    void removeAllObjects();
+    
+    /**
+     * @brief Get the number of lookups that found their key.
+     * @return The number of hits.
+     */
+    size_t hitCount() const;
+    
+    /**
+     * @brief Get the number of lookups that did not find their key.
+     * @return The number of misses.
+     */
+    size_t missCount() const;
+    
+    /**
+     * @brief Get the number of objects evicted by the limits or by removeAllObjects().
+     * @return The number of evictions.
+     */
+    size_t evictionCount() const;
+    
+    /**
+     * @brief Set the hit, miss and eviction counts back to 0.
+     */
+    void resetStatistics();
+
+private:
+    mutable std::mutex m_mutex; /**< Protects every member below. */
+    SXCacheStorage* m_pStorage; /**< Hash table and recency list of the entries. */
+    unsigned int m_countLimit{0}; /**< Maximum number of objects, 0 for none. */
+    size_t m_totalCostLimit{0}; /**< Maximum total cost, 0 for none. */
+    size_t m_totalCost{0}; /**< Sum of the costs of the entries. */
+    size_t m_hitCount{0}; /**< Number of lookups that found their key. */
+    size_t m_missCount{0}; /**< Number of lookups that did not find their key. */
+    size_t m_evictionCount{0}; /**< Number of evicted objects. */
+    SXSelector<void(SXDictionary*)>* m_pMemoryPressureObserver; /**< Observer of SX_MEMORY_PRESSURE_NOTIFICATION. */
+    SXCacheObserverLink* m_pObserverLink; /**< Link from the observer to the cache, owned by the observer. */
+    
+    /**
+     * @brief Lookup shared by both retainedObjectForKey() overloads.
+     */
+    template <typename LookupKey>
+    SXObject* retainedObjectForLookupKey(const LookupKey& rKey, size_t hash);
+    
+    /**
+     * @brief Insertion shared by both setObject() overloads.
+     */
+    template <typename LookupKey>
+    void setObjectForLookupKey(SXObject* pObject, const LookupKey& rKey, size_t hash, size_t cost);
+    
+    /**
+     * @brief Unlink least recently used entries while a limit is exceeded.
+     * @details Must be called with the lock held. The objects of the unlinked entries are added to rEvicted, to be released once the lock is dropped.
+     */
+    void evictToLimits(std::vector<SXObject*>& rEvicted);
+};
+
+} // namespace spalx
+
+#endif // SXCache_hpp
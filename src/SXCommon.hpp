@@ -26,6 +26,11 @@
 #ifndef SXCommon_hpp
 #define SXCommon_hpp
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
 namespace spalx {
 
 // Maximum length for log messages.
@@ -38,6 +43,44 @@ namespace spalx {
  */
 void SXLog(const char* pFormat, ...);
 
+/**
+ * @brief Hash the characters of a string.
+ * @details All string-keyed collections and SXAtom use this function, so a hash computed once can be reused for lookups in any of them.
+ * @param string The characters to hash.
+ * @return The hash value.
+ */
+inline size_t SXHashString(std::string_view string)
+{
+    return std::hash<std::string_view>()(string);
+}
+
+/**
+ * @brief Scramble the bits of a 64-bit value (MurmurHash3 finalizer).
+ * @details The same on every target, whatever the width of size_t.
+ * @param value The value to scramble.
+ * @return The scrambled value.
+ */
+inline uint64_t SXHashMix64(uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdull;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ull;
+    value ^= value >> 33;
+    return value;
+}
+
+/**
+ * @brief Scramble the bits of a hash.
+ * @details Used to combine the hashes of unordered collections by addition, so that entries with close hashes do not cancel each other. Scrambles in 64 bits, then keeps the low bits when size_t is narrower.
+ * @param hash The hash to scramble.
+ * @return The scrambled hash.
+ */
+inline size_t SXHashMix(size_t hash)
+{
+    return static_cast<size_t>(SXHashMix64(static_cast<uint64_t>(hash)));
+}
+
 } // namespace spalx
 
 #endif // SXCommon_hpp
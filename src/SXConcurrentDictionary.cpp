@@ -0,0 +1,569 @@
+/**
+ * @file SXConcurrentDictionary.hpp
+ * @brief Implementation of the SXConcurrentDictionary class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SXConcurrentDictionary.hpp"
+#include "SXString.hpp"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace spalx {
+
+// Epoch of a thread that is not reading.
+#define SX_EPOCH_INACTIVE UINT64_MAX
+
+// Smallest number of buckets of a shard.
+#define SX_CONCURRENT_DICTIONARY_MIN_BUCKETS 8
+
+/**
+ * @brief Registration of a thread in the epoch scheme.
+ * @details Records are never freed: a thread that exits gives its record back for reuse by later threads. Each read section writes the record of its thread twice, so records are aligned on cache lines, for readers on different cores not to share one.
+ */
+struct alignas(64) SXEpochRecord
+{
+    std::atomic<uint64_t> epoch{SX_EPOCH_INACTIVE}; /**< Global epoch when the thread started reading, or SX_EPOCH_INACTIVE. */
+    std::atomic<bool> inUse{true}; /**< Whether a thread owns the record. */
+    SXEpochRecord* pNext{nullptr}; /**< Next record. */
+};
+
+static std::atomic<uint64_t> s_globalEpoch{0}; /**< Incremented each time memory is retired. */
+static std::atomic<SXEpochRecord*> s_pEpochRecords{nullptr}; /**< Records of all threads that ever read. */
+
+/**
+ * @brief The epoch record of the current thread and its read section nesting depth.
+ */
+class SXEpochThreadState
+{
+public:
+    SXEpochThreadState()
+    {
+        for (SXEpochRecord* pRecord = s_pEpochRecords.load(std::memory_order_acquire); pRecord; pRecord = pRecord->pNext) {
+            bool inUse = false;
+            if (pRecord->inUse.compare_exchange_strong(inUse, true)) {
+                m_pRecord = pRecord;
+                return;
+            }
+        }
+        
+        m_pRecord = new SXEpochRecord();
+        SXEpochRecord* pHead = s_pEpochRecords.load(std::memory_order_relaxed);
+        do {
+            m_pRecord->pNext = pHead;
+        } while (!s_pEpochRecords.compare_exchange_weak(pHead, m_pRecord, std::memory_order_release, std::memory_order_relaxed));
+    }
+    
+    ~SXEpochThreadState()
+    {
+        m_pRecord->inUse.store(false, std::memory_order_release);
+    }
+    
+    SXEpochRecord* m_pRecord; /**< Record owned by the thread. */
+    unsigned int m_depth{0}; /**< Number of nested read sections. */
+};
+
+static thread_local SXEpochThreadState t_epochState;
+
+/**
+ * @brief Read section: memory retired while the guard exists is not freed.
+ */
+class SXEpochGuard
+{
+public:
+    SXEpochGuard()
+    :m_rState(t_epochState)
+    {
+        if (m_rState.m_depth++ == 0) {
+            m_rState.m_pRecord->epoch.store(s_globalEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            // Publish the epoch before reading any shared pointer.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+    
+    ~SXEpochGuard()
+    {
+        if (--m_rState.m_depth == 0) {
+            m_rState.m_pRecord->epoch.store(SX_EPOCH_INACTIVE, std::memory_order_release);
+        }
+    }
+
+private:
+    SXEpochThreadState& m_rState;
+};
+
+/**
+ * @brief Get the oldest epoch in which a thread is reading.
+ * @details Memory retired with an epoch lower than this one cannot be seen by any reader.
+ */
+static uint64_t oldestActiveEpoch()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t oldest = SX_EPOCH_INACTIVE;
+    for (SXEpochRecord* pRecord = s_pEpochRecords.load(std::memory_order_acquire); pRecord; pRecord = pRecord->pNext) {
+        uint64_t epoch = pRecord->epoch.load(std::memory_order_seq_cst);
+        if (epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    return oldest;
+}
+
+/**
+ * @brief Entry of a bucket chain.
+ * @details Only the object and the link to the next node change after the node is published.
+ */
+struct SXConcurrentDictionaryNode
+{
+    template <typename... KeyArgs>
+    SXConcurrentDictionaryNode(SXObject* pObject, KeyArgs&&... keyArgs)
+    :key(std::forward<KeyArgs>(keyArgs)...), pObject(pObject), pNext(nullptr)
+    {
+    }
+    
+    SXDictionaryKey key; /**< The key. */
+    std::atomic<SXObject*> pObject; /**< The object, retained by the node. */
+    std::atomic<SXConcurrentDictionaryNode*> pNext; /**< Next node of the bucket. */
+};
+
+/**
+ * @brief Bucket array of a shard.
+ */
+struct SXConcurrentDictionaryTable
+{
+    explicit SXConcurrentDictionaryTable(size_t bucketCount)
+    :mask(bucketCount - 1), pBuckets(new std::atomic<SXConcurrentDictionaryNode*>[bucketCount])
+    {
+        for (size_t i = 0; i < bucketCount; i++) {
+            pBuckets[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+    
+    ~SXConcurrentDictionaryTable()
+    {
+        delete[] pBuckets;
+    }
+    
+    size_t mask; /**< Number of buckets minus 1 (power-of-two size). */
+    std::atomic<SXConcurrentDictionaryNode*>* pBuckets; /**< Heads of the chains. */
+};
+
+/**
+ * @brief Memory unlinked by a writer, waiting until no reader can see it.
+ */
+struct SXConcurrentDictionaryRetired
+{
+    uint64_t epoch; /**< Global epoch when the memory was retired. */
+    void (*pFunction)(void*); /**< Function freeing the memory. */
+    void* pPointer; /**< The memory. */
+};
+
+/**
+ * @brief Shard of a concurrent dictionary.
+ * @details Aligned to a cache line so writers of neighbouring shards do not share lines.
+ */
+struct alignas(64) SXConcurrentDictionaryShard
+{
+    std::mutex mutex; /**< Serializes the writers of the shard. */
+    std::atomic<SXConcurrentDictionaryTable*> pTable{nullptr}; /**< Current bucket array. */
+    std::atomic<unsigned int> count{0}; /**< Number of entries. */
+    std::vector<SXConcurrentDictionaryRetired> retired; /**< Memory waiting to be freed, by increasing epoch. Guarded by mutex. */
+};
+
+static void releaseObject(void* pPointer)
+{
+    static_cast<SXObject*>(pPointer)->release();
+}
+
+static void deleteNode(void* pPointer)
+{
+    SXConcurrentDictionaryNode* pNode = static_cast<SXConcurrentDictionaryNode*>(pPointer);
+    pNode->pObject.load(std::memory_order_relaxed)->release();
+    delete pNode;
+}
+
+static void deleteTable(void* pPointer)
+{
+    SXConcurrentDictionaryTable* pTable = static_cast<SXConcurrentDictionaryTable*>(pPointer);
+    for (size_t i = 0; i <= pTable->mask; i++) {
+        SXConcurrentDictionaryNode* pNode = pTable->pBuckets[i].load(std::memory_order_relaxed);
+        while (pNode) {
+            SXConcurrentDictionaryNode* pNext = pNode->pNext.load(std::memory_order_relaxed);
+            deleteNode(pNode);
+            pNode = pNext;
+        }
+    }
+    delete pTable;
+}
+
+/**
+ * @brief Queue memory to be freed once no reader can see it. The shard must be locked.
+ */
+static void retire(SXConcurrentDictionaryShard& rShard, void (*pFunction)(void*), void* pPointer)
+{
+    // Readers that start after the increment get a greater epoch, and can no longer reach the memory.
+    rShard.retired.push_back({s_globalEpoch.fetch_add(1, std::memory_order_seq_cst), pFunction, pPointer});
+}
+
+/**
+ * @brief Move the retired memory no reader can see out of a shard. The shard must be locked.
+ * @details The memory is freed by runRetired() after the shard is unlocked, because releasing an object may call back into the dictionary.
+ */
+static void collectReclaimable(SXConcurrentDictionaryShard& rShard, std::vector<SXConcurrentDictionaryRetired>& rReclaimable)
+{
+    if (rShard.retired.empty()) {
+        return;
+    }
+    
+    uint64_t oldest = oldestActiveEpoch();
+    size_t count = 0;
+    while (count < rShard.retired.size() && rShard.retired[count].epoch < oldest) {
+        count++;
+    }
+    if (count > 0) {
+        rReclaimable.assign(rShard.retired.begin(), rShard.retired.begin() + count);
+        rShard.retired.erase(rShard.retired.begin(), rShard.retired.begin() + count);
+    }
+}
+
+static void runRetired(const std::vector<SXConcurrentDictionaryRetired>& rRetired)
+{
+    for (const SXConcurrentDictionaryRetired& rEntry: rRetired) {
+        rEntry.pFunction(rEntry.pPointer);
+    }
+}
+
+/**
+ * @brief Find the node of a key in a bucket array.
+ * @param ppLink If not nullptr, receives the link pointing to the node.
+ * @return The node. nullptr if the key is not in the table.
+ */
+template <typename LookupKey>
+static SXConcurrentDictionaryNode* findNode(SXConcurrentDictionaryTable* pTable, const LookupKey& rKey, size_t hash, std::atomic<SXConcurrentDictionaryNode*>** ppLink = nullptr)
+{
+    std::atomic<SXConcurrentDictionaryNode*>* pLink = &pTable->pBuckets[hash & pTable->mask];
+    for (SXConcurrentDictionaryNode* pNode = pLink->load(std::memory_order_acquire); pNode; pNode = pLink->load(std::memory_order_acquire)) {
+        if (pNode->key.hash() == hash && SXDictionaryKeyEqual()(pNode->key, rKey)) {
+            if (ppLink) {
+                *ppLink = pLink;
+            }
+            return pNode;
+        }
+        pLink = &pNode->pNext;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Replace the bucket array of a shard with one twice as large. The shard must be locked.
+ * @details Readers may be walking the old chains, so the nodes are copied rather than moved, and the old array is retired.
+ */
+static SXConcurrentDictionaryTable* growTable(SXConcurrentDictionaryShard& rShard, SXConcurrentDictionaryTable* pOldTable)
+{
+    SXConcurrentDictionaryTable* pTable = new SXConcurrentDictionaryTable((pOldTable->mask + 1) * 2);
+    for (size_t i = 0; i <= pOldTable->mask; i++) {
+        for (SXConcurrentDictionaryNode* pOldNode = pOldTable->pBuckets[i].load(std::memory_order_relaxed); pOldNode; pOldNode = pOldNode->pNext.load(std::memory_order_relaxed)) {
+            SXObject* pObject = pOldNode->pObject.load(std::memory_order_relaxed);
+            pObject->retain();
+            SXConcurrentDictionaryNode* pNode = new SXConcurrentDictionaryNode(pObject, pOldNode->key);
+            std::atomic<SXConcurrentDictionaryNode*>& rBucket = pTable->pBuckets[pNode->key.hash() & pTable->mask];
+            pNode->pNext.store(rBucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            rBucket.store(pNode, std::memory_order_relaxed);
+        }
+    }
+    rShard.pTable.store(pTable, std::memory_order_release);
+    retire(rShard, deleteTable, pOldTable);
+    return pTable;
+}
+
+/**
+ * @brief Publish a new node at the head of its bucket. The shard must be locked.
+ */
+static void insertNode(SXConcurrentDictionaryShard& rShard, SXConcurrentDictionaryNode* pNode)
+{
+    SXConcurrentDictionaryTable* pTable = rShard.pTable.load(std::memory_order_relaxed);
+    unsigned int count = rShard.count.load(std::memory_order_relaxed) + 1;
+    if (count > pTable->mask + 1) {
+        pTable = growTable(rShard, pTable);
+    }
+    
+    std::atomic<SXConcurrentDictionaryNode*>& rBucket = pTable->pBuckets[pNode->key.hash() & pTable->mask];
+    pNode->pNext.store(rBucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    rBucket.store(pNode, std::memory_order_release);
+    rShard.count.store(count, std::memory_order_relaxed);
+}
+
+SXConcurrentDictionary::SXConcurrentDictionary()
+:SXConcurrentDictionary(SX_CONCURRENT_DICTIONARY_DEFAULT_SHARD_COUNT)
+{
+}
+
+SXConcurrentDictionary::SXConcurrentDictionary(unsigned int shardCount)
+{
+    while ((1u << m_shardBits) < shardCount) {
+        m_shardBits++;
+    }
+    
+    m_pShards = new SXConcurrentDictionaryShard[1u << m_shardBits];
+    for (unsigned int i = 0; i < (1u << m_shardBits); i++) {
+        m_pShards[i].pTable.store(new SXConcurrentDictionaryTable(SX_CONCURRENT_DICTIONARY_MIN_BUCKETS), std::memory_order_relaxed);
+    }
+}
+
+SXConcurrentDictionary::~SXConcurrentDictionary()
+{
+    for (unsigned int i = 0; i < (1u << m_shardBits); i++) {
+        deleteTable(m_pShards[i].pTable.load(std::memory_order_relaxed));
+        runRetired(m_pShards[i].retired);
+    }
+    delete[] m_pShards;
+    m_pShards = nullptr;
+}
+
+SXConcurrentDictionary* SXConcurrentDictionary::create()
+{
+    return createWithShardCount(SX_CONCURRENT_DICTIONARY_DEFAULT_SHARD_COUNT);
+}
+
+SXConcurrentDictionary* SXConcurrentDictionary::createWithShardCount(unsigned int shardCount)
+{
+    SXConcurrentDictionary* pDictionary = new SXConcurrentDictionary(shardCount);
+    
+    if (pDictionary) {
+        pDictionary->autorelease();
+    }
+    
+    return pDictionary;
+}
+
+SXConcurrentDictionaryShard& SXConcurrentDictionary::shardForHash(size_t hash) const
+{
+    // Buckets are picked with the low bits of the hash, so shards use the high bits of a multiplicative mix.
+    if (m_shardBits == 0) {
+        return m_pShards[0];
+    }
+    return m_pShards[(static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull) >> (64 - m_shardBits)];
+}
+
+unsigned int SXConcurrentDictionary::count() const
+{
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < (1u << m_shardBits); i++) {
+        count += m_pShards[i].count.load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+SXArray* SXConcurrentDictionary::allKeys() const
+{
+    SXArray* pKeys = SXArray::createWithCapacity(count());
+    enumerateLocked([pKeys](const SXDictionaryKey& rKey, SXObject*) {
+        SXString* pKey = SXString::newWithCharacters(rKey.view().data(), rKey.length());
+        pKeys->addObject(pKey);
+        pKey->release();
+    });
+    return pKeys;
+}
+
+template <typename LookupKey>
+SXObject* SXConcurrentDictionary::retainedObjectForLookupKey(const LookupKey& rKey, size_t hash) const
+{
+    SXConcurrentDictionaryShard& rShard = shardForHash(hash);
+    
+    SXEpochGuard guard;
+    SXConcurrentDictionaryNode* pNode = findNode(rShard.pTable.load(std::memory_order_acquire), rKey, hash);
+    if (!pNode) {
+        return nullptr;
+    }
+    // The node holds a reference until the guard is gone, so retaining is safe.
+    SXObject* pObject = pNode->pObject.load(std::memory_order_acquire);
+    pObject->retain();
+    return pObject;
+}
+
+SXObject* SXConcurrentDictionary::retainedObjectForKey(std::string_view key) const
+{
+    return retainedObjectForLookupKey(key, SXDictionary::hashForKey(key));
+}
+
+SXObject* SXConcurrentDictionary::retainedObjectForKey(SXAtom atom) const
+{
+    return retainedObjectForLookupKey(atom, atom.hash());
+}
+
+template <typename LookupKey>
+void SXConcurrentDictionary::setObjectForLookupKey(SXObject* pObject, const LookupKey& rKey, size_t hash)
+{
+    pObject->retain();
+    
+    SXConcurrentDictionaryShard& rShard = shardForHash(hash);
+    std::vector<SXConcurrentDictionaryRetired> reclaimable;
+    {
+        std::lock_guard<std::mutex> lock(rShard.mutex);
+        SXConcurrentDictionaryNode* pNode = findNode(rShard.pTable.load(std::memory_order_relaxed), rKey, hash);
+        if (pNode) {
+            // Replace previous object for this key. Readers may still be retaining it.
+            retire(rShard, releaseObject, pNode->pObject.exchange(pObject, std::memory_order_acq_rel));
+        } else if constexpr (std::is_same<LookupKey, SXAtom>::value) {
+            insertNode(rShard, new SXConcurrentDictionaryNode(pObject, rKey));
+        } else {
+            insertNode(rShard, new SXConcurrentDictionaryNode(pObject, rKey, hash));
+        }
+        collectReclaimable(rShard, reclaimable);
+    }
+    runRetired(reclaimable);
+}
+
+void SXConcurrentDictionary::setObject(SXObject* pObject, std::string_view key)
+{
+    setObjectForLookupKey(pObject, key, SXDictionary::hashForKey(key));
+}
+
+void SXConcurrentDictionary::setObject(SXObject* pObject, SXAtom atom)
+{
+    setObjectForLookupKey(pObject, atom, atom.hash());
+}
+
+SXObject* SXConcurrentDictionary::addObjectIfAbsent(SXObject* pObject, std::string_view key)
+{
+    return computeObjectIfAbsent(key, [pObject]() {
+        pObject->retain();
+        return pObject;
+    });
+}
+
+SXObject* SXConcurrentDictionary::computeObjectIfAbsent(std::string_view key, const std::function<SXObject*()>& function)
+{
+    size_t hash = SXDictionary::hashForKey(key);
+    SXObject* pObject = retainedObjectForLookupKey(key, hash);
+    if (pObject) {
+        return pObject;
+    }
+    
+    SXConcurrentDictionaryShard& rShard = shardForHash(hash);
+    std::vector<SXConcurrentDictionaryRetired> reclaimable;
+    {
+        std::lock_guard<std::mutex> lock(rShard.mutex);
+        // Another thread may have added the key since the lock-free lookup.
+        SXConcurrentDictionaryNode* pNode = findNode(rShard.pTable.load(std::memory_order_relaxed), key, hash);
+        if (pNode) {
+            pObject = pNode->pObject.load(std::memory_order_relaxed);
+        } else {
+            pObject = function();
+            if (pObject) {
+                insertNode(rShard, new SXConcurrentDictionaryNode(pObject, key, hash));
+            }
+        }
+        if (pObject) {
+            pObject->retain();
+        }
+        collectReclaimable(rShard, reclaimable);
+    }
+    runRetired(reclaimable);
+    return pObject;
+}
+
+void SXConcurrentDictionary::removeObjectForKey(std::string_view key)
+{
+    size_t hash = SXDictionary::hashForKey(key);
+    SXConcurrentDictionaryShard& rShard = shardForHash(hash);
+    std::vector<SXConcurrentDictionaryRetired> reclaimable;
+    {
+        std::lock_guard<std::mutex> lock(rShard.mutex);
+        std::atomic<SXConcurrentDictionaryNode*>* pLink;
+        SXConcurrentDictionaryNode* pNode = findNode(rShard.pTable.load(std::memory_order_relaxed), key, hash, &pLink);
+        if (pNode) {
+            // Readers standing on the node can still follow its link.
+            pLink->store(pNode->pNext.load(std::memory_order_relaxed), std::memory_order_release);
+            rShard.count.store(rShard.count.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+            retire(rShard, deleteNode, pNode);
+        }
+        collectReclaimable(rShard, reclaimable);
+    }
+    runRetired(reclaimable);
+}
+
+void SXConcurrentDictionary::removeAllObjects()
+{
+    for (unsigned int i = 0; i < (1u << m_shardBits); i++) {
+        SXConcurrentDictionaryShard& rShard = m_pShards[i];
+        std::vector<SXConcurrentDictionaryRetired> reclaimable;
+        {
+            std::lock_guard<std::mutex> lock(rShard.mutex);
+            SXConcurrentDictionaryTable* pTable = rShard.pTable.exchange(new SXConcurrentDictionaryTable(SX_CONCURRENT_DICTIONARY_MIN_BUCKETS), std::memory_order_acq_rel);
+            rShard.count.store(0, std::memory_order_relaxed);
+            retire(rShard, deleteTable, pTable);
+            collectReclaimable(rShard, reclaimable);
+        }
+        runRetired(reclaimable);
+    }
+}
+
+void SXConcurrentDictionary::enumerateLocked(const std::function<void(const SXDictionaryKey&, SXObject*)>& function) const
+{
+    for (unsigned int i = 0; i < (1u << m_shardBits); i++) {
+        SXConcurrentDictionaryShard& rShard = m_pShards[i];
+        std::lock_guard<std::mutex> lock(rShard.mutex);
+        SXConcurrentDictionaryTable* pTable = rShard.pTable.load(std::memory_order_relaxed);
+        for (size_t j = 0; j <= pTable->mask; j++) {
+            for (SXConcurrentDictionaryNode* pNode = pTable->pBuckets[j].load(std::memory_order_relaxed); pNode; pNode = pNode->pNext.load(std::memory_order_relaxed)) {
+                function(pNode->key, pNode->pObject.load(std::memory_order_relaxed));
+            }
+        }
+    }
+}
+
+SXDictionary* SXConcurrentDictionary::dictionaryRepresentation() const
+{
+    SXDictionary* pDictionary = SXDictionary::create();
+    enumerateLocked([pDictionary](const SXDictionaryKey& rKey, SXObject* pObject) {
+        if (rKey.atom().isNull()) {
+            pDictionary->setObject(pObject, rKey.view());
+        } else {
+            pDictionary->setObject(pObject, rKey.atom());
+        }
+    });
+    return pDictionary;
+}
+
+SXObject* SXConcurrentDictionary::copy() const
+{
+    SXConcurrentDictionary* pDictionary = new SXConcurrentDictionary(1u << m_shardBits);
+    enumerateLocked([pDictionary](const SXDictionaryKey& rKey, SXObject* pObject) {
+        SXObject* pTmpObject = pObject->copy();
+        if (!pTmpObject) {
+            return;
+        }
+        if (rKey.atom().isNull()) {
+            pDictionary->setObject(pTmpObject, rKey.view());
+        } else {
+            pDictionary->setObject(pTmpObject, rKey.atom());
+        }
+        pTmpObject->release();
+    });
+    return pDictionary;
+}
+
+}
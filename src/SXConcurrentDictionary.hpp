@@ -0,0 +1,203 @@
+/**
+ * @file SXConcurrentDictionary.hpp
+ * @brief Declaration of the SXConcurrentDictionary class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SXConcurrentDictionary_hpp
+#define SXConcurrentDictionary_hpp
+
+#include "SXObject.hpp"
+#include "SXArray.hpp"
+#include "SXAtom.hpp"
+#include "SXDictionary.hpp"
+#include <functional>
+#include <string_view>
+
+namespace spalx {
+
+// Default number of shards.
+#define SX_CONCURRENT_DICTIONARY_DEFAULT_SHARD_COUNT 16
+
+struct SXConcurrentDictionaryShard;
+
+/**
+ * @class SXConcurrentDictionary
+ * @brief Dynamic collection of key-value pairs that can be shared between threads.
+ * @details Keys are spread over independent shards, each a chained hash table with its own writer mutex, so writers to different shards do not contend. Readers never lock: they walk the chains while registered in the current epoch, and memory unlinked by a writer (nodes, bucket arrays, replaced objects) is only released once every reader that could still see it has left. Lookups return retained objects, so an object stays alive after it is removed or replaced by another thread.
+ * @note The dictionary itself must be kept alive (retained) by every thread using it. Methods returning autoreleased objects use the shared autorelease pools, which are not meant to be used from several threads at once.
+ */
+class SXConcurrentDictionary : public SXObject
+{
+public:
+    /**
+     * @brief Default constructor.
+     * @details Uses SX_CONCURRENT_DICTIONARY_DEFAULT_SHARD_COUNT shards.
+     */
+    SXConcurrentDictionary();
+    
+    /**
+     * @brief Constructor with a number of shards.
+     * @param shardCount The number of shards, rounded up to a power of two.
+     */
+    explicit SXConcurrentDictionary(unsigned int shardCount);
+    
+    /**
+     * @brief Destructor.
+     * @details Before deletion, removes all objects from the dictionary so their reference count gets decreased by 1. No other thread may be using the dictionary.
+     */
+    ~SXConcurrentDictionary();
+    
+    /**
+     * @brief Create a new concurrent dictionary.
+     * @return The new dictionary object. nullptr if initialization fails.
+     */
+    static SXConcurrentDictionary* create();
+    
+    /**
+     * @brief Create a new concurrent dictionary with a number of shards.
+     * @param shardCount The number of shards, rounded up to a power of two.
+     * @return The new dictionary object. nullptr if initialization fails.
+     */
+    static SXConcurrentDictionary* createWithShardCount(unsigned int shardCount);
+    
+    /**
+     * @brief Get the number of elements in the dictionary.
+     * @details Other threads may be adding or removing elements, so the result is only a snapshot.
+     * @return The number of elements.
+     */
+    unsigned int count() const;
+    
+    /**
+     * @brief Get all the keys from the dictionary.
+     * @details Each shard is locked in turn while its keys are collected.
+     * @return Array of strings (the keys).
+     */
+    SXArray* allKeys() const;
+    
+    /**
+     * @brief Get the object with the specific key.
+     * @details Lock-free. The object is retained before being returned, so it stays valid even if another thread removes it. Threads looking up the same key at the same time contend on the reference count of its object.
+     * @param key The key of the object to retrieve.
+     * @return The object, which the caller must release. nullptr if the key is not in the dictionary.
+     */
+    SXObject* retainedObjectForKey(std::string_view key) const;
+    
+    /**
+     * @brief Get the object with the specific key, given as an atom.
+     * @details Lock-free. The object is retained before being returned.
+     * @param atom The key of the object to retrieve.
+     * @return The object, which the caller must release. nullptr if the key is not in the dictionary.
+     */
+    SXObject* retainedObjectForKey(SXAtom atom) const;
+    
+    /**
+     * @brief Add object to the dictionary.
+     * @details The reference count of the object is increased by 1. A replaced object is released once no reader can see it anymore.
+     * @param pObject The object to add.
+     * @param key The key to assign to the object.
+     */
+    void setObject(SXObject* pObject, std::string_view key);
+    
+    /**
+     * @brief Add object to the dictionary with an atom as key.
+     * @details The reference count of the object is increased by 1. The key characters are not copied.
+     * @param pObject The object to add.
+     * @param atom The key to assign to the object.
+     */
+    void setObject(SXObject* pObject, SXAtom atom);
+    
+    /**
+     * @brief Add object to the dictionary unless the key already has one.
+     * @details Atomic: when several threads add the same key, exactly one object is stored and all of them get it back.
+     * @param pObject The object to add. Its reference count is increased by 1 if it is added.
+     * @param key The key to assign to the object.
+     * @return The object stored for the key (pObject or the existing one), which the caller must release.
+     */
+    SXObject* addObjectIfAbsent(SXObject* pObject, std::string_view key);
+    
+    /**
+     * @brief Get the object with the specific key, creating it if the key is not in the dictionary.
+     * @details Atomic: the function is called at most once per missing key, with the shard locked, so it must not use this dictionary. When the key is present no lock is taken.
+     * @param key The key of the object.
+     * @param function Function returning a new object (reference count 1) whose ownership passes to the dictionary, or nullptr to add nothing.
+     * @return The object stored for the key, which the caller must release. nullptr if the function returned nullptr.
+     */
+    SXObject* computeObjectIfAbsent(std::string_view key, const std::function<SXObject*()>& function);
+    
+    /**
+     * @brief Remove the object with the specific key.
+     * @details The reference count of the object is decreased by 1 once no reader can see it anymore.
+     * @param key The key of the object to remove.
+     */
+    void removeObjectForKey(std::string_view key);
+    
+    /**
+     * @brief Remove all objects.
+     * @details The reference count of each object is decreased by 1 once no reader can see it anymore.
+     */
+    void removeAllObjects();
+    
+    /**
+     * @brief Get a snapshot of the dictionary.
+     * @details Each shard is locked in turn while its entries are collected. The objects are not copied.
+     * @return A dictionary with the same keys and objects.
+     */
+    SXDictionary* dictionaryRepresentation() const;
+    
+    /**
+     * @brief Perform a deep copy of the dictionary.
+     * @details Create a new dictionary with the same number of shards by copying (copy() is called) each element inside the dictionary.
+     * @return The new copied dictionary.
+     */
+    virtual SXObject* copy() const override;
+
+private:
+    SXConcurrentDictionaryShard* m_pShards{nullptr}; /**< The shards. */
+    unsigned int m_shardBits{0}; /**< log2 of the number of shards. */
+    
+    /**
+     * @brief Get the shard that holds a hash.
+     */
+    SXConcurrentDictionaryShard& shardForHash(size_t hash) const;
+    
+    /**
+     * @brief Lock-free lookup shared by both retainedObjectForKey() overloads.
+     */
+    template <typename LookupKey>
+    SXObject* retainedObjectForLookupKey(const LookupKey& rKey, size_t hash) const;
+    
+    /**
+     * @brief Insert or replace an entry, shared by both setObject() overloads.
+     */
+    template <typename LookupKey>
+    void setObjectForLookupKey(SXObject* pObject, const LookupKey& rKey, size_t hash);
+    
+    /**
+     * @brief Call a function on each entry of each shard, with the shard locked.
+     */
+    void enumerateLocked(const std::function<void(const SXDictionaryKey&, SXObject*)>& function) const;
+};
+
+} // namespace spalx
+
+#endif // SXConcurrentDictionary_hpp
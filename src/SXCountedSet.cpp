@@ -0,0 +1,302 @@
+/**
+ * @file SXCountedSet.hpp
+ * @brief Implementation of the SXCountedSet class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SXCountedSet.hpp"
+#include "SXCommon.hpp"
+#include "SXString.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace spalx {
+
+SXCountedSet::SXCountedSet()
+:SXCountedSet(SXSetMembershipEquality)
+{
+}
+
+SXCountedSet::SXCountedSet(SXSetMembership membership)
+:m_membership(membership)
+{
+    m_pTable = new SXCountedSetTable(SXSetEntryHash(), SXSetEntryEqual{membership == SXSetMembershipIdentity});
+}
+
+SXCountedSet::~SXCountedSet()
+{
+    m_immutable = false; // An immutable counted set still releases its objects.
+    removeAllObjects();
+    delete m_pTable;
+    m_pTable = nullptr;
+}
+
+SXCountedSet* SXCountedSet::create()
+{
+    SXCountedSet* pCountedSet = new SXCountedSet();
+    
+    if (pCountedSet) {
+        pCountedSet->autorelease();
+    }
+    
+    return pCountedSet;
+}
+
+SXCountedSet* SXCountedSet::createWithMembership(SXSetMembership membership)
+{
+    SXCountedSet* pCountedSet = new SXCountedSet(membership);
+    
+    if (pCountedSet) {
+        pCountedSet->autorelease();
+    }
+    
+    return pCountedSet;
+}
+
+SXSetMembership SXCountedSet::membership() const
+{
+    return m_membership;
+}
+
+unsigned int SXCountedSet::count() const
+{
+    return static_cast<unsigned int>(m_pTable->size());
+}
+
+size_t SXCountedSet::totalCount() const
+{
+    return m_totalCount;
+}
+
+size_t SXCountedSet::countForObject(SXObject* pObject) const
+{
+    if (!pObject) {
+        return 0;
+    }
+    
+    SXSetEntry entry = entryForObject(pObject);
+    SXCountedSetTable::Iterator it = m_pTable->find(entry, entry.hash);
+    return (it == m_pTable->end()) ? 0 : it->second;
+}
+
+size_t SXCountedSet::countForKey(std::string_view key) const
+{
+    SXCountedSetTable::Iterator it = m_pTable->find(key, SXHashString(key));
+    return (it == m_pTable->end()) ? 0 : it->second;
+}
+
+SXObject* SXCountedSet::member(SXObject* pObject) const
+{
+    if (!pObject) {
+        return nullptr;
+    }
+    
+    SXSetEntry entry = entryForObject(pObject);
+    SXCountedSetTable::Iterator it = m_pTable->find(entry, entry.hash);
+    return (it == m_pTable->end()) ? nullptr : it->first.pObject;
+}
+
+void SXCountedSet::addObject(SXObject* pObject, size_t occurrences)
+{
+    if (!checkMutable() || !pObject || occurrences == 0) {
+        return;
+    }
+    
+    // The count is updated in the slot: only a new member is retained and inserted.
+    SXSetEntry entry = entryForObject(pObject);
+    std::pair<SXCountedSetTable::Iterator, bool> result = m_pTable->emplace(entry, entry.hash, entry, 0);
+    if (result.second) {
+        pObject->retain();
+    }
+    result.first->second += occurrences;
+    m_totalCount += occurrences;
+}
+
+void SXCountedSet::addKey(std::string_view key, size_t occurrences)
+{
+    if (!checkMutable() || occurrences == 0) {
+        return;
+    }
+    
+    // Existing members are found by their characters: a string is only created for a new member, which owns its reference.
+    SXCountedSetTable::Iterator it = m_pTable->find(key, SXHashString(key));
+    if (it == m_pTable->end()) {
+        SXString* pString = new SXString(key.data(), key.size());
+        SXSetEntry entry = entryForObject(pString);
+        it = m_pTable->emplace(entry, entry.hash, entry, 0).first;
+    }
+    it->second += occurrences;
+    m_totalCount += occurrences;
+}
+
+void SXCountedSet::removeObject(SXObject* pObject, size_t occurrences)
+{
+    if (!checkMutable() || !pObject || occurrences == 0) {
+        return;
+    }
+    
+    SXSetEntry entry = entryForObject(pObject);
+    SXCountedSetTable::Iterator it = m_pTable->find(entry, entry.hash);
+    if (it == m_pTable->end()) {
+        return;
+    }
+    
+    if (it->second > occurrences) {
+        it->second -= occurrences;
+        m_totalCount -= occurrences;
+        return;
+    }
+    
+    SXObject* pMember = it->first.pObject;
+    m_totalCount -= it->second;
+    m_pTable->erase(it);
+    pMember->release();
+}
+
+void SXCountedSet::removeAllObjects()
+{
+    if (!checkMutable()) {
+        return;
+    }
+    
+    for (const std::pair<SXSetEntry, size_t>& rSlot : *m_pTable) {
+        rSlot.first.pObject->release();
+    }
+    m_pTable->clear();
+    m_totalCount = 0;
+}
+
+void SXCountedSet::reserve(unsigned int count)
+{
+    m_pTable->reserve(count);
+}
+
+SXArray* SXCountedSet::topObjects(unsigned int k) const
+{
+    typedef std::pair<size_t, SXObject*> SXCountedObject;
+    auto higherCount = [](const SXCountedObject& rA, const SXCountedObject& rB) { return rA.first > rB.first; };
+    
+    // Min-heap of the k highest counts seen so far: its front is the member to replace.
+    std::vector<SXCountedObject> heap;
+    heap.reserve(std::min<size_t>(k, m_pTable->size()));
+    if (k > 0) {
+        for (const std::pair<SXSetEntry, size_t>& rSlot : *m_pTable) {
+            if (heap.size() < k) {
+                heap.emplace_back(rSlot.second, rSlot.first.pObject);
+                std::push_heap(heap.begin(), heap.end(), higherCount);
+            } else if (rSlot.second > heap.front().first) {
+                std::pop_heap(heap.begin(), heap.end(), higherCount);
+                heap.back() = SXCountedObject(rSlot.second, rSlot.first.pObject);
+                std::push_heap(heap.begin(), heap.end(), higherCount);
+            }
+        }
+    }
+    
+    std::sort_heap(heap.begin(), heap.end(), higherCount);
+    SXArray* pArray = SXArray::createWithCapacity(static_cast<unsigned int>(heap.size()));
+    for (const SXCountedObject& rCountedObject : heap) {
+        pArray->addObject(rCountedObject.second);
+    }
+    return pArray;
+}
+
+bool SXCountedSet::isEqual(const SXObject* pObject) const
+{
+    if (pObject == this) {
+        return true;
+    }
+    
+    const SXCountedSet* pOtherCountedSet = dynamic_cast<const SXCountedSet*>(pObject);
+    if (!pOtherCountedSet || pOtherCountedSet->count() != count() || pOtherCountedSet->m_totalCount != m_totalCount) {
+        return false;
+    }
+    
+    if (m_immutable && pOtherCountedSet->m_immutable && m_hash != pOtherCountedSet->m_hash) {
+        return false;
+    }
+    
+    // Each member is looked up in the other table, by value, and must have the same count there.
+    for (const std::pair<SXSetEntry, size_t>& rSlot : *m_pTable) {
+        SXSetEntry entry = (pOtherCountedSet->m_membership == m_membership) ? rSlot.first : pOtherCountedSet->entryForObject(rSlot.first.pObject);
+        SXCountedSetTable::Iterator it = pOtherCountedSet->m_pTable->find(entry, entry.hash);
+        if (it == pOtherCountedSet->m_pTable->end() || it->second != rSlot.second) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+size_t SXCountedSet::hash() const
+{
+    if (m_immutable) {
+        return m_hash;
+    }
+    
+    // Members are combined by addition, so the hash does not depend on the slot order.
+    bool identity = m_membership == SXSetMembershipIdentity;
+    size_t hash = m_pTable->size();
+    for (const std::pair<SXSetEntry, size_t>& rSlot : *m_pTable) {
+        hash += SXHashMix((identity ? rSlot.first.pObject->hash() : rSlot.first.hash) ^ SXHashMix(rSlot.second));
+    }
+    return hash;
+}
+
+void SXCountedSet::makeImmutable()
+{
+    if (m_immutable) {
+        return;
+    }
+    
+    for (const std::pair<SXSetEntry, size_t>& rSlot : *m_pTable) {
+        rSlot.first.pObject->makeImmutable();
+    }
+    m_hash = hash();
+    m_immutable = true;
+}
+
+SXObject* SXCountedSet::copy() const
+{
+    SXCountedSet* pCountedSet = new SXCountedSet(m_membership);
+    pCountedSet->reserve(count());
+    
+    for (const std::pair<SXSetEntry, size_t>& rSlot : *m_pTable) {
+        SXObject* pTmpObject = rSlot.first.pObject->copy();
+        pCountedSet->addObject(pTmpObject, rSlot.second);
+        pTmpObject->release();
+    }
+    
+    return pCountedSet;
+}
+
+SXSetEntry SXCountedSet::entryForObject(SXObject* pObject) const
+{
+    if (m_membership == SXSetMembershipIdentity) {
+        return SXSetEntry{pObject, static_cast<size_t>(reinterpret_cast<uintptr_t>(pObject))};
+    }
+    return SXSetEntry{pObject, pObject->hash()};
+}
+
+}
@@ -0,0 +1,219 @@
+/**
+ * @file SXCountedSet.hpp
+ * @brief Declaration of the SXCountedSet class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SXCountedSet_hpp
+#define SXCountedSet_hpp
+
+#include "SXObject.hpp"
+#include "SXArray.hpp"
+#include "SXSet.hpp"
+#include "SXHashTable.hpp"
+#include <cstddef>
+#include <string_view>
+
+namespace spalx {
+
+typedef SXHashTable<SXSetEntry, size_t, SXSetEntryHash, SXSetEntryEqual> SXCountedSetTable;
+// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+// Type definition for the open-addressing table holding the members of a counted set and their counts.
+
+/**
+ * @class SXCountedSet
+ * @brief Unordered collection of distinct objects, each with the number of times it was added.
+ * @details Counts are stored next to the members in the slots of the hash table, so adding an object that is already a member only increments a counter: nothing is allocated, boxed or replaced. Members are retained once, when first added, and released when their count drops to 0. Like SXSet, members are compared by identity or by value; counted sets compare by value (SXSetMembershipEquality) by default, since they usually count occurrences of equal strings or numbers.
+ */
+class SXCountedSet : public SXObject
+{
+public:
+    /**
+     * @brief Default constructor.
+     * @details The counted set uses SXSetMembershipEquality.
+     */
+    SXCountedSet();
+    
+    /**
+     * @brief Constructor.
+     * @param membership How members are compared.
+     */
+    explicit SXCountedSet(SXSetMembership membership);
+    
+    /**
+     * @brief Destructor.
+     * @details Releases all members.
+     */
+    ~SXCountedSet();
+    
+    /**
+     * @brief Create a new counted set comparing members by value.
+     * @return The new counted set object, autoreleased.
+     */
+    static SXCountedSet* create();
+    
+    /**
+     * @brief Create a new counted set with a given membership.
+     * @param membership How members are compared.
+     * @return The new counted set object, autoreleased.
+     */
+    static SXCountedSet* createWithMembership(SXSetMembership membership);
+    
+    /**
+     * @brief Get how members are compared.
+     * @return The membership the counted set was created with.
+     */
+    SXSetMembership membership() const;
+    
+    /**
+     * @brief Get the number of distinct members.
+     * @return The number of members.
+     */
+    unsigned int count() const;
+    
+    /**
+     * @brief Get the sum of the counts of all members.
+     * @return The number of times objects were added, minus the number of times they were removed.
+     */
+    size_t totalCount() const;
+    
+    /**
+     * @brief Get the number of times an object was added.
+     * @param pObject The object to look up.
+     * @return The count of the object. 0 if it is not a member.
+     */
+    size_t countForObject(SXObject* pObject) const;
+    
+    /**
+     * @brief Get the number of times a string was added.
+     * @details Looks the characters up without creating a string object. Only SXString members match, and only when members are compared by value.
+     * @param key The characters to look up.
+     * @return The count of the string. 0 if it is not a member.
+     */
+    size_t countForKey(std::string_view key) const;
+    
+    /**
+     * @brief Get the member matching an object.
+     * @param pObject The object to look up.
+     * @return The member. nullptr if there is none.
+     */
+    SXObject* member(SXObject* pObject) const;
+    
+    /**
+     * @brief Add an object, or increment its count if it is already a member.
+     * @details The object is retained only when it becomes a member. With SXSetMembershipEquality, the member added first is kept and equal objects only increment its count.
+     * @param pObject The object to add.
+     * @param occurrences The amount to add to the count.
+     */
+    void addObject(SXObject* pObject, size_t occurrences = 1);
+    
+    /**
+     * @brief Add a string, or increment its count if it is already a member.
+     * @details Looks the characters up without creating a string object: an SXString is created only when the characters become a member, so counting tokens allocates once per distinct token. With SXSetMembershipIdentity, no member matches and each call adds a new string.
+     * @param key The characters to add.
+     * @param occurrences The amount to add to the count.
+     */
+    void addKey(std::string_view key, size_t occurrences = 1);
+    
+    /**
+     * @brief Decrement the count of a member, and remove it when the count reaches 0.
+     * @param pObject The object to remove.
+     * @param occurrences The amount to subtract from the count. Larger than the count removes the member.
+     */
+    void removeObject(SXObject* pObject, size_t occurrences = 1);
+    
+    /**
+     * @brief Remove all members, whatever their count.
+     */
+    void removeAllObjects();
+    
+    /**
+     * @brief Pre-size the table so it can hold a number of members without rehashing.
+     * @param count The number of members to make room for.
+     */
+    void reserve(unsigned int count);
+    
+    /**
+     * @brief Get the members with the highest counts.
+     * @details Selects them with a min-heap of k members in one pass over the table, O(n log k), instead of sorting all members.
+     * @param k The maximum number of members to return.
+     * @return Array of the members, by descending count, autoreleased. Members with equal counts are in no particular order.
+     */
+    SXArray* topObjects(unsigned int k) const;
+    
+    /**
+     * @brief Call a function for each member and its count.
+     * @param function Callable invoked as function(SXObject* pObject, size_t count, bool& rStop). Set rStop to true to stop the enumeration. The counted set must not be modified during the enumeration.
+     */
+    template <typename Function>
+    void enumerateObjectsAndCounts(Function&& function) const
+    {
+        bool stop = false;
+        for (const std::pair<SXSetEntry, size_t>& rSlot : *m_pTable) {
+            function(rSlot.first.pObject, rSlot.second, stop);
+            if (stop) {
+                return;
+            }
+        }
+    }
+    
+    /**
+     * @brief Compare with other object.
+     * @param pObject The object to compare with.
+     * @return Whether the object is a counted set with equal members and the same counts.
+     */
+    virtual bool isEqual(const SXObject* pObject) const override;
+    
+    /**
+     * @brief Get a hash value of the members and their counts.
+     * @details Computed once when the counted set is immutable.
+     * @return The hash value.
+     */
+    virtual size_t hash() const override;
+    
+    /**
+     * @brief Make the counted set and its members immutable.
+     */
+    virtual void makeImmutable() override;
+    
+    /**
+     * @brief Perform a deep copy of the counted set.
+     * @details Each member is copied (copy() is called) and keeps its count.
+     * @return The new copied object.
+     */
+    virtual SXObject* copy() const override;
+
+private:
+    SXSetMembership m_membership; /**< How members are compared. */
+    SXCountedSetTable* m_pTable; /**< Members and their counts. */
+    size_t m_totalCount{0}; /**< Sum of the counts. */
+    size_t m_hash{0}; /**< Hash computed by makeImmutable(). */
+    
+    /**
+     * @brief Build the table entry of an object: its address as hash in identity sets, hash() in equality sets.
+     */
+    SXSetEntry entryForObject(SXObject* pObject) const;
+};
+
+} // namespace spalx
+
+#endif // SXCountedSet_hpp
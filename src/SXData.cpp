@@ -51,6 +51,17 @@ SXData* SXData::create()
     return pData;
 }
 
+SXData* SXData::createWithBytes(const void* pBytes, size_t length)
+{
+    SXData* pData = create();
+    
+    if (pData) {
+        pData->appendBytes(pBytes, length);
+    }
+    
+    return pData;
+}
+
 SXData* SXData::createWithContentsOfFile(const char* pFilePath)
 {
     SXData* pData = create();
@@ -96,6 +107,26 @@ unsigned long SXData::length() const
     return m_pBytes->size();
 }
 
+const char* SXData::bytes() const
+{
+    return m_pBytes->data();
+}
+
+void SXData::appendBytes(const void* pBytes, size_t length)
+{
+    if (!checkMutable()) {
+        return;
+    }
+    
+    const char* pChars = static_cast<const char*>(pBytes);
+    m_pBytes->insert(m_pBytes->end(), pChars, pChars + length);
+}
+
+void SXData::reserve(size_t capacity)
+{
+    m_pBytes->reserve(capacity);
+}
+
 bool SXData::writeToFile(const char* pFilePath) const
 {
     std::ofstream file(pFilePath, std::ios::binary);
@@ -113,6 +144,17 @@ bool SXData::writeToFile(const char* pFilePath) const
     return true;
 }
 
+bool SXData::isEqual(const SXObject* pObject) const
+{
+    const SXData* pData = dynamic_cast<const SXData*>(pObject);
+    return (pData != nullptr) && (*pData->m_pBytes == *m_pBytes);
+}
+
+size_t SXData::hash() const
+{
+    return SXHashString(std::string_view(m_pBytes->data(), m_pBytes->size()));
+}
+
 SXObject* SXData::copy() const
 {
     SXData* pData = new SXData();
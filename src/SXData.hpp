@@ -56,6 +56,14 @@ public:
      */
     static SXData* create();
     
+    /**
+     * @brief Create a new data object with a copy of a byte buffer.
+     * @param pBytes The bytes to copy.
+     * @param length The number of bytes.
+     * @return The new data object. nullptr if initialization fails.
+     */
+    static SXData* createWithBytes(const void* pBytes, size_t length);
+    
     /**
      * @brief Create a new data object with the binary contents of a file.
      * @param pFilePath The path of the file to read from.
@@ -85,6 +93,26 @@ public:
      */
     unsigned long length() const;
     
+    /**
+     * @brief Get the bytes.
+     * @return A pointer to the first byte, valid until the data object is modified.
+     */
+    const char* bytes() const;
+    
+    /**
+     * @brief Append bytes at the end of the buffer.
+     * @details The buffer grows geometrically, so appending many small pieces is linear overall. Does nothing if the data object is immutable.
+     * @param pBytes The bytes to append.
+     * @param length The number of bytes.
+     */
+    void appendBytes(const void* pBytes, size_t length);
+    
+    /**
+     * @brief Pre-size the buffer.
+     * @param capacity The number of bytes the buffer must be able to hold without reallocating.
+     */
+    void reserve(size_t capacity);
+    
     /**
      * @brief Write the bytes data to a file.
      * @param pFilePath The path of the file to write to.
@@ -92,12 +120,25 @@ public:
      */
     bool writeToFile(const char* pFilePath) const;
     
+    /**
+     * @brief Compare the bytes with another data object.
+     * @param pObject The object to compare with.
+     * @return Whether both objects hold the same bytes.
+     */
+    virtual bool isEqual(const SXObject* pObject) const override;
+    
+    /**
+     * @brief Get a hash value for the bytes.
+     * @return The hash value.
+     */
+    virtual size_t hash() const override;
+    
     /**
      * @brief Create a new data object with current object's bytes data.
      * @return The new copied data object.
      */
     virtual SXObject* copy() const override;
-    
+
 private:
     std::vector<char>* m_pBytes{nullptr}; /**< Vector of bytes. */
 };
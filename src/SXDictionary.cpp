@@ -24,18 +24,25 @@
  */
 
 #include "SXDictionary.hpp"
+#include "SXBloomFilter.hpp"
+#include "SXFrozenDictionary.hpp"
 #include "SXString.hpp"
+#include <algorithm>
+#include <thread>
+#include <vector>
 
 namespace spalx {
 
 SXDictionary::SXDictionary()
 {
-    m_pMap = new std::unordered_map<std::string, SXObject*>;
+    m_pMap = new SXDictionaryTable();
 }
 
 SXDictionary::~SXDictionary()
 {
+    m_immutable = false; // An immutable dictionary still releases its objects.
     removeAllObjects();
+    disableBloomFilter();
     delete m_pMap;
     m_pMap = nullptr;
 }
@@ -43,17 +50,78 @@ SXDictionary::~SXDictionary()
 SXDictionary* SXDictionary::create()
 {
     SXDictionary* pDictionary = new SXDictionary();
-
+    
     if (pDictionary) {
         pDictionary->autorelease();
     }
+    
+    return pDictionary;
+}
+
+SXDictionary* SXDictionary::createWithObjectsForKeys(SXArray* pObjects, SXArray* pKeys)
+{
+    if (pObjects->count() != pKeys->count()) {
+        return nullptr;
+    }
+    
+    unsigned int count = pKeys->count();
+    std::vector<SXString*> keys(count);
+    for (unsigned int i = 0; i < count; i++) {
+        keys[i] = dynamic_cast<SXString*>((*pKeys)[i]);
+    }
+    
+    // Hash all keys up front, in parallel for large inputs, so filling the table only probes.
+    std::vector<size_t> hashes(count);
+    auto hashRange = [&keys, &hashes](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            SXString* pKey = keys[i];
+            if (pKey) {
+                hashes[i] = pKey->hash(); // Cached by the string, or the hash of its atom.
+            }
+        }
+    };
+    
+    unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    if (count < SX_DICTIONARY_PARALLEL_HASH_THRESHOLD || threadCount == 1) {
+        hashRange(0, count);
+    } else {
+        unsigned int chunk = (count + threadCount - 1) / threadCount;
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount - 1);
+        for (unsigned int begin = chunk; begin < count; begin += chunk) {
+            threads.emplace_back(hashRange, begin, std::min(begin + chunk, count));
+        }
+        hashRange(0, std::min(chunk, count));
+        for (std::thread& rThread: threads) {
+            rThread.join();
+        }
+    }
+    
+    SXDictionary* pDictionary = create();
+    pDictionary->reserve(count);
+    for (unsigned int i = 0; i < count; i++) {
+        SXString* pKey = keys[i];
+        if (!pKey) {
+            continue; // Only strings can be keys of this dictionary, use SXMapTable for other key types.
+        }
         
+        if (pKey->getAtom().isNull()) {
+            pDictionary->setObject((*pObjects)[i], pKey->view(), hashes[i]);
+        } else {
+            pDictionary->setObject((*pObjects)[i], pKey->getAtom());
+        }
+    }
     return pDictionary;
 }
 
-SXObject* SXDictionary::operator[](const std::string& rKey) const
+size_t SXDictionary::hashForKey(std::string_view key)
+{
+    return SXHashString(key);
+}
+
+SXObject* SXDictionary::operator[](std::string_view key) const
 {
-    return objectForKey(rKey);
+    return objectForKey(key);
 }
 
 unsigned int SXDictionary::count() const
@@ -63,48 +131,187 @@ unsigned int SXDictionary::count() const
 
 SXArray* SXDictionary::allKeys() const
 {
-    SXArray* pKeys = SXArray::create();
+    SXArray* pKeys = SXArray::createWithCapacity(count());
     for (const auto& [key, value]: *m_pMap) {
-        pKeys->addObject(SXString::create(key.c_str()));
+        SXString* pKey = SXString::newWithCharacters(key.view().data(), key.length());
+        pKeys->addObject(pKey);
+        pKey->release();
     }
     return pKeys;
 }
 
-SXObject* SXDictionary::objectForKey(const std::string& rKey) const
+SXObject* SXDictionary::objectForKey(std::string_view key) const
 {
-    return (*m_pMap)[rKey];
+    return objectForKey(key, hashForKey(key));
 }
 
-void SXDictionary::setObject(SXObject* pObject, const std::string& rKey)
+SXObject* SXDictionary::objectForKey(std::string_view key, size_t hash) const
 {
-    // Remove previous object for this key (if exists).
-    removeObjectForKey(rKey);
+    if (m_pBloomFilter && !m_pBloomFilter->mightContainHash(hash)) {
+        return nullptr;
+    }
+    
+    SXDictionaryIterator it = m_pMap->find(key, hash);
+    return (it != m_pMap->end()) ? it->second : nullptr;
+}
+
+SXObject* SXDictionary::objectForKey(SXAtom atom) const
+{
+    if (m_pBloomFilter && !m_pBloomFilter->mightContainHash(atom.hash())) {
+        return nullptr;
+    }
+    
+    SXDictionaryIterator it = m_pMap->find(atom, atom.hash());
+    return (it != m_pMap->end()) ? it->second : nullptr;
+}
+
+void SXDictionary::setObject(SXObject* pObject, std::string_view key)
+{
+    setObject(pObject, key, hashForKey(key));
+}
+
+void SXDictionary::setObject(SXObject* pObject, std::string_view key, size_t hash)
+{
+    if (!checkMutable()) {
+        return;
+    }
+    
     pObject->retain();
-    (*m_pMap)[rKey] = pObject;
+    
+    // The key is only copied into a std::string when a new slot is created.
+    auto [it, inserted] = m_pMap->emplace(key, hash, std::piecewise_construct, std::forward_as_tuple(key, hash), std::forward_as_tuple(pObject));
+    if (!inserted) {
+        // Replace previous object for this key.
+        it->second->release();
+        it->second = pObject;
+    } else {
+        bloomFilterDidAdd(it->first.hash());
+    }
+}
+
+void SXDictionary::setObject(SXObject* pObject, SXAtom atom)
+{
+    if (!checkMutable()) {
+        return;
+    }
+    
+    pObject->retain();
+    
+    auto [it, inserted] = m_pMap->emplace(atom, atom.hash(), std::piecewise_construct, std::forward_as_tuple(atom), std::forward_as_tuple(pObject));
+    if (!inserted) {
+        // Replace previous object for this key.
+        it->second->release();
+        it->second = pObject;
+    } else {
+        bloomFilterDidAdd(it->first.hash());
+    }
+}
+
+void SXDictionary::addEntriesFromDictionary(const SXDictionary* pDictionary)
+{
+    if (!checkMutable() || pDictionary == this) {
+        return;
+    }
+    
+    reserve(count() + pDictionary->count());
+    for (const auto& [key, value]: *pDictionary->m_pMap) {
+        value->retain();
+        
+        // The stored key is copied as is, so an atom key stays an atom.
+        auto [it, inserted] = m_pMap->emplace(key.view(), key.hash(), std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(value));
+        if (!inserted) {
+            it->second->release();
+            it->second = value;
+        } else {
+            bloomFilterDidAdd(key.hash());
+        }
+    }
+}
+
+void SXDictionary::reserve(unsigned int count)
+{
+    m_pMap->reserve(count);
+}
+
+void SXDictionary::enableBloomFilter(double falsePositiveRate)
+{
+    disableBloomFilter();
+    m_pBloomFilter = new SXBloomFilter(SX_BLOOM_FILTER_MIN_CAPACITY, falsePositiveRate);
+    rebuildBloomFilter();
+}
+
+void SXDictionary::disableBloomFilter()
+{
+    if (m_pBloomFilter) {
+        m_pBloomFilter->release();
+        m_pBloomFilter = nullptr;
+    }
+}
+
+SXBloomFilter* SXDictionary::bloomFilter() const
+{
+    return m_pBloomFilter;
 }
 
-void SXDictionary::removeObjectForKey(const std::string& rKey)
+void SXDictionary::removeObjectForKey(std::string_view key)
 {
-    SXObject* pObject = (*this)[rKey];
-    if (pObject) {
+    if (!checkMutable()) {
+        return;
+    }
+    
+    SXDictionaryIterator it = m_pMap->find(key);
+    if (it != m_pMap->end()) {
+        SXObject* pObject = it->second;
+        m_pMap->erase(it);
         pObject->release();
-        m_pMap->erase(rKey);
+        bloomFilterDidRemove();
+    }
+}
+
+void SXDictionary::removeObjectForKey(SXAtom atom)
+{
+    if (!checkMutable()) {
+        return;
+    }
+    
+    SXDictionaryIterator it = m_pMap->find(atom, atom.hash());
+    if (it != m_pMap->end()) {
+        SXObject* pObject = it->second;
+        m_pMap->erase(it);
+        pObject->release();
+        bloomFilterDidRemove();
     }
 }
 
 void SXDictionary::removeObjectsForKeys(SXArray* pKeys)
 {
     for (unsigned int i = 0; i < pKeys->count(); i++) {
-        removeObjectForKey((dynamic_cast<SXString*>((*pKeys)[i]))->getCString());
+        SXString* pKey = dynamic_cast<SXString*>((*pKeys)[i]);
+        if (!pKey) {
+            continue; // Only strings can be keys of this dictionary, use SXMapTable for other key types.
+        }
+        
+        if (pKey->getAtom().isNull()) {
+            removeObjectForKey(pKey->view());
+        } else {
+            removeObjectForKey(pKey->getAtom());
+        }
     }
 }
 
 void SXDictionary::removeAllObjects()
 {
+    if (!checkMutable()) {
+        return;
+    }
+    
     for (const auto& [key, value]: *m_pMap) {
         value->release();
     }
     m_pMap->clear();
+    if (m_pBloomFilter) {
+        m_pBloomFilter->resetWithCapacity(SX_BLOOM_FILTER_MIN_CAPACITY);
+    }
 }
 
 SXDictionaryIterator SXDictionary::begin() const
@@ -117,15 +324,113 @@ SXDictionaryIterator SXDictionary::end() const
     return m_pMap->end();
 }
 
+bool SXDictionary::isEqual(const SXObject* pObject) const
+{
+    if (pObject == this) {
+        return true;
+    }
+    
+    const SXDictionary* pOtherDictionary = dynamic_cast<const SXDictionary*>(pObject);
+    if (!pOtherDictionary || pOtherDictionary->count() != count()) {
+        return false;
+    }
+    
+    // Cached hashes of immutable dictionaries reject most unequal dictionaries without visiting the entries.
+    if (m_immutable && pOtherDictionary->m_immutable && m_hash != pOtherDictionary->m_hash) {
+        return false;
+    }
+    
+    for (const auto& [key, value]: *m_pMap) {
+        // The stored hash is reused, so no key is hashed again.
+        SXDictionaryIterator it = pOtherDictionary->m_pMap->find(key.view(), key.hash());
+        if (it == pOtherDictionary->m_pMap->end()) {
+            return false;
+        }
+        if (it->second != value && !value->isEqual(it->second)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+size_t SXDictionary::hash() const
+{
+    if (m_immutable) {
+        return m_hash;
+    }
+    
+    // Entries are combined by addition, so the hash does not depend on the slot order.
+    size_t hash = m_pMap->size();
+    for (const auto& [key, value]: *m_pMap) {
+        hash += SXHashMix(key.hash() * 31 + value->hash());
+    }
+    return hash;
+}
+
+void SXDictionary::makeImmutable()
+{
+    if (m_immutable) {
+        return;
+    }
+    
+    for (const auto& [key, value]: *m_pMap) {
+        value->makeImmutable();
+    }
+    m_hash = hash();
+    m_immutable = true;
+}
+
 SXObject* SXDictionary::copy() const
 {
     SXDictionary* pDictionary = new SXDictionary();
+    pDictionary->m_pMap->reserve(m_pMap->size());
     for (auto& [key, value]: *m_pMap) {
+        // Keys are unique and already hashed, so they are copied over without probing for duplicates.
         SXObject* pTmpObject = value->copy();
-        pDictionary->setObject(pTmpObject, key);
-        pTmpObject->release();
+        if (pTmpObject) {
+            pDictionary->m_pMap->emplaceUnique(key.hash(), key, pTmpObject);
+        }
+    }
+    if (m_pBloomFilter) {
+        pDictionary->enableBloomFilter(m_pBloomFilter->falsePositiveRate());
     }
     return pDictionary;
 }
 
+
+SXFrozenDictionary* SXDictionary::freeze() const
+{
+    return SXFrozenDictionary::createWithDictionary(this);
+}
+
+void SXDictionary::bloomFilterDidAdd(size_t hash)
+{
+    if (m_pBloomFilter) {
+        m_pBloomFilter->addHash(hash);
+        if (m_pBloomFilter->needsRebuild()) {
+            rebuildBloomFilter();
+        }
+    }
+}
+
+void SXDictionary::bloomFilterDidRemove()
+{
+    if (m_pBloomFilter) {
+        m_pBloomFilter->noteRemovedMembers(1);
+        if (m_pBloomFilter->needsRebuild()) {
+            rebuildBloomFilter();
+        }
+    }
+}
+
+void SXDictionary::rebuildBloomFilter()
+{
+    // Sized for twice the keys, so a growing dictionary rebuilds its filter a logarithmic number of times.
+    m_pBloomFilter->resetWithCapacity(std::max<size_t>(m_pMap->size() * 2, SX_BLOOM_FILTER_MIN_CAPACITY));
+    for (const auto& [key, value]: *m_pMap) {
+        m_pBloomFilter->addHash(key.hash());
+    }
+}
+
 }
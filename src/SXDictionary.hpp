@@ -28,14 +28,131 @@
 
 #include "SXObject.hpp"
 #include "SXArray.hpp"
+#include "SXAtom.hpp"
+#include "SXHashTable.hpp"
 #include <string>
-#include <unordered_map>
+#include <string_view>
 
 namespace spalx {
 
-typedef std::unordered_map<std::string, SXObject*>::iterator SXDictionaryIterator;
-// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
-// Type definition for an iterator over an unordered_map with string keys and SXObject* values.
+// Number of keys from which createWithObjectsForKeys() hashes the keys on several threads.
+#define SX_DICTIONARY_PARALLEL_HASH_THRESHOLD 65536
+
+class SXFrozenDictionary;
+class SXBloomFilter;
+
+/**
+ * @class SXDictionaryKey
+ * @brief Key stored in a dictionary slot.
+ * @details Holds the key characters together with their hash, so the table never hashes a stored key again. Keys added through an SXAtom point to the interned characters instead of copying them, and remember the atom so lookups by atom are a pointer comparison.
+ */
+class SXDictionaryKey
+{
+public:
+    /**
+     * @brief Create a key by copying the characters.
+     * @param key The key characters.
+     * @param hash The value SXHashString() returns for key.
+     */
+    SXDictionaryKey(std::string_view key, size_t hash)
+    :m_string(key), m_view(m_string), m_hash(hash)
+    {
+    }
+    
+    /**
+     * @brief Create a key referring to an interned string.
+     * @param atom The atom.
+     */
+    explicit SXDictionaryKey(SXAtom atom)
+    :m_view(atom.view()), m_hash(atom.hash()), m_atom(atom)
+    {
+    }
+    
+    SXDictionaryKey(const SXDictionaryKey& rOther)
+    :m_string(rOther.m_string), m_view(rOther.m_atom.isNull() ? std::string_view(m_string) : rOther.m_view), m_hash(rOther.m_hash), m_atom(rOther.m_atom)
+    {
+    }
+    
+    SXDictionaryKey(SXDictionaryKey&& rOther) noexcept
+    :m_string(std::move(rOther.m_string)), m_view(rOther.m_atom.isNull() ? std::string_view(m_string) : rOther.m_view), m_hash(rOther.m_hash), m_atom(rOther.m_atom)
+    {
+    }
+    
+    SXDictionaryKey& operator=(const SXDictionaryKey&) = delete;
+    
+    /**
+     * @brief Get the C-style string value.
+     * @return The C string.
+     */
+    const char* c_str() const { return m_atom.isNull() ? m_string.c_str() : m_atom.getCString(); }
+    
+    /**
+     * @brief Get length of the key.
+     * @return The length.
+     */
+    size_t length() const { return m_view.length(); }
+    
+    /**
+     * @brief Get the hash of the key.
+     * @return The hash value.
+     */
+    size_t hash() const { return m_hash; }
+    
+    /**
+     * @brief Get the atom the key was added with.
+     * @return The atom. A null atom if the key was added as a string.
+     */
+    SXAtom atom() const { return m_atom; }
+    
+    /**
+     * @brief Get a view of the key characters.
+     * @return The string view.
+     */
+    std::string_view view() const { return m_view; }
+    
+    operator std::string_view() const { return m_view; }
+
+private:
+    std::string m_string; /**< Copied characters. Empty when the key is an atom. */
+    std::string_view m_view; /**< View of either m_string or the interned characters. */
+    size_t m_hash; /**< Hash of the characters. */
+    SXAtom m_atom; /**< Atom the key was added with, if any. */
+};
+
+/**
+ * @brief Hash functor for the string keys of a dictionary.
+ */
+struct SXDictionaryKeyHash
+{
+    size_t operator()(const SXDictionaryKey& rKey) const { return rKey.hash(); }
+    size_t operator()(std::string_view key) const { return SXHashString(key); }
+    size_t operator()(SXAtom atom) const { return atom.hash(); }
+};
+
+/**
+ * @brief Equality functor for the string keys of a dictionary.
+ */
+struct SXDictionaryKeyEqual
+{
+    bool operator()(const SXDictionaryKey& rStoredKey, std::string_view key) const
+    {
+        return rStoredKey.view() == key;
+    }
+    
+    bool operator()(const SXDictionaryKey& rStoredKey, SXAtom atom) const
+    {
+        // Two different atoms never hold the same characters.
+        return (rStoredKey.atom() == atom) || (rStoredKey.atom().isNull() && rStoredKey.view() == atom.view());
+    }
+};
+
+typedef SXHashTable<SXDictionaryKey, SXObject*, SXDictionaryKeyHash, SXDictionaryKeyEqual> SXDictionaryTable;
+// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+// Type definition for the open-addressing table with string keys and SXObject* values.
+
+typedef SXDictionaryTable::Iterator SXDictionaryIterator;
+// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+// Type definition for an iterator over the dictionary table. Dereferencing it yields a std::pair of key and value.
 
 /**
  * @class SXArray
@@ -46,7 +163,7 @@ class SXDictionary : public SXObject
 public:
     /**
      * @brief Default constructor.
-     * @details Initializes the unordered map.
+     * @details Initializes the hash table. No slots are allocated until the first object is added.
      */
     SXDictionary();
     
@@ -62,13 +179,30 @@ public:
      */
     static SXDictionary* create();
     
+    /**
+     * @brief Create a new dictionary from parallel arrays of objects and keys.
+     * @details The table is sized once for all entries and each key is hashed once. Keys that are atoms keep their atom. From SX_DICTIONARY_PARALLEL_HASH_THRESHOLD keys the hashes are computed on several threads; the table itself is filled on the calling thread. When a key appears more than once, the last object wins.
+     * @param pObjects The objects.
+     * @param pKeys The keys (SXString objects), at the same indices as their objects. Elements of other types are skipped with their object.
+     * @return The new dictionary object. nullptr if the arrays have different sizes.
+     */
+    static SXDictionary* createWithObjectsForKeys(SXArray* pObjects, SXArray* pKeys);
+    
+    /**
+     * @brief Get the hash of a key.
+     * @details The result can be stored and passed to objectForKey() to skip hashing on repeated lookups of the same key.
+     * @param key The key to hash.
+     * @return The hash value.
+     */
+    static size_t hashForKey(std::string_view key);
+    
     /**
      * @brief Overloaded subscript operator to access elements by key.
      * @details Provides read-only access to the element for the specified key.
-     * @param rKey The key of the element to access.
-     * @return The object for the specified key.
+     * @param key The key of the element to access.
+     * @return The object for the specified key. nullptr if the key is not in the dictionary.
      */
-    SXObject* operator[](const std::string& rKey) const;
+    SXObject* operator[](std::string_view key) const;
     
     /**
      * @brief Get the number of elements in the dictionary.
@@ -78,36 +212,128 @@ public:
     
     /**
      * @brief Get all the keys from the dictionary.
+     * @details The array is allocated once with the right capacity. The strings are owned by the array only, they are not added to the autorelease pool. Use enumerateKeysAndObjects() or the iterators to read the keys without creating any object.
      * @return Array of strings (the keys).
      */
     SXArray* allKeys() const;
     
+    /**
+     * @brief Call a function for each entry of the dictionary.
+     * @details Nothing is allocated or copied: the key is a view of the stored characters, valid until the entry is removed.
+     * @param function Callable invoked as function(std::string_view key, SXObject* pObject, bool& rStop). Set rStop to true to stop the enumeration.
+     */
+    template <typename Function>
+    void enumerateKeysAndObjects(Function&& function) const
+    {
+        bool stop = false;
+        for (const auto& [key, value]: *m_pMap) {
+            function(key.view(), value, stop);
+            if (stop) {
+                return;
+            }
+        }
+    }
+    
     /**
      * @brief Get the object with the specific key.
-     * @param rKey The key of the object to retrieve.
-     * @return The object.
+     * @details The lookup never allocates and never modifies the dictionary. std::string, C strings and string views are all accepted without a copy.
+     * @param key The key of the object to retrieve.
+     * @return The object. nullptr if the key is not in the dictionary.
      */
-    SXObject* objectForKey(const std::string& rKey) const;
+    SXObject* objectForKey(std::string_view key) const;
+    
+    /**
+     * @brief Get the object with the specific key, using a precomputed hash.
+     * @param key The key of the object to retrieve.
+     * @param hash The value returned by hashForKey() for this key.
+     * @return The object. nullptr if the key is not in the dictionary.
+     */
+    SXObject* objectForKey(std::string_view key, size_t hash) const;
+    
+    /**
+     * @brief Get the object with the specific key, given as an atom.
+     * @details The hash stored in the atom is used, and keys that were added as the same atom match by pointer comparison.
+     * @param atom The key of the object to retrieve.
+     * @return The object. nullptr if the key is not in the dictionary.
+     */
+    SXObject* objectForKey(SXAtom atom) const;
     
     /**
      * @brief Add object to the dictionary.
      * @details The reference count of the object is increased by 1.
      * @param pObject The object to add.
-     * @param rKey The key to assign to the object.
+     * @param key The key to assign to the object.
+     */
+    void setObject(SXObject* pObject, std::string_view key);
+    
+    /**
+     * @brief Add object to the dictionary, using a precomputed hash.
+     * @details The reference count of the object is increased by 1.
+     * @param pObject The object to add.
+     * @param key The key to assign to the object.
+     * @param hash The value returned by hashForKey() for this key.
+     */
+    void setObject(SXObject* pObject, std::string_view key, size_t hash);
+    
+    /**
+     * @brief Add object to the dictionary with an atom as key.
+     * @details The reference count of the object is increased by 1. The key characters are not copied.
+     * @param pObject The object to add.
+     * @param atom The key to assign to the object.
+     */
+    void setObject(SXObject* pObject, SXAtom atom);
+    
+    /**
+     * @brief Add all entries of another dictionary.
+     * @details The table is sized once for both dictionaries, and the stored hashes of the other dictionary are reused. The reference count of each added object is increased by 1. Objects of keys present in both dictionaries are replaced.
+     * @param pDictionary The dictionary whose entries are added.
+     */
+    void addEntriesFromDictionary(const SXDictionary* pDictionary);
+    
+    /**
+     * @brief Pre-size the dictionary.
+     * @details Adding up to count elements in total will not rehash the table.
+     * @param count The number of elements to make room for.
      */
-    void setObject(SXObject* pObject, const std::string& rKey);
+    void reserve(unsigned int count);
+    
+    /**
+     * @brief Attach a Bloom filter of the keys, checked before the table by every lookup.
+     * @details Worth it for large dictionaries queried mostly with keys they do not have: most of them are rejected by reading one cache line, before probing the table and comparing keys. The filter is updated on each insertion, and rebuilt from the table when the dictionary has grown past its capacity or after many removals. Replaces the current filter.
+     * @param falsePositiveRate The rate of lookups of missing keys that still probe the table, such as 0.01.
+     */
+    void enableBloomFilter(double falsePositiveRate);
+    
+    /**
+     * @brief Detach and release the Bloom filter.
+     */
+    void disableBloomFilter();
+    
+    /**
+     * @brief Get the Bloom filter of the keys.
+     * @details The keys are added by their SXHashString() hash, so the filter can be serialized and queried with mightContainKey().
+     * @return The filter, owned by the dictionary. nullptr if enableBloomFilter() was not called.
+     */
+    SXBloomFilter* bloomFilter() const;
     
     /**
      * @brief Remove the object with the specific key.
      * @details The reference count of the object is decreased by 1.
-     * @param rKey The key of the object to remove.
+     * @param key The key of the object to remove.
      */
-    void removeObjectForKey(const std::string& rKey);
+    void removeObjectForKey(std::string_view key);
+    
+    /**
+     * @brief Remove the object with the specific key, given as an atom.
+     * @details The reference count of the object is decreased by 1.
+     * @param atom The key of the object to remove.
+     */
+    void removeObjectForKey(SXAtom atom);
     
     /**
      * @brief Remove all objects with the specific keys.
      * @details The reference count of each object is decreased by 1.
-     * @param pKeys Array of keys of the objects to remove.
+     * @param pKeys Array of keys (SXString objects) of the objects to remove. Elements of other types are skipped.
      */
     void removeObjectsForKeys(SXArray* pKeys);
     
@@ -119,16 +345,36 @@ public:
     
     /**
      * @brief Get the first element of the map.
-     * @return An iterator over the first element of the unordered_map.
+     * @return An iterator over the first element of the hash table.
      */
     SXDictionaryIterator begin() const;
     
     /**
      * @brief Get the last element of the map.
-     * @return An iterator over the last element of the unordered_map. If iterator reaches here, means that there are no more objects in the dictionary.
+     * @return An iterator past the last element of the hash table. If iterator reaches here, means that there are no more objects in the dictionary.
      */
     SXDictionaryIterator end() const;
     
+    /**
+     * @brief Compare dictionary with another dictionary.
+     * @details Both dictionaries must have the same keys, and the objects for each key must be equal (isEqual() is called). When both dictionaries are immutable, dictionaries with different hashes are rejected without comparing any entry.
+     * @return Whether both dictionaries have equal entries.
+     */
+    virtual bool isEqual(const SXObject* pObject) const override;
+    
+    /**
+     * @brief Get a hash value for the dictionary.
+     * @details Combines the hash of each key and object independently of their order, so dictionaries that are equal according to isEqual() have the same hash. The hash of an immutable dictionary is computed once.
+     * @return The hash value.
+     */
+    virtual size_t hash() const override;
+    
+    /**
+     * @brief Make the dictionary and all its objects immutable.
+     * @details Afterwards the methods that add or remove objects do nothing.
+     */
+    virtual void makeImmutable() override;
+    
     /**
      * @brief Perform a deep copy of the dictionary.
      * @details Create a new dictionary by copying (copy() is called) each element inside the dictionary.
@@ -136,8 +382,32 @@ public:
      */
     virtual SXObject* copy() const override;
     
+    /**
+     * @brief Build an immutable version of the dictionary, optimized for lookups.
+     * @details The objects are retained, not copied. Later changes to this dictionary do not affect the frozen one.
+     * @return The frozen dictionary. nullptr if two keys have the same hash and cannot be told apart.
+     */
+    SXFrozenDictionary* freeze() const;
+
 private:
-    std::unordered_map<std::string, SXObject*>* m_pMap; /**< Map container of all objects. */
+    SXDictionaryTable* m_pMap; /**< Hash table container of all objects. */
+    size_t m_hash{0}; /**< Hash cached by makeImmutable(). */
+    SXBloomFilter* m_pBloomFilter{nullptr}; /**< Filter of the key hashes, retained. nullptr unless enableBloomFilter() was called. */
+    
+    /**
+     * @brief Add the hash of a new key to the Bloom filter, if any.
+     */
+    void bloomFilterDidAdd(size_t hash);
+    
+    /**
+     * @brief Count a removed key against the Bloom filter, if any, and rebuild it when too many are stale.
+     */
+    void bloomFilterDidRemove();
+    
+    /**
+     * @brief Fill the Bloom filter again from the table.
+     */
+    void rebuildBloomFilter();
 };
 
 } // namespace spalx
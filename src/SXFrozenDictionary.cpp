@@ -0,0 +1,376 @@
+/**
+ * @file SXFrozenDictionary.hpp
+ * @brief Implementation of the SXFrozenDictionary class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SXFrozenDictionary.hpp"
+#include "SXString.hpp"
+#include <algorithm>
+
+namespace spalx {
+
+// Average number of keys per bucket.
+#define SX_FROZEN_DICTIONARY_BUCKET_SIZE 4
+
+// Seed flag: the other bits are the slot of the bucket's only key.
+#define SX_FROZEN_DICTIONARY_DIRECT_SLOT 0x80000000u
+
+// Number of seeds tried for a bucket before giving up.
+#define SX_FROZEN_DICTIONARY_MAX_SEEDS (1u << 24)
+
+/**
+ * @brief Spread the bits of a hash (MurmurHash3 finalizer).
+ */
+static inline uint64_t mixHash(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/**
+ * @brief Map the high 32 bits of a mixed hash to a bucket.
+ */
+static inline size_t bucketForMixedHash(uint64_t mixedHash, size_t bucketCount)
+{
+    return static_cast<size_t>(((mixedHash >> 32) * bucketCount) >> 32);
+}
+
+/**
+ * @brief Map a hash and a seed to a slot.
+ */
+static inline size_t slotForSeed(size_t hash, uint32_t seed, size_t slotCount)
+{
+    uint32_t mixed = static_cast<uint32_t>(mixHash(hash + (seed + 1) * 0x9E3779B97F4A7C15ull));
+    return static_cast<size_t>((static_cast<uint64_t>(mixed) * slotCount) >> 32);
+}
+
+SXFrozenDictionary::SXFrozenDictionary()
+{
+    m_pSeeds = new std::vector<uint32_t>;
+    m_pTags = new std::vector<uint16_t>;
+    m_pSlots = new std::vector<SXFrozenDictionarySlot>;
+    m_pKeyBytes = new std::vector<char>;
+}
+
+SXFrozenDictionary::~SXFrozenDictionary()
+{
+    for (unsigned int i = 0; i < m_count; i++) {
+        (*m_pSlots)[i].pObject->release();
+    }
+    delete m_pSeeds;
+    m_pSeeds = nullptr;
+    delete m_pTags;
+    m_pTags = nullptr;
+    delete m_pSlots;
+    m_pSlots = nullptr;
+    delete m_pKeyBytes;
+    m_pKeyBytes = nullptr;
+}
+
+SXFrozenDictionary* SXFrozenDictionary::createWithDictionary(const SXDictionary* pDictionary)
+{
+    SXFrozenDictionary* pFrozenDictionary = new SXFrozenDictionary();
+    
+    if (!pFrozenDictionary->build(pDictionary)) {
+        pFrozenDictionary->release();
+        return nullptr;
+    }
+    
+    pFrozenDictionary->autorelease();
+    return pFrozenDictionary;
+}
+
+bool SXFrozenDictionary::build(const SXDictionary* pDictionary)
+{
+    size_t count = pDictionary->count();
+    if (count == 0) {
+        return true;
+    }
+    if (count >= SX_FROZEN_DICTIONARY_DIRECT_SLOT) {
+        return false;
+    }
+    
+    struct Entry
+    {
+        size_t hash;
+        const SXDictionaryKey* pKey;
+        SXObject* pObject;
+    };
+    
+    // Group the entries by bucket (counting sort).
+    size_t bucketCount = (count + SX_FROZEN_DICTIONARY_BUCKET_SIZE - 1) / SX_FROZEN_DICTIONARY_BUCKET_SIZE;
+    std::vector<uint32_t> bucketStarts(bucketCount + 1, 0);
+    for (const auto& [key, value]: *pDictionary) {
+        bucketStarts[bucketForMixedHash(mixHash(key.hash()), bucketCount) + 1]++;
+    }
+    for (size_t i = 0; i < bucketCount; i++) {
+        bucketStarts[i + 1] += bucketStarts[i];
+    }
+    std::vector<Entry> entries(count);
+    std::vector<uint32_t> fill(bucketStarts.begin(), bucketStarts.end() - 1);
+    for (const auto& [key, value]: *pDictionary) {
+        size_t bucket = bucketForMixedHash(mixHash(key.hash()), bucketCount);
+        entries[fill[bucket]++] = Entry{key.hash(), &key, value};
+    }
+    
+    // Place the largest buckets first, while the table is still mostly free.
+    std::vector<uint32_t> order(bucketCount);
+    for (size_t i = 0; i < bucketCount; i++) {
+        order[i] = static_cast<uint32_t>(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&bucketStarts](uint32_t a, uint32_t b) {
+        return bucketStarts[a + 1] - bucketStarts[a] > bucketStarts[b + 1] - bucketStarts[b];
+    });
+    
+    m_pSeeds->assign(bucketCount, 0);
+    std::vector<bool> taken(count, false);
+    std::vector<uint32_t> slots(count);
+    std::vector<size_t> candidates;
+    size_t freeSlot = 0;
+    for (uint32_t bucket: order) {
+        uint32_t start = bucketStarts[bucket];
+        uint32_t size = bucketStarts[bucket + 1] - start;
+        if (size == 0) {
+            break;
+        }
+        
+        if (size == 1) {
+            // A single key takes the next free slot directly, no seed search needed.
+            while (taken[freeSlot]) {
+                freeSlot++;
+            }
+            taken[freeSlot] = true;
+            slots[start] = static_cast<uint32_t>(freeSlot);
+            (*m_pSeeds)[bucket] = SX_FROZEN_DICTIONARY_DIRECT_SLOT | static_cast<uint32_t>(freeSlot);
+            continue;
+        }
+        
+        // Keys with the same hash would always collide.
+        for (uint32_t i = start; i < start + size; i++) {
+            for (uint32_t j = start; j < i; j++) {
+                if (entries[i].hash == entries[j].hash) {
+                    return false;
+                }
+            }
+        }
+        
+        uint32_t seed = 0;
+        for (; seed < SX_FROZEN_DICTIONARY_MAX_SEEDS; seed++) {
+            candidates.clear();
+            for (uint32_t i = start; i < start + size; i++) {
+                size_t slot = slotForSeed(entries[i].hash, seed, count);
+                if (taken[slot] || std::find(candidates.begin(), candidates.end(), slot) != candidates.end()) {
+                    break;
+                }
+                candidates.push_back(slot);
+            }
+            if (candidates.size() == size) {
+                break;
+            }
+        }
+        if (seed == SX_FROZEN_DICTIONARY_MAX_SEEDS) {
+            return false;
+        }
+        
+        for (uint32_t i = 0; i < size; i++) {
+            taken[candidates[i]] = true;
+            slots[start + i] = static_cast<uint32_t>(candidates[i]);
+        }
+        (*m_pSeeds)[bucket] = seed;
+    }
+    
+    // Lay the entries out in slot order.
+    std::vector<const Entry*> slotEntries(count);
+    size_t keyBytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        slotEntries[slots[i]] = &entries[i];
+        keyBytes += entries[i].pKey->length() + 1;
+    }
+    if (keyBytes > UINT32_MAX) {
+        return false;
+    }
+    
+    m_pTags->reserve(count);
+    m_pSlots->reserve(count + 1);
+    m_pKeyBytes->reserve(keyBytes);
+    for (const Entry* pEntry: slotEntries) {
+        std::string_view key = pEntry->pKey->view();
+        pEntry->pObject->retain();
+        m_pTags->push_back(static_cast<uint16_t>(pEntry->hash >> 16));
+        m_pSlots->push_back(SXFrozenDictionarySlot{static_cast<uint32_t>(pEntry->hash), static_cast<uint32_t>(m_pKeyBytes->size()), pEntry->pObject});
+        m_pKeyBytes->insert(m_pKeyBytes->end(), key.begin(), key.end());
+        m_pKeyBytes->push_back('\0');
+    }
+    m_pSlots->push_back(SXFrozenDictionarySlot{0, static_cast<uint32_t>(m_pKeyBytes->size()), nullptr});
+    m_count = static_cast<unsigned int>(count);
+    return true;
+}
+
+size_t SXFrozenDictionary::slotForHash(size_t hash) const
+{
+    uint32_t seed = (*m_pSeeds)[bucketForMixedHash(mixHash(hash), m_pSeeds->size())];
+    size_t slot = slotForSeed(hash, seed, m_count);
+    // Compiled into a conditional move, not a branch.
+    return (seed & SX_FROZEN_DICTIONARY_DIRECT_SLOT) ? (seed & ~SX_FROZEN_DICTIONARY_DIRECT_SLOT) : slot;
+}
+
+SXObject* SXFrozenDictionary::operator[](std::string_view key) const
+{
+    return objectForKey(key);
+}
+
+unsigned int SXFrozenDictionary::count() const
+{
+    return m_count;
+}
+
+SXArray* SXFrozenDictionary::allKeys() const
+{
+    SXArray* pKeys = SXArray::createWithCapacity(m_count);
+    for (unsigned int i = 0; i < m_count; i++) {
+        std::string_view key = keyAtIndex(i);
+        SXString* pKey = SXString::newWithCharacters(key.data(), key.length());
+        pKeys->addObject(pKey);
+        pKey->release();
+    }
+    return pKeys;
+}
+
+SXObject* SXFrozenDictionary::objectForKey(std::string_view key) const
+{
+    return objectForKey(key, SXDictionary::hashForKey(key));
+}
+
+SXObject* SXFrozenDictionary::objectForKey(std::string_view key, size_t hash) const
+{
+    if (m_count == 0) {
+        return nullptr;
+    }
+    
+    size_t slot = slotForHash(hash);
+    // A missing key almost always fails the tag comparison, so the slot and the characters are not read.
+    if ((*m_pTags)[slot] != static_cast<uint16_t>(hash >> 16)) {
+        return nullptr;
+    }
+    const SXFrozenDictionarySlot& rSlot = (*m_pSlots)[slot];
+    bool found = (rSlot.fingerprint == static_cast<uint32_t>(hash)) && (keyAtIndex(static_cast<unsigned int>(slot)) == key);
+    return found ? rSlot.pObject : nullptr;
+}
+
+SXObject* SXFrozenDictionary::objectForKey(SXAtom atom) const
+{
+    return objectForKey(atom.view(), atom.hash());
+}
+
+std::string_view SXFrozenDictionary::keyAtIndex(unsigned int index) const
+{
+    uint32_t offset = (*m_pSlots)[index].keyOffset;
+    return std::string_view(m_pKeyBytes->data() + offset, (*m_pSlots)[index + 1].keyOffset - offset - 1);
+}
+
+SXObject* SXFrozenDictionary::objectAtIndex(unsigned int index) const
+{
+    return (*m_pSlots)[index].pObject;
+}
+
+size_t SXFrozenDictionary::byteSize() const
+{
+    return m_pSeeds->capacity() * sizeof(uint32_t) + m_pTags->capacity() * sizeof(uint16_t) + m_pSlots->capacity() * sizeof(SXFrozenDictionarySlot) + m_pKeyBytes->capacity();
+}
+
+bool SXFrozenDictionary::isEqual(const SXObject* pObject) const
+{
+    if (pObject == this) {
+        return true;
+    }
+    
+    const SXFrozenDictionary* pOtherDictionary = dynamic_cast<const SXFrozenDictionary*>(pObject);
+    if (!pOtherDictionary || pOtherDictionary->m_count != m_count) {
+        return false;
+    }
+    
+    // Cached hashes of immutable dictionaries reject most unequal dictionaries without visiting the entries.
+    if (m_immutable && pOtherDictionary->m_immutable && m_hash != pOtherDictionary->m_hash) {
+        return false;
+    }
+    
+    for (unsigned int i = 0; i < m_count; i++) {
+        SXObject* pValue = (*m_pSlots)[i].pObject;
+        SXObject* pOtherValue = pOtherDictionary->objectForKey(keyAtIndex(i));
+        if (!pOtherValue || (pOtherValue != pValue && !pValue->isEqual(pOtherValue))) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+size_t SXFrozenDictionary::hash() const
+{
+    if (m_immutable) {
+        return m_hash;
+    }
+    
+    // Entries are combined by addition, so the hash does not depend on the slot order.
+    size_t hash = m_count;
+    for (unsigned int i = 0; i < m_count; i++) {
+        hash += SXHashMix(SXHashString(keyAtIndex(i)) * 31 + (*m_pSlots)[i].pObject->hash());
+    }
+    return hash;
+}
+
+void SXFrozenDictionary::makeImmutable()
+{
+    if (m_immutable) {
+        return;
+    }
+    
+    for (unsigned int i = 0; i < m_count; i++) {
+        (*m_pSlots)[i].pObject->makeImmutable();
+    }
+    m_hash = hash();
+    m_immutable = true;
+}
+
+SXObject* SXFrozenDictionary::copy() const
+{
+    SXDictionary* pDictionary = new SXDictionary();
+    for (unsigned int i = 0; i < m_count; i++) {
+        SXObject* pTmpObject = (*m_pSlots)[i].pObject->copy();
+        if (pTmpObject) {
+            pDictionary->setObject(pTmpObject, keyAtIndex(i));
+            pTmpObject->release();
+        }
+    }
+    
+    SXFrozenDictionary* pFrozenDictionary = new SXFrozenDictionary();
+    pFrozenDictionary->build(pDictionary);
+    pDictionary->release();
+    return pFrozenDictionary;
+}
+
+}
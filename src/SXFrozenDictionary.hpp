@@ -0,0 +1,206 @@
+/**
+ * @file SXFrozenDictionary.hpp
+ * @brief Declaration of the SXFrozenDictionary class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SXFrozenDictionary_hpp
+#define SXFrozenDictionary_hpp
+
+#include "SXObject.hpp"
+#include "SXArray.hpp"
+#include "SXAtom.hpp"
+#include "SXDictionary.hpp"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace spalx {
+
+/**
+ * @brief Slot of a frozen dictionary.
+ * @details 16 bytes, so a lookup finds everything but the key characters in a single cache line.
+ */
+struct SXFrozenDictionarySlot
+{
+    uint32_t fingerprint; /**< Low 32 bits of the hash of the key. */
+    uint32_t keyOffset; /**< Offset of the key in the key buffer. */
+    SXObject* pObject; /**< The object. */
+};
+
+/**
+ * @class SXFrozenDictionary
+ * @brief Immutable collection of key-value pairs, built once for fast lookups.
+ * @details Backed by a minimal perfect hash (hash and displace): keys are grouped in small buckets, and each bucket stores a seed chosen so that its keys land on distinct slots. A table of n keys has exactly n slots, stored in one array of 16-byte slots (32-bit fingerprint, key offset, object) with all key characters in a single buffer. A lookup reads one seed and one slot. A missing key is almost always rejected by a dense array of 16-bit tags, without touching the slots or the key characters.
+ */
+class SXFrozenDictionary : public SXObject
+{
+public:
+    /**
+     * @brief Destructor.
+     * @details Releases all objects of the dictionary.
+     */
+    ~SXFrozenDictionary();
+    
+    /**
+     * @brief Create a frozen dictionary with the contents of a dictionary.
+     * @details The keys keep the hash computed when they were added to the dictionary. Each object is retained.
+     * @param pDictionary The dictionary to freeze.
+     * @return The new frozen dictionary. nullptr if two keys have the same hash and cannot be told apart.
+     */
+    static SXFrozenDictionary* createWithDictionary(const SXDictionary* pDictionary);
+    
+    /**
+     * @brief Overloaded subscript operator to access elements by key.
+     * @param key The key of the element to access.
+     * @return The object for the specified key. nullptr if the key is not in the dictionary.
+     */
+    SXObject* operator[](std::string_view key) const;
+    
+    /**
+     * @brief Get the number of elements in the dictionary.
+     * @return The number of elements.
+     */
+    unsigned int count() const;
+    
+    /**
+     * @brief Get all the keys from the dictionary.
+     * @details The array is allocated once with the right capacity. The strings are owned by the array only, they are not added to the autorelease pool.
+     * @return Array of strings (the keys).
+     */
+    SXArray* allKeys() const;
+    
+    /**
+     * @brief Call a function for each entry of the dictionary, in slot order.
+     * @details Nothing is allocated or copied: the key is a view of the stored characters.
+     * @param function Callable invoked as function(std::string_view key, SXObject* pObject, bool& rStop). Set rStop to true to stop the enumeration.
+     */
+    template <typename Function>
+    void enumerateKeysAndObjects(Function&& function) const
+    {
+        bool stop = false;
+        for (unsigned int i = 0; i < m_count; i++) {
+            function(keyAtIndex(i), objectAtIndex(i), stop);
+            if (stop) {
+                return;
+            }
+        }
+    }
+    
+    /**
+     * @brief Get the object with the specific key.
+     * @param key The key of the object to retrieve.
+     * @return The object. nullptr if the key is not in the dictionary.
+     */
+    SXObject* objectForKey(std::string_view key) const;
+    
+    /**
+     * @brief Get the object with the specific key, using a precomputed hash.
+     * @param key The key of the object to retrieve.
+     * @param hash The value returned by SXDictionary::hashForKey() for this key.
+     * @return The object. nullptr if the key is not in the dictionary.
+     */
+    SXObject* objectForKey(std::string_view key, size_t hash) const;
+    
+    /**
+     * @brief Get the object with the specific key, given as an atom.
+     * @param atom The key of the object to retrieve.
+     * @return The object. nullptr if the key is not in the dictionary.
+     */
+    SXObject* objectForKey(SXAtom atom) const;
+    
+    /**
+     * @brief Get the key stored in a slot.
+     * @param index The slot, less than count().
+     * @return A view of the key characters, followed by a NUL character.
+     */
+    std::string_view keyAtIndex(unsigned int index) const;
+    
+    /**
+     * @brief Get the object stored in a slot.
+     * @param index The slot, less than count().
+     * @return The object.
+     */
+    SXObject* objectAtIndex(unsigned int index) const;
+    
+    /**
+     * @brief Get the memory used by the table.
+     * @return The size of the arrays in bytes, excluding the objects.
+     */
+    size_t byteSize() const;
+    
+    /**
+     * @brief Compare dictionary with another frozen dictionary.
+     * @details Both dictionaries must have the same keys, and the objects for each key must be equal (isEqual() is called). When both dictionaries are immutable, dictionaries with different hashes are rejected without comparing any entry.
+     * @return Whether both dictionaries have equal entries.
+     */
+    virtual bool isEqual(const SXObject* pObject) const override;
+    
+    /**
+     * @brief Get a hash value for the dictionary.
+     * @details Combines the hash of each key and object independently of their order, so dictionaries that are equal according to isEqual() have the same hash. The hash of an immutable dictionary is computed once.
+     * @return The hash value.
+     */
+    virtual size_t hash() const override;
+    
+    /**
+     * @brief Make all objects of the dictionary immutable.
+     * @details The keys can never change, but the objects can until this is called. Afterwards the hash is cached.
+     */
+    virtual void makeImmutable() override;
+    
+    /**
+     * @brief Perform a deep copy of the dictionary.
+     * @details Create a new frozen dictionary by copying (copy() is called) each element inside the dictionary.
+     * @return The new copied dictionary.
+     */
+    virtual SXObject* copy() const override;
+
+private:
+    unsigned int m_count{0}; /**< Number of keys, and of slots. */
+    std::vector<uint32_t>* m_pSeeds{nullptr}; /**< Seed of each bucket. */
+    std::vector<uint16_t>* m_pTags{nullptr}; /**< Bits 16 to 31 of the hash of each slot's key, packed densely for misses. */
+    std::vector<SXFrozenDictionarySlot>* m_pSlots{nullptr}; /**< The slots, plus a last one holding the end offset of the keys. */
+    std::vector<char>* m_pKeyBytes{nullptr}; /**< Characters of all keys in slot order, each followed by a NUL character. */
+    size_t m_hash{0}; /**< Hash cached by makeImmutable(). */
+    
+    /**
+     * @brief Default constructor.
+     * @details Use createWithDictionary() or SXDictionary::freeze().
+     */
+    SXFrozenDictionary();
+    
+    /**
+     * @brief Place the keys of a dictionary and fill the arrays.
+     * @return Whether every key could be placed.
+     */
+    bool build(const SXDictionary* pDictionary);
+    
+    /**
+     * @brief Get the slot that a key can occupy.
+     */
+    size_t slotForHash(size_t hash) const;
+};
+
+} // namespace spalx
+
+#endif // SXFrozenDictionary_hpp
@@ -0,0 +1,555 @@
+/**
+ * @file SXHashTable.hpp
+ * @brief Declaration and implementation of the SXHashTable class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SXHashTable_hpp
+#define SXHashTable_hpp
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SX_HASH_TABLE_USE_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace spalx {
+
+// Number of control bytes scanned at once when probing.
+#define SX_HASH_TABLE_GROUP_WIDTH 16
+
+/**
+ * @class SXHashTable
+ * @brief Open-addressing hash table used as storage engine by the collection classes.
+ * @details Swiss table layout: one control byte per slot holds either a state (empty/deleted) or the low 7 bits of the slot's hash, and slots are stored contiguously in the same allocation. A probe compares a whole group of 16 control bytes at once (with SSE2 when available) and only touches the slots whose 7 bits match. Lookups accept any key type the Hash and KeyEqual functors accept, so callers can probe with a view of the key instead of building a Key.
+ * @tparam Key Stored key type.
+ * @tparam Value Stored value type. When void the table is a set and each slot holds only the key.
+ * @tparam Hash Functor returning the hash of a key (or of any lookup type).
+ * @tparam KeyEqual Functor comparing a stored key with a lookup key.
+ */
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+class SXHashTable
+{
+public:
+    typedef typename std::conditional<std::is_void<Value>::value, Key, std::pair<Key, Value>>::type SlotType;
+    
+    /**
+     * @class Iterator
+     * @brief Forward iterator over the occupied slots of the table.
+     * @details Iterators are invalidated by any insertion or removal. Keys must not be modified through an iterator.
+     */
+    class Iterator
+    {
+    public:
+        Iterator() {}
+        
+        Iterator(const int8_t* pCtrl, const int8_t* pCtrlEnd, SlotType* pSlot)
+        :m_pCtrl(pCtrl), m_pCtrlEnd(pCtrlEnd), m_pSlot(pSlot)
+        {
+            skipFreeSlots();
+        }
+        
+        SlotType& operator*() const { return *m_pSlot; }
+        SlotType* operator->() const { return m_pSlot; }
+        
+        Iterator& operator++()
+        {
+            m_pCtrl++;
+            m_pSlot++;
+            skipFreeSlots();
+            return *this;
+        }
+        
+        Iterator operator++(int)
+        {
+            Iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+        
+        bool operator==(const Iterator& rOther) const { return m_pCtrl == rOther.m_pCtrl; }
+        bool operator!=(const Iterator& rOther) const { return m_pCtrl != rOther.m_pCtrl; }
+    
+    private:
+        friend class SXHashTable;
+        
+        const int8_t* m_pCtrl{nullptr}; /**< Control byte of the current slot. */
+        const int8_t* m_pCtrlEnd{nullptr}; /**< One past the last control byte. */
+        SlotType* m_pSlot{nullptr}; /**< Current slot. */
+        
+        /**
+         * @brief Advance until an occupied slot or the end is reached.
+         */
+        void skipFreeSlots()
+        {
+            while (m_pCtrl != m_pCtrlEnd && *m_pCtrl < 0) {
+                m_pCtrl++;
+                m_pSlot++;
+            }
+        }
+    };
+    
+    /**
+     * @brief Constructor.
+     * @details No memory is allocated until the first insertion.
+     * @param rHash Hash functor instance.
+     * @param rKeyEqual Key equality functor instance.
+     */
+    explicit SXHashTable(const Hash& rHash = Hash(), const KeyEqual& rKeyEqual = KeyEqual())
+    :m_hash(rHash), m_keyEqual(rKeyEqual)
+    {
+    }
+    
+    SXHashTable(const SXHashTable&) = delete;
+    SXHashTable& operator=(const SXHashTable&) = delete;
+    
+    /**
+     * @brief Destructor.
+     * @details Destroys all slots and frees the storage.
+     */
+    ~SXHashTable()
+    {
+        destroySlots();
+        deallocate();
+    }
+    
+    /**
+     * @brief Get the number of occupied slots.
+     * @return The number of elements.
+     */
+    size_t size() const { return m_size; }
+    
+    /**
+     * @brief Check whether the table has no elements.
+     * @return Whether the table is empty.
+     */
+    bool empty() const { return m_size == 0; }
+    
+    /**
+     * @brief Get the number of slots currently allocated.
+     * @return The capacity.
+     */
+    size_t capacity() const { return m_capacity; }
+    
+    /**
+     * @brief Get the hash of a key, as used by the table.
+     * @param rKey The key (or any lookup type accepted by Hash).
+     * @return The hash value, which may be passed to the precomputed-hash overloads.
+     */
+    template <typename LookupKey>
+    size_t hashForKey(const LookupKey& rKey) const
+    {
+        return m_hash(rKey);
+    }
+    
+    Iterator begin() const { return Iterator(m_pCtrl, m_pCtrl + m_capacity, m_pSlots); }
+    Iterator end() const { return Iterator(m_pCtrl + m_capacity, m_pCtrl + m_capacity, m_pSlots + m_capacity); }
+    
+    /**
+     * @brief Find the slot holding a key.
+     * @param rKey The key to find.
+     * @return Iterator to the slot, or end() if the key is not in the table.
+     */
+    template <typename LookupKey>
+    Iterator find(const LookupKey& rKey) const
+    {
+        return find(rKey, m_hash(rKey));
+    }
+    
+    /**
+     * @brief Find the slot holding a key whose hash is already known.
+     * @param rKey The key to find.
+     * @param hash The value hashForKey() returns for rKey.
+     * @return Iterator to the slot, or end() if the key is not in the table.
+     */
+    template <typename LookupKey>
+    Iterator find(const LookupKey& rKey, size_t hash) const
+    {
+        size_t index = findIndex(rKey, hash);
+        return (index == SIZE_MAX) ? end() : iteratorAt(index);
+    }
+    
+    /**
+     * @brief Insert a slot for a key unless the key is already present.
+     * @details The slot is constructed from slotArgs only when the key is not found, so the arguments may be tuples for std::piecewise_construct.
+     * @param rKey The key to look for.
+     * @param hash The value hashForKey() returns for rKey.
+     * @param slotArgs Constructor arguments of the slot.
+     * @return Iterator to the slot holding the key, and whether a new slot was inserted.
+     */
+    template <typename LookupKey, typename... Args>
+    std::pair<Iterator, bool> emplace(const LookupKey& rKey, size_t hash, Args&&... slotArgs)
+    {
+        size_t index = findIndex(rKey, hash);
+        if (index != SIZE_MAX) {
+            return std::make_pair(iteratorAt(index), false);
+        }
+        index = emplaceNew(hash, std::forward<Args>(slotArgs)...);
+        return std::make_pair(iteratorAt(index), true);
+    }
+    
+    /**
+     * @brief Insert a slot without checking whether the key is already present.
+     * @details Only valid when the caller knows the key is not in the table.
+     * @param hash The hash of the slot's key.
+     * @param slotArgs Constructor arguments of the slot.
+     * @return Iterator to the new slot.
+     */
+    template <typename... Args>
+    Iterator emplaceUnique(size_t hash, Args&&... slotArgs)
+    {
+        return iteratorAt(emplaceNew(hash, std::forward<Args>(slotArgs)...));
+    }
+    
+    /**
+     * @brief Remove the slot pointed to by an iterator.
+     * @param it A valid iterator returned by this table.
+     */
+    void erase(Iterator it)
+    {
+        eraseAt(static_cast<size_t>(it.m_pSlot - m_pSlots));
+    }
+    
+    /**
+     * @brief Remove the slot holding a key.
+     * @param rKey The key to remove.
+     * @return Whether a slot was removed.
+     */
+    template <typename LookupKey>
+    bool erase(const LookupKey& rKey)
+    {
+        size_t index = findIndex(rKey, m_hash(rKey));
+        if (index == SIZE_MAX) {
+            return false;
+        }
+        eraseAt(index);
+        return true;
+    }
+    
+    /**
+     * @brief Remove all slots.
+     * @details The storage is kept so the table can be refilled without reallocating.
+     */
+    void clear()
+    {
+        destroySlots();
+        if (m_capacity > 0) {
+            std::fill(m_pCtrl, m_pCtrl + m_capacity, kCtrlEmpty);
+        }
+        m_size = 0;
+        m_growthLeft = maxLoad(m_capacity);
+    }
+    
+    /**
+     * @brief Pre-size the table so it can hold a number of elements without rehashing.
+     * @param count The number of elements to make room for.
+     */
+    void reserve(size_t count)
+    {
+        if (count > m_size + m_growthLeft) {
+            rehash(capacityForCount(count));
+        }
+    }
+
+private:
+    static constexpr int8_t kCtrlEmpty = -128; /**< Control byte of a slot that was never used. */
+    static constexpr int8_t kCtrlDeleted = -2; /**< Control byte of a removed slot (tombstone). */
+    
+    Hash m_hash; /**< Hash functor. */
+    KeyEqual m_keyEqual; /**< Key equality functor. */
+    int8_t* m_pCtrl{emptyGroup()}; /**< Control bytes, one per slot. */
+    SlotType* m_pSlots{nullptr}; /**< Slot storage (same allocation as the control bytes). */
+    size_t m_capacity{0}; /**< Number of slots, a power-of-two multiple of the group width. */
+    size_t m_size{0}; /**< Number of occupied slots. */
+    size_t m_growthLeft{0}; /**< Number of empty slots that may still be filled before the table grows. */
+    
+    /**
+     * @brief Control group used by tables that have not allocated yet, so lookups need no special case.
+     */
+    static int8_t* emptyGroup()
+    {
+        alignas(16) static int8_t group[SX_HASH_TABLE_GROUP_WIDTH] = {
+            kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty,
+            kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty
+        };
+        return group;
+    }
+    
+    /**
+     * @brief Get the key of a slot.
+     */
+    static const Key& slotKey(const SlotType& rSlot)
+    {
+        if constexpr (std::is_void<Value>::value) {
+            return rSlot;
+        } else {
+            return rSlot.first;
+        }
+    }
+    
+    /**
+     * @brief Spread the bits of a user hash so that both the group index and the 7 control bits are well distributed.
+     */
+    static size_t mixHash(size_t hash)
+    {
+        uint64_t h = static_cast<uint64_t>(hash);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h);
+    }
+    
+    static int8_t h2(size_t mixedHash) { return static_cast<int8_t>(mixedHash & 0x7F); }
+    static size_t h1(size_t mixedHash) { return mixedHash >> 7; }
+    
+    static size_t maxLoad(size_t capacity) { return capacity - capacity / 8; }
+    
+    static size_t capacityForCount(size_t count)
+    {
+        size_t capacity = SX_HASH_TABLE_GROUP_WIDTH;
+        while (maxLoad(capacity) < count) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+    
+    static unsigned int trailingZeros(unsigned int mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<unsigned int>(index);
+#else
+        return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+    }
+    
+    /**
+     * @brief Get a bit mask of the group's control bytes equal to a value.
+     */
+    static unsigned int matchByte(const int8_t* pGroup, int8_t byte)
+    {
+#ifdef SX_HASH_TABLE_USE_SSE2
+        __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pGroup));
+        return static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(byte), ctrl)));
+#else
+        unsigned int mask = 0;
+        for (unsigned int i = 0; i < SX_HASH_TABLE_GROUP_WIDTH; i++) {
+            if (pGroup[i] == byte) {
+                mask |= 1u << i;
+            }
+        }
+        return mask;
+#endif
+    }
+    
+    /**
+     * @brief Get a bit mask of the group's free (empty or deleted) slots.
+     */
+    static unsigned int matchFree(const int8_t* pGroup)
+    {
+#ifdef SX_HASH_TABLE_USE_SSE2
+        // Occupied control bytes are in [0, 127], free ones are negative.
+        __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pGroup));
+        return static_cast<unsigned int>(_mm_movemask_epi8(ctrl));
+#else
+        unsigned int mask = 0;
+        for (unsigned int i = 0; i < SX_HASH_TABLE_GROUP_WIDTH; i++) {
+            if (pGroup[i] < 0) {
+                mask |= 1u << i;
+            }
+        }
+        return mask;
+#endif
+    }
+    
+    Iterator iteratorAt(size_t index) const
+    {
+        Iterator it;
+        it.m_pCtrl = m_pCtrl + index;
+        it.m_pCtrlEnd = m_pCtrl + m_capacity;
+        it.m_pSlot = m_pSlots + index;
+        return it;
+    }
+    
+    size_t groupMask() const
+    {
+        return (m_capacity == 0) ? 0 : (m_capacity / SX_HASH_TABLE_GROUP_WIDTH - 1);
+    }
+    
+    /**
+     * @brief Probe for a key.
+     * @details Groups are visited in triangular order, which covers every group of a power-of-two table. A group containing an empty slot ends the probe, since an insertion never skips past one.
+     * @return The slot index, or SIZE_MAX if the key is not in the table.
+     */
+    template <typename LookupKey>
+    size_t findIndex(const LookupKey& rKey, size_t hash) const
+    {
+        size_t mixed = mixHash(hash);
+        int8_t tag = h2(mixed);
+        size_t mask = groupMask();
+        size_t group = h1(mixed) & mask;
+        
+        for (size_t step = 1; ; step++) {
+            const int8_t* pGroup = m_pCtrl + group * SX_HASH_TABLE_GROUP_WIDTH;
+            for (unsigned int match = matchByte(pGroup, tag); match != 0; match &= match - 1) {
+                size_t index = group * SX_HASH_TABLE_GROUP_WIDTH + trailingZeros(match);
+                if (m_keyEqual(slotKey(m_pSlots[index]), rKey)) {
+                    return index;
+                }
+            }
+            if (matchByte(pGroup, kCtrlEmpty) != 0) {
+                return SIZE_MAX;
+            }
+            group = (group + step) & mask;
+        }
+    }
+    
+    /**
+     * @brief Get the first free slot on the probe sequence of a hash.
+     */
+    size_t findFreeIndex(size_t mixedHash) const
+    {
+        size_t mask = groupMask();
+        size_t group = h1(mixedHash) & mask;
+        
+        for (size_t step = 1; ; step++) {
+            unsigned int match = matchFree(m_pCtrl + group * SX_HASH_TABLE_GROUP_WIDTH);
+            if (match != 0) {
+                return group * SX_HASH_TABLE_GROUP_WIDTH + trailingZeros(match);
+            }
+            group = (group + step) & mask;
+        }
+    }
+    
+    template <typename... Args>
+    size_t emplaceNew(size_t hash, Args&&... slotArgs)
+    {
+        size_t mixed = mixHash(hash);
+        size_t index = findFreeIndex(mixed);
+        
+        if (m_growthLeft == 0 && m_pCtrl[index] == kCtrlEmpty) {
+            // Reclaim tombstones when they make up a large part of the table, otherwise double it.
+            rehash((m_size * 2 <= maxLoad(m_capacity)) ? capacityForCount(m_size + 1) : capacityForCount(m_capacity + 1));
+            index = findFreeIndex(mixed);
+        }
+        
+        if (m_pCtrl[index] == kCtrlEmpty) {
+            m_growthLeft--;
+        }
+        m_pCtrl[index] = h2(mixed);
+        new (m_pSlots + index) SlotType(std::forward<Args>(slotArgs)...);
+        m_size++;
+        
+        return index;
+    }
+    
+    void eraseAt(size_t index)
+    {
+        m_pSlots[index].~SlotType();
+        
+        // The slot can go back to empty when its group still has an empty slot,
+        // because then no probe sequence ever continued past this group.
+        const int8_t* pGroup = m_pCtrl + (index & ~static_cast<size_t>(SX_HASH_TABLE_GROUP_WIDTH - 1));
+        if (matchByte(pGroup, kCtrlEmpty) != 0) {
+            m_pCtrl[index] = kCtrlEmpty;
+            m_growthLeft++;
+        } else {
+            m_pCtrl[index] = kCtrlDeleted;
+        }
+        m_size--;
+    }
+    
+    void destroySlots()
+    {
+        if constexpr (!std::is_trivially_destructible<SlotType>::value) {
+            for (size_t i = 0; i < m_capacity; i++) {
+                if (m_pCtrl[i] >= 0) {
+                    m_pSlots[i].~SlotType();
+                }
+            }
+        }
+    }
+    
+    static size_t slotsOffset(size_t capacity)
+    {
+        size_t alignment = alignof(SlotType);
+        return (capacity + alignment - 1) / alignment * alignment;
+    }
+    
+    void deallocate()
+    {
+        if (m_capacity > 0) {
+            ::operator delete(m_pCtrl);
+        }
+        m_pCtrl = emptyGroup();
+        m_pSlots = nullptr;
+        m_capacity = 0;
+    }
+    
+    /**
+     * @brief Move all slots into a new allocation with the given capacity.
+     */
+    void rehash(size_t capacity)
+    {
+        int8_t* pOldCtrl = m_pCtrl;
+        SlotType* pOldSlots = m_pSlots;
+        size_t oldCapacity = m_capacity;
+        
+        char* pStorage = static_cast<char*>(::operator new(slotsOffset(capacity) + capacity * sizeof(SlotType)));
+        m_pCtrl = reinterpret_cast<int8_t*>(pStorage);
+        m_pSlots = reinterpret_cast<SlotType*>(pStorage + slotsOffset(capacity));
+        m_capacity = capacity;
+        std::fill(m_pCtrl, m_pCtrl + capacity, kCtrlEmpty);
+        
+        for (size_t i = 0; i < oldCapacity; i++) {
+            if (pOldCtrl[i] >= 0) {
+                size_t mixed = mixHash(m_hash(slotKey(pOldSlots[i])));
+                size_t index = findFreeIndex(mixed);
+                m_pCtrl[index] = h2(mixed);
+                new (m_pSlots + index) SlotType(std::move(pOldSlots[i]));
+                pOldSlots[i].~SlotType();
+            }
+        }
+        
+        m_growthLeft = maxLoad(capacity) - m_size;
+        
+        if (oldCapacity > 0) {
+            ::operator delete(pOldCtrl);
+        }
+    }
+};
+
+} // namespace spalx
+
+#endif // SXHashTable_hpp
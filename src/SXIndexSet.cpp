@@ -0,0 +1,837 @@
+/**
+ * @file SXIndexSet.hpp
+ * @brief Implementation of the SXIndexSet class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SXIndexSet.hpp"
+#include "SXCommon.hpp"
+#include "SXNumber.hpp"
+#include <algorithm>
+#include <climits>
+#include <iterator>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SX_INDEX_SET_USE_SSE2 1
+#endif
+
+namespace spalx {
+
+/**
+ * @brief Count the bits set in a word.
+ */
+static inline uint32_t popCount(uint64_t word)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    return static_cast<uint32_t>(__popcnt64(word));
+#elif defined(_MSC_VER)
+    return static_cast<uint32_t>(__popcnt(static_cast<uint32_t>(word)) + __popcnt(static_cast<uint32_t>(word >> 32)));
+#else
+    return static_cast<uint32_t>(__builtin_popcountll(word));
+#endif
+}
+
+static inline bool testBit(const std::vector<uint64_t>& rBitmap, uint16_t low)
+{
+    return (rBitmap[low >> 6] >> (low & 63)) & 1;
+}
+
+/**
+ * @brief Count the bits set in a bitmap container.
+ */
+static uint32_t bitmapCardinality(const std::vector<uint64_t>& rBitmap)
+{
+    uint32_t cardinality = 0;
+    for (uint64_t word : rBitmap) {
+        cardinality += popCount(word);
+    }
+    return cardinality;
+}
+
+/**
+ * @brief Set or clear the bits from first to last, both included.
+ */
+static void setBitRange(std::vector<uint64_t>& rBitmap, uint32_t first, uint32_t last, bool value)
+{
+    uint32_t firstWord = first >> 6;
+    uint32_t lastWord = last >> 6;
+    uint64_t firstMask = ~0ull << (first & 63);
+    uint64_t lastMask = ~0ull >> (63 - (last & 63));
+    if (firstWord == lastWord) {
+        firstMask &= lastMask;
+        lastMask = firstMask;
+    }
+    
+    for (uint32_t word = firstWord; word <= lastWord; word++) {
+        uint64_t mask = (word == firstWord) ? firstMask : ((word == lastWord) ? lastMask : ~0ull);
+        rBitmap[word] = value ? (rBitmap[word] | mask) : (rBitmap[word] & ~mask);
+    }
+}
+
+/**
+ * @brief Turn an array container into a bitmap container.
+ */
+static void convertToBitmap(SXIndexSetContainer& rContainer)
+{
+    rContainer.bitmap.assign(SX_INDEX_SET_BITMAP_WORDS, 0);
+    for (uint16_t low : rContainer.array) {
+        rContainer.bitmap[low >> 6] |= 1ull << (low & 63);
+    }
+    rContainer.array = std::vector<uint16_t>();
+}
+
+/**
+ * @brief Give a container the smaller of its two forms, and make its cardinality match an array.
+ * @details Called after every change, so a container with more than SX_INDEX_SET_ARRAY_MAX members is always a bitmap and one with fewer always an array.
+ */
+static void normalize(SXIndexSetContainer& rContainer)
+{
+    if (!rContainer.isBitmap()) {
+        rContainer.cardinality = static_cast<uint32_t>(rContainer.array.size());
+        if (rContainer.cardinality > SX_INDEX_SET_ARRAY_MAX) {
+            convertToBitmap(rContainer);
+        }
+    } else if (rContainer.cardinality <= SX_INDEX_SET_ARRAY_MAX) {
+        std::vector<uint16_t> array;
+        array.reserve(rContainer.cardinality);
+        for (uint32_t word = 0; word < SX_INDEX_SET_BITMAP_WORDS; word++) {
+            for (uint64_t bits = rContainer.bitmap[word]; bits; bits &= bits - 1) {
+                array.push_back(static_cast<uint16_t>((word << 6) + popCount((bits & (0 - bits)) - 1)));
+            }
+        }
+        rContainer.array = std::move(array);
+        rContainer.bitmap = std::vector<uint64_t>();
+    }
+}
+
+/**
+ * @brief Bitwise operations combining two bitmap containers.
+ */
+struct SXIndexSetOr
+{
+    static uint64_t word(uint64_t a, uint64_t b) { return a | b; }
+#ifdef SX_INDEX_SET_USE_SSE2
+    static __m128i vector(__m128i a, __m128i b) { return _mm_or_si128(a, b); }
+#endif
+};
+
+struct SXIndexSetAnd
+{
+    static uint64_t word(uint64_t a, uint64_t b) { return a & b; }
+#ifdef SX_INDEX_SET_USE_SSE2
+    static __m128i vector(__m128i a, __m128i b) { return _mm_and_si128(a, b); }
+#endif
+};
+
+struct SXIndexSetAndNot
+{
+    static uint64_t word(uint64_t a, uint64_t b) { return a & ~b; }
+#ifdef SX_INDEX_SET_USE_SSE2
+    static __m128i vector(__m128i a, __m128i b) { return _mm_andnot_si128(b, a); }
+#endif
+};
+
+/**
+ * @brief Combine a bitmap with another one, 128 bits at a time when SSE2 is available.
+ * @return The number of bits set in the result.
+ */
+template <typename Operation>
+static uint32_t combineBitmaps(std::vector<uint64_t>& rBitmap, const std::vector<uint64_t>& rOtherBitmap)
+{
+    uint64_t* pWords = rBitmap.data();
+    const uint64_t* pOtherWords = rOtherBitmap.data();
+    uint32_t cardinality = 0;
+#ifdef SX_INDEX_SET_USE_SSE2
+    for (uint32_t word = 0; word < SX_INDEX_SET_BITMAP_WORDS; word += 2) {
+        __m128i result = Operation::vector(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pWords + word)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(pOtherWords + word)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pWords + word), result);
+        cardinality += popCount(pWords[word]) + popCount(pWords[word + 1]);
+    }
+#else
+    for (uint32_t word = 0; word < SX_INDEX_SET_BITMAP_WORDS; word++) {
+        pWords[word] = Operation::word(pWords[word], pOtherWords[word]);
+        cardinality += popCount(pWords[word]);
+    }
+#endif
+    return cardinality;
+}
+
+/**
+ * @brief Visit the values two sorted arrays have in common.
+ * @details When one array is much smaller, its values are searched in the other with a binary search that only moves forward, instead of merging.
+ * @param output Called with each common value, in ascending order.
+ */
+template <typename Output>
+static void intersectArrays(const std::vector<uint16_t>& rArray, const std::vector<uint16_t>& rOtherArray, Output output)
+{
+    const std::vector<uint16_t>& rSmall = (rArray.size() <= rOtherArray.size()) ? rArray : rOtherArray;
+    const std::vector<uint16_t>& rLarge = (&rSmall == &rArray) ? rOtherArray : rArray;
+    if (rSmall.size() * 32 < rLarge.size()) {
+        auto it = rLarge.begin();
+        for (uint16_t value : rSmall) {
+            it = std::lower_bound(it, rLarge.end(), value);
+            if (it == rLarge.end()) {
+                return;
+            }
+            if (*it == value) {
+                output(value);
+            }
+        }
+        return;
+    }
+    
+    auto it = rSmall.begin();
+    auto otherIt = rLarge.begin();
+    while (it != rSmall.end() && otherIt != rLarge.end()) {
+        if (*it < *otherIt) {
+            ++it;
+        } else if (*otherIt < *it) {
+            ++otherIt;
+        } else {
+            output(*it);
+            ++it;
+            ++otherIt;
+        }
+    }
+}
+
+/**
+ * @brief Add the members of a container to another container of the same key.
+ */
+static void unionContainers(SXIndexSetContainer& rContainer, const SXIndexSetContainer& rOtherContainer)
+{
+    if (!rContainer.isBitmap() && !rOtherContainer.isBitmap() && rContainer.cardinality + rOtherContainer.cardinality <= SX_INDEX_SET_ARRAY_MAX) {
+        std::vector<uint16_t> array;
+        array.reserve(rContainer.cardinality + rOtherContainer.cardinality);
+        std::set_union(rContainer.array.begin(), rContainer.array.end(), rOtherContainer.array.begin(), rOtherContainer.array.end(), std::back_inserter(array));
+        rContainer.array = std::move(array);
+        normalize(rContainer);
+        return;
+    }
+    
+    if (!rContainer.isBitmap() && rOtherContainer.isBitmap()) {
+        std::vector<uint16_t> array = std::move(rContainer.array);
+        rContainer.bitmap = rOtherContainer.bitmap;
+        rContainer.cardinality = rOtherContainer.cardinality;
+        rContainer.array = std::vector<uint16_t>();
+        for (uint16_t low : array) {
+            uint64_t bit = 1ull << (low & 63);
+            rContainer.cardinality += !(rContainer.bitmap[low >> 6] & bit);
+            rContainer.bitmap[low >> 6] |= bit;
+        }
+    } else if (rOtherContainer.isBitmap()) {
+        rContainer.cardinality = combineBitmaps<SXIndexSetOr>(rContainer.bitmap, rOtherContainer.bitmap);
+    } else {
+        if (!rContainer.isBitmap()) {
+            convertToBitmap(rContainer);
+        }
+        for (uint16_t low : rOtherContainer.array) {
+            uint64_t bit = 1ull << (low & 63);
+            rContainer.cardinality += !(rContainer.bitmap[low >> 6] & bit);
+            rContainer.bitmap[low >> 6] |= bit;
+        }
+    }
+    normalize(rContainer);
+}
+
+/**
+ * @brief Keep the members of a container that are in another container of the same key.
+ */
+static void intersectContainers(SXIndexSetContainer& rContainer, const SXIndexSetContainer& rOtherContainer)
+{
+    if (rContainer.isBitmap() && rOtherContainer.isBitmap()) {
+        rContainer.cardinality = combineBitmaps<SXIndexSetAnd>(rContainer.bitmap, rOtherContainer.bitmap);
+    } else if (rContainer.isBitmap()) {
+        std::vector<uint16_t> array;
+        array.reserve(rOtherContainer.cardinality);
+        for (uint16_t low : rOtherContainer.array) {
+            if (testBit(rContainer.bitmap, low)) {
+                array.push_back(low);
+            }
+        }
+        rContainer.array = std::move(array);
+        rContainer.bitmap = std::vector<uint64_t>();
+    } else if (rOtherContainer.isBitmap()) {
+        const std::vector<uint64_t>& rBitmap = rOtherContainer.bitmap;
+        rContainer.array.erase(std::remove_if(rContainer.array.begin(), rContainer.array.end(), [&rBitmap](uint16_t low) { return !testBit(rBitmap, low); }), rContainer.array.end());
+    } else {
+        std::vector<uint16_t> array;
+        array.reserve(std::min(rContainer.cardinality, rOtherContainer.cardinality));
+        intersectArrays(rContainer.array, rOtherContainer.array, [&array](uint16_t low) { array.push_back(low); });
+        rContainer.array = std::move(array);
+    }
+    normalize(rContainer);
+}
+
+/**
+ * @brief Remove the members of a container that are in another container of the same key.
+ */
+static void subtractContainers(SXIndexSetContainer& rContainer, const SXIndexSetContainer& rOtherContainer)
+{
+    if (rContainer.isBitmap() && rOtherContainer.isBitmap()) {
+        rContainer.cardinality = combineBitmaps<SXIndexSetAndNot>(rContainer.bitmap, rOtherContainer.bitmap);
+    } else if (rContainer.isBitmap()) {
+        for (uint16_t low : rOtherContainer.array) {
+            uint64_t bit = 1ull << (low & 63);
+            rContainer.cardinality -= !!(rContainer.bitmap[low >> 6] & bit);
+            rContainer.bitmap[low >> 6] &= ~bit;
+        }
+    } else if (rOtherContainer.isBitmap()) {
+        const std::vector<uint64_t>& rBitmap = rOtherContainer.bitmap;
+        rContainer.array.erase(std::remove_if(rContainer.array.begin(), rContainer.array.end(), [&rBitmap](uint16_t low) { return testBit(rBitmap, low); }), rContainer.array.end());
+    } else {
+        std::vector<uint16_t> array;
+        array.reserve(rContainer.cardinality);
+        std::set_difference(rContainer.array.begin(), rContainer.array.end(), rOtherContainer.array.begin(), rOtherContainer.array.end(), std::back_inserter(array));
+        rContainer.array = std::move(array);
+    }
+    normalize(rContainer);
+}
+
+/**
+ * @brief Count the members two containers of the same key have in common.
+ */
+static uint32_t intersectionCardinality(const SXIndexSetContainer& rContainer, const SXIndexSetContainer& rOtherContainer)
+{
+    uint32_t cardinality = 0;
+    if (rContainer.isBitmap() && rOtherContainer.isBitmap()) {
+        for (uint32_t word = 0; word < SX_INDEX_SET_BITMAP_WORDS; word++) {
+            cardinality += popCount(rContainer.bitmap[word] & rOtherContainer.bitmap[word]);
+        }
+    } else if (rContainer.isBitmap() || rOtherContainer.isBitmap()) {
+        const SXIndexSetContainer& rBitmapContainer = rContainer.isBitmap() ? rContainer : rOtherContainer;
+        const SXIndexSetContainer& rArrayContainer = rContainer.isBitmap() ? rOtherContainer : rContainer;
+        for (uint16_t low : rArrayContainer.array) {
+            cardinality += testBit(rBitmapContainer.bitmap, low);
+        }
+    } else {
+        intersectArrays(rContainer.array, rOtherContainer.array, [&cardinality](uint16_t) { cardinality++; });
+    }
+    return cardinality;
+}
+
+/**
+ * @brief Get the last index of a range, which stops at the largest unsigned int.
+ */
+static inline unsigned int lastIndexOfRange(unsigned int location, unsigned int length)
+{
+    return (length - 1 > UINT_MAX - location) ? UINT_MAX : location + (length - 1);
+}
+
+/**
+ * @brief Read the value of an object if it is an SXNumber<T>.
+ * @return Whether the object was an SXNumber<T>. rValid receives whether its value is an unsigned int, and rIndex the value.
+ */
+template <typename T>
+static bool indexOfNumber(const SXObject* pObject, unsigned int& rIndex, bool& rValid)
+{
+    const SXNumber<T>* pNumber = dynamic_cast<const SXNumber<T>*>(pObject);
+    if (!pNumber) {
+        return false;
+    }
+    
+    T value = pNumber->getValue();
+    if constexpr (std::is_signed_v<T>) {
+        rValid = value >= 0 && static_cast<unsigned long long>(value) <= UINT_MAX;
+    } else {
+        rValid = static_cast<unsigned long long>(value) <= UINT_MAX;
+    }
+    rIndex = static_cast<unsigned int>(value);
+    return true;
+}
+
+/**
+ * @brief Get the index represented by an object.
+ * @return Whether the object is an integer SXNumber whose value is an unsigned int.
+ */
+static bool indexOfObject(const SXObject* pObject, unsigned int& rIndex)
+{
+    bool valid = false;
+    indexOfNumber<unsigned int>(pObject, rIndex, valid) || indexOfNumber<int>(pObject, rIndex, valid) ||
+    indexOfNumber<unsigned long long>(pObject, rIndex, valid) || indexOfNumber<long long>(pObject, rIndex, valid) ||
+    indexOfNumber<unsigned long>(pObject, rIndex, valid) || indexOfNumber<long>(pObject, rIndex, valid) ||
+    indexOfNumber<unsigned short>(pObject, rIndex, valid) || indexOfNumber<short>(pObject, rIndex, valid) ||
+    indexOfNumber<unsigned char>(pObject, rIndex, valid) || indexOfNumber<char>(pObject, rIndex, valid);
+    return valid;
+}
+
+SXIndexSet::SXIndexSet()
+:m_pContainers(new std::vector<SXIndexSetContainer>())
+{
+}
+
+SXIndexSet::~SXIndexSet()
+{
+    delete m_pContainers;
+    m_pContainers = nullptr;
+}
+
+SXIndexSet* SXIndexSet::create()
+{
+    SXIndexSet* pIndexSet = new SXIndexSet();
+    
+    if (pIndexSet) {
+        pIndexSet->autorelease();
+    }
+    
+    return pIndexSet;
+}
+
+SXIndexSet* SXIndexSet::createWithIndexesInRange(unsigned int location, unsigned int length)
+{
+    SXIndexSet* pIndexSet = create();
+    pIndexSet->addIndexesInRange(location, length);
+    return pIndexSet;
+}
+
+SXIndexSet* SXIndexSet::createWithArray(const SXArray* pArray)
+{
+    SXIndexSet* pIndexSet = create();
+    if (pArray) {
+        std::vector<unsigned int> indexes;
+        indexes.reserve(pArray->count());
+        for (unsigned int i = 0; i < pArray->count(); i++) {
+            unsigned int index;
+            if (indexOfObject(pArray->objectAtIndex(i), index)) {
+                indexes.push_back(index);
+            }
+        }
+        pIndexSet->addIndexes(indexes);
+    }
+    return pIndexSet;
+}
+
+SXIndexSet* SXIndexSet::createWithSet(const SXSet* pSet)
+{
+    SXIndexSet* pIndexSet = create();
+    if (pSet) {
+        std::vector<unsigned int> indexes;
+        indexes.reserve(pSet->count());
+        for (SXObject* pObj : *pSet) {
+            unsigned int index;
+            if (indexOfObject(pObj, index)) {
+                indexes.push_back(index);
+            }
+        }
+        pIndexSet->addIndexes(indexes);
+    }
+    return pIndexSet;
+}
+
+size_t SXIndexSet::count() const
+{
+    size_t count = 0;
+    for (const SXIndexSetContainer& rContainer : *m_pContainers) {
+        count += rContainer.cardinality;
+    }
+    return count;
+}
+
+bool SXIndexSet::containsIndex(unsigned int index) const
+{
+    uint16_t key = static_cast<uint16_t>(index >> 16);
+    auto it = std::lower_bound(m_pContainers->begin(), m_pContainers->end(), key, [](const SXIndexSetContainer& rContainer, uint16_t key) { return rContainer.key < key; });
+    if (it == m_pContainers->end() || it->key != key) {
+        return false;
+    }
+    
+    uint16_t low = static_cast<uint16_t>(index);
+    return it->isBitmap() ? testBit(it->bitmap, low) : std::binary_search(it->array.begin(), it->array.end(), low);
+}
+
+void SXIndexSet::addIndex(unsigned int index)
+{
+    if (!checkMutable()) {
+        return;
+    }
+    
+    SXIndexSetContainer* pContainer = containerForKey(static_cast<uint16_t>(index >> 16), true);
+    uint16_t low = static_cast<uint16_t>(index);
+    if (pContainer->isBitmap()) {
+        uint64_t bit = 1ull << (low & 63);
+        pContainer->cardinality += !(pContainer->bitmap[low >> 6] & bit);
+        pContainer->bitmap[low >> 6] |= bit;
+        return;
+    }
+    
+    auto it = std::lower_bound(pContainer->array.begin(), pContainer->array.end(), low);
+    if (it == pContainer->array.end() || *it != low) {
+        pContainer->array.insert(it, low);
+        normalize(*pContainer);
+    }
+}
+
+void SXIndexSet::addIndexesInRange(unsigned int location, unsigned int length)
+{
+    if (!checkMutable() || length == 0) {
+        return;
+    }
+    
+    unsigned int last = lastIndexOfRange(location, length);
+    uint32_t firstKey = location >> 16;
+    uint32_t lastKey = last >> 16;
+    for (uint32_t key = firstKey; key <= lastKey; key++) {
+        uint32_t firstLow = (key == firstKey) ? (location & 0xFFFF) : 0;
+        uint32_t lastLow = (key == lastKey) ? (last & 0xFFFF) : 0xFFFF;
+        SXIndexSetContainer* pContainer = containerForKey(static_cast<uint16_t>(key), true);
+        if (pContainer->isBitmap() || pContainer->cardinality + (lastLow - firstLow + 1) > SX_INDEX_SET_ARRAY_MAX) {
+            if (!pContainer->isBitmap()) {
+                convertToBitmap(*pContainer);
+            }
+            setBitRange(pContainer->bitmap, firstLow, lastLow, true);
+            pContainer->cardinality = bitmapCardinality(pContainer->bitmap);
+        } else {
+            std::vector<uint16_t> array;
+            array.reserve(pContainer->cardinality + (lastLow - firstLow + 1));
+            auto it = std::lower_bound(pContainer->array.begin(), pContainer->array.end(), static_cast<uint16_t>(firstLow));
+            array.insert(array.end(), pContainer->array.begin(), it);
+            for (uint32_t low = firstLow; low <= lastLow; low++) {
+                array.push_back(static_cast<uint16_t>(low));
+            }
+            array.insert(array.end(), std::upper_bound(it, pContainer->array.end(), static_cast<uint16_t>(lastLow)), pContainer->array.end());
+            pContainer->array = std::move(array);
+        }
+        normalize(*pContainer);
+    }
+}
+
+void SXIndexSet::removeIndex(unsigned int index)
+{
+    if (!checkMutable()) {
+        return;
+    }
+    
+    SXIndexSetContainer* pContainer = containerForKey(static_cast<uint16_t>(index >> 16), false);
+    if (!pContainer) {
+        return;
+    }
+    
+    uint16_t low = static_cast<uint16_t>(index);
+    if (pContainer->isBitmap()) {
+        uint64_t bit = 1ull << (low & 63);
+        pContainer->cardinality -= !!(pContainer->bitmap[low >> 6] & bit);
+        pContainer->bitmap[low >> 6] &= ~bit;
+    } else {
+        auto it = std::lower_bound(pContainer->array.begin(), pContainer->array.end(), low);
+        if (it == pContainer->array.end() || *it != low) {
+            return;
+        }
+        pContainer->array.erase(it);
+    }
+    normalize(*pContainer);
+    removeEmptyContainers();
+}
+
+void SXIndexSet::removeIndexesInRange(unsigned int location, unsigned int length)
+{
+    if (!checkMutable() || length == 0) {
+        return;
+    }
+    
+    unsigned int last = lastIndexOfRange(location, length);
+    uint32_t firstKey = location >> 16;
+    uint32_t lastKey = last >> 16;
+    for (SXIndexSetContainer& rContainer : *m_pContainers) {
+        if (rContainer.key < firstKey || rContainer.key > lastKey) {
+            continue;
+        }
+        
+        uint32_t firstLow = (rContainer.key == firstKey) ? (location & 0xFFFF) : 0;
+        uint32_t lastLow = (rContainer.key == lastKey) ? (last & 0xFFFF) : 0xFFFF;
+        if (rContainer.isBitmap()) {
+            setBitRange(rContainer.bitmap, firstLow, lastLow, false);
+            rContainer.cardinality = bitmapCardinality(rContainer.bitmap);
+        } else {
+            auto it = std::lower_bound(rContainer.array.begin(), rContainer.array.end(), static_cast<uint16_t>(firstLow));
+            rContainer.array.erase(it, std::upper_bound(it, rContainer.array.end(), static_cast<uint16_t>(lastLow)));
+        }
+        normalize(rContainer);
+    }
+    removeEmptyContainers();
+}
+
+void SXIndexSet::removeAllIndexes()
+{
+    if (!checkMutable()) {
+        return;
+    }
+    
+    m_pContainers->clear();
+}
+
+void SXIndexSet::unionIndexSet(const SXIndexSet* pOtherIndexSet)
+{
+    if (!checkMutable() || !pOtherIndexSet || pOtherIndexSet == this) {
+        return;
+    }
+    
+    // Both container lists are sorted by key, so they are merged in one pass.
+    std::vector<SXIndexSetContainer> containers;
+    containers.reserve(m_pContainers->size() + pOtherIndexSet->m_pContainers->size());
+    auto it = m_pContainers->begin();
+    auto otherIt = pOtherIndexSet->m_pContainers->begin();
+    while (it != m_pContainers->end() || otherIt != pOtherIndexSet->m_pContainers->end()) {
+        if (otherIt == pOtherIndexSet->m_pContainers->end() || (it != m_pContainers->end() && it->key < otherIt->key)) {
+            containers.push_back(std::move(*it++));
+        } else if (it == m_pContainers->end() || otherIt->key < it->key) {
+            containers.push_back(*otherIt++);
+        } else {
+            unionContainers(*it, *otherIt++);
+            containers.push_back(std::move(*it++));
+        }
+    }
+    *m_pContainers = std::move(containers);
+}
+
+void SXIndexSet::intersectIndexSet(const SXIndexSet* pOtherIndexSet)
+{
+    if (!checkMutable() || !pOtherIndexSet || pOtherIndexSet == this) {
+        return;
+    }
+    
+    auto otherIt = pOtherIndexSet->m_pContainers->begin();
+    for (SXIndexSetContainer& rContainer : *m_pContainers) {
+        while (otherIt != pOtherIndexSet->m_pContainers->end() && otherIt->key < rContainer.key) {
+            ++otherIt;
+        }
+        if (otherIt == pOtherIndexSet->m_pContainers->end() || otherIt->key != rContainer.key) {
+            rContainer.cardinality = 0;
+        } else {
+            intersectContainers(rContainer, *otherIt);
+        }
+    }
+    removeEmptyContainers();
+}
+
+void SXIndexSet::minusIndexSet(const SXIndexSet* pOtherIndexSet)
+{
+    if (!checkMutable() || !pOtherIndexSet) {
+        return;
+    }
+    
+    if (pOtherIndexSet == this) {
+        removeAllIndexes();
+        return;
+    }
+    
+    auto otherIt = pOtherIndexSet->m_pContainers->begin();
+    for (SXIndexSetContainer& rContainer : *m_pContainers) {
+        while (otherIt != pOtherIndexSet->m_pContainers->end() && otherIt->key < rContainer.key) {
+            ++otherIt;
+        }
+        if (otherIt != pOtherIndexSet->m_pContainers->end() && otherIt->key == rContainer.key) {
+            subtractContainers(rContainer, *otherIt);
+        }
+    }
+    removeEmptyContainers();
+}
+
+size_t SXIndexSet::countOfIntersectionWithIndexSet(const SXIndexSet* pOtherIndexSet) const
+{
+    if (!pOtherIndexSet) {
+        return 0;
+    }
+    
+    size_t count = 0;
+    auto otherIt = pOtherIndexSet->m_pContainers->begin();
+    for (const SXIndexSetContainer& rContainer : *m_pContainers) {
+        while (otherIt != pOtherIndexSet->m_pContainers->end() && otherIt->key < rContainer.key) {
+            ++otherIt;
+        }
+        if (otherIt != pOtherIndexSet->m_pContainers->end() && otherIt->key == rContainer.key) {
+            count += intersectionCardinality(rContainer, *otherIt);
+        }
+    }
+    return count;
+}
+
+bool SXIndexSet::intersectsIndexSet(const SXIndexSet* pOtherIndexSet) const
+{
+    if (!pOtherIndexSet) {
+        return false;
+    }
+    
+    auto otherIt = pOtherIndexSet->m_pContainers->begin();
+    for (const SXIndexSetContainer& rContainer : *m_pContainers) {
+        while (otherIt != pOtherIndexSet->m_pContainers->end() && otherIt->key < rContainer.key) {
+            ++otherIt;
+        }
+        if (otherIt != pOtherIndexSet->m_pContainers->end() && otherIt->key == rContainer.key && intersectionCardinality(rContainer, *otherIt) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+SXArray* SXIndexSet::arrayOfNumbers() const
+{
+    size_t count = this->count();
+    SXArray* pArray = SXArray::createWithCapacity(static_cast<unsigned int>(std::min<size_t>(count, UINT_MAX)));
+    for (unsigned int index : *this) {
+        SXNumber<unsigned int>* pNumber = new SXNumber<unsigned int>(index);
+        pArray->addObject(pNumber);
+        pNumber->release();
+    }
+    return pArray;
+}
+
+SXSet* SXIndexSet::setOfNumbers() const
+{
+    SXSet* pSet = SXSet::createWithMembership(SXSetMembershipEquality);
+    pSet->reserve(static_cast<unsigned int>(std::min<size_t>(count(), UINT_MAX)));
+    for (unsigned int index : *this) {
+        SXNumber<unsigned int>* pNumber = new SXNumber<unsigned int>(index);
+        pSet->addObject(pNumber);
+        pNumber->release();
+    }
+    return pSet;
+}
+
+size_t SXIndexSet::memoryUsage() const
+{
+    size_t bytes = m_pContainers->capacity() * sizeof(SXIndexSetContainer);
+    for (const SXIndexSetContainer& rContainer : *m_pContainers) {
+        bytes += rContainer.array.capacity() * sizeof(uint16_t) + rContainer.bitmap.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+}
+
+SXIndexSetIterator SXIndexSet::begin() const
+{
+    return SXIndexSetIterator(m_pContainers, 0);
+}
+
+SXIndexSetIterator SXIndexSet::end() const
+{
+    return SXIndexSetIterator(m_pContainers, m_pContainers->size());
+}
+
+bool SXIndexSet::isEqual(const SXObject* pObject) const
+{
+    if (pObject == this) {
+        return true;
+    }
+    
+    const SXIndexSet* pOtherIndexSet = dynamic_cast<const SXIndexSet*>(pObject);
+    if (!pOtherIndexSet || pOtherIndexSet->m_pContainers->size() != m_pContainers->size()) {
+        return false;
+    }
+    
+    if (m_immutable && pOtherIndexSet->m_immutable && m_hash != pOtherIndexSet->m_hash) {
+        return false;
+    }
+    
+    // Containers always have the smaller form, so equal sets have identical containers.
+    for (size_t i = 0; i < m_pContainers->size(); i++) {
+        const SXIndexSetContainer& rContainer = (*m_pContainers)[i];
+        const SXIndexSetContainer& rOtherContainer = (*pOtherIndexSet->m_pContainers)[i];
+        if (rContainer.key != rOtherContainer.key || rContainer.cardinality != rOtherContainer.cardinality || rContainer.array != rOtherContainer.array || rContainer.bitmap != rOtherContainer.bitmap) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t SXIndexSet::hash() const
+{
+    if (m_immutable) {
+        return m_hash;
+    }
+    
+    size_t hash = m_pContainers->size();
+    for (const SXIndexSetContainer& rContainer : *m_pContainers) {
+        hash = hash * 31 + static_cast<size_t>(SXHashMix64((static_cast<uint64_t>(rContainer.key) << 32) | rContainer.cardinality));
+        for (uint16_t low : rContainer.array) {
+            hash = hash * 31 + low;
+        }
+        for (uint64_t word : rContainer.bitmap) {
+            hash = hash * 31 + static_cast<size_t>(word);
+        }
+    }
+    return SXHashMix(hash);
+}
+
+void SXIndexSet::makeImmutable()
+{
+    if (m_immutable) {
+        return;
+    }
+    
+    m_hash = hash();
+    m_immutable = true;
+}
+
+SXObject* SXIndexSet::copy() const
+{
+    SXIndexSet* pIndexSet = new SXIndexSet();
+    *pIndexSet->m_pContainers = *m_pContainers;
+    return pIndexSet;
+}
+
+SXIndexSetContainer* SXIndexSet::containerForKey(uint16_t key, bool create)
+{
+    auto it = std::lower_bound(m_pContainers->begin(), m_pContainers->end(), key, [](const SXIndexSetContainer& rContainer, uint16_t key) { return rContainer.key < key; });
+    if (it != m_pContainers->end() && it->key == key) {
+        return &*it;
+    }
+    
+    if (!create) {
+        return nullptr;
+    }
+    
+    return &*m_pContainers->insert(it, SXIndexSetContainer{key, 0, {}, {}});
+}
+
+void SXIndexSet::addIndexes(std::vector<unsigned int>& rIndexes)
+{
+    std::sort(rIndexes.begin(), rIndexes.end());
+    rIndexes.erase(std::unique(rIndexes.begin(), rIndexes.end()), rIndexes.end());
+    
+    // Each run of indexes with the same high 16 bits becomes one container, merged into the existing one if any.
+    size_t begin = 0;
+    while (begin < rIndexes.size()) {
+        uint16_t key = static_cast<uint16_t>(rIndexes[begin] >> 16);
+        size_t end = begin;
+        SXIndexSetContainer container{key, 0, {}, {}};
+        while (end < rIndexes.size() && (rIndexes[end] >> 16) == key) {
+            container.array.push_back(static_cast<uint16_t>(rIndexes[end++]));
+        }
+        normalize(container);
+        
+        SXIndexSetContainer* pContainer = containerForKey(key, false);
+        if (pContainer) {
+            unionContainers(*pContainer, container);
+        } else {
+            *containerForKey(key, true) = std::move(container);
+        }
+        begin = end;
+    }
+}
+
+void SXIndexSet::removeEmptyContainers()
+{
+    m_pContainers->erase(std::remove_if(m_pContainers->begin(), m_pContainers->end(), [](const SXIndexSetContainer& rContainer) { return rContainer.cardinality == 0; }), m_pContainers->end());
+}
+
+}
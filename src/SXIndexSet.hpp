@@ -0,0 +1,348 @@
+/**
+ * @file SXIndexSet.hpp
+ * @brief Declaration of the SXIndexSetIterator and SXIndexSet classes.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SXIndexSet_hpp
+#define SXIndexSet_hpp
+
+#include "SXObject.hpp"
+#include "SXArray.hpp"
+#include "SXSet.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace spalx {
+
+// Maximum number of members of an array container; containers with more members are bitmaps.
+#define SX_INDEX_SET_ARRAY_MAX 4096
+
+// Number of 64-bit words of a bitmap container (65536 bits).
+#define SX_INDEX_SET_BITMAP_WORDS 1024
+
+/**
+ * @brief Members of an SXIndexSet sharing the same high 16 bits.
+ * @details A container holding up to SX_INDEX_SET_ARRAY_MAX members is a sorted array of their low 16 bits (2 bytes per member), a fuller one is a bitmap of 65536 bits (8 KB). Containers are always converted to the smaller form, so two sets with the same members have the same containers.
+ */
+struct SXIndexSetContainer
+{
+    uint16_t key; /**< High 16 bits of the members. */
+    uint32_t cardinality; /**< Number of members. */
+    std::vector<uint16_t> array; /**< Sorted low 16 bits of the members, when the container is not a bitmap. */
+    std::vector<uint64_t> bitmap; /**< SX_INDEX_SET_BITMAP_WORDS words when the container is a bitmap, empty otherwise. */
+    
+    bool isBitmap() const { return !bitmap.empty(); }
+};
+
+/**
+ * @class SXIndexSetIterator
+ * @brief Iterator over the members of an SXIndexSet, in ascending order.
+ * @details Bitmap containers are scanned a word at a time, skipping the zero bits.
+ */
+class SXIndexSetIterator
+{
+public:
+    SXIndexSetIterator(const std::vector<SXIndexSetContainer>* pContainers, size_t container)
+    :m_pContainers(pContainers), m_container(container)
+    {
+        seek();
+    }
+    
+    unsigned int operator*() const
+    {
+        const SXIndexSetContainer& rContainer = (*m_pContainers)[m_container];
+        return (static_cast<unsigned int>(rContainer.key) << 16) | (rContainer.isBitmap() ? m_position : rContainer.array[m_position]);
+    }
+    
+    SXIndexSetIterator& operator++()
+    {
+        m_position++;
+        seek();
+        return *this;
+    }
+    
+    bool operator==(const SXIndexSetIterator& rOther) const { return m_container == rOther.m_container && m_position == rOther.m_position; }
+    bool operator!=(const SXIndexSetIterator& rOther) const { return !(*this == rOther); }
+
+private:
+    const std::vector<SXIndexSetContainer>* m_pContainers; /**< Containers of the set. */
+    size_t m_container; /**< Current container. */
+    uint32_t m_position{0}; /**< Position in the array, or bit of the bitmap, of the current member. */
+    
+    /**
+     * @brief Move to the first member at or after the current position, possibly in a following container.
+     */
+    void seek()
+    {
+        while (m_container < m_pContainers->size()) {
+            const SXIndexSetContainer& rContainer = (*m_pContainers)[m_container];
+            if (!rContainer.isBitmap()) {
+                if (m_position < rContainer.array.size()) {
+                    return;
+                }
+            } else {
+                uint32_t word = m_position >> 6;
+                if (word < SX_INDEX_SET_BITMAP_WORDS) {
+                    uint64_t bits = rContainer.bitmap[word] & (~0ull << (m_position & 63));
+                    while (!bits && ++word < SX_INDEX_SET_BITMAP_WORDS) {
+                        bits = rContainer.bitmap[word];
+                    }
+                    if (bits) {
+                        m_position = (word << 6) + trailingZeros(bits);
+                        return;
+                    }
+                }
+            }
+            m_container++;
+            m_position = 0;
+        }
+    }
+    
+    static uint32_t trailingZeros(uint64_t bits)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, bits);
+        return static_cast<uint32_t>(index);
+#else
+        return static_cast<uint32_t>(__builtin_ctzll(bits));
+#endif
+    }
+};
+
+/**
+ * @class SXIndexSet
+ * @brief Set of unsigned integers stored as a compressed bitmap.
+ * @details An alternative to an SXSet of SXNumber<unsigned int> for sets of IDs or indexes, based on Roaring bitmaps. Members are grouped by their high 16 bits into containers, sorted by key: sparse groups are sorted arrays of 2 bytes per member, dense groups are bitmaps of 8 KB. A set of a million consecutive IDs takes about 128 KB, instead of tens of bytes per member for boxed numbers.
+ *
+ * Lookups are a binary search over the containers, then over the array or a bit test. Union, intersection and difference work a container at a time, and bitmap containers are combined 128 bits at a time (SSE2 when available). Counting the members of an intersection does not build it.
+ */
+class SXIndexSet : public SXObject
+{
+public:
+    /**
+     * @brief Default constructor.
+     */
+    SXIndexSet();
+    
+    /**
+     * @brief Destructor.
+     */
+    ~SXIndexSet();
+    
+    /**
+     * @brief Create a new empty index set.
+     * @return The new index set object, autoreleased.
+     */
+    static SXIndexSet* create();
+    
+    /**
+     * @brief Create a new index set with a range of consecutive indexes.
+     * @param location The first index.
+     * @param length The number of indexes. The range stops at the largest unsigned int.
+     * @return The new index set object, autoreleased.
+     */
+    static SXIndexSet* createWithIndexesInRange(unsigned int location, unsigned int length);
+    
+    /**
+     * @brief Create a new index set with the numbers of an array.
+     * @details Integer SXNumber objects whose value is an unsigned int are added, other objects are ignored.
+     * @param pArray The array.
+     * @return The new index set object, autoreleased.
+     */
+    static SXIndexSet* createWithArray(const SXArray* pArray);
+    
+    /**
+     * @brief Create a new index set with the numbers of a set.
+     * @details Integer SXNumber objects whose value is an unsigned int are added, other objects are ignored.
+     * @param pSet The set.
+     * @return The new index set object, autoreleased.
+     */
+    static SXIndexSet* createWithSet(const SXSet* pSet);
+    
+    /**
+     * @brief Get the number of indexes in the set.
+     * @details The sum of the container cardinalities, so it is O(number of containers).
+     * @return The number of indexes. A size_t, because the set can hold every unsigned int.
+     */
+    size_t count() const;
+    
+    /**
+     * @brief Check whether an index is in the set.
+     * @param index The index.
+     * @return Whether the index is a member.
+     */
+    bool containsIndex(unsigned int index) const;
+    
+    /**
+     * @brief Add an index to the set.
+     * @param index The index.
+     */
+    void addIndex(unsigned int index);
+    
+    /**
+     * @brief Add a range of consecutive indexes to the set.
+     * @details Whole words of bitmap containers are filled at once.
+     * @param location The first index.
+     * @param length The number of indexes. The range stops at the largest unsigned int.
+     */
+    void addIndexesInRange(unsigned int location, unsigned int length);
+    
+    /**
+     * @brief Remove an index from the set.
+     * @param index The index.
+     */
+    void removeIndex(unsigned int index);
+    
+    /**
+     * @brief Remove a range of consecutive indexes from the set.
+     * @param location The first index.
+     * @param length The number of indexes. The range stops at the largest unsigned int.
+     */
+    void removeIndexesInRange(unsigned int location, unsigned int length);
+    
+    /**
+     * @brief Remove all indexes from the set.
+     */
+    void removeAllIndexes();
+    
+    /**
+     * @brief Add the indexes of another index set.
+     * @param pOtherIndexSet The index set whose indexes are added.
+     */
+    void unionIndexSet(const SXIndexSet* pOtherIndexSet);
+    
+    /**
+     * @brief Remove the indexes that are not in another index set.
+     * @param pOtherIndexSet The index set to intersect with.
+     */
+    void intersectIndexSet(const SXIndexSet* pOtherIndexSet);
+    
+    /**
+     * @brief Remove the indexes that are in another index set.
+     * @param pOtherIndexSet The index set whose indexes are removed.
+     */
+    void minusIndexSet(const SXIndexSet* pOtherIndexSet);
+    
+    /**
+     * @brief Count the indexes in both this set and another index set, without building the intersection.
+     * @param pOtherIndexSet The other index set.
+     * @return The number of common indexes.
+     */
+    size_t countOfIntersectionWithIndexSet(const SXIndexSet* pOtherIndexSet) const;
+    
+    /**
+     * @brief Check whether the two index sets have at least one index in common.
+     * @param pOtherIndexSet The other index set.
+     * @return Whether the index sets intersect.
+     */
+    bool intersectsIndexSet(const SXIndexSet* pOtherIndexSet) const;
+    
+    /**
+     * @brief Build an array of the indexes as SXNumber<unsigned int> objects.
+     * @return The array, in ascending order, autoreleased.
+     */
+    SXArray* arrayOfNumbers() const;
+    
+    /**
+     * @brief Build a set of the indexes as SXNumber<unsigned int> objects.
+     * @return The set, with SXSetMembershipEquality, autoreleased.
+     */
+    SXSet* setOfNumbers() const;
+    
+    /**
+     * @brief Get the number of bytes used by the containers.
+     * @return The number of bytes, not counting the object itself.
+     */
+    size_t memoryUsage() const;
+    
+    /**
+     * @brief Get an iterator to the smallest index.
+     * @return The iterator.
+     */
+    SXIndexSetIterator begin() const;
+    
+    /**
+     * @brief Get an iterator past the largest index.
+     * @return The iterator.
+     */
+    SXIndexSetIterator end() const;
+    
+    /**
+     * @brief Compare with other object.
+     * @param pObject The object to compare with.
+     * @return Whether the object is an index set with the same indexes.
+     */
+    virtual bool isEqual(const SXObject* pObject) const override;
+    
+    /**
+     * @brief Get a hash value of the indexes.
+     * @details Computed once when the index set is immutable.
+     * @return The hash value.
+     */
+    virtual size_t hash() const override;
+    
+    /**
+     * @brief Make the index set immutable.
+     * @details The hash is computed once, here.
+     */
+    virtual void makeImmutable() override;
+    
+    /**
+     * @brief Perform a deep copy of the index set.
+     * @return The new copied object.
+     */
+    virtual SXObject* copy() const override;
+
+private:
+    std::vector<SXIndexSetContainer>* m_pContainers; /**< Containers sorted by key. Empty containers are removed. */
+    size_t m_hash{0}; /**< Hash computed by makeImmutable(). */
+    
+    /**
+     * @brief Find the container of a key.
+     * @param key High 16 bits of the indexes.
+     * @param create Whether to insert an empty container if there is none.
+     * @return The container. nullptr if there is none and create is false.
+     */
+    SXIndexSetContainer* containerForKey(uint16_t key, bool create);
+    
+    /**
+     * @brief Add many indexes at once, a container at a time.
+     * @param rIndexes The indexes, in any order. Sorted in place.
+     */
+    void addIndexes(std::vector<unsigned int>& rIndexes);
+    
+    /**
+     * @brief Remove the containers left without members.
+     */
+    void removeEmptyContainers();
+};
+
+} // namespace spalx
+
+#endif // SXIndexSet_hpp
@@ -0,0 +1,1374 @@
+/**
+ * @file SXJSONSerialization.hpp
+ * @brief Implementation of the SXJSONSerialization class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SXJSONSerialization.hpp"
+#include "SXArray.hpp"
+#include "SXAtom.hpp"
+#include "SXDictionary.hpp"
+#include "SXFrozenDictionary.hpp"
+#include "SXNull.hpp"
+#include "SXNumber.hpp"
+#include "SXOrderedDictionary.hpp"
+#include "SXSortedDictionary.hpp"
+#include "SXString.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SX_JSON_USE_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace spalx {
+
+// Number of entries of the parser's cache of recently interned keys (a power of two).
+#define SX_JSON_ATOM_CACHE_SIZE 256
+
+// Bound on the exponents read when telling overflow from underflow, far past the range of a double.
+#define SX_JSON_MAX_DECIMAL_EXPONENT 1000000000LL
+
+/**
+ * @brief What SXJSONStreamReader accepts next.
+ */
+enum SXJSONStreamState
+{
+    SXJSONStreamExpectValue, /**< The root value, a value after ':' or after ',' in an array. */
+    SXJSONStreamExpectValueOrEnd, /**< The first value of an array, or ']'. */
+    SXJSONStreamExpectKey, /**< A key after ',' in a dictionary. */
+    SXJSONStreamExpectKeyOrEnd, /**< The first key of a dictionary, or '}'. */
+    SXJSONStreamExpectColon, /**< ':' after a key. */
+    SXJSONStreamExpectCommaOrEnd, /**< ',' or the end of the container after a value. */
+    SXJSONStreamExpectEndOfDocument, /**< Whitespace after the root value. */
+    SXJSONStreamFailed /**< The input is invalid or could not be read. */
+};
+
+/**
+ * @brief Check whether a byte must be escaped inside a JSON string.
+ */
+static inline bool isStringSpecial(unsigned char c)
+{
+    return c == '"' || c == '\\' || c < 0x20;
+}
+
+/**
+ * @brief Find the first byte that ends a run of plain string characters.
+ * @details The same set of bytes ('"', '\\' and control characters) stops the parser inside a string and must be escaped by the writer.
+ * @return A pointer to the byte, or pEnd if there is none.
+ */
+static inline const char* findStringSpecial(const char* p, const char* pEnd)
+{
+#ifdef SX_JSON_USE_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    while (pEnd - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        // Unsigned bytes up to 0x1F are the only ones left unchanged by max(byte, 0x1F) == 0x1F.
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)), _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(special));
+        if (mask) {
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return p + index;
+#else
+            return p + __builtin_ctz(mask);
+#endif
+        }
+        p += 16;
+    }
+#endif
+    while (p < pEnd && !isStringSpecial(static_cast<unsigned char>(*p))) {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * @brief Append a code point to a string, encoded in UTF-8.
+ */
+static void appendUTF8(std::string& rString, uint32_t codePoint)
+{
+    if (codePoint < 0x80) {
+        rString += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        rString += static_cast<char>(0xC0 | (codePoint >> 6));
+        rString += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        rString += static_cast<char>(0xE0 | (codePoint >> 12));
+        rString += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        rString += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+        rString += static_cast<char>(0xF0 | (codePoint >> 18));
+        rString += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        rString += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        rString += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+/**
+ * @brief Key of an object member waiting for its dictionary to be created.
+ */
+struct SXJSONKey
+{
+    SXAtom atom; /**< The interned key. Null with SXJSONReadingCopyKeys. */
+    std::string string; /**< The key characters with SXJSONReadingCopyKeys. */
+    size_t hash; /**< Hash of the key characters. */
+};
+
+/**
+ * @class SXJSONReader
+ * @brief Recursive descent JSON parser building SX objects.
+ * @details Values parsed inside a container wait on a stack shared by all levels, so each container is created once its size is known. Every object on the stack is owned by the reader until it is added to its container.
+ */
+class SXJSONReader
+{
+public:
+    SXJSONReader(std::string_view text, unsigned int options)
+    :m_pBegin(text.data()), m_pCurrent(text.data()), m_pEnd(text.data() + text.length()), m_options(options)
+    {
+    }
+    
+    ~SXJSONReader()
+    {
+        for (SXObject* pObject : m_values) {
+            pObject->release();
+        }
+    }
+    
+    /**
+     * @brief Parse the whole text.
+     * @return The root object (reference count 1). nullptr if the text is not valid JSON.
+     */
+    SXObject* parse()
+    {
+        skipWhitespace();
+        if (!parseValue(0)) {
+            return nullptr;
+        }
+        
+        skipWhitespace();
+        if (m_pCurrent != m_pEnd) {
+            return nullptr; // Trailing characters.
+        }
+        
+        SXObject* pRoot = m_values.back();
+        m_values.pop_back();
+        return pRoot;
+    }
+    
+    /**
+     * @brief Get the offset where parsing stopped.
+     */
+    size_t offset() const
+    {
+        return static_cast<size_t>(m_pCurrent - m_pBegin);
+    }
+    
+    /**
+     * @brief Start over with another text, keeping the atom cache.
+     */
+    void reset(std::string_view text)
+    {
+        for (SXObject* pObject : m_values) {
+            pObject->release();
+        }
+        m_values.clear();
+        m_keys.clear();
+        m_pBegin = text.data();
+        m_pCurrent = text.data();
+        m_pEnd = text.data() + text.length();
+    }
+    
+    /**
+     * @brief Parse a text made of exactly one string.
+     * @param rString Receives the characters: a view of the text when there is no escape sequence, of the reader's buffer otherwise.
+     */
+    bool parseStringToken(std::string_view& rString)
+    {
+        return m_pCurrent < m_pEnd && *m_pCurrent == '"' && parseString(rString) && m_pCurrent == m_pEnd;
+    }
+
+private:
+    const char* m_pBegin; /**< First byte of the text. */
+    const char* m_pCurrent; /**< Next byte to parse. */
+    const char* m_pEnd; /**< Byte past the end of the text. */
+    unsigned int m_options; /**< Combination of SXJSONReadingOptions. */
+    std::vector<SXObject*> m_values; /**< Parsed values not added to a container yet. */
+    std::vector<SXJSONKey> m_keys; /**< Keys of the object members on m_values. */
+    std::string m_scratch; /**< Buffer for strings with escape sequences. */
+    SXAtom m_atomCache[SX_JSON_ATOM_CACHE_SIZE]; /**< Recently interned keys, indexed by hash, to skip the atom table lock. */
+    
+    void skipWhitespace()
+    {
+        while (m_pCurrent < m_pEnd && (*m_pCurrent == ' ' || *m_pCurrent == '\n' || *m_pCurrent == '\r' || *m_pCurrent == '\t')) {
+            m_pCurrent++;
+        }
+    }
+    
+    bool consume(char c)
+    {
+        if (m_pCurrent < m_pEnd && *m_pCurrent == c) {
+            m_pCurrent++;
+            return true;
+        }
+        return false;
+    }
+    
+    bool consumeLiteral(const char* pLiteral, size_t length)
+    {
+        if (static_cast<size_t>(m_pEnd - m_pCurrent) >= length && memcmp(m_pCurrent, pLiteral, length) == 0) {
+            m_pCurrent += length;
+            return true;
+        }
+        return false;
+    }
+    
+    /**
+     * @brief Parse a value and push it on the value stack.
+     */
+    bool parseValue(unsigned int depth)
+    {
+        if (m_pCurrent == m_pEnd) {
+            return false;
+        }
+        
+        switch (*m_pCurrent) {
+            case '{':
+                return parseObject(depth + 1);
+            case '[':
+                return parseArray(depth + 1);
+            case '"': {
+                std::string_view string;
+                if (!parseString(string)) {
+                    return false;
+                }
+                m_values.push_back(SXString::newWithCharacters(string.data(), string.length()));
+                return true;
+            }
+            case 't':
+                if (!consumeLiteral("true", 4)) {
+                    return false;
+                }
+                m_values.push_back(new SXNumber<bool>(true));
+                return true;
+            case 'f':
+                if (!consumeLiteral("false", 5)) {
+                    return false;
+                }
+                m_values.push_back(new SXNumber<bool>(false));
+                return true;
+            case 'n':
+                if (!consumeLiteral("null", 4)) {
+                    return false;
+                }
+                SXNull::null()->retain();
+                m_values.push_back(SXNull::null());
+                return true;
+            default:
+                return parseNumber();
+        }
+    }
+    
+    bool parseArray(unsigned int depth)
+    {
+        if (depth > SX_JSON_MAX_DEPTH) {
+            return false;
+        }
+        
+        m_pCurrent++; // '['
+        size_t base = m_values.size();
+        skipWhitespace();
+        if (!consume(']')) {
+            do {
+                skipWhitespace();
+                if (!parseValue(depth)) {
+                    return false;
+                }
+                skipWhitespace();
+            } while (consume(','));
+            
+            if (!consume(']')) {
+                return false;
+            }
+        }
+        
+        unsigned int count = static_cast<unsigned int>(m_values.size() - base);
+        SXArray* pArray = new SXArray();
+        pArray->initWithCapacity(count);
+        for (size_t i = base; i < m_values.size(); i++) {
+            pArray->addObject(m_values[i]);
+            m_values[i]->release();
+        }
+        m_values.resize(base);
+        m_values.push_back(pArray);
+        return true;
+    }
+    
+    bool parseObject(unsigned int depth)
+    {
+        if (depth > SX_JSON_MAX_DEPTH) {
+            return false;
+        }
+        
+        m_pCurrent++; // '{'
+        size_t base = m_values.size();
+        skipWhitespace();
+        if (!consume('}')) {
+            do {
+                skipWhitespace();
+                std::string_view key;
+                if (m_pCurrent == m_pEnd || *m_pCurrent != '"' || !parseString(key)) {
+                    return false;
+                }
+                pushKey(key);
+                
+                skipWhitespace();
+                if (!consume(':')) {
+                    return false;
+                }
+                skipWhitespace();
+                if (!parseValue(depth)) {
+                    return false;
+                }
+                skipWhitespace();
+            } while (consume(','));
+            
+            if (!consume('}')) {
+                return false;
+            }
+        }
+        
+        size_t count = m_values.size() - base;
+        size_t keyBase = m_keys.size() - count;
+        SXDictionary* pDictionary = new SXDictionary();
+        pDictionary->reserve(static_cast<unsigned int>(count));
+        for (size_t i = 0; i < count; i++) {
+            // A repeated key keeps the last value, like setObject() does.
+            SXJSONKey& rKey = m_keys[keyBase + i];
+            SXObject* pObject = m_values[base + i];
+            if (rKey.atom.isNull()) {
+                pDictionary->setObject(pObject, rKey.string, rKey.hash);
+            } else {
+                pDictionary->setObject(pObject, rKey.atom);
+            }
+            pObject->release();
+        }
+        m_keys.resize(keyBase);
+        m_values.resize(base);
+        m_values.push_back(pDictionary);
+        return true;
+    }
+    
+    void pushKey(std::string_view key)
+    {
+        size_t hash = SXHashString(key);
+        if (m_options & SXJSONReadingCopyKeys) {
+            m_keys.push_back(SXJSONKey{SXAtom(), std::string(key), hash});
+            return;
+        }
+        
+        SXAtom& rCachedAtom = m_atomCache[hash & (SX_JSON_ATOM_CACHE_SIZE - 1)];
+        if (rCachedAtom.isNull() || rCachedAtom.hash() != hash || rCachedAtom.view() != key) {
+            rCachedAtom = SXAtom::intern(key);
+        }
+        m_keys.push_back(SXJSONKey{rCachedAtom, std::string(), hash});
+    }
+    
+    /**
+     * @brief Parse a string.
+     * @param rString Receives the characters: a view of the text when there is no escape sequence, of m_scratch otherwise.
+     */
+    bool parseString(std::string_view& rString)
+    {
+        m_pCurrent++; // '"'
+        const char* pStart = m_pCurrent;
+        m_pCurrent = findStringSpecial(m_pCurrent, m_pEnd);
+        if (m_pCurrent < m_pEnd && *m_pCurrent == '"') {
+            rString = std::string_view(pStart, m_pCurrent - pStart);
+            m_pCurrent++;
+            return true;
+        }
+        
+        // Slow path: decode the escape sequences into the scratch buffer.
+        m_scratch.assign(pStart, m_pCurrent - pStart);
+        while (m_pCurrent < m_pEnd) {
+            char c = *m_pCurrent;
+            if (c == '"') {
+                m_pCurrent++;
+                rString = m_scratch;
+                return true;
+            }
+            if (c != '\\') {
+                return false; // Unescaped control character.
+            }
+            
+            if (++m_pCurrent == m_pEnd) {
+                return false;
+            }
+            switch (*m_pCurrent++) {
+                case '"': m_scratch += '"'; break;
+                case '\\': m_scratch += '\\'; break;
+                case '/': m_scratch += '/'; break;
+                case 'b': m_scratch += '\b'; break;
+                case 'f': m_scratch += '\f'; break;
+                case 'n': m_scratch += '\n'; break;
+                case 'r': m_scratch += '\r'; break;
+                case 't': m_scratch += '\t'; break;
+                case 'u': {
+                    uint32_t codePoint;
+                    if (!parseHex4(codePoint)) {
+                        return false;
+                    }
+                    if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+                        // High surrogate, which must be followed by an escaped low surrogate.
+                        uint32_t low;
+                        if (!consumeLiteral("\\u", 2) || !parseHex4(low) || low < 0xDC00 || low >= 0xE000) {
+                            return false;
+                        }
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    } else if (codePoint >= 0xDC00 && codePoint < 0xE000) {
+                        return false;
+                    }
+                    appendUTF8(m_scratch, codePoint);
+                    break;
+                }
+                default:
+                    m_pCurrent--;
+                    return false;
+            }
+            
+            const char* pRun = m_pCurrent;
+            m_pCurrent = findStringSpecial(m_pCurrent, m_pEnd);
+            m_scratch.append(pRun, m_pCurrent - pRun);
+        }
+        return false;
+    }
+    
+    bool parseHex4(uint32_t& rValue)
+    {
+        if (m_pEnd - m_pCurrent < 4) {
+            return false;
+        }
+        
+        rValue = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = *m_pCurrent;
+            uint32_t digit;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                digit = c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                digit = c - 'A' + 10;
+            } else {
+                return false;
+            }
+            rValue = (rValue << 4) | digit;
+            m_pCurrent++;
+        }
+        return true;
+    }
+    
+    /**
+     * @brief Get the decimal exponent of a valid JSON number, the e for which it is 0.d × 10^e with d its significant digits.
+     * @details Computed from the text alone, without the locale-dependent C library. Positive when the number is at least 1.
+     */
+    static long long decimalExponent(const char* p, const char* pEnd)
+    {
+        long long exponent = 0;
+        bool significant = false;
+        if (*p == '-') {
+            p++;
+        }
+        for (; p < pEnd && *p >= '0' && *p <= '9'; p++) {
+            significant = significant || *p != '0';
+            if (significant) {
+                exponent++;
+            }
+        }
+        if (p < pEnd && *p == '.') {
+            for (p++; p < pEnd && *p >= '0' && *p <= '9'; p++) {
+                significant = significant || *p != '0';
+                if (!significant) {
+                    exponent--; // A leading zero of the fraction.
+                }
+            }
+        }
+        if (p < pEnd && (*p == 'e' || *p == 'E')) {
+            p++;
+            bool negative = (*p == '-');
+            if (*p == '+' || *p == '-') {
+                p++;
+            }
+            long long explicitExponent = 0;
+            for (; p < pEnd && *p >= '0' && *p <= '9'; p++) {
+                if (explicitExponent < SX_JSON_MAX_DECIMAL_EXPONENT) {
+                    explicitExponent = explicitExponent * 10 + (*p - '0');
+                }
+            }
+            exponent += negative ? -explicitExponent : explicitExponent;
+        }
+        return exponent;
+    }
+    
+    bool parseNumber()
+    {
+        // Validate the JSON number grammar first, std::from_chars is more lenient.
+        const char* pStart = m_pCurrent;
+        const char* p = m_pCurrent;
+        bool integral = true;
+        
+        if (p < m_pEnd && *p == '-') {
+            p++;
+        }
+        if (p == m_pEnd || !(*p >= '0' && *p <= '9')) {
+            return false;
+        }
+        if (*p == '0') {
+            p++;
+        } else {
+            while (p < m_pEnd && *p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+        if (p < m_pEnd && *p == '.') {
+            integral = false;
+            p++;
+            if (p == m_pEnd || !(*p >= '0' && *p <= '9')) {
+                m_pCurrent = p;
+                return false;
+            }
+            while (p < m_pEnd && *p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+        if (p < m_pEnd && (*p == 'e' || *p == 'E')) {
+            integral = false;
+            p++;
+            if (p < m_pEnd && (*p == '+' || *p == '-')) {
+                p++;
+            }
+            if (p == m_pEnd || !(*p >= '0' && *p <= '9')) {
+                m_pCurrent = p;
+                return false;
+            }
+            while (p < m_pEnd && *p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+        m_pCurrent = p;
+        
+        if (integral) {
+            long long value;
+            std::from_chars_result result = std::from_chars(pStart, p, value);
+            if (result.ec == std::errc()) {
+                m_values.push_back(new SXNumber<long long>(value));
+                return true;
+            }
+            // Out of range, fall back to a double.
+        }
+        
+        double value;
+        std::from_chars_result result = std::from_chars(pStart, p, value);
+        if (result.ec == std::errc::result_out_of_range) {
+            // std::from_chars leaves the value untouched. A number of at least 1 overflowed: an error, as the writer could not write it back. A smaller one underflowed to 0.
+            if (decimalExponent(pStart, p) > 0) {
+                m_pCurrent = pStart;
+                return false;
+            }
+            value = (*pStart == '-') ? -0.0 : 0.0;
+        } else if (result.ec != std::errc()) {
+            return false;
+        }
+        m_values.push_back(new SXNumber<double>(value));
+        return true;
+    }
+};
+
+/**
+ * @class SXJSONWriter
+ * @brief JSON writer with a fixed output buffer.
+ * @details The buffer is handed to an SXData, to a file descriptor, or discarded (to validate a graph) each time it fills up.
+ */
+class SXJSONWriter
+{
+public:
+    SXJSONWriter(SXData* pData, int fileDescriptor, unsigned int options)
+    :m_pData(pData), m_fileDescriptor(fileDescriptor), m_options(options), m_pBuffer(new char[SX_JSON_WRITE_BUFFER_SIZE])
+    {
+    }
+    
+    /**
+     * @brief Write a whole graph and flush the buffer.
+     */
+    bool write(const SXObject* pObject)
+    {
+        bool written = writeValue(pObject, 0);
+        flush();
+        return written && !m_failed;
+    }
+
+private:
+    SXData* m_pData; /**< Destination data object, or nullptr. */
+    int m_fileDescriptor; /**< Destination file descriptor when m_pData is nullptr. Negative to discard the output. */
+    unsigned int m_options; /**< Combination of SXJSONWritingOptions. */
+    std::unique_ptr<char[]> m_pBuffer; /**< Output buffer. */
+    size_t m_length{0}; /**< Number of bytes in the buffer. */
+    bool m_failed{false}; /**< Whether writing to the destination failed. */
+    
+    void output(const char* pBytes, size_t length)
+    {
+        if (m_pData) {
+            m_pData->appendBytes(pBytes, length);
+            return;
+        }
+        
+        while (m_fileDescriptor >= 0 && length > 0 && !m_failed) {
+#if defined(_WIN32)
+            int written = _write(m_fileDescriptor, pBytes, static_cast<unsigned int>(std::min<size_t>(length, 1 << 30)));
+#else
+            ssize_t written = ::write(m_fileDescriptor, pBytes, length);
+#endif
+            if (written < 0) {
+                if (errno != EINTR) {
+                    m_failed = true;
+                }
+                continue;
+            }
+            pBytes += written;
+            length -= static_cast<size_t>(written);
+        }
+    }
+    
+    void flush()
+    {
+        output(m_pBuffer.get(), m_length);
+        m_length = 0;
+    }
+    
+    void append(const char* pBytes, size_t length)
+    {
+        if (m_length + length > SX_JSON_WRITE_BUFFER_SIZE) {
+            flush();
+            if (length > SX_JSON_WRITE_BUFFER_SIZE) {
+                output(pBytes, length);
+                return;
+            }
+        }
+        memcpy(m_pBuffer.get() + m_length, pBytes, length);
+        m_length += length;
+    }
+    
+    void append(char c)
+    {
+        if (m_length == SX_JSON_WRITE_BUFFER_SIZE) {
+            flush();
+        }
+        m_pBuffer[m_length++] = c;
+    }
+    
+    void appendNewline(unsigned int depth)
+    {
+        if (m_options & SXJSONWritingPrettyPrinted) {
+            append('\n');
+            for (unsigned int i = 0; i < depth; i++) {
+                append("  ", 2);
+            }
+        }
+    }
+    
+    void appendString(std::string_view string)
+    {
+        static const char* const pHexDigits = "0123456789abcdef";
+        
+        append('"');
+        const char* p = string.data();
+        const char* pEnd = p + string.length();
+        while (p < pEnd) {
+            const char* pSpecial = findStringSpecial(p, pEnd);
+            append(p, pSpecial - p);
+            if (pSpecial == pEnd) {
+                break;
+            }
+            
+            unsigned char c = static_cast<unsigned char>(*pSpecial);
+            switch (c) {
+                case '"': append("\\\"", 2); break;
+                case '\\': append("\\\\", 2); break;
+                case '\b': append("\\b", 2); break;
+                case '\f': append("\\f", 2); break;
+                case '\n': append("\\n", 2); break;
+                case '\r': append("\\r", 2); break;
+                case '\t': append("\\t", 2); break;
+                default: {
+                    char escape[6] = {'\\', 'u', '0', '0', pHexDigits[c >> 4], pHexDigits[c & 0xF]};
+                    append(escape, 6);
+                    break;
+                }
+            }
+            p = pSpecial + 1;
+        }
+        append('"');
+    }
+    
+    template <typename T>
+    bool appendInteger(T value)
+    {
+        char digits[24];
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+        append(digits, result.ptr - digits);
+        return true;
+    }
+    
+    template <typename T>
+    bool appendFloatingPoint(T value)
+    {
+        if (!std::isfinite(value)) {
+            return false;
+        }
+        
+        // Shortest representation that reads back as the same value.
+        char digits[32];
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+        size_t length = result.ptr - digits;
+        append(digits, length);
+        if (std::find_if(digits, result.ptr, [](char c) { return c == '.' || c == 'e'; }) == result.ptr) {
+            append(".0", 2); // Keep it a floating-point number when read back.
+        }
+        return true;
+    }
+    
+    /**
+     * @brief Write the object if it is an SXNumber<T>.
+     * @return Whether the object was an SXNumber<T>. rWritten receives whether writing succeeded.
+     */
+    template <typename T>
+    bool writeNumber(const SXObject* pObject, bool& rWritten)
+    {
+        const SXNumber<T>* pNumber = dynamic_cast<const SXNumber<T>*>(pObject);
+        if (!pNumber) {
+            return false;
+        }
+        
+        if constexpr (std::is_same_v<T, bool>) {
+            pNumber->getValue() ? append("true", 4) : append("false", 5);
+            rWritten = true;
+        } else if constexpr (std::is_floating_point_v<T>) {
+            rWritten = appendFloatingPoint(pNumber->getValue());
+        } else {
+            rWritten = appendInteger(pNumber->getValue());
+        }
+        return true;
+    }
+    
+    template <typename Dictionary>
+    bool writeDictionary(const Dictionary* pDictionary, unsigned int depth)
+    {
+        if (pDictionary->count() == 0) {
+            append("{}", 2);
+            return true;
+        }
+        
+        bool written = true;
+        bool first = true;
+        auto writeMember = [this, depth, &written, &first](std::string_view key, SXObject* pObject, bool& rStop) {
+            append(first ? '{' : ',');
+            first = false;
+            appendNewline(depth + 1);
+            appendString(key);
+            (m_options & SXJSONWritingPrettyPrinted) ? append(": ", 2) : append(':');
+            if (!writeValue(pObject, depth + 1)) {
+                written = false;
+                rStop = true;
+            }
+        };
+        
+        if (m_options & SXJSONWritingSortedKeys) {
+            std::vector<std::pair<std::string_view, SXObject*>> entries;
+            entries.reserve(pDictionary->count());
+            pDictionary->enumerateKeysAndObjects([&entries](std::string_view key, SXObject* pObject, bool&) {
+                entries.emplace_back(key, pObject);
+            });
+            std::sort(entries.begin(), entries.end(), [](const auto& rA, const auto& rB) { return rA.first < rB.first; });
+            
+            bool stop = false;
+            for (const auto& [key, value]: entries) {
+                writeMember(key, value, stop);
+                if (stop) {
+                    break;
+                }
+            }
+        } else {
+            pDictionary->enumerateKeysAndObjects(writeMember);
+        }
+        
+        if (!written) {
+            return false;
+        }
+        appendNewline(depth);
+        append('}');
+        return true;
+    }
+    
+    bool writeArray(const SXArray* pArray, unsigned int depth)
+    {
+        if (pArray->count() == 0) {
+            append("[]", 2);
+            return true;
+        }
+        
+        for (unsigned int i = 0; i < pArray->count(); i++) {
+            append(i == 0 ? '[' : ',');
+            appendNewline(depth + 1);
+            if (!writeValue(pArray->objectAtIndex(i), depth + 1)) {
+                return false;
+            }
+        }
+        appendNewline(depth);
+        append(']');
+        return true;
+    }
+    
+    bool writeValue(const SXObject* pObject, unsigned int depth)
+    {
+        if (!pObject || depth > SX_JSON_MAX_DEPTH || m_failed) {
+            return false;
+        }
+        
+        // Most common types first.
+        if (const SXString* pString = dynamic_cast<const SXString*>(pObject)) {
+            appendString(pString->view());
+            return true;
+        }
+        if (const SXDictionary* pDictionary = dynamic_cast<const SXDictionary*>(pObject)) {
+            return writeDictionary(pDictionary, depth);
+        }
+        if (const SXArray* pArray = dynamic_cast<const SXArray*>(pObject)) {
+            return writeArray(pArray, depth);
+        }
+        if (pObject == SXNull::null()) {
+            append("null", 4);
+            return true;
+        }
+        
+        bool written = false;
+        if (writeNumber<long long>(pObject, written) || writeNumber<double>(pObject, written) || writeNumber<bool>(pObject, written) ||
+            writeNumber<int>(pObject, written) || writeNumber<unsigned int>(pObject, written) || writeNumber<long>(pObject, written) ||
+            writeNumber<unsigned long>(pObject, written) || writeNumber<unsigned long long>(pObject, written) || writeNumber<float>(pObject, written) ||
+            writeNumber<short>(pObject, written) || writeNumber<unsigned short>(pObject, written) || writeNumber<char>(pObject, written) ||
+            writeNumber<unsigned char>(pObject, written)) {
+            return written;
+        }
+        
+        if (const SXOrderedDictionary* pDictionary = dynamic_cast<const SXOrderedDictionary*>(pObject)) {
+            return writeDictionary(pDictionary, depth);
+        }
+        if (const SXSortedDictionary* pDictionary = dynamic_cast<const SXSortedDictionary*>(pObject)) {
+            return writeDictionary(pDictionary, depth);
+        }
+        if (const SXFrozenDictionary* pDictionary = dynamic_cast<const SXFrozenDictionary*>(pObject)) {
+            return writeDictionary(pDictionary, depth);
+        }
+        
+        return false; // No JSON representation.
+    }
+};
+
+SXObject* SXJSONSerialization::JSONObjectWithString(std::string_view text, unsigned int options, size_t* pErrorOffset)
+{
+    SXJSONReader reader(text, options);
+    SXObject* pRoot = reader.parse();
+    if (!pRoot) {
+        if (pErrorOffset) {
+            *pErrorOffset = reader.offset();
+        }
+        return nullptr;
+    }
+    
+    if (options & SXJSONReadingImmutable) {
+        pRoot->makeImmutable();
+    }
+    
+    return pRoot->autorelease();
+}
+
+SXObject* SXJSONSerialization::JSONObjectWithData(const SXData* pData, unsigned int options, size_t* pErrorOffset)
+{
+    return JSONObjectWithString(std::string_view(pData->bytes(), pData->length()), options, pErrorOffset);
+}
+
+bool SXJSONSerialization::isValidJSONObject(const SXObject* pObject)
+{
+    SXJSONWriter writer(nullptr, -1, SXJSONWritingDefault);
+    return writer.write(pObject);
+}
+
+SXData* SXJSONSerialization::dataWithJSONObject(const SXObject* pObject, unsigned int options)
+{
+    SXData* pData = SXData::create();
+    return writeJSONObject(pObject, pData, options) ? pData : nullptr;
+}
+
+bool SXJSONSerialization::writeJSONObject(const SXObject* pObject, SXData* pData, unsigned int options)
+{
+    SXJSONWriter writer(pData, -1, options);
+    return writer.write(pObject);
+}
+
+bool SXJSONSerialization::writeJSONObject(const SXObject* pObject, int fileDescriptor, unsigned int options)
+{
+    if (fileDescriptor < 0) {
+        return false;
+    }
+    
+    SXJSONWriter writer(nullptr, fileDescriptor, options);
+    return writer.write(pObject);
+}
+
+SXJSONStreamReader::SXJSONStreamReader(unsigned int options)
+:m_options(options), m_state(SXJSONStreamExpectValue), m_pContainers(new std::vector<char>), m_pReader(new SXJSONReader(std::string_view(), options))
+{
+}
+
+SXJSONStreamReader::~SXJSONStreamReader()
+{
+    if (m_pValue) {
+        m_pValue->release();
+        m_pValue = nullptr;
+    }
+    delete m_pReader;
+    m_pReader = nullptr;
+    delete m_pContainers;
+    m_pContainers = nullptr;
+    delete m_pBuffer;
+    m_pBuffer = nullptr;
+    if (m_pData) {
+        m_pData->release();
+        m_pData = nullptr;
+    }
+    if (m_fileDescriptor >= 0) {
+#if defined(_WIN32)
+        _close(m_fileDescriptor);
+#else
+        close(m_fileDescriptor);
+#endif
+        m_fileDescriptor = -1;
+    }
+}
+
+SXJSONStreamReader* SXJSONStreamReader::createWithData(SXData* pData, unsigned int options)
+{
+    if (!pData) {
+        return nullptr;
+    }
+    
+    SXJSONStreamReader* pReader = new SXJSONStreamReader(options);
+    pData->retain();
+    pReader->m_pData = pData;
+    pReader->m_pBase = pData->bytes();
+    pReader->m_pCursor = pReader->m_pBase;
+    pReader->m_pEnd = pReader->m_pBase + pData->length();
+    pReader->autorelease();
+    return pReader;
+}
+
+SXJSONStreamReader* SXJSONStreamReader::createWithContentsOfFile(const char* pFilePath, unsigned int options)
+{
+#if defined(_WIN32)
+    int fileDescriptor = _open(pFilePath, _O_RDONLY | _O_BINARY);
+#else
+    int fileDescriptor = open(pFilePath, O_RDONLY);
+#endif
+    if (fileDescriptor < 0) {
+        return nullptr;
+    }
+    
+    SXJSONStreamReader* pReader = new SXJSONStreamReader(options);
+    pReader->m_fileDescriptor = fileDescriptor;
+    pReader->m_pBuffer = new std::vector<char>(SX_JSON_STREAM_BUFFER_SIZE);
+    pReader->m_pBase = pReader->m_pBuffer->data();
+    pReader->m_pCursor = pReader->m_pBase;
+    pReader->m_pEnd = pReader->m_pBase;
+    pReader->autorelease();
+    return pReader;
+}
+
+SXJSONStreamEvent SXJSONStreamReader::nextEvent()
+{
+    if (m_pValue) {
+        m_pValue->release();
+        m_pValue = nullptr;
+    }
+    m_key = std::string_view();
+    m_lastEvent = SXJSONStreamError;
+    
+    while (true) {
+        if (m_state == SXJSONStreamFailed) {
+            return SXJSONStreamError;
+        }
+        if (!skipWhitespace()) {
+            if (m_state != SXJSONStreamExpectEndOfDocument) {
+                return fail();
+            }
+            m_lastEvent = SXJSONStreamEndOfDocument;
+            return m_lastEvent;
+        }
+        
+        char c = *m_pCursor;
+        switch (m_state) {
+            case SXJSONStreamExpectEndOfDocument:
+                return fail(); // Trailing characters.
+            
+            case SXJSONStreamExpectCommaOrEnd:
+                if (c == ',') {
+                    m_pCursor++;
+                    m_state = m_pContainers->back() == '{' ? SXJSONStreamExpectKey : SXJSONStreamExpectValue;
+                    continue;
+                }
+                if (c != (m_pContainers->back() == '{' ? '}' : ']')) {
+                    return fail();
+                }
+                m_pCursor++;
+                m_pContainers->pop_back();
+                finishValue();
+                m_lastEvent = c == '}' ? SXJSONStreamEndDictionary : SXJSONStreamEndArray;
+                return m_lastEvent;
+            
+            case SXJSONStreamExpectColon:
+                if (c != ':') {
+                    return fail();
+                }
+                m_pCursor++;
+                m_state = SXJSONStreamExpectValue;
+                continue;
+            
+            case SXJSONStreamExpectKeyOrEnd:
+            case SXJSONStreamExpectKey: {
+                if (c == '}' && m_state == SXJSONStreamExpectKeyOrEnd) {
+                    m_pCursor++;
+                    m_pContainers->pop_back();
+                    finishValue();
+                    m_lastEvent = SXJSONStreamEndDictionary;
+                    return m_lastEvent;
+                }
+                
+                size_t length;
+                bool escaped;
+                if (c != '"' || !scanToken(length, escaped)) {
+                    return fail();
+                }
+                if (escaped) {
+                    m_pReader->reset(std::string_view(m_pCursor, length));
+                    if (!m_pReader->parseStringToken(m_key)) {
+                        m_pCursor += m_pReader->offset();
+                        return fail();
+                    }
+                } else {
+                    m_key = std::string_view(m_pCursor + 1, length - 2);
+                }
+                m_pCursor += length;
+                // The colon is read by the next call, so that reading more input cannot move the key.
+                m_state = SXJSONStreamExpectColon;
+                m_lastEvent = SXJSONStreamKey;
+                return m_lastEvent;
+            }
+            
+            case SXJSONStreamExpectValueOrEnd:
+            case SXJSONStreamExpectValue: {
+                if (c == ']' && m_state == SXJSONStreamExpectValueOrEnd) {
+                    m_pCursor++;
+                    m_pContainers->pop_back();
+                    finishValue();
+                    m_lastEvent = SXJSONStreamEndArray;
+                    return m_lastEvent;
+                }
+                if (c == '{' || c == '[') {
+                    if (m_pContainers->size() >= SX_JSON_MAX_DEPTH) {
+                        return fail();
+                    }
+                    m_pCursor++;
+                    m_pContainers->push_back(c);
+                    m_state = c == '{' ? SXJSONStreamExpectKeyOrEnd : SXJSONStreamExpectValueOrEnd;
+                    m_lastEvent = c == '{' ? SXJSONStreamBeginDictionary : SXJSONStreamBeginArray;
+                    return m_lastEvent;
+                }
+                
+                size_t length;
+                bool escaped;
+                if (!scanToken(length, escaped)) {
+                    return fail();
+                }
+                if (c == '"' && !escaped) {
+                    m_pValue = SXString::newWithCharacters(m_pCursor + 1, length - 2);
+                } else {
+                    m_pReader->reset(std::string_view(m_pCursor, length));
+                    m_pValue = m_pReader->parse();
+                    if (!m_pValue) {
+                        m_pCursor += m_pReader->offset();
+                        return fail();
+                    }
+                }
+                m_pCursor += length;
+                finishValue();
+                m_lastEvent = SXJSONStreamValue;
+                return m_lastEvent;
+            }
+            
+            default:
+                return fail();
+        }
+    }
+}
+
+std::string_view SXJSONStreamReader::key() const
+{
+    return m_key;
+}
+
+SXObject* SXJSONStreamReader::value() const
+{
+    return m_pValue;
+}
+
+SXObject* SXJSONStreamReader::readObject()
+{
+    if (m_lastEvent == SXJSONStreamValue && m_pValue) {
+        m_pValue->retain();
+        return m_pValue->autorelease();
+    }
+    
+    std::string text;
+    if ((m_lastEvent != SXJSONStreamBeginDictionary && m_lastEvent != SXJSONStreamBeginArray) || !scanContainer(&text)) {
+        return nullptr;
+    }
+    
+    m_pReader->reset(text);
+    SXObject* pObject = m_pReader->parse();
+    m_pReader->reset(std::string_view());
+    if (!pObject) {
+        fail();
+        return nullptr;
+    }
+    
+    if (m_options & SXJSONReadingImmutable) {
+        pObject->makeImmutable();
+    }
+    return pObject->autorelease();
+}
+
+bool SXJSONStreamReader::skipObject()
+{
+    return (m_lastEvent == SXJSONStreamBeginDictionary || m_lastEvent == SXJSONStreamBeginArray) && scanContainer(nullptr);
+}
+
+unsigned int SXJSONStreamReader::depth() const
+{
+    return static_cast<unsigned int>(m_pContainers->size());
+}
+
+size_t SXJSONStreamReader::offset() const
+{
+    return m_discarded + static_cast<size_t>(m_pCursor - m_pBase);
+}
+
+bool SXJSONStreamReader::fill()
+{
+    if (m_fileDescriptor < 0) {
+        return false;
+    }
+    
+    // Move the unread bytes to the front, and grow the buffer only for a token longer than it.
+    size_t kept = static_cast<size_t>(m_pEnd - m_pCursor);
+    m_discarded += static_cast<size_t>(m_pCursor - m_pBase);
+    if (kept == m_pBuffer->size()) {
+        std::vector<char>* pBuffer = new std::vector<char>(m_pBuffer->size() * 2);
+        memcpy(pBuffer->data(), m_pCursor, kept);
+        delete m_pBuffer;
+        m_pBuffer = pBuffer;
+    } else if (kept > 0) {
+        memmove(m_pBuffer->data(), m_pCursor, kept);
+    }
+    m_pBase = m_pBuffer->data();
+    m_pCursor = m_pBase;
+    m_pEnd = m_pBase + kept;
+    
+    while (true) {
+#if defined(_WIN32)
+        int length = _read(m_fileDescriptor, m_pBuffer->data() + kept, static_cast<unsigned int>(std::min<size_t>(m_pBuffer->size() - kept, 1 << 30)));
+#else
+        ssize_t length = ::read(m_fileDescriptor, m_pBuffer->data() + kept, m_pBuffer->size() - kept);
+#endif
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length <= 0) {
+            return false;
+        }
+        m_pEnd += length;
+        return true;
+    }
+}
+
+bool SXJSONStreamReader::skipWhitespace()
+{
+    while (true) {
+        while (m_pCursor < m_pEnd && (*m_pCursor == ' ' || *m_pCursor == '\n' || *m_pCursor == '\r' || *m_pCursor == '\t')) {
+            m_pCursor++;
+        }
+        if (m_pCursor < m_pEnd) {
+            return true;
+        }
+        if (!fill()) {
+            return false;
+        }
+    }
+}
+
+bool SXJSONStreamReader::scanToken(size_t& rLength, bool& rEscaped)
+{
+    rEscaped = false;
+    size_t length = 0;
+    if (*m_pCursor == '"') {
+        length = 1;
+        while (true) {
+            const char* p = findStringSpecial(m_pCursor + length, m_pEnd);
+            length = static_cast<size_t>(p - m_pCursor);
+            if (p + 1 < m_pEnd || (p < m_pEnd && *p == '"')) {
+                if (*p == '"') {
+                    rLength = length + 1;
+                    return true;
+                }
+                if (*p != '\\') {
+                    return false; // Unescaped control character.
+                }
+                // Step over the escaped byte, so an escaped quote does not end the string.
+                rEscaped = true;
+                length += 2;
+                continue;
+            }
+            if (!fill()) {
+                return false;
+            }
+        }
+    }
+    
+    // Numbers and literals end at the first byte that cannot belong to them; the parser validates them.
+    while (true) {
+        while (m_pCursor + length < m_pEnd) {
+            char c = m_pCursor[length];
+            if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E')) {
+                break;
+            }
+            length++;
+        }
+        if (m_pCursor + length < m_pEnd || !fill()) {
+            break;
+        }
+    }
+    rLength = length;
+    return length > 0;
+}
+
+bool SXJSONStreamReader::scanContainer(std::string* pText)
+{
+    if (pText) {
+        *pText = m_pContainers->back();
+    }
+    
+    size_t depth = 1;
+    bool inString = false;
+    bool escaped = false;
+    while (depth > 0) {
+        if (m_pCursor == m_pEnd && !fill()) {
+            fail();
+            return false;
+        }
+        
+        const char* p = m_pCursor;
+        while (p < m_pEnd && depth > 0) {
+            char c = *p++;
+            if (inString) {
+                if (escaped) {
+                    escaped = false;
+                } else if (c == '\\') {
+                    escaped = true;
+                } else if (c == '"') {
+                    inString = false;
+                }
+            } else if (c == '"') {
+                inString = true;
+            } else if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                depth--;
+            }
+        }
+        if (pText) {
+            pText->append(m_pCursor, p);
+        }
+        m_pCursor = p;
+    }
+    
+    m_lastEvent = m_pContainers->back() == '{' ? SXJSONStreamEndDictionary : SXJSONStreamEndArray;
+    m_pContainers->pop_back();
+    finishValue();
+    return true;
+}
+
+void SXJSONStreamReader::finishValue()
+{
+    m_state = m_pContainers->empty() ? SXJSONStreamExpectEndOfDocument : SXJSONStreamExpectCommaOrEnd;
+}
+
+SXJSONStreamEvent SXJSONStreamReader::fail()
+{
+    m_state = SXJSONStreamFailed;
+    m_lastEvent = SXJSONStreamError;
+    return SXJSONStreamError;
+}
+
+}
@@ -0,0 +1,296 @@
+/**
+ * @file SXJSONSerialization.hpp
+ * @brief Declaration of the SXJSONSerialization class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SXJSONSerialization_hpp
+#define SXJSONSerialization_hpp
+
+#include "SXObject.hpp"
+#include "SXData.hpp"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace spalx {
+
+// Maximum nesting of arrays and objects accepted by the parser.
+#define SX_JSON_MAX_DEPTH 512
+
+// Size of the buffer the writer fills before handing bytes to its destination.
+#define SX_JSON_WRITE_BUFFER_SIZE 65536
+
+// Size of the chunks SXJSONStreamReader reads from a file.
+#define SX_JSON_STREAM_BUFFER_SIZE 65536
+
+/**
+ * @brief Options for reading JSON.
+ */
+enum SXJSONReadingOptions
+{
+    SXJSONReadingDefault = 0, /**< Mutable containers, interned keys. */
+    SXJSONReadingImmutable = 1 << 0, /**< makeImmutable() is called on the result, so its hash is cached and comparisons are fast. */
+    SXJSONReadingCopyKeys = 1 << 1 /**< Dictionary keys are copied instead of interned. Use it for documents with many distinct keys (identifiers, timestamps...), which would otherwise fill the atom table. */
+};
+
+/**
+ * @brief Options for writing JSON.
+ */
+enum SXJSONWritingOptions
+{
+    SXJSONWritingDefault = 0, /**< Compact output. */
+    SXJSONWritingPrettyPrinted = 1 << 0, /**< One value per line, indented by two spaces per level. */
+    SXJSONWritingSortedKeys = 1 << 1 /**< Dictionary keys are written in ascending byte order, so equal dictionaries give the same output. */
+};
+
+/**
+ * @class SXJSONSerialization
+ * @brief Conversion between JSON text and SX objects.
+ * @details JSON objects become SXDictionary, arrays SXArray, strings SXString, integers SXNumber<long long> (SXNumber<double> when they do not fit), other numbers SXNumber<double>, true and false SXNumber<bool> and null SXNull. Numbers too large for a double, such as 1e999, are errors, and numbers too small for one become 0. The parser builds the objects directly from the input buffer: strings are scanned 16 bytes at a time (SSE2 when available), strings without escapes are copied once, and the elements of each container are collected first so the container is allocated with its final size. Dictionary keys are interned as SXAtom by default, so documents repeating the same keys share one copy of each.
+ *
+ * The writer accepts SXDictionary, SXOrderedDictionary, SXSortedDictionary and SXFrozenDictionary as JSON objects, SXArray, SXString, all SXNumber types and SXNull. Output goes through a fixed buffer to an SXData or a file descriptor, so writing a large graph does not build the whole text in memory first.
+ */
+class SXJSONSerialization
+{
+public:
+    /**
+     * @brief Parse JSON text.
+     * @param text The JSON text, in UTF-8.
+     * @param options Combination of SXJSONReadingOptions.
+     * @param pErrorOffset Optional. Receives the offset of the first invalid byte when parsing fails.
+     * @return The root object, autoreleased. nullptr if the text is not valid JSON.
+     */
+    static SXObject* JSONObjectWithString(std::string_view text, unsigned int options = SXJSONReadingDefault, size_t* pErrorOffset = nullptr);
+    
+    /**
+     * @brief Parse JSON text held by a data object.
+     * @param pData The JSON text, in UTF-8.
+     * @param options Combination of SXJSONReadingOptions.
+     * @param pErrorOffset Optional. Receives the offset of the first invalid byte when parsing fails.
+     * @return The root object, autoreleased. nullptr if the text is not valid JSON.
+     */
+    static SXObject* JSONObjectWithData(const SXData* pData, unsigned int options = SXJSONReadingDefault, size_t* pErrorOffset = nullptr);
+    
+    /**
+     * @brief Check whether an object graph can be written as JSON.
+     * @param pObject The root object.
+     * @return Whether every object in the graph has a JSON representation (finite numbers only).
+     */
+    static bool isValidJSONObject(const SXObject* pObject);
+    
+    /**
+     * @brief Write an object graph as JSON into a new data object.
+     * @param pObject The root object.
+     * @param options Combination of SXJSONWritingOptions.
+     * @return The data object, autoreleased. nullptr if the graph cannot be written as JSON.
+     */
+    static SXData* dataWithJSONObject(const SXObject* pObject, unsigned int options = SXJSONWritingDefault);
+    
+    /**
+     * @brief Append an object graph as JSON to a data object.
+     * @param pObject The root object.
+     * @param pData The data object to append to.
+     * @param options Combination of SXJSONWritingOptions.
+     * @return Whether the whole graph was written. On failure, the bytes written so far stay in pData.
+     */
+    static bool writeJSONObject(const SXObject* pObject, SXData* pData, unsigned int options = SXJSONWritingDefault);
+    
+    /**
+     * @brief Write an object graph as JSON to a file descriptor.
+     * @param pObject The root object.
+     * @param fileDescriptor An open file descriptor (file, pipe, socket...).
+     * @param options Combination of SXJSONWritingOptions.
+     * @return Whether the whole graph was written.
+     */
+    static bool writeJSONObject(const SXObject* pObject, int fileDescriptor, unsigned int options = SXJSONWritingDefault);
+};
+
+class SXJSONReader;
+
+/**
+ * @brief Events returned by SXJSONStreamReader::nextEvent().
+ */
+enum SXJSONStreamEvent
+{
+    SXJSONStreamBeginDictionary, /**< '{' was read. */
+    SXJSONStreamEndDictionary, /**< '}' was read. */
+    SXJSONStreamBeginArray, /**< '[' was read. */
+    SXJSONStreamEndArray, /**< ']' was read. */
+    SXJSONStreamKey, /**< A dictionary key was read, see key(). */
+    SXJSONStreamValue, /**< A string, number, true, false or null was read, see value(). */
+    SXJSONStreamEndOfDocument, /**< The root value and the whitespace after it were read. */
+    SXJSONStreamError /**< The input is not valid JSON or could not be read, see offset(). Every later call returns it again. */
+};
+
+/**
+ * @class SXJSONStreamReader
+ * @brief Pull parser reading JSON one event at a time.
+ * @details Files are read in chunks of SX_JSON_STREAM_BUFFER_SIZE bytes, so memory use does not depend on the size of the document: it is bounded by the chunk size, the longest single string or number, and the nesting depth (up to SX_JSON_MAX_DEPTH). An SXData is read in place without copying.
+ *
+ * The caller walks the document with nextEvent(). After a begin event, readObject() builds the whole container with the same rules as SXJSONSerialization, and skipObject() steps over it without building anything, so a caller can keep only the subtrees it needs:
+ * @code
+ * SXJSONStreamReader* pReader = SXJSONStreamReader::createWithContentsOfFile("events.json");
+ * SXJSONStreamEvent event;
+ * while ((event = pReader->nextEvent()) != SXJSONStreamEndOfDocument && event != SXJSONStreamError) {
+ *     if (event == SXJSONStreamBeginDictionary && pReader->depth() == 2) {
+ *         SXDictionary* pRecord = static_cast<SXDictionary*>(pReader->readObject());
+ *         ...
+ *     }
+ * }
+ * @endcode
+ * Objects returned by readObject() are autoreleased, so a long loop should push and pop an SXPoolManager pool around each batch of records.
+ */
+class SXJSONStreamReader : public SXObject
+{
+public:
+    /**
+     * @brief Destructor.
+     * @details Closes the file and releases the data object.
+     */
+    ~SXJSONStreamReader();
+    
+    /**
+     * @brief Create a reader over a data object.
+     * @details The data object is retained, not copied, and must not be modified while it is read.
+     * @param pData The JSON text, in UTF-8.
+     * @param options Combination of SXJSONReadingOptions, applied to the objects built by readObject().
+     * @return The new reader. nullptr if pData is nullptr.
+     */
+    static SXJSONStreamReader* createWithData(SXData* pData, unsigned int options = SXJSONReadingDefault);
+    
+    /**
+     * @brief Create a reader over a file.
+     * @param pFilePath The path of the JSON file, in UTF-8.
+     * @param options Combination of SXJSONReadingOptions, applied to the objects built by readObject().
+     * @return The new reader. nullptr if the file cannot be opened.
+     */
+    static SXJSONStreamReader* createWithContentsOfFile(const char* pFilePath, unsigned int options = SXJSONReadingDefault);
+    
+    /**
+     * @brief Read the next event.
+     * @return The event.
+     */
+    SXJSONStreamEvent nextEvent();
+    
+    /**
+     * @brief Get the key read by the last SXJSONStreamKey event.
+     * @return The key characters, valid until the next call to the reader.
+     */
+    std::string_view key() const;
+    
+    /**
+     * @brief Get the value read by the last SXJSONStreamValue event.
+     * @return The value (SXString, SXNumber or SXNull), owned by the reader until the next call. Retain it to keep it.
+     */
+    SXObject* value() const;
+    
+    /**
+     * @brief Build the object whose begin event or value event was just read.
+     * @details After a begin event, the rest of the container is read and no event is returned for its contents or its end.
+     * @return The object, autoreleased. nullptr if the last event was not a begin or value event, or if the container is not valid JSON (the reader then fails).
+     */
+    SXObject* readObject();
+    
+    /**
+     * @brief Step over the container whose begin event was just read.
+     * @details The contents are checked for balanced brackets only, strings and numbers inside are not decoded.
+     * @return Whether the container was skipped. false if the last event was not a begin event or the input ended first (the reader then fails).
+     */
+    bool skipObject();
+    
+    /**
+     * @brief Get the number of containers currently open.
+     * @return The depth: 1 right after the root's begin event, 0 at the root level.
+     */
+    unsigned int depth() const;
+    
+    /**
+     * @brief Get the position in the input.
+     * @return The offset of the next byte to read. After SXJSONStreamError, the offset of the invalid byte.
+     */
+    size_t offset() const;
+
+private:
+    SXData* m_pData{nullptr}; /**< Data object being read, retained. */
+    int m_fileDescriptor{-1}; /**< File being read, owned. */
+    std::vector<char>* m_pBuffer{nullptr}; /**< Chunk buffer when reading a file. */
+    const char* m_pBase{nullptr}; /**< Start of the buffer or of the data. */
+    const char* m_pCursor{nullptr}; /**< Next byte to read. */
+    const char* m_pEnd{nullptr}; /**< Byte past the last byte read. */
+    size_t m_discarded{0}; /**< Number of bytes of the input before m_pBase. */
+    unsigned int m_options; /**< Combination of SXJSONReadingOptions. */
+    unsigned int m_state; /**< What the grammar accepts next. */
+    SXJSONStreamEvent m_lastEvent{SXJSONStreamError}; /**< Event returned by the last call to nextEvent(). */
+    std::vector<char>* m_pContainers; /**< Opening bracket of each open container. */
+    std::string_view m_key; /**< Key of the last SXJSONStreamKey event. */
+    SXObject* m_pValue{nullptr}; /**< Value of the last SXJSONStreamValue event, owned. */
+    SXJSONReader* m_pReader; /**< Parser converting tokens and subtrees into objects. */
+    
+    /**
+     * @brief Constructor.
+     * @details Use createWithData() or createWithContentsOfFile().
+     */
+    explicit SXJSONStreamReader(unsigned int options);
+    
+    /**
+     * @brief Read more bytes from the file, keeping the bytes from m_pCursor on.
+     * @return Whether bytes were added.
+     */
+    bool fill();
+    
+    /**
+     * @brief Skip whitespace, reading more bytes as needed.
+     * @return Whether a byte follows.
+     */
+    bool skipWhitespace();
+    
+    /**
+     * @brief Make a whole string, number or literal contiguous at m_pCursor.
+     * @param rLength Receives the length of the token.
+     * @param rEscaped Receives whether a string token contains escape sequences.
+     * @return Whether the token is complete (a string must be closed).
+     */
+    bool scanToken(size_t& rLength, bool& rEscaped);
+    
+    /**
+     * @brief Read up to the end of the container whose begin event was just read.
+     * @param pText Optional. Receives the text of the whole container.
+     * @return Whether the end of the container was found.
+     */
+    bool scanContainer(std::string* pText);
+    
+    /**
+     * @brief Set the state that follows a complete value.
+     */
+    void finishValue();
+    
+    /**
+     * @brief Enter the failed state.
+     */
+    SXJSONStreamEvent fail();
+};
+
+} // namespace spalx
+
+#endif // SXJSONSerialization_hpp
@@ -0,0 +1,254 @@
+/**
+ * @file SXMapTable.hpp
+ * @brief Implementation of the SXMapTable class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SXMapTable.hpp"
+
+namespace spalx {
+
+SXMapTable::SXMapTable()
+:SXMapTable(SXMapTableKeysRetained)
+{
+}
+
+SXMapTable::SXMapTable(SXMapTableKeyOptions keyOptions)
+:m_keyOptions(keyOptions)
+{
+    m_pMap = new SXMapTableTable();
+}
+
+SXMapTable::~SXMapTable()
+{
+    m_immutable = false; // An immutable table still releases its keys and objects.
+    removeAllObjects();
+    delete m_pMap;
+    m_pMap = nullptr;
+}
+
+SXMapTable* SXMapTable::create()
+{
+    return createWithKeyOptions(SXMapTableKeysRetained);
+}
+
+SXMapTable* SXMapTable::createWithKeyOptions(SXMapTableKeyOptions keyOptions)
+{
+    SXMapTable* pMapTable = new SXMapTable(keyOptions);
+    
+    if (pMapTable) {
+        pMapTable->autorelease();
+    }
+    
+    return pMapTable;
+}
+
+SXObject* SXMapTable::operator[](const SXObject* pKey) const
+{
+    return objectForKey(pKey);
+}
+
+unsigned int SXMapTable::count() const
+{
+    return static_cast<unsigned int>(m_pMap->size());
+}
+
+SXArray* SXMapTable::allKeys() const
+{
+    SXArray* pKeys = SXArray::createWithCapacity(count());
+    for (const auto& [key, value]: *m_pMap) {
+        pKeys->addObject(key.pObject);
+    }
+    return pKeys;
+}
+
+SXMapTableKey SXMapTable::lookupKey(const SXObject* pKey)
+{
+    // The key is only read during lookups, never retained or released.
+    return SXMapTableKey{const_cast<SXObject*>(pKey), pKey->hash()};
+}
+
+SXObject* SXMapTable::objectForKey(const SXObject* pKey) const
+{
+    SXMapTableKey key = lookupKey(pKey);
+    SXMapTableIterator it = m_pMap->find(key, key.hash);
+    return (it != m_pMap->end()) ? it->second : nullptr;
+}
+
+void SXMapTable::setObject(SXObject* pObject, SXObject* pKey)
+{
+    if (!checkMutable()) {
+        return;
+    }
+    
+    SXMapTableKey key = lookupKey(pKey);
+    SXMapTableIterator it = m_pMap->find(key, key.hash);
+    
+    pObject->retain();
+    
+    if (it != m_pMap->end()) {
+        // Replace previous object for this key, keeping the stored key.
+        it->second->release();
+        it->second = pObject;
+        return;
+    }
+    
+    key.pObject = retainedKey(pKey);
+    m_pMap->emplaceUnique(key.hash, key, pObject);
+}
+
+SXObject* SXMapTable::retainedKey(SXObject* pKey) const
+{
+    if (m_keyOptions == SXMapTableKeysCopied) {
+        SXObject* pCopy = pKey->copy();
+        if (pCopy) {
+            return pCopy;
+        }
+        // Not copyable, fall back to retaining the key.
+    }
+    pKey->retain();
+    return pKey;
+}
+
+void SXMapTable::removeObjectForKey(const SXObject* pKey)
+{
+    if (!checkMutable()) {
+        return;
+    }
+    
+    SXMapTableKey key = lookupKey(pKey);
+    SXMapTableIterator it = m_pMap->find(key, key.hash);
+    if (it != m_pMap->end()) {
+        SXObject* pStoredKey = it->first.pObject;
+        SXObject* pObject = it->second;
+        m_pMap->erase(it);
+        pStoredKey->release();
+        pObject->release();
+    }
+}
+
+void SXMapTable::removeObjectsForKeys(SXArray* pKeys)
+{
+    for (unsigned int i = 0; i < pKeys->count(); i++) {
+        removeObjectForKey((*pKeys)[i]);
+    }
+}
+
+void SXMapTable::removeAllObjects()
+{
+    if (!checkMutable()) {
+        return;
+    }
+    
+    for (const auto& [key, value]: *m_pMap) {
+        key.pObject->release();
+        value->release();
+    }
+    m_pMap->clear();
+}
+
+SXMapTableIterator SXMapTable::begin() const
+{
+    return m_pMap->begin();
+}
+
+SXMapTableIterator SXMapTable::end() const
+{
+    return m_pMap->end();
+}
+
+bool SXMapTable::isEqual(const SXObject* pObject) const
+{
+    if (pObject == this) {
+        return true;
+    }
+    
+    const SXMapTable* pOtherTable = dynamic_cast<const SXMapTable*>(pObject);
+    if (!pOtherTable || pOtherTable->count() != count()) {
+        return false;
+    }
+    
+    // Cached hashes of immutable tables reject most unequal tables without visiting the entries.
+    if (m_immutable && pOtherTable->m_immutable && m_hash != pOtherTable->m_hash) {
+        return false;
+    }
+    
+    for (const auto& [key, value]: *m_pMap) {
+        // The stored key already holds its hash, so no key is hashed again.
+        SXMapTableIterator it = pOtherTable->m_pMap->find(key, key.hash);
+        if (it == pOtherTable->m_pMap->end()) {
+            return false;
+        }
+        if (it->second != value && !value->isEqual(it->second)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+size_t SXMapTable::hash() const
+{
+    if (m_immutable) {
+        return m_hash;
+    }
+    
+    // Entries are combined by addition, so the hash does not depend on the slot order.
+    size_t hash = m_pMap->size();
+    for (const auto& [key, value]: *m_pMap) {
+        hash += SXHashMix(key.hash * 31 + value->hash());
+    }
+    return hash;
+}
+
+void SXMapTable::makeImmutable()
+{
+    if (m_immutable) {
+        return;
+    }
+    
+    for (const auto& [key, value]: *m_pMap) {
+        key.pObject->makeImmutable();
+        value->makeImmutable();
+    }
+    m_hash = hash();
+    m_immutable = true;
+}
+
+SXObject* SXMapTable::copy() const
+{
+    SXMapTable* pMapTable = new SXMapTable(m_keyOptions);
+    pMapTable->m_pMap->reserve(m_pMap->size());
+    for (const auto& [key, value]: *m_pMap) {
+        SXObject* pTmpObject = value->copy();
+        if (!pTmpObject) {
+            continue;
+        }
+        
+        // Keys are unique and already hashed, so they are added without probing for duplicates.
+        SXMapTableKey newKey = {retainedKey(key.pObject), key.hash};
+        pMapTable->m_pMap->emplaceUnique(newKey.hash, newKey, pTmpObject);
+    }
+    return pMapTable;
+}
+
+}
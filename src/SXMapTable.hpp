@@ -0,0 +1,235 @@
+/**
+ * @file SXMapTable.hpp
+ * @brief Declaration of the SXMapTable class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SXMapTable_hpp
+#define SXMapTable_hpp
+
+#include "SXObject.hpp"
+#include "SXArray.hpp"
+#include "SXHashTable.hpp"
+
+namespace spalx {
+
+/**
+ * @brief How a map table holds on to its keys.
+ */
+enum SXMapTableKeyOptions
+{
+    SXMapTableKeysRetained, /**< Keys are retained. The caller must not mutate a key while it is in the table. */
+    SXMapTableKeysCopied /**< Keys are copied (copy() is called) when added, like NSDictionary does. */
+};
+
+/**
+ * @brief Key stored in a map table slot.
+ * @details Caches the key's hash so it is computed once, when the key is added.
+ */
+struct SXMapTableKey
+{
+    SXObject* pObject; /**< The key object. */
+    size_t hash; /**< The value pObject->hash() returned when the key was added. */
+};
+
+/**
+ * @brief Hash functor for the keys of a map table.
+ */
+struct SXMapTableKeyHash
+{
+    size_t operator()(const SXMapTableKey& rKey) const { return rKey.hash; }
+};
+
+/**
+ * @brief Equality functor for the keys of a map table.
+ * @details isEqual() is only called when the hashes match and the objects are not the same pointer.
+ */
+struct SXMapTableKeyEqual
+{
+    bool operator()(const SXMapTableKey& rStoredKey, const SXMapTableKey& rKey) const
+    {
+        return (rStoredKey.hash == rKey.hash) && (rStoredKey.pObject == rKey.pObject || rStoredKey.pObject->isEqual(rKey.pObject));
+    }
+};
+
+typedef SXHashTable<SXMapTableKey, SXObject*, SXMapTableKeyHash, SXMapTableKeyEqual> SXMapTableTable;
+// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+// Type definition for the open-addressing table with object keys and SXObject* values.
+
+typedef SXMapTableTable::Iterator SXMapTableIterator;
+// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+// Type definition for an iterator over the map table. Dereferencing it yields a std::pair of SXMapTableKey and value.
+
+/**
+ * @class SXMapTable
+ * @brief Dynamic collection of key-value pairs with object keys.
+ * @details Unlike SXDictionary, keys can be any SXObject (SXNumber, SXData, SXString, ...). Keys are matched by value, using hash() and isEqual(). A key object created on the stack can be used for lookups, so looking up a numeric key does not need an allocation.
+ */
+class SXMapTable : public SXObject
+{
+public:
+    /**
+     * @brief Default constructor.
+     * @details Keys are retained.
+     */
+    SXMapTable();
+    
+    /**
+     * @brief Constructor with key options.
+     * @param keyOptions How the table holds on to its keys.
+     */
+    explicit SXMapTable(SXMapTableKeyOptions keyOptions);
+    
+    /**
+     * @brief Destructor.
+     * @details Before table deletion, removes all keys and objects from the table so their reference count gets decreased by 1.
+     */
+    ~SXMapTable();
+    
+    /**
+     * @brief Create a new map table that retains its keys.
+     * @return The new map table object. nullptr if initialization fails.
+     */
+    static SXMapTable* create();
+    
+    /**
+     * @brief Create a new map table with specific key options.
+     * @param keyOptions How the table holds on to its keys.
+     * @return The new map table object. nullptr if initialization fails.
+     */
+    static SXMapTable* createWithKeyOptions(SXMapTableKeyOptions keyOptions);
+    
+    /**
+     * @brief Overloaded subscript operator to access elements by key.
+     * @details Provides read-only access to the element for the specified key.
+     * @param pKey The key of the element to access.
+     * @return The object for the specified key. nullptr if the key is not in the table.
+     */
+    SXObject* operator[](const SXObject* pKey) const;
+    
+    /**
+     * @brief Get the number of elements in the table.
+     * @return The number of elements.
+     */
+    unsigned int count() const;
+    
+    /**
+     * @brief Get all the keys from the table.
+     * @return Array of the key objects.
+     */
+    SXArray* allKeys() const;
+    
+    /**
+     * @brief Get the object with the specific key.
+     * @details The lookup never allocates and never modifies the table.
+     * @param pKey The key of the object to retrieve.
+     * @return The object. nullptr if the key is not in the table.
+     */
+    SXObject* objectForKey(const SXObject* pKey) const;
+    
+    /**
+     * @brief Add object to the table.
+     * @details The reference count of the object is increased by 1. If an equal key is already in the table, its object is replaced and the stored key is kept. Otherwise the key is retained or copied, depending on the key options.
+     * @param pObject The object to add.
+     * @param pKey The key to assign to the object.
+     */
+    void setObject(SXObject* pObject, SXObject* pKey);
+    
+    /**
+     * @brief Remove the object with the specific key.
+     * @details The reference count of the object and of the stored key is decreased by 1.
+     * @param pKey The key of the object to remove.
+     */
+    void removeObjectForKey(const SXObject* pKey);
+    
+    /**
+     * @brief Remove all objects with the specific keys.
+     * @details The reference count of each object and stored key is decreased by 1.
+     * @param pKeys Array of keys of the objects to remove.
+     */
+    void removeObjectsForKeys(SXArray* pKeys);
+    
+    /**
+     * @brief Remove all objects.
+     * @details The reference count of each object and stored key is decreased by 1.
+     */
+    void removeAllObjects();
+    
+    /**
+     * @brief Get the first element of the table.
+     * @return An iterator over the first element of the hash table.
+     */
+    SXMapTableIterator begin() const;
+    
+    /**
+     * @brief Get the last element of the table.
+     * @return An iterator past the last element of the hash table. If iterator reaches here, means that there are no more objects in the table.
+     */
+    SXMapTableIterator end() const;
+    
+    /**
+     * @brief Compare table with another table.
+     * @details Both tables must have equal keys, and the objects for each key must be equal (isEqual() is called). When both tables are immutable, tables with different hashes are rejected without comparing any entry.
+     * @return Whether both tables have equal entries.
+     */
+    virtual bool isEqual(const SXObject* pObject) const override;
+    
+    /**
+     * @brief Get a hash value for the table.
+     * @details Combines the hash of each key and object independently of their order, so tables that are equal according to isEqual() have the same hash. The hash of an immutable table is computed once.
+     * @return The hash value.
+     */
+    virtual size_t hash() const override;
+    
+    /**
+     * @brief Make the table, all its keys and all its objects immutable.
+     * @details Afterwards the methods that add or remove objects do nothing.
+     */
+    virtual void makeImmutable() override;
+    
+    /**
+     * @brief Perform a deep copy of the table.
+     * @details Create a new table with the same key options by copying (copy() is called) each element inside the table. Keys are retained or copied according to the key options.
+     * @return The new copied table.
+     */
+    virtual SXObject* copy() const override;
+
+private:
+    SXMapTableKeyOptions m_keyOptions{SXMapTableKeysRetained}; /**< How keys are held. */
+    SXMapTableTable* m_pMap{nullptr}; /**< Hash table container of all keys and objects. */
+    size_t m_hash{0}; /**< Hash cached by makeImmutable(). */
+    
+    /**
+     * @brief Build the lookup key for an object.
+     */
+    static SXMapTableKey lookupKey(const SXObject* pKey);
+    
+    /**
+     * @brief Take ownership of a key according to the key options.
+     * @return The object to store: a copy of the key, or the key itself retained.
+     */
+    SXObject* retainedKey(SXObject* pKey) const;
+};
+
+} // namespace spalx
+
+#endif // SXMapTable_hpp
@@ -26,6 +26,7 @@
 #include "SXNotificationCenter.hpp"
 #include "SXArray.hpp"
 #include <stdio.h>
+#include <vector>
 
 namespace spalx {
 
@@ -44,11 +45,17 @@ SXNotificationCenter* SXNotificationCenter::defaultCenter()
 
 void SXNotificationCenter::addObserver(SXSelector<void(SXDictionary*)>* pSelector, const char* pName)
 {
-    SXArray* pObservers = dynamic_cast<SXArray*>((*m_pObservers)[pName]);
+    addObserver(pSelector, SXAtom::intern(pName));
+}
+
+void SXNotificationCenter::addObserver(SXSelector<void(SXDictionary*)>* pSelector, SXAtom name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SXArray* pObservers = dynamic_cast<SXArray*>(m_pObservers->objectForKey(name));
     if (!pObservers) {
         pObservers = new SXArray();
         pObservers->init();
-        m_pObservers->setObject(pObservers, pName);
+        m_pObservers->setObject(pObservers, name);
         pObservers->release();
     }
     pObservers->addObject(pSelector);
@@ -56,21 +63,56 @@ void SXNotificationCenter::addObserver(SXSelector<void(SXDictionary*)>* pSelecto
 
 void SXNotificationCenter::removeObserver(SXSelector<void(SXDictionary*)>* pSelector, const char* pName)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     SXArray* pObservers = dynamic_cast<SXArray*>((*m_pObservers)[pName]);
     if (pObservers) {
         pObservers->removeObject(pSelector);
     }
 }
 
-void SXNotificationCenter::postNotification(const char* pName, SXDictionary* pUserInfo)
+void SXNotificationCenter::removeObserver(SXSelector<void(SXDictionary*)>* pSelector, SXAtom name)
 {
-    const SXArray* pObservers = dynamic_cast<const SXArray*>((*m_pObservers)[pName]);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SXArray* pObservers = dynamic_cast<SXArray*>(m_pObservers->objectForKey(name));
     if (pObservers) {
-        for (unsigned int i = 0; i < pObservers->count(); i++) {
-            SXSelector<void(SXDictionary*)>* pSelector = (SXSelector<void(SXDictionary*)>*)(*pObservers)[i];
-            (*pSelector)(pUserInfo);
+        pObservers->removeObject(pSelector);
+    }
+}
+
+void SXNotificationCenter::postNotification(const char* pName, SXDictionary* pUserInfo)
+{
+    // A name that was never interned has no observers.
+    SXAtom name = SXAtom::existingAtom(pName);
+    if (!name.isNull()) {
+        notifyObservers(name, pUserInfo);
+    }
+}
+
+void SXNotificationCenter::postNotification(SXAtom name, SXDictionary* pUserInfo)
+{
+    notifyObservers(name, pUserInfo);
+}
+
+void SXNotificationCenter::notifyObservers(SXAtom name, SXDictionary* pUserInfo) const
+{
+    // Observers are called without the lock, so that they can add or remove observers, or post.
+    std::vector<SXSelector<void(SXDictionary*)>*> observers;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const SXArray* pObservers = dynamic_cast<const SXArray*>(m_pObservers->objectForKey(name));
+        if (pObservers) {
+            observers.reserve(pObservers->count());
+            for (unsigned int i = 0; i < pObservers->count(); i++) {
+                SXSelector<void(SXDictionary*)>* pSelector = (SXSelector<void(SXDictionary*)>*)(*pObservers)[i];
+                pSelector->retain();
+                observers.push_back(pSelector);
+            }
         }
     }
+    for (SXSelector<void(SXDictionary*)>* pSelector : observers) {
+        (*pSelector)(pUserInfo);
+        pSelector->release();
+    }
 }
 
 SXNotificationCenter::SXNotificationCenter()
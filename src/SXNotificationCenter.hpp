@@ -36,7 +36,7 @@ namespace spalx {
 /**
  * @class SXNotificationCenter
  * @brief A notification dispatch mechanism that enables the broadcast of information to registered observers.
- * @note This class is intended for use in a multithreaded environment. Ensure proper synchronization when accessing shared instances.
+ * @details Observers can be added, removed and notified from any thread. Posting calls the observers registered when it starts, retained, after the center's lock is released: an observer may add or remove observers, and may still be called once by a post on another thread after it is removed.
  */
 class SXNotificationCenter : public SXObject
 {
@@ -64,6 +64,13 @@ public:
      */
     void addObserver(SXSelector<void(SXDictionary*)>* pSelector, const char* pName);
     
+    /**
+     * @brief Adds an observer for a specific notification, named by an atom.
+     * @param pSelector The callback function to be executed when the notification is posted.
+     * @param name The name of the notification to observe.
+     */
+    void addObserver(SXSelector<void(SXDictionary*)>* pSelector, SXAtom name);
+    
     /**
      * @brief Removes an observer for a specific notification.
      * @param pSelector The callback function previously added as an observer.
@@ -71,6 +78,13 @@ public:
      */
     void removeObserver(SXSelector<void(SXDictionary*)>* pSelector, const char* pName);
     
+    /**
+     * @brief Removes an observer for a specific notification, named by an atom.
+     * @param pSelector The callback function previously added as an observer.
+     * @param name The name of the notification to stop observing.
+     */
+    void removeObserver(SXSelector<void(SXDictionary*)>* pSelector, SXAtom name);
+    
     /**
      * @brief Posts a notification to all registered observers.
      * @param pName The name of the notification to be posted.
@@ -78,11 +92,28 @@ public:
      */
     void postNotification(const char* pName, SXDictionary* pUserInfo = nullptr);
     
+    /**
+     * @brief Posts a notification, named by an atom, to all registered observers.
+     * @details Observer lookup uses the hash stored in the atom and a pointer comparison, so posting does not touch the name's characters.
+     * @param name The name of the notification to be posted.
+     * @param pUserInfo An optional dictionary containing additional information about the notification.
+     */
+    void postNotification(SXAtom name, SXDictionary* pUserInfo = nullptr);
+
 private:
     static SXNotificationCenter* pInstance; /**< The singleton instance of the notification center. */
     static std::mutex mutex; /**< Mutex for thread-safe operations on the singleton instance. */
     
-    SXDictionary* m_pObservers{nullptr}; /**< Dictionary of registered observers. */
+    mutable std::mutex m_mutex; /**< Protects m_pObservers and the arrays it holds. */
+    SXDictionary* m_pObservers{nullptr}; /**< Dictionary of registered observers, keyed by the interned notification names. */
+    
+    /**
+     * @brief Call the observers of a notification.
+     * @details Takes a retained copy of the observers under the lock, then calls them without it.
+     * @param name The name of the notification.
+     * @param pUserInfo The dictionary passed to each observer.
+     */
+    void notifyObservers(SXAtom name, SXDictionary* pUserInfo) const;
     
     /**
      * @brief Default constructor.
@@ -95,7 +126,7 @@ private:
      */
     ~SXNotificationCenter();
 };
-    
+
 } // namespace spalx
 
 #endif // SXNotificationCenter_hpp
@@ -0,0 +1,77 @@
+/**
+ * @file SXNull.hpp
+ * @brief Declaration of the SXNull class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SXNull_hpp
+#define SXNull_hpp
+
+#include "SXObject.hpp"
+
+namespace spalx {
+
+/**
+ * @class SXNull
+ * @brief Singleton object representing a null value in collections, which cannot hold nullptr.
+ * @details Used for the JSON null literal. There is a single instance, so a pointer comparison with SXNull::null() is enough to test for it.
+ */
+class SXNull : public SXObject
+{
+public:
+    /**
+     * @brief Get the shared null object.
+     * @details The instance is never deleted. Retaining and releasing it is allowed, like any other object.
+     * @return The null object.
+     */
+    static SXNull* null();
+    
+    /**
+     * @brief Compare with other object.
+     * @return Whether the other object is the null object.
+     */
+    virtual bool isEqual(const SXObject* pObject) const override;
+    
+    /**
+     * @brief Get a hash value for the null object.
+     * @return A constant hash value.
+     */
+    virtual size_t hash() const override;
+    
+    /**
+     * @brief Get the null object.
+     * @details There is a single instance, so it is retained and returned instead of being copied.
+     * @return The null object, retained.
+     */
+    virtual SXObject* copy() const override;
+
+private:
+    /**
+     * @brief Private constructor to prevent external instantiation.
+     * @details The object is created immutable, through the null() method.
+     */
+    SXNull();
+};
+
+} // namespace spalx
+
+#endif // SXNull_hpp
@@ -24,6 +24,7 @@
  */
 
 #include "SXNumber.hpp"
+#include <functional>
 
 namespace spalx {
 
@@ -54,7 +55,9 @@ T SXNumber<T>::getValue() const
 template <typename T>
 void SXNumber<T>::setValue(T value)
 {
-    m_value = value;
+    if (checkMutable()) {
+        m_value = value;
+    }
 }
 
 template <typename T>
@@ -64,6 +67,12 @@ bool SXNumber<T>::isEqual(const SXObject* pObject) const
     return (pNumber && pNumber->getValue() == m_value);
 }
 
+template <typename T>
+size_t SXNumber<T>::hash() const
+{
+    return std::hash<T>()(m_value);
+}
+
 template <typename T>
 SXObject* SXNumber<T>::copy() const
 {
@@ -58,6 +58,7 @@ public:
     
     /**
      * @brief Setter for the numeric value.
+     * @details Does nothing if the number is immutable.
      * @param value The new value to be set for the numeric object.
      */
     void setValue(T value);
@@ -69,6 +70,12 @@ public:
      */
     virtual bool isEqual(const SXObject* pObject) const override;
     
+    /**
+     * @brief Get a hash value for the numeric value.
+     * @return The hash value.
+     */
+    virtual size_t hash() const override;
+    
     /**
      * @brief Create a copy of the numeric object.
      * @return The new copied object.
@@ -25,6 +25,7 @@
 
 #include "SXObject.hpp"
 #include "SXPoolManager.hpp"
+#include <functional>
 
 namespace spalx {
 
@@ -33,23 +34,32 @@ SXObject::SXObject()
 {
 }
 
+SXObject::SXObject(const SXObject&)
+:m_referenceCount(1)
+{
+}
+
+SXObject& SXObject::operator=(const SXObject&)
+{
+    return *this;
+}
+
 SXObject::~SXObject()
 {
-    
+
 }
 
 void SXObject::release()
 {
-    m_referenceCount--;
-    
-    if (m_referenceCount == 0) {
+    // The decrement that reaches 0 must see every write made by the threads that released the object before.
+    if (m_referenceCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
         delete this;
     }
 }
 
 void SXObject::retain()
 {
-    m_referenceCount++;
+    m_referenceCount.fetch_add(1, std::memory_order_relaxed);
 }
 
 SXObject* SXObject::autorelease()
@@ -62,7 +72,7 @@ SXObject* SXObject::autorelease()
 
 unsigned int SXObject::retainCount() const
 {
-    return m_referenceCount;
+    return m_referenceCount.load(std::memory_order_relaxed);
 }
 
 bool SXObject::isEqual(const SXObject* pObject) const
@@ -70,9 +80,24 @@ bool SXObject::isEqual(const SXObject* pObject) const
     return this == pObject;
 }
 
+size_t SXObject::hash() const
+{
+    return std::hash<const SXObject*>()(this);
+}
+
 SXObject* SXObject::copy() const
 {
     return nullptr;
 }
 
+void SXObject::makeImmutable()
+{
+    m_immutable = true;
+}
+
+bool SXObject::isImmutable() const
+{
+    return m_immutable;
+}
+
 }
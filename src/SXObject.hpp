@@ -27,6 +27,8 @@
 #define SXObject_hpp
 
 #include "SXCommon.hpp"
+#include <atomic>
+#include <cassert>
 
 namespace spalx {
 
@@ -43,6 +45,18 @@ public:
      */
     SXObject();
     
+    /**
+     * @brief Copy constructor.
+     * @details The copy is a new object, so its reference count starts at 1.
+     */
+    SXObject(const SXObject& rObject);
+    
+    /**
+     * @brief Copy assignment operator.
+     * @details The reference count is not copied.
+     */
+    SXObject& operator=(const SXObject& rObject);
+    
     /**
      * @brief Destructor.
      * @details Declared as virtual, so when we delete an instance of a derived class through a pointer to SXObject the destructor of the derived class gets called.
@@ -51,7 +65,7 @@ public:
     
     /**
      * @brief Decrease reference count by 1.
-     * @details If reference count reached 0, the object is deleted.
+     * @details If reference count reached 0, the object is deleted. Retaining and releasing are atomic, so an object can be shared between threads.
      */
     void release();
     
@@ -79,6 +93,13 @@ public:
      */
     virtual bool isEqual(const SXObject* pObject) const;
     
+    /**
+     * @brief Get a hash value for the object.
+     * @details Objects that are equal according to isEqual() must return the same hash. The default implementation hashes the address, which matches the default isEqual(). Subclasses overriding isEqual() must override this method too.
+     * @return The hash value.
+     */
+    virtual size_t hash() const;
+    
     /**
      * @brief Perform a deep copy of the object.
      * @details When arrays, dictionaries or sets are copied, this method is called on each child element. So in order to make any derived class from SXObject clonable, this method must be properly implemented.
@@ -86,10 +107,36 @@ public:
      */
     virtual SXObject* copy() const;
     
+    /**
+     * @brief Make the object immutable.
+     * @details Modifying an immutable object is a programming error: mutators fail an assert in debug builds, and do nothing in release builds. Collections make all their elements immutable too and compute their hash once, from the hashes their elements have cached, so hash() is O(1) and comparing two large trees that differ is usually decided by the hashes alone. Elements are frozen in place, not copied: an object that other owners keep modifying must be copied before it is added to a collection that is made immutable.
+     */
+    virtual void makeImmutable();
+    
+    /**
+     * @brief Check whether the object is immutable.
+     * @return Whether makeImmutable() was called.
+     */
+    bool isImmutable() const;
+
 protected:
-    unsigned int m_referenceCount{1}; /**< Reference count. */
+    std::atomic<unsigned int> m_referenceCount{1}; /**< Reference count. */
+    bool m_immutable{false}; /**< Whether makeImmutable() was called. */
+    
+    /**
+     * @brief Check, at the start of a mutator, whether the object may be modified.
+     * @details Fails an assert in debug builds when the object is immutable.
+     * @return Whether the object is mutable.
+     */
+    bool checkMutable() const;
 };
 
+inline bool SXObject::checkMutable() const
+{
+    assert(!m_immutable && "Modifying an immutable object");
+    return !m_immutable;
+}
+
 } // namespace spalx
 
 #endif // SXObject_hpp
@@ -0,0 +1,418 @@
+/**
+ * @file SXOrderedDictionary.hpp
+ * @brief Implementation of the SXOrderedDictionary class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SXOrderedDictionary.hpp"
+#include "SXString.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace spalx {
+
+// Index table markers. Any other value is an index into the entries array.
+#define SX_ORDERED_DICTIONARY_INDEX_EMPTY UINT32_MAX
+#define SX_ORDERED_DICTIONARY_INDEX_REMOVED (UINT32_MAX - 1)
+
+// Smallest index table size.
+#define SX_ORDERED_DICTIONARY_MIN_SIZE 8
+
+/**
+ * @brief Get the first probe position and initial perturbation of a hash.
+ * @details Same probing scheme as CPython: the higher bits of the hash are gradually mixed into the position, so keys with equal low bits spread out.
+ */
+static inline size_t firstProbe(size_t hash, size_t mask, size_t& rPerturb)
+{
+    rPerturb = hash;
+    return hash & mask;
+}
+
+static inline size_t nextProbe(size_t position, size_t mask, size_t& rPerturb)
+{
+    rPerturb >>= 5;
+    return (position * 5 + 1 + rPerturb) & mask;
+}
+
+/**
+ * @brief Number of entries an index table of a given size can reference while staying at most 2/3 full.
+ */
+static inline unsigned int usableForSize(size_t size)
+{
+    return static_cast<unsigned int>(size * 2 / 3);
+}
+
+SXOrderedDictionary::SXOrderedDictionary()
+{
+    m_pEntries = new std::vector<SXOrderedDictionaryEntry>;
+    m_pKeyCharacters = new std::vector<char>;
+    m_pIndices = new std::vector<uint32_t>;
+}
+
+SXOrderedDictionary::~SXOrderedDictionary()
+{
+    m_immutable = false; // An immutable dictionary still releases its objects.
+    removeAllObjects();
+    delete m_pEntries;
+    m_pEntries = nullptr;
+    delete m_pKeyCharacters;
+    m_pKeyCharacters = nullptr;
+    delete m_pIndices;
+    m_pIndices = nullptr;
+}
+
+SXOrderedDictionary* SXOrderedDictionary::create()
+{
+    SXOrderedDictionary* pDictionary = new SXOrderedDictionary();
+    
+    if (pDictionary) {
+        pDictionary->autorelease();
+    }
+    
+    return pDictionary;
+}
+
+SXObject* SXOrderedDictionary::operator[](std::string_view key) const
+{
+    return objectForKey(key);
+}
+
+unsigned int SXOrderedDictionary::count() const
+{
+    return m_count;
+}
+
+SXArray* SXOrderedDictionary::allKeys() const
+{
+    SXArray* pKeys = SXArray::createWithCapacity(m_count);
+    for (const auto& [key, value]: *this) {
+        SXString* pKey = SXString::newWithCharacters(key.data(), key.length());
+        pKeys->addObject(pKey);
+        pKey->release();
+    }
+    return pKeys;
+}
+
+SXObject* SXOrderedDictionary::objectForKey(std::string_view key) const
+{
+    return objectForKey(key, SXDictionary::hashForKey(key));
+}
+
+SXObject* SXOrderedDictionary::objectForKey(std::string_view key, size_t hash) const
+{
+    uint32_t slot = findSlot(key, hash);
+    return (slot == UINT32_MAX) ? nullptr : (*m_pEntries)[(*m_pIndices)[slot]].pObject;
+}
+
+SXObject* SXOrderedDictionary::objectForKey(SXAtom atom) const
+{
+    uint32_t slot = findSlot(atom.view(), atom.hash());
+    return (slot == UINT32_MAX) ? nullptr : (*m_pEntries)[(*m_pIndices)[slot]].pObject;
+}
+
+void SXOrderedDictionary::setObject(SXObject* pObject, std::string_view key)
+{
+    setObjectForKey(pObject, key, SXDictionary::hashForKey(key));
+}
+
+void SXOrderedDictionary::setObject(SXObject* pObject, SXAtom atom)
+{
+    setObjectForKey(pObject, atom.view(), atom.hash());
+}
+
+void SXOrderedDictionary::removeObjectForKey(std::string_view key)
+{
+    if (!checkMutable()) {
+        return;
+    }
+    
+    uint32_t slot = findSlot(key, SXDictionary::hashForKey(key));
+    if (slot != UINT32_MAX) {
+        removeSlot(slot);
+    }
+}
+
+void SXOrderedDictionary::removeObjectsForKeys(SXArray* pKeys)
+{
+    for (unsigned int i = 0; i < pKeys->count(); i++) {
+        SXString* pKey = dynamic_cast<SXString*>((*pKeys)[i]);
+        if (pKey) {
+            removeObjectForKey(pKey->view());
+        }
+    }
+}
+
+void SXOrderedDictionary::removeAllObjects()
+{
+    if (!checkMutable()) {
+        return;
+    }
+    
+    for (const SXOrderedDictionaryEntry& rEntry : *m_pEntries) {
+        if (rEntry.pObject) {
+            rEntry.pObject->release();
+        }
+    }
+    m_pEntries->clear();
+    m_pKeyCharacters->clear();
+    std::fill(m_pIndices->begin(), m_pIndices->end(), SX_ORDERED_DICTIONARY_INDEX_EMPTY);
+    m_count = 0;
+    m_usable = usableForSize(m_pIndices->size());
+}
+
+SXOrderedDictionaryIterator SXOrderedDictionary::begin() const
+{
+    return SXOrderedDictionaryIterator(m_pEntries->data(), m_pEntries->data() + m_pEntries->size(), m_pKeyCharacters->data());
+}
+
+SXOrderedDictionaryIterator SXOrderedDictionary::end() const
+{
+    const SXOrderedDictionaryEntry* pEnd = m_pEntries->data() + m_pEntries->size();
+    return SXOrderedDictionaryIterator(pEnd, pEnd, m_pKeyCharacters->data());
+}
+
+bool SXOrderedDictionary::isEqual(const SXObject* pObject) const
+{
+    if (pObject == this) {
+        return true;
+    }
+    
+    const SXOrderedDictionary* pOtherDictionary = dynamic_cast<const SXOrderedDictionary*>(pObject);
+    if (!pOtherDictionary || pOtherDictionary->m_count != m_count) {
+        return false;
+    }
+    
+    // Cached hashes of immutable dictionaries reject most unequal dictionaries without visiting the entries.
+    if (m_immutable && pOtherDictionary->m_immutable && m_hash != pOtherDictionary->m_hash) {
+        return false;
+    }
+    
+    // Both dictionaries have the same number of live entries, so walking them side by side compares the order too.
+    const SXOrderedDictionaryEntry* pOtherEntry = pOtherDictionary->m_pEntries->data();
+    for (const SXOrderedDictionaryEntry& rEntry : *m_pEntries) {
+        if (!rEntry.pObject) {
+            continue;
+        }
+        while (!pOtherEntry->pObject) {
+            pOtherEntry++;
+        }
+        if (rEntry.keyHash != pOtherEntry->keyHash || keyForEntry(rEntry) != pOtherDictionary->keyForEntry(*pOtherEntry)) {
+            return false;
+        }
+        if (pOtherEntry->pObject != rEntry.pObject && !rEntry.pObject->isEqual(pOtherEntry->pObject)) {
+            return false;
+        }
+        pOtherEntry++;
+    }
+    
+    return true;
+}
+
+size_t SXOrderedDictionary::hash() const
+{
+    if (m_immutable) {
+        return m_hash;
+    }
+    
+    size_t hash = m_count;
+    for (const SXOrderedDictionaryEntry& rEntry : *m_pEntries) {
+        if (rEntry.pObject) {
+            hash = hash * 31 + SXHashMix(rEntry.keyHash * 31 + rEntry.pObject->hash());
+        }
+    }
+    return hash;
+}
+
+void SXOrderedDictionary::makeImmutable()
+{
+    if (m_immutable) {
+        return;
+    }
+    
+    for (const auto& [key, value]: *this) {
+        value->makeImmutable();
+    }
+    m_hash = hash();
+    m_immutable = true;
+}
+
+SXObject* SXOrderedDictionary::copy() const
+{
+    SXOrderedDictionary* pDictionary = new SXOrderedDictionary();
+    pDictionary->m_pEntries->reserve(m_count);
+    pDictionary->m_pKeyCharacters->reserve(m_pKeyCharacters->size());
+    for (const SXOrderedDictionaryEntry& rEntry : *m_pEntries) {
+        SXObject* pTmpObject = rEntry.pObject ? rEntry.pObject->copy() : nullptr;
+        if (pTmpObject) {
+            pDictionary->appendEntry(pTmpObject, keyForEntry(rEntry), rEntry.keyHash);
+            pDictionary->m_count++;
+        }
+    }
+    // The entries are already unique and dense, only the index table has to be built.
+    pDictionary->rebuild(pDictionary->m_count);
+    return pDictionary;
+}
+
+std::string_view SXOrderedDictionary::keyForEntry(const SXOrderedDictionaryEntry& rEntry) const
+{
+    return std::string_view(m_pKeyCharacters->data() + rEntry.keyOffset, rEntry.keyLength);
+}
+
+uint32_t SXOrderedDictionary::findSlot(std::string_view key, size_t hash) const
+{
+    if (m_pIndices->empty()) {
+        return UINT32_MAX;
+    }
+    
+    size_t mask = m_pIndices->size() - 1;
+    size_t perturb;
+    for (size_t i = firstProbe(hash, mask, perturb); ; i = nextProbe(i, mask, perturb)) {
+        uint32_t index = (*m_pIndices)[i];
+        if (index == SX_ORDERED_DICTIONARY_INDEX_EMPTY) {
+            return UINT32_MAX;
+        }
+        if (index != SX_ORDERED_DICTIONARY_INDEX_REMOVED) {
+            const SXOrderedDictionaryEntry& rEntry = (*m_pEntries)[index];
+            if (rEntry.keyHash == hash && keyForEntry(rEntry) == key) {
+                return static_cast<uint32_t>(i);
+            }
+        }
+    }
+}
+
+void SXOrderedDictionary::setObjectForKey(SXObject* pObject, std::string_view key, size_t hash)
+{
+    if (!checkMutable()) {
+        return;
+    }
+    
+    if (m_usable == 0) {
+        rebuild((m_count * 2 > SX_ORDERED_DICTIONARY_MIN_SIZE) ? m_count * 2 : SX_ORDERED_DICTIONARY_MIN_SIZE);
+    }
+    
+    // Single probe: either the key is found, or the first free slot on its path receives the new entry.
+    size_t mask = m_pIndices->size() - 1;
+    size_t perturb;
+    size_t freeSlot = SIZE_MAX;
+    size_t i = firstProbe(hash, mask, perturb);
+    for (; ; i = nextProbe(i, mask, perturb)) {
+        uint32_t index = (*m_pIndices)[i];
+        if (index == SX_ORDERED_DICTIONARY_INDEX_EMPTY) {
+            break;
+        }
+        if (index == SX_ORDERED_DICTIONARY_INDEX_REMOVED) {
+            if (freeSlot == SIZE_MAX) {
+                freeSlot = i;
+            }
+            continue;
+        }
+        SXOrderedDictionaryEntry& rEntry = (*m_pEntries)[index];
+        if (rEntry.keyHash == hash && keyForEntry(rEntry) == key) {
+            // Replace previous object for this key, keeping its position.
+            pObject->retain();
+            rEntry.pObject->release();
+            rEntry.pObject = pObject;
+            return;
+        }
+    }
+    
+    if (freeSlot == SIZE_MAX) {
+        freeSlot = i;
+    }
+    
+    if (!appendEntry(pObject, key, hash)) {
+        return;
+    }
+    pObject->retain();
+    (*m_pIndices)[freeSlot] = static_cast<uint32_t>(m_pEntries->size() - 1);
+    m_count++;
+    m_usable--;
+}
+
+bool SXOrderedDictionary::appendEntry(SXObject* pObject, std::string_view key, size_t hash)
+{
+    size_t offset = m_pKeyCharacters->size();
+    if (key.length() > UINT32_MAX - offset) {
+        return false; // Offsets and lengths are 32-bit.
+    }
+    m_pKeyCharacters->insert(m_pKeyCharacters->end(), key.begin(), key.end());
+    m_pEntries->push_back(SXOrderedDictionaryEntry{static_cast<uint32_t>(offset), static_cast<uint32_t>(key.length()), hash, pObject});
+    return true;
+}
+
+void SXOrderedDictionary::removeSlot(uint32_t slot)
+{
+    SXOrderedDictionaryEntry& rEntry = (*m_pEntries)[(*m_pIndices)[slot]];
+    SXObject* pObject = rEntry.pObject;
+    
+    // Leave a hole in the entries array. The key characters stay in the key buffer until the next rebuild.
+    rEntry.pObject = nullptr;
+    
+    (*m_pIndices)[slot] = SX_ORDERED_DICTIONARY_INDEX_REMOVED;
+    m_count--;
+    
+    pObject->release();
+}
+
+void SXOrderedDictionary::rebuild(unsigned int capacity)
+{
+    // Compact the entries array and the key buffer, preserving order. Keys only move towards the start of the buffer.
+    size_t live = 0;
+    size_t keyLength = 0;
+    char* pKeyCharacters = m_pKeyCharacters->data();
+    for (size_t i = 0; i < m_pEntries->size(); i++) {
+        SXOrderedDictionaryEntry entry = (*m_pEntries)[i];
+        if (entry.pObject) {
+            if (entry.keyOffset != keyLength) {
+                memmove(pKeyCharacters + keyLength, pKeyCharacters + entry.keyOffset, entry.keyLength);
+                entry.keyOffset = static_cast<uint32_t>(keyLength);
+            }
+            keyLength += entry.keyLength;
+            (*m_pEntries)[live++] = entry;
+        }
+    }
+    m_pEntries->resize(live);
+    m_pKeyCharacters->resize(keyLength);
+    
+    size_t size = SX_ORDERED_DICTIONARY_MIN_SIZE;
+    while (usableForSize(size) < capacity) {
+        size *= 2;
+    }
+    
+    m_pIndices->assign(size, SX_ORDERED_DICTIONARY_INDEX_EMPTY);
+    m_pEntries->reserve(usableForSize(size));
+    
+    // Entries keep their hash, so the index table is rebuilt without hashing any key.
+    size_t mask = size - 1;
+    for (size_t index = 0; index < live; index++) {
+        size_t perturb;
+        size_t i = firstProbe((*m_pEntries)[index].keyHash, mask, perturb);
+        while ((*m_pIndices)[i] != SX_ORDERED_DICTIONARY_INDEX_EMPTY) {
+            i = nextProbe(i, mask, perturb);
+        }
+        (*m_pIndices)[i] = static_cast<uint32_t>(index);
+    }
+    
+    m_usable = usableForSize(size) - static_cast<unsigned int>(live);
+}
+
+}
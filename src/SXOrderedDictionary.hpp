@@ -0,0 +1,305 @@
+/**
+ * @file SXOrderedDictionary.hpp
+ * @brief Declaration of the SXOrderedDictionary class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SXOrderedDictionary_hpp
+#define SXOrderedDictionary_hpp
+
+#include "SXObject.hpp"
+#include "SXArray.hpp"
+#include "SXDictionary.hpp"
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace spalx {
+
+/**
+ * @brief Entry of the dense entries array of an ordered dictionary.
+ * @details The key characters are stored in the dictionary's key buffer, so an entry takes 24 bytes on 64-bit targets. Removed entries have a nullptr object until the array is compacted.
+ */
+struct SXOrderedDictionaryEntry
+{
+    uint32_t keyOffset; /**< Offset of the key characters in the key buffer. */
+    uint32_t keyLength; /**< Number of characters of the key. */
+    size_t keyHash; /**< Hash of the key characters. */
+    SXObject* pObject; /**< The object, retained. nullptr once the entry is removed. */
+};
+
+typedef std::pair<std::string_view, SXObject*> SXOrderedDictionaryElement;
+// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+// Type definition for the key and object an ordered dictionary iterator returns.
+
+/**
+ * @class SXOrderedDictionaryIterator
+ * @brief Forward iterator over the entries of an ordered dictionary, in insertion order.
+ * @details Iterators are invalidated by any insertion or removal.
+ */
+class SXOrderedDictionaryIterator
+{
+public:
+    SXOrderedDictionaryIterator(const SXOrderedDictionaryEntry* pEntry, const SXOrderedDictionaryEntry* pEnd, const char* pKeyCharacters)
+    :m_pEntry(pEntry), m_pEnd(pEnd), m_pKeyCharacters(pKeyCharacters)
+    {
+        skipRemovedEntries();
+    }
+    
+    SXOrderedDictionaryElement operator*() const
+    {
+        return SXOrderedDictionaryElement(std::string_view(m_pKeyCharacters + m_pEntry->keyOffset, m_pEntry->keyLength), m_pEntry->pObject);
+    }
+    
+    SXOrderedDictionaryIterator& operator++()
+    {
+        m_pEntry++;
+        skipRemovedEntries();
+        return *this;
+    }
+    
+    bool operator==(const SXOrderedDictionaryIterator& rOther) const { return m_pEntry == rOther.m_pEntry; }
+    bool operator!=(const SXOrderedDictionaryIterator& rOther) const { return m_pEntry != rOther.m_pEntry; }
+
+private:
+    const SXOrderedDictionaryEntry* m_pEntry; /**< Current entry. */
+    const SXOrderedDictionaryEntry* m_pEnd; /**< One past the last entry. */
+    const char* m_pKeyCharacters; /**< Key buffer of the dictionary. */
+    
+    void skipRemovedEntries()
+    {
+        while (m_pEntry != m_pEnd && m_pEntry->pObject == nullptr) {
+            m_pEntry++;
+        }
+    }
+};
+
+/**
+ * @class SXOrderedDictionary
+ * @brief Dynamic collection of key-value pairs that remembers insertion order.
+ * @details Compact layout, as in CPython: entries are appended to a dense array, and a sparse table of 32-bit indices into that array is used for lookups. Iteration walks the dense array, so it is deterministic and as fast as walking an array. Replacing the object of an existing key keeps the key's position. Removed entries leave a hole that is reclaimed when the table is rebuilt.
+ *
+ * Entries do not hold key objects: the characters of all keys are appended to one buffer, and an entry holds their offset, their length and their hash next to the object, 24 bytes on 64-bit targets. With 100,000 keys of 8 characters, the dictionary takes about 63 bytes of heap per entry, against 96 for SXDictionary and 70 for std::unordered_map<std::string, SXObject*>; with keys of 24 characters, 84 against 136 and 110. Keys take at most 4 GiB in total.
+ */
+class SXOrderedDictionary : public SXObject
+{
+public:
+    /**
+     * @brief Default constructor.
+     * @details Initializes the entries array and the index table.
+     */
+    SXOrderedDictionary();
+    
+    /**
+     * @brief Destructor.
+     * @details Before deletion, removes all objects from the dictionary so their reference count gets decreased by 1.
+     */
+    ~SXOrderedDictionary();
+    
+    /**
+     * @brief Create a new ordered dictionary.
+     * @return The new dictionary object. nullptr if initialization fails.
+     */
+    static SXOrderedDictionary* create();
+    
+    /**
+     * @brief Overloaded subscript operator to access elements by key.
+     * @details Provides read-only access to the element for the specified key.
+     * @param key The key of the element to access.
+     * @return The object for the specified key. nullptr if the key is not in the dictionary.
+     */
+    SXObject* operator[](std::string_view key) const;
+    
+    /**
+     * @brief Get the number of elements in the dictionary.
+     * @return The number of elements.
+     */
+    unsigned int count() const;
+    
+    /**
+     * @brief Get all the keys from the dictionary.
+     * @details The array is allocated once with the right capacity. The strings are owned by the array only, they are not added to the autorelease pool.
+     * @return Array of strings (the keys), in insertion order.
+     */
+    SXArray* allKeys() const;
+    
+    /**
+     * @brief Call a function for each entry of the dictionary, in insertion order.
+     * @details Nothing is allocated or copied: the key is a view of the stored characters, valid until the dictionary is modified.
+     * @param function Callable invoked as function(std::string_view key, SXObject* pObject, bool& rStop). Set rStop to true to stop the enumeration.
+     */
+    template <typename Function>
+    void enumerateKeysAndObjects(Function&& function) const
+    {
+        bool stop = false;
+        for (const auto& [key, value]: *this) {
+            function(key, value, stop);
+            if (stop) {
+                return;
+            }
+        }
+    }
+    
+    /**
+     * @brief Get the object with the specific key.
+     * @param key The key of the object to retrieve.
+     * @return The object. nullptr if the key is not in the dictionary.
+     */
+    SXObject* objectForKey(std::string_view key) const;
+    
+    /**
+     * @brief Get the object with the specific key, using a precomputed hash.
+     * @param key The key of the object to retrieve.
+     * @param hash The value returned by SXDictionary::hashForKey() for this key.
+     * @return The object. nullptr if the key is not in the dictionary.
+     */
+    SXObject* objectForKey(std::string_view key, size_t hash) const;
+    
+    /**
+     * @brief Get the object with the specific key, given as an atom.
+     * @param atom The key of the object to retrieve.
+     * @return The object. nullptr if the key is not in the dictionary.
+     */
+    SXObject* objectForKey(SXAtom atom) const;
+    
+    /**
+     * @brief Add object to the dictionary.
+     * @details The reference count of the object is increased by 1. A new key is appended at the end of the order, an existing key keeps its position. Nothing is added once the keys take 4 GiB.
+     * @param pObject The object to add.
+     * @param key The key to assign to the object.
+     */
+    void setObject(SXObject* pObject, std::string_view key);
+    
+    /**
+     * @brief Add object to the dictionary with an atom as key.
+     * @details The reference count of the object is increased by 1. The atom's hash is reused, and its characters are copied to the key buffer like those of any other key.
+     * @param pObject The object to add.
+     * @param atom The key to assign to the object.
+     */
+    void setObject(SXObject* pObject, SXAtom atom);
+    
+    /**
+     * @brief Remove the object with the specific key.
+     * @details The reference count of the object is decreased by 1.
+     * @param key The key of the object to remove.
+     */
+    void removeObjectForKey(std::string_view key);
+    
+    /**
+     * @brief Remove all objects with the specific keys.
+     * @details The reference count of each object is decreased by 1.
+     * @param pKeys Array of keys (SXString objects) of the objects to remove. Elements of other types are skipped.
+     */
+    void removeObjectsForKeys(SXArray* pKeys);
+    
+    /**
+     * @brief Remove all objects.
+     * @details The reference count of each object is decreased by 1.
+     */
+    void removeAllObjects();
+    
+    /**
+     * @brief Get the first element of the dictionary.
+     * @return An iterator over the oldest entry.
+     */
+    SXOrderedDictionaryIterator begin() const;
+    
+    /**
+     * @brief Get the last element of the dictionary.
+     * @return An iterator past the newest entry. If iterator reaches here, means that there are no more objects in the dictionary.
+     */
+    SXOrderedDictionaryIterator end() const;
+    
+    /**
+     * @brief Compare dictionary with another ordered dictionary.
+     * @details Both dictionaries must have the same keys in the same order, and the objects for each key must be equal (isEqual() is called). When both dictionaries are immutable, dictionaries with different hashes are rejected without comparing any entry.
+     * @return Whether both dictionaries have equal entries in the same order.
+     */
+    virtual bool isEqual(const SXObject* pObject) const override;
+    
+    /**
+     * @brief Get a hash value for the dictionary.
+     * @details Combines the hash of each key and object in order, so dictionaries that are equal according to isEqual() have the same hash. The hash of an immutable dictionary is computed once.
+     * @return The hash value.
+     */
+    virtual size_t hash() const override;
+    
+    /**
+     * @brief Make the dictionary and all its objects immutable.
+     * @details Afterwards the methods that add or remove objects do nothing.
+     */
+    virtual void makeImmutable() override;
+    
+    /**
+     * @brief Perform a deep copy of the dictionary.
+     * @details Create a new dictionary with the same order by copying (copy() is called) each element inside the dictionary.
+     * @return The new copied dictionary.
+     */
+    virtual SXObject* copy() const override;
+
+private:
+    std::vector<SXOrderedDictionaryEntry>* m_pEntries{nullptr}; /**< Dense array of entries, in insertion order. */
+    std::vector<char>* m_pKeyCharacters{nullptr}; /**< Characters of the keys, one after the other, without NUL characters. */
+    std::vector<uint32_t>* m_pIndices{nullptr}; /**< Sparse table of indices into m_pEntries (power-of-two size). */
+    unsigned int m_count{0}; /**< Number of live entries. */
+    unsigned int m_usable{0}; /**< Number of entries that can still be appended before the table is rebuilt. */
+    size_t m_hash{0}; /**< Hash cached by makeImmutable(). */
+    
+    /**
+     * @brief Get the key of an entry.
+     * @return A view of the key buffer.
+     */
+    std::string_view keyForEntry(const SXOrderedDictionaryEntry& rEntry) const;
+    
+    /**
+     * @brief Find the index table slot of a key.
+     * @return The slot, or UINT32_MAX if the key is not in the dictionary.
+     */
+    uint32_t findSlot(std::string_view key, size_t hash) const;
+    
+    /**
+     * @brief Insert or replace an entry.
+     */
+    void setObjectForKey(SXObject* pObject, std::string_view key, size_t hash);
+    
+    /**
+     * @brief Append an entry and its key characters, without touching the index table.
+     * @return Whether the key fits in the key buffer.
+     */
+    bool appendEntry(SXObject* pObject, std::string_view key, size_t hash);
+    
+    /**
+     * @brief Remove the entry referenced by an index table slot.
+     */
+    void removeSlot(uint32_t slot);
+    
+    /**
+     * @brief Drop removed entries and their key characters, and rebuild the index table for a number of entries.
+     * @param capacity The number of live entries the rebuilt table must be able to hold.
+     */
+    void rebuild(unsigned int capacity);
+};
+
+} // namespace spalx
+
+#endif // SXOrderedDictionary_hpp
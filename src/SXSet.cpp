@@ -24,17 +24,39 @@
  */
 
 #include "SXSet.hpp"
+#include "SXBloomFilter.hpp"
+#include "SXString.hpp"
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
 
 namespace spalx {
 
+bool SXSetEntryEqual::operator()(const SXSetEntry& rStoredEntry, std::string_view key) const
+{
+    if (identity) {
+        return false;
+    }
+    const SXString* pString = dynamic_cast<const SXString*>(rStoredEntry.pObject);
+    return pString && pString->view() == key;
+}
+
 SXSet::SXSet()
+:SXSet(SXSetMembershipIdentity)
 {
-    m_pSet = new std::unordered_set<SXObject*>;
+}
+
+SXSet::SXSet(SXSetMembership membership)
+:m_membership(membership)
+{
+    m_pSet = new SXSetTable(SXSetEntryHash(), SXSetEntryEqual{membership == SXSetMembershipIdentity});
 }
 
 SXSet::~SXSet()
 {
+    m_immutable = false; // An immutable set still releases its objects.
     removeAllObjects();
+    disableBloomFilter();
     delete m_pSet;
     m_pSet = nullptr;
 }
@@ -42,14 +64,30 @@ SXSet::~SXSet()
 SXSet* SXSet::create()
 {
     SXSet* pSet = new SXSet();
+    
+    if (pSet) {
+        pSet->autorelease();
+    }
+    
+    return pSet;
+}
 
+SXSet* SXSet::createWithMembership(SXSetMembership membership)
+{
+    SXSet* pSet = new SXSet(membership);
+    
     if (pSet) {
         pSet->autorelease();
     }
-        
+    
     return pSet;
 }
 
+SXSetMembership SXSet::membership() const
+{
+    return m_membership;
+}
+
 unsigned int SXSet::count() const
 {
     return static_cast<unsigned int>(m_pSet->size());
@@ -57,41 +95,268 @@ unsigned int SXSet::count() const
 
 void SXSet::addObject(SXObject* pObject)
 {
-    if (!containsObject(pObject)) {
+    if (!checkMutable() || !pObject) {
+        return;
+    }
+    
+    SXSetEntry entry = entryForObject(pObject);
+    if (m_pSet->emplace(entry, entry.hash, entry).second) {
         pObject->retain();
-        m_pSet->insert(pObject);
+        bloomFilterDidAdd(entry.hash);
     }
 }
 
 bool SXSet::containsObject(SXObject* pObject) const
 {
-    return m_pSet->find(pObject) != m_pSet->end();
+    return member(pObject) != nullptr;
+}
+
+SXObject* SXSet::member(SXObject* pObject) const
+{
+    if (!pObject) {
+        return nullptr;
+    }
+    
+    SXSetEntry entry = entryForObject(pObject);
+    SXSetTable::Iterator it = findEntry(entry);
+    return (it == m_pSet->end()) ? nullptr : it->pObject;
+}
+
+void SXSet::reserve(unsigned int count)
+{
+    m_pSet->reserve(count);
 }
 
 void SXSet::removeObject(SXObject* pObject)
 {
-    if (containsObject(pObject)) {
-        pObject->release();
-        m_pSet->erase(pObject);
+    if (!checkMutable() || !pObject) {
+        return;
+    }
+    
+    SXSetEntry entry = entryForObject(pObject);
+    SXSetTable::Iterator it = findEntry(entry);
+    if (it != m_pSet->end()) {
+        SXObject* pMember = it->pObject;
+        m_pSet->erase(it);
+        pMember->release();
+        bloomFilterDidRemove(1);
     }
 }
 
 void SXSet::removeAllObjects()
 {
-    for (SXObject* pObj : *m_pSet) {
-        pObj->release();
+    if (!checkMutable()) {
+        return;
+    }
+    
+    for (const SXSetEntry& rEntry : *m_pSet) {
+        rEntry.pObject->release();
     }
     m_pSet->clear();
+    if (m_pBloomFilter) {
+        m_pBloomFilter->resetWithCapacity(SX_BLOOM_FILTER_MIN_CAPACITY);
+    }
+}
+
+void SXSet::unionSet(const SXSet* pOtherSet)
+{
+    if (!checkMutable() || !pOtherSet || pOtherSet == this) {
+        return;
+    }
+    
+    reserve(count() + pOtherSet->count());
+    for (const SXSetEntry& rEntry : *pOtherSet->m_pSet) {
+        addEntry(pOtherSet->m_membership == m_membership ? rEntry : entryForObject(rEntry.pObject));
+    }
+}
+
+void SXSet::intersectSet(const SXSet* pOtherSet)
+{
+    if (!checkMutable() || !pOtherSet || pOtherSet == this) {
+        return;
+    }
+    
+    size_t previousCount = m_pSet->size();
+    if (count() <= pOtherSet->count()) {
+        // Drop the members of this set the other set does not have.
+        std::vector<SXSetEntry> ownEntries = entries();
+        std::vector<SXObject*> found = pOtherSet->membersForEntries(ownEntries, m_membership);
+        for (size_t i = 0; i < ownEntries.size(); i++) {
+            if (!found[i]) {
+                m_pSet->erase(ownEntries[i]);
+                ownEntries[i].pObject->release();
+            }
+        }
+    } else {
+        // The other set is smaller: keep the members it matches, in a new table, and release the others.
+        std::vector<SXObject*> kept = membersForEntries(pOtherSet->entries(), pOtherSet->m_membership);
+        SXSetTable* pKept = new SXSetTable(SXSetEntryHash(), SXSetEntryEqual{m_membership == SXSetMembershipIdentity});
+        pKept->reserve(kept.size());
+        for (SXObject* pMember : kept) {
+            if (pMember) {
+                SXSetEntry entry = entryForObject(pMember);
+                pKept->emplace(entry, entry.hash, entry);
+            }
+        }
+        for (const SXSetEntry& rEntry : *m_pSet) {
+            if (pKept->find(rEntry, rEntry.hash) == pKept->end()) {
+                rEntry.pObject->release();
+            }
+        }
+        delete m_pSet;
+        m_pSet = pKept;
+    }
+    bloomFilterDidRemove(previousCount - m_pSet->size());
+}
+
+void SXSet::minusSet(const SXSet* pOtherSet)
+{
+    if (!checkMutable() || !pOtherSet) {
+        return;
+    }
+    
+    if (pOtherSet == this) {
+        removeAllObjects();
+        return;
+    }
+    
+    size_t previousCount = m_pSet->size();
+    if (count() <= pOtherSet->count()) {
+        std::vector<SXSetEntry> ownEntries = entries();
+        std::vector<SXObject*> found = pOtherSet->membersForEntries(ownEntries, m_membership);
+        for (size_t i = 0; i < ownEntries.size(); i++) {
+            if (found[i]) {
+                m_pSet->erase(ownEntries[i]);
+                ownEntries[i].pObject->release();
+            }
+        }
+    } else {
+        std::vector<SXObject*> found = membersForEntries(pOtherSet->entries(), pOtherSet->m_membership);
+        for (SXObject* pMember : found) {
+            // Several objects of the other set may match the same member, which is only removed once.
+            if (pMember && m_pSet->erase(entryForObject(pMember))) {
+                pMember->release();
+            }
+        }
+    }
+    bloomFilterDidRemove(previousCount - m_pSet->size());
+}
+
+SXSet* SXSet::setByUnionWithSet(const SXSet* pOtherSet) const
+{
+    SXSet* pSet = createWithMembership(m_membership);
+    pSet->reserve(count() + (pOtherSet ? pOtherSet->count() : 0));
+    for (const SXSetEntry& rEntry : *m_pSet) {
+        pSet->addEntry(rEntry);
+    }
+    pSet->unionSet(pOtherSet);
+    return pSet;
+}
+
+SXSet* SXSet::setByIntersectingWithSet(const SXSet* pOtherSet) const
+{
+    SXSet* pSet = createWithMembership(m_membership);
+    if (!pOtherSet) {
+        return pSet;
+    }
+    
+    if (count() <= pOtherSet->count()) {
+        std::vector<SXSetEntry> ownEntries = entries();
+        std::vector<SXObject*> found = pOtherSet->membersForEntries(ownEntries, m_membership);
+        pSet->reserve(static_cast<unsigned int>(std::count_if(found.begin(), found.end(), [](SXObject* pMember) { return pMember != nullptr; })));
+        for (size_t i = 0; i < ownEntries.size(); i++) {
+            if (found[i]) {
+                pSet->addEntry(ownEntries[i]);
+            }
+        }
+    } else {
+        std::vector<SXObject*> found = membersForEntries(pOtherSet->entries(), pOtherSet->m_membership);
+        pSet->reserve(pOtherSet->count());
+        for (SXObject* pMember : found) {
+            if (pMember) {
+                pSet->addObject(pMember);
+            }
+        }
+    }
+    return pSet;
+}
+
+SXSet* SXSet::setBySubtractingSet(const SXSet* pOtherSet) const
+{
+    SXSet* pSet = createWithMembership(m_membership);
+    std::vector<SXSetEntry> ownEntries = entries();
+    std::vector<SXObject*> found = pOtherSet ? pOtherSet->membersForEntries(ownEntries, m_membership) : std::vector<SXObject*>(ownEntries.size(), nullptr);
+    pSet->reserve(static_cast<unsigned int>(std::count(found.begin(), found.end(), nullptr)));
+    for (size_t i = 0; i < ownEntries.size(); i++) {
+        if (!found[i]) {
+            pSet->addEntry(ownEntries[i]);
+        }
+    }
+    return pSet;
+}
+
+bool SXSet::isSubsetOfSet(const SXSet* pOtherSet) const
+{
+    if (!pOtherSet || count() > pOtherSet->count()) {
+        return false;
+    }
+    
+    bool sameMembership = pOtherSet->m_membership == m_membership;
+    for (const SXSetEntry& rEntry : *m_pSet) {
+        SXSetEntry entry = sameMembership ? rEntry : pOtherSet->entryForObject(rEntry.pObject);
+        if (pOtherSet->findEntry(entry) == pOtherSet->m_pSet->end()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SXSet::intersectsSet(const SXSet* pOtherSet) const
+{
+    if (!pOtherSet) {
+        return false;
+    }
+    
+    const SXSet* pSmaller = (count() <= pOtherSet->count()) ? this : pOtherSet;
+    const SXSet* pLarger = (pSmaller == this) ? pOtherSet : this;
+    bool sameMembership = pSmaller->m_membership == pLarger->m_membership;
+    for (const SXSetEntry& rEntry : *pSmaller->m_pSet) {
+        SXSetEntry entry = sameMembership ? rEntry : pLarger->entryForObject(rEntry.pObject);
+        if (pLarger->findEntry(entry) != pLarger->m_pSet->end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SXSet::enableBloomFilter(double falsePositiveRate)
+{
+    disableBloomFilter();
+    m_pBloomFilter = new SXBloomFilter(SX_BLOOM_FILTER_MIN_CAPACITY, falsePositiveRate);
+    rebuildBloomFilter();
+}
+
+void SXSet::disableBloomFilter()
+{
+    if (m_pBloomFilter) {
+        m_pBloomFilter->release();
+        m_pBloomFilter = nullptr;
+    }
+}
+
+SXBloomFilter* SXSet::bloomFilter() const
+{
+    return m_pBloomFilter;
 }
 
 SXSetIterator SXSet::begin() const
 {
-    return m_pSet->begin();
+    return SXSetIterator(m_pSet->begin());
 }
 
 SXSetIterator SXSet::end() const
 {
-    return m_pSet->end();
+    return SXSetIterator(m_pSet->end());
 }
 
 SXObject* SXSet::anyObject() const
@@ -100,26 +365,196 @@ SXObject* SXSet::anyObject() const
         return nullptr;
     }
     
-    for (SXObject* pObj : *m_pSet) {
-        if (pObj) {
-            return pObj;
+    return m_pSet->begin()->pObject;
+}
+
+bool SXSet::isEqual(const SXObject* pObject) const
+{
+    if (pObject == this) {
+        return true;
+    }
+    
+    const SXSet* pOtherSet = dynamic_cast<const SXSet*>(pObject);
+    if (!pOtherSet || pOtherSet->count() != count()) {
+        return false;
+    }
+    
+    // Cached hashes of immutable sets reject most unequal sets without visiting the objects.
+    if (m_immutable && pOtherSet->m_immutable && m_hash != pOtherSet->m_hash) {
+        return false;
+    }
+    
+    // Members of equality sets are distinct values with cached value hashes, so each one is looked up in the other table.
+    if (m_membership == SXSetMembershipEquality && pOtherSet->m_membership == SXSetMembershipEquality) {
+        for (const SXSetEntry& rEntry : *m_pSet) {
+            if (pOtherSet->findEntry(rEntry) == pOtherSet->m_pSet->end()) {
+                return false;
+            }
         }
+        return true;
     }
+    
+    // Members may be stored by address, so the other set's objects are indexed by hash to match them by value.
+    std::unordered_multimap<size_t, SXObject*> otherObjects;
+    otherObjects.reserve(pOtherSet->count());
+    for (SXObject* pObj : *pOtherSet) {
+        otherObjects.emplace(pObj->hash(), pObj);
+    }
+    
+    for (SXObject* pObj : *this) {
+        auto range = otherObjects.equal_range(pObj->hash());
+        auto it = range.first;
+        while (it != range.second && it->second != pObj && !pObj->isEqual(it->second)) {
+            ++it;
+        }
+        if (it == range.second) {
+            return false;
+        }
+        otherObjects.erase(it); // Each object of the other set matches only once.
+    }
+    
+    return true;
+}
+
+size_t SXSet::hash() const
+{
+    if (m_immutable) {
+        return m_hash;
+    }
+    
+    // Objects are combined by addition, so the hash does not depend on the slot order. Equality sets already cache the value hashes.
+    bool identity = m_membership == SXSetMembershipIdentity;
+    size_t hash = m_pSet->size();
+    for (const SXSetEntry& rEntry : *m_pSet) {
+        hash += SXHashMix(identity ? rEntry.pObject->hash() : rEntry.hash);
+    }
+    return hash;
+}
 
-    return nullptr;
+void SXSet::makeImmutable()
+{
+    if (m_immutable) {
+        return;
+    }
+    
+    for (SXObject* pObj : *this) {
+        pObj->makeImmutable();
+    }
+    m_hash = hash();
+    m_immutable = true;
 }
 
 SXObject* SXSet::copy() const
 {
-    SXSet* pSet = new SXSet();
+    SXSet* pSet = new SXSet(m_membership);
+    pSet->reserve(count());
     
-    for (SXObject* pObj : *m_pSet) {
+    for (SXObject* pObj : *this) {
         SXObject* pTmpObject = pObj->copy();
         pSet->addObject(pTmpObject);
         pTmpObject->release();
     }
+    if (m_pBloomFilter) {
+        pSet->enableBloomFilter(m_pBloomFilter->falsePositiveRate());
+    }
     
     return pSet;
 }
 
+SXSetEntry SXSet::entryForObject(SXObject* pObject) const
+{
+    if (m_membership == SXSetMembershipIdentity) {
+        return SXSetEntry{pObject, static_cast<size_t>(reinterpret_cast<uintptr_t>(pObject))};
+    }
+    return SXSetEntry{pObject, pObject->hash()};
+}
+
+std::vector<SXSetEntry> SXSet::entries() const
+{
+    std::vector<SXSetEntry> entries;
+    entries.reserve(m_pSet->size());
+    for (const SXSetEntry& rEntry : *m_pSet) {
+        entries.push_back(rEntry);
+    }
+    return entries;
+}
+
+std::vector<SXObject*> SXSet::membersForEntries(const std::vector<SXSetEntry>& rEntries, SXSetMembership membership) const
+{
+    std::vector<SXObject*> members(rEntries.size(), nullptr);
+    bool sameMembership = membership == m_membership;
+    auto findRange = [this, &rEntries, &members, sameMembership](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            SXSetEntry entry = sameMembership ? rEntries[i] : entryForObject(rEntries[i].pObject);
+            SXSetTable::Iterator it = findEntry(entry);
+            if (it != m_pSet->end()) {
+                members[i] = it->pObject;
+            }
+        }
+    };
+    
+    size_t count = rEntries.size();
+    size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    if (count < SX_SET_PARALLEL_THRESHOLD || threadCount == 1) {
+        findRange(0, count);
+    } else {
+        size_t chunk = (count + threadCount - 1) / threadCount;
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount - 1);
+        for (size_t begin = chunk; begin < count; begin += chunk) {
+            threads.emplace_back(findRange, begin, std::min(begin + chunk, count));
+        }
+        findRange(0, std::min(chunk, count));
+        for (std::thread& rThread: threads) {
+            rThread.join();
+        }
+    }
+    return members;
+}
+
+void SXSet::addEntry(const SXSetEntry& rEntry)
+{
+    if (m_pSet->emplace(rEntry, rEntry.hash, rEntry).second) {
+        rEntry.pObject->retain();
+        bloomFilterDidAdd(rEntry.hash);
+    }
+}
+
+SXSetTable::Iterator SXSet::findEntry(const SXSetEntry& rEntry) const
+{
+    if (m_pBloomFilter && !m_pBloomFilter->mightContainHash(rEntry.hash)) {
+        return m_pSet->end();
+    }
+    return m_pSet->find(rEntry, rEntry.hash);
+}
+
+void SXSet::bloomFilterDidAdd(size_t hash)
+{
+    if (m_pBloomFilter) {
+        m_pBloomFilter->addHash(hash);
+        if (m_pBloomFilter->needsRebuild()) {
+            rebuildBloomFilter();
+        }
+    }
+}
+
+void SXSet::bloomFilterDidRemove(size_t count)
+{
+    if (m_pBloomFilter && count > 0) {
+        m_pBloomFilter->noteRemovedMembers(count);
+        if (m_pBloomFilter->needsRebuild()) {
+            rebuildBloomFilter();
+        }
+    }
+}
+
+void SXSet::rebuildBloomFilter()
+{
+    // Sized for twice the members, so a growing set rebuilds its filter a logarithmic number of times.
+    m_pBloomFilter->resetWithCapacity(std::max<size_t>(m_pSet->size() * 2, SX_BLOOM_FILTER_MIN_CAPACITY));
+    for (const SXSetEntry& rEntry : *m_pSet) {
+        m_pBloomFilter->addHash(rEntry.hash);
+    }
+}
+
 }
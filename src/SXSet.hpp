@@ -27,27 +27,116 @@
 #define SXSet_hpp
 
 #include "SXObject.hpp"
-#include <unordered_set>
+#include "SXHashTable.hpp"
+#include <cstdint>
+#include <string_view>
+#include <vector>
 
 namespace spalx {
 
-typedef std::unordered_set<SXObject*>::iterator SXSetIterator;
-// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
-// Type definition for an iterator over an unordered_set with SXObject* values.
+class SXBloomFilter;
+
+// Number of members from which set operations look up members on several threads.
+#define SX_SET_PARALLEL_THRESHOLD 65536
+
+/**
+ * @brief How a set decides whether two objects are the same member.
+ */
+enum SXSetMembership
+{
+    SXSetMembershipIdentity, /**< Members are distinct objects (pointer comparison). Equal strings are different members. */
+    SXSetMembershipEquality /**< Members are distinct values: objects are compared with hash() and isEqual(), so adding an object equal to a member does nothing. */
+};
+
+/**
+ * @brief Slot of a set's hash table: a member and its hash.
+ * @details The hash is computed once when the member is added (the address in identity sets, hash() in equality sets), so lookups and growth never call hash() on members again.
+ */
+struct SXSetEntry
+{
+    SXObject* pObject; /**< The member, retained by the set. */
+    size_t hash; /**< Cached hash of the member. */
+};
+
+/**
+ * @brief Hash functor of a set's table: entries carry their hash.
+ */
+struct SXSetEntryHash
+{
+    size_t operator()(const SXSetEntry& rEntry) const { return rEntry.hash; }
+};
+
+/**
+ * @brief Equality functor of a set's table.
+ * @details In equality sets, isEqual() is only called on members whose full hash matches.
+ */
+struct SXSetEntryEqual
+{
+    bool identity{true}; /**< Whether members are compared by address only. */
+    
+    bool operator()(const SXSetEntry& rStoredEntry, const SXSetEntry& rEntry) const
+    {
+        return rStoredEntry.pObject == rEntry.pObject || (!identity && rStoredEntry.hash == rEntry.hash && rStoredEntry.pObject->isEqual(rEntry.pObject));
+    }
+    
+    /**
+     * @brief Compare a member with characters, without creating a string: only SXString members of equality sets match.
+     */
+    bool operator()(const SXSetEntry& rStoredEntry, std::string_view key) const;
+};
+
+typedef SXHashTable<SXSetEntry, void, SXSetEntryHash, SXSetEntryEqual> SXSetTable;
+// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+// Type definition for the open-addressing table holding the members of a set.
+
+/**
+ * @class SXSetIterator
+ * @brief Forward iterator over the members of a set, in no particular order.
+ * @details Iterators are invalidated by any insertion or removal.
+ */
+class SXSetIterator
+{
+public:
+    explicit SXSetIterator(SXSetTable::Iterator it)
+    :m_it(it)
+    {
+    }
+    
+    SXObject* operator*() const { return m_it->pObject; }
+    
+    SXSetIterator& operator++()
+    {
+        ++m_it;
+        return *this;
+    }
+    
+    bool operator==(const SXSetIterator& rOther) const { return m_it == rOther.m_it; }
+    bool operator!=(const SXSetIterator& rOther) const { return m_it != rOther.m_it; }
+
+private:
+    SXSetTable::Iterator m_it; /**< Current slot. */
+};
 
 /**
  * @class SXSet
  * @brief Unordered collection of distinct objects.
+ * @details Members are kept in an open-addressing hash table together with their hash. By default members are distinct objects; a set created with SXSetMembershipEquality holds distinct values instead, which deduplicates equal strings, numbers or collections at hash table speed. Members of an equality set must not be changed while they are in the set (making them immutable guarantees it), since their hash is cached.
  */
 class SXSet : public SXObject
 {
 public:
     /**
      * @brief Default constructor.
-     * @details Initializes the unordered set.
+     * @details Initializes the hash table. Members are compared by identity.
      */
     SXSet();
     
+    /**
+     * @brief Constructor choosing how members are compared.
+     * @param membership Whether members are distinct objects or distinct values.
+     */
+    explicit SXSet(SXSetMembership membership);
+    
     /**
      * @brief Destructor.
      * @details Before set deletion, removes all objects from the set so their reference count gets decreased by 1.
@@ -60,6 +149,19 @@ public:
      */
     static SXSet* create();
     
+    /**
+     * @brief Create a new set choosing how members are compared.
+     * @param membership Whether members are distinct objects or distinct values.
+     * @return The new set object. nullptr if initialization fails.
+     */
+    static SXSet* createWithMembership(SXSetMembership membership);
+    
+    /**
+     * @brief Get how members are compared.
+     * @return The membership the set was created with.
+     */
+    SXSetMembership membership() const;
+    
     /**
      * @brief Get the number of elements in the set.
      * @return The number of elements.
@@ -68,19 +170,34 @@ public:
     
     /**
      * @brief Add the object to the set, if it is not already a member.
+     * @details In an equality set, an object equal to a member is not added.
      */
     void addObject(SXObject* pObject);
     
     /**
      * @brief Check whether the set has a specific object.
-     * @param pObject The object to find.
+     * @param pObject The object to find. In an equality set, any equal object.
      * @return Whether object exists in the set.
      */
     bool containsObject(SXObject* pObject) const;
     
+    /**
+     * @brief Get the member matching an object.
+     * @details In an equality set this returns the member equal to pObject, so it can be used to share one instance of each value.
+     * @param pObject The object to find.
+     * @return The member. nullptr if there is none.
+     */
+    SXObject* member(SXObject* pObject) const;
+    
+    /**
+     * @brief Pre-size the set so it can hold a number of members without growing.
+     * @param count The number of members to make room for.
+     */
+    void reserve(unsigned int count);
+    
     /**
      * @brief Remove object from the set.
-     * @details The reference count of the object is decreased by 1.
+     * @details The reference count of the member is decreased by 1. In an equality set, the member equal to pObject is removed.
      * @param pObject The object to remove.
      */
     void removeObject(SXObject* pObject);
@@ -90,16 +207,96 @@ public:
      * @details The reference count of each object is decreased by 1.
      */
     void removeAllObjects();
-
+    
+    /**
+     * @brief Add the members of another set to this set.
+     * @details The table is sized once for both sets. Members of this set are kept when the other set has equal ones.
+     * @param pOtherSet The set whose members are added.
+     */
+    void unionSet(const SXSet* pOtherSet);
+    
+    /**
+     * @brief Remove the members that are not in another set.
+     * @details Iterates the smaller of the two sets. From SX_SET_PARALLEL_THRESHOLD members the lookups run on several threads.
+     * @param pOtherSet The set to intersect with.
+     */
+    void intersectSet(const SXSet* pOtherSet);
+    
+    /**
+     * @brief Remove the members that are in another set.
+     * @details Iterates the smaller of the two sets. From SX_SET_PARALLEL_THRESHOLD members the lookups run on several threads.
+     * @param pOtherSet The set whose members are removed.
+     */
+    void minusSet(const SXSet* pOtherSet);
+    
+    /**
+     * @brief Create the union of this set and another set.
+     * @details The result has the membership of this set and is sized once for both sets.
+     * @param pOtherSet The other set.
+     * @return The new set, autoreleased.
+     */
+    SXSet* setByUnionWithSet(const SXSet* pOtherSet) const;
+    
+    /**
+     * @brief Create the intersection of this set and another set.
+     * @details The result has the membership of this set. Iterates the smaller of the two sets; from SX_SET_PARALLEL_THRESHOLD members the lookups run on several threads.
+     * @param pOtherSet The other set.
+     * @return The new set, autoreleased.
+     */
+    SXSet* setByIntersectingWithSet(const SXSet* pOtherSet) const;
+    
+    /**
+     * @brief Create the set of the members of this set that are not in another set.
+     * @details The result has the membership of this set. From SX_SET_PARALLEL_THRESHOLD members the lookups run on several threads.
+     * @param pOtherSet The set whose members are left out.
+     * @return The new set, autoreleased.
+     */
+    SXSet* setBySubtractingSet(const SXSet* pOtherSet) const;
+    
+    /**
+     * @brief Check whether every member of this set is in another set.
+     * @details Membership is decided by the other set. Returns false at once when this set is larger, and stops at the first member not found.
+     * @param pOtherSet The other set.
+     * @return Whether this set is a subset of the other set.
+     */
+    bool isSubsetOfSet(const SXSet* pOtherSet) const;
+    
+    /**
+     * @brief Check whether the two sets have at least one member in common.
+     * @details Iterates the smaller of the two sets and stops at the first common member.
+     * @param pOtherSet The other set.
+     * @return Whether the sets intersect.
+     */
+    bool intersectsSet(const SXSet* pOtherSet) const;
+    
+    /**
+     * @brief Attach a Bloom filter of the members, checked before the table by every lookup.
+     * @details Worth it for large sets queried mostly with objects that are not members: most of them are rejected by reading one cache line, before probing the table and comparing members. The filter is updated on each insertion, and rebuilt from the table when the set has grown past its capacity or after many removals. Replaces the current filter.
+     * @param falsePositiveRate The rate of lookups of non-members that still probe the table, such as 0.01.
+     */
+    void enableBloomFilter(double falsePositiveRate);
+    
+    /**
+     * @brief Detach and release the Bloom filter.
+     */
+    void disableBloomFilter();
+    
+    /**
+     * @brief Get the Bloom filter of the members.
+     * @details It holds the cached hashes of the members: hash() for equality sets, the addresses for identity sets.
+     * @return The filter, owned by the set. nullptr if enableBloomFilter() was not called.
+     */
+    SXBloomFilter* bloomFilter() const;
+    
     /**
      * @brief Get the first element of the set.
-     * @return An iterator over the first element of the unordered_set.
+     * @return An iterator over the first element of the set.
      */
     SXSetIterator begin() const;
     
     /**
-     * @brief Get the last element of the set.
-     * @return An iterator over the last element of the unordered_set. If iterator reaches here, means that there are no more objects in the set.
+     * @brief Get the end of the set.
+     * @return An iterator past the last element of the set. If iterator reaches here, means that there are no more objects in the set.
      */
     SXSetIterator end() const;
     
@@ -109,15 +306,82 @@ public:
      */
     SXObject* anyObject() const;
     
+    /**
+     * @brief Compare set with another set.
+     * @details Each object of one set must be equal (isEqual() is called) to a distinct object of the other set. When both sets are equality sets, each member is looked up in the other set's table. When both sets are immutable, sets with different hashes are rejected without comparing any object.
+     * @return Whether both sets have equal objects.
+     */
+    virtual bool isEqual(const SXObject* pObject) const override;
+    
+    /**
+     * @brief Get a hash value for the set.
+     * @details Combines the hash of each object independently of their order, so sets that are equal according to isEqual() have the same hash. The hash of an immutable set is computed once.
+     * @return The hash value.
+     */
+    virtual size_t hash() const override;
+    
+    /**
+     * @brief Make the set and all its objects immutable.
+     * @details Afterwards the methods that add or remove objects do nothing.
+     */
+    virtual void makeImmutable() override;
+    
     /**
      * @brief Perform a deep copy of the set.
-     * @details Create a new set by copying (copy() is called) each element inside the set.
+     * @details Create a new set with the same membership by copying (copy() is called) each element inside the set.
      * @return The new copied set.
      */
     virtual SXObject* copy() const override;
-    
+
 private:
-    std::unordered_set<SXObject*>* m_pSet; /**< Set container of all objects. */
+    SXSetMembership m_membership; /**< How members are compared. */
+    SXSetTable* m_pSet; /**< Hash table of all objects. */
+    size_t m_hash{0}; /**< Hash cached by makeImmutable(). */
+    SXBloomFilter* m_pBloomFilter{nullptr}; /**< Filter of the member hashes, retained. nullptr unless enableBloomFilter() was called. */
+    
+    /**
+     * @brief Build the table entry of an object.
+     */
+    SXSetEntry entryForObject(SXObject* pObject) const;
+    
+    /**
+     * @brief Find the slot of an entry, asking the Bloom filter first when there is one.
+     */
+    SXSetTable::Iterator findEntry(const SXSetEntry& rEntry) const;
+    
+    /**
+     * @brief Add the hash of a new member to the Bloom filter, if any.
+     */
+    void bloomFilterDidAdd(size_t hash);
+    
+    /**
+     * @brief Count removed members against the Bloom filter, if any, and rebuild it when too many are stale.
+     */
+    void bloomFilterDidRemove(size_t count);
+    
+    /**
+     * @brief Fill the Bloom filter again from the table.
+     */
+    void rebuildBloomFilter();
+    
+    /**
+     * @brief Copy the entries of the table, with their cached hashes.
+     */
+    std::vector<SXSetEntry> entries() const;
+    
+    /**
+     * @brief Find the members matching entries of another set.
+     * @details From SX_SET_PARALLEL_THRESHOLD entries the lookups run on several threads; the table is only read.
+     * @param rEntries The entries to look up.
+     * @param membership The membership of the set the entries come from, which tells whether their cached hash can be used here.
+     * @return For each entry, the matching member of this set, or nullptr.
+     */
+    std::vector<SXObject*> membersForEntries(const std::vector<SXSetEntry>& rEntries, SXSetMembership membership) const;
+    
+    /**
+     * @brief Add an entry of a set with the same membership, reusing its cached hash.
+     */
+    void addEntry(const SXSetEntry& rEntry);
 };
 
 } // namespace spalx
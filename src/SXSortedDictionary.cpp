@@ -0,0 +1,625 @@
+/**
+ * @file SXSortedDictionary.hpp
+ * @brief Implementation of the SXSortedDictionary class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SXSortedDictionary.hpp"
+#include "SXString.hpp"
+#include <vector>
+
+namespace spalx {
+
+/**
+ * @brief Pack the first 8 bytes of a key into an integer.
+ * @details The bytes are stored big-endian and missing bytes are zero, so if the prefix of a key is less than the prefix of another key, the first key is less than the second one.
+ */
+static inline uint64_t keyPrefix(std::string_view key)
+{
+    uint64_t prefix = 0;
+    size_t length = (key.length() < 8) ? key.length() : 8;
+    for (size_t i = 0; i < length; i++) {
+        prefix |= static_cast<uint64_t>(static_cast<unsigned char>(key[i])) << (56 - 8 * i);
+    }
+    return prefix;
+}
+
+/**
+ * @brief Compare a stored key with a key being searched for.
+ * @return A negative value, zero or a positive value if the stored key is less than, equal to or greater than the key.
+ */
+static inline int compareKeys(uint64_t storedPrefix, std::string_view storedKey, uint64_t prefix, std::string_view key)
+{
+    if (storedPrefix != prefix) {
+        return (storedPrefix < prefix) ? -1 : 1;
+    }
+    return storedKey.compare(key);
+}
+
+/**
+ * @brief Find the first entry of a leaf that is not less than (or greater than, if upper is true) a key.
+ */
+static inline unsigned int searchLeaf(const SXSortedDictionaryLeaf* pLeaf, std::string_view key, uint64_t prefix, bool upper)
+{
+    unsigned int low = 0;
+    unsigned int high = pLeaf->count;
+    while (low < high) {
+        unsigned int middle = (low + high) / 2;
+        int order = compareKeys(pLeaf->prefixes[middle], pLeaf->entries[middle].first, prefix, key);
+        if (order < 0 || (upper && order == 0)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Find the child of an inner node that covers a key.
+ * @details That is the number of separator keys less than or equal to the key.
+ */
+static inline unsigned int searchInnerNode(const SXSortedDictionaryInnerNode* pInner, std::string_view key, uint64_t prefix)
+{
+    unsigned int low = 0;
+    unsigned int high = pInner->count;
+    while (low < high) {
+        unsigned int middle = (low + high) / 2;
+        if (compareKeys(pInner->prefixes[middle], pInner->keys[middle], prefix, key) <= 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+SXSortedDictionary::SXSortedDictionary()
+{
+    SXSortedDictionaryLeaf* pLeaf = new SXSortedDictionaryLeaf();
+    m_pRoot = pLeaf;
+    m_pFirstLeaf = pLeaf;
+    m_pLastLeaf = pLeaf;
+}
+
+SXSortedDictionary::~SXSortedDictionary()
+{
+    destroyNode(m_pRoot);
+    m_pRoot = nullptr;
+    m_pFirstLeaf = nullptr;
+    m_pLastLeaf = nullptr;
+}
+
+SXSortedDictionary* SXSortedDictionary::create()
+{
+    SXSortedDictionary* pDictionary = new SXSortedDictionary();
+    
+    if (pDictionary) {
+        pDictionary->autorelease();
+    }
+    
+    return pDictionary;
+}
+
+SXSortedDictionary* SXSortedDictionary::createWithObjectsForKeys(SXArray* pObjects, SXArray* pKeys)
+{
+    if (pObjects->count() != pKeys->count()) {
+        return nullptr;
+    }
+    
+    std::vector<std::pair<std::string_view, SXObject*>> entries;
+    entries.reserve(pKeys->count());
+    bool sorted = true;
+    for (unsigned int i = 0; i < pKeys->count(); i++) {
+        SXString* pKey = dynamic_cast<SXString*>((*pKeys)[i]);
+        if (!pKey) {
+            continue;
+        }
+        std::string_view key = pKey->view();
+        if (!entries.empty() && entries.back().first >= key) {
+            sorted = false;
+        }
+        entries.emplace_back(key, (*pObjects)[i]);
+    }
+    
+    SXSortedDictionary* pDictionary = create();
+    if (sorted) {
+        pDictionary->bulkLoad(entries.data(), static_cast<unsigned int>(entries.size()));
+    } else {
+        for (const auto& [key, value]: entries) {
+            pDictionary->setObject(value, key);
+        }
+    }
+    return pDictionary;
+}
+
+SXObject* SXSortedDictionary::operator[](std::string_view key) const
+{
+    return objectForKey(key);
+}
+
+unsigned int SXSortedDictionary::count() const
+{
+    return m_count;
+}
+
+SXArray* SXSortedDictionary::allKeys() const
+{
+    SXArray* pKeys = SXArray::createWithCapacity(m_count);
+    for (const auto& [key, value]: *this) {
+        SXString* pKey = SXString::newWithCharacters(key.data(), key.length());
+        pKeys->addObject(pKey);
+        pKey->release();
+    }
+    return pKeys;
+}
+
+SXSortedDictionaryLeaf* SXSortedDictionary::findLeaf(std::string_view key, uint64_t prefix) const
+{
+    SXSortedDictionaryNode* pNode = m_pRoot;
+    while (!pNode->isLeaf) {
+        SXSortedDictionaryInnerNode* pInner = static_cast<SXSortedDictionaryInnerNode*>(pNode);
+        pNode = pInner->children[searchInnerNode(pInner, key, prefix)];
+    }
+    return static_cast<SXSortedDictionaryLeaf*>(pNode);
+}
+
+SXObject* SXSortedDictionary::objectForKey(std::string_view key) const
+{
+    uint64_t prefix = keyPrefix(key);
+    SXSortedDictionaryLeaf* pLeaf = findLeaf(key, prefix);
+    unsigned int index = searchLeaf(pLeaf, key, prefix, false);
+    if (index < pLeaf->count && pLeaf->prefixes[index] == prefix && pLeaf->entries[index].first == key) {
+        return pLeaf->entries[index].second;
+    }
+    return nullptr;
+}
+
+void SXSortedDictionary::setObject(SXObject* pObject, std::string_view key)
+{
+    if (!checkMutable()) {
+        return;
+    }
+    
+    pObject->retain();
+    
+    uint64_t prefix = keyPrefix(key);
+    
+    // Full nodes are split on the way down, so a split never has to travel back up the tree.
+    if (m_pRoot->count == SX_SORTED_DICTIONARY_NODE_CAPACITY) {
+        SXSortedDictionaryInnerNode* pRoot = new SXSortedDictionaryInnerNode();
+        pRoot->isLeaf = false;
+        pRoot->children[0] = m_pRoot;
+        m_pRoot = pRoot;
+        splitChild(pRoot, 0);
+    }
+    
+    SXSortedDictionaryNode* pNode = m_pRoot;
+    while (!pNode->isLeaf) {
+        SXSortedDictionaryInnerNode* pInner = static_cast<SXSortedDictionaryInnerNode*>(pNode);
+        unsigned int index = searchInnerNode(pInner, key, prefix);
+        if (pInner->children[index]->count == SX_SORTED_DICTIONARY_NODE_CAPACITY) {
+            splitChild(pInner, index);
+            if (compareKeys(pInner->prefixes[index], pInner->keys[index], prefix, key) <= 0) {
+                index++;
+            }
+        }
+        pNode = pInner->children[index];
+    }
+    
+    SXSortedDictionaryLeaf* pLeaf = static_cast<SXSortedDictionaryLeaf*>(pNode);
+    unsigned int index = searchLeaf(pLeaf, key, prefix, false);
+    if (index < pLeaf->count && pLeaf->prefixes[index] == prefix && pLeaf->entries[index].first == key) {
+        // Replace previous object for this key.
+        pLeaf->entries[index].second->release();
+        pLeaf->entries[index].second = pObject;
+        return;
+    }
+    
+    for (unsigned int i = pLeaf->count; i > index; i--) {
+        pLeaf->entries[i] = std::move(pLeaf->entries[i - 1]);
+        pLeaf->prefixes[i] = pLeaf->prefixes[i - 1];
+    }
+    pLeaf->entries[index].first.assign(key);
+    pLeaf->entries[index].second = pObject;
+    pLeaf->prefixes[index] = prefix;
+    pLeaf->count++;
+    m_count++;
+}
+
+void SXSortedDictionary::splitChild(SXSortedDictionaryInnerNode* pParent, unsigned int index)
+{
+    const unsigned int half = SX_SORTED_DICTIONARY_NODE_CAPACITY / 2;
+    SXSortedDictionaryNode* pChild = pParent->children[index];
+    SXSortedDictionaryNode* pRight;
+    std::string separator;
+    uint64_t separatorPrefix;
+    
+    if (pChild->isLeaf) {
+        // Leaves keep all their entries: the separator is a copy of the first key of the new leaf.
+        SXSortedDictionaryLeaf* pLeaf = static_cast<SXSortedDictionaryLeaf*>(pChild);
+        SXSortedDictionaryLeaf* pNewLeaf = new SXSortedDictionaryLeaf();
+        for (unsigned int i = half; i < SX_SORTED_DICTIONARY_NODE_CAPACITY; i++) {
+            pNewLeaf->entries[i - half] = std::move(pLeaf->entries[i]);
+            pNewLeaf->prefixes[i - half] = pLeaf->prefixes[i];
+        }
+        pNewLeaf->count = SX_SORTED_DICTIONARY_NODE_CAPACITY - half;
+        pLeaf->count = half;
+        
+        pNewLeaf->pPrevious = pLeaf;
+        pNewLeaf->pNext = pLeaf->pNext;
+        if (pLeaf->pNext) {
+            pLeaf->pNext->pPrevious = pNewLeaf;
+        } else {
+            m_pLastLeaf = pNewLeaf;
+        }
+        pLeaf->pNext = pNewLeaf;
+        
+        separator = pNewLeaf->entries[0].first;
+        separatorPrefix = pNewLeaf->prefixes[0];
+        pRight = pNewLeaf;
+    } else {
+        // Inner nodes move their middle key up to the parent.
+        SXSortedDictionaryInnerNode* pInner = static_cast<SXSortedDictionaryInnerNode*>(pChild);
+        SXSortedDictionaryInnerNode* pNewInner = new SXSortedDictionaryInnerNode();
+        pNewInner->isLeaf = false;
+        separator = std::move(pInner->keys[half]);
+        separatorPrefix = pInner->prefixes[half];
+        for (unsigned int i = half + 1; i < SX_SORTED_DICTIONARY_NODE_CAPACITY; i++) {
+            pNewInner->keys[i - half - 1] = std::move(pInner->keys[i]);
+            pNewInner->prefixes[i - half - 1] = pInner->prefixes[i];
+        }
+        for (unsigned int i = half + 1; i <= SX_SORTED_DICTIONARY_NODE_CAPACITY; i++) {
+            pNewInner->children[i - half - 1] = pInner->children[i];
+        }
+        pNewInner->count = SX_SORTED_DICTIONARY_NODE_CAPACITY - half - 1;
+        pInner->count = half;
+        pRight = pNewInner;
+    }
+    
+    for (unsigned int i = pParent->count; i > index; i--) {
+        pParent->keys[i] = std::move(pParent->keys[i - 1]);
+        pParent->prefixes[i] = pParent->prefixes[i - 1];
+        pParent->children[i + 1] = pParent->children[i];
+    }
+    pParent->keys[index] = std::move(separator);
+    pParent->prefixes[index] = separatorPrefix;
+    pParent->children[index + 1] = pRight;
+    pParent->count++;
+}
+
+void SXSortedDictionary::removeObjectForKey(std::string_view key)
+{
+    if (!checkMutable()) {
+        return;
+    }
+    
+    if (!removeFromNode(m_pRoot, key, keyPrefix(key)) || m_pRoot->isLeaf) {
+        // Collapse inner roots left with a single child.
+        while (!m_pRoot->isLeaf && m_pRoot->count == 0) {
+            SXSortedDictionaryInnerNode* pRoot = static_cast<SXSortedDictionaryInnerNode*>(m_pRoot);
+            m_pRoot = pRoot->children[0];
+            delete pRoot;
+        }
+        return;
+    }
+    
+    // The last entry was removed from an inner root: every leaf is gone.
+    delete static_cast<SXSortedDictionaryInnerNode*>(m_pRoot);
+    SXSortedDictionaryLeaf* pLeaf = new SXSortedDictionaryLeaf();
+    m_pRoot = pLeaf;
+    m_pFirstLeaf = pLeaf;
+    m_pLastLeaf = pLeaf;
+}
+
+bool SXSortedDictionary::removeFromNode(SXSortedDictionaryNode* pNode, std::string_view key, uint64_t prefix)
+{
+    if (pNode->isLeaf) {
+        SXSortedDictionaryLeaf* pLeaf = static_cast<SXSortedDictionaryLeaf*>(pNode);
+        unsigned int index = searchLeaf(pLeaf, key, prefix, false);
+        if (index == pLeaf->count || pLeaf->prefixes[index] != prefix || pLeaf->entries[index].first != key) {
+            return false;
+        }
+        
+        SXObject* pObject = pLeaf->entries[index].second;
+        for (unsigned int i = index + 1; i < pLeaf->count; i++) {
+            pLeaf->entries[i - 1] = std::move(pLeaf->entries[i]);
+            pLeaf->prefixes[i - 1] = pLeaf->prefixes[i];
+        }
+        pLeaf->count--;
+        std::string().swap(pLeaf->entries[pLeaf->count].first);
+        pLeaf->entries[pLeaf->count].second = nullptr;
+        m_count--;
+        
+        pObject->release();
+        return pLeaf->count == 0;
+    }
+    
+    SXSortedDictionaryInnerNode* pInner = static_cast<SXSortedDictionaryInnerNode*>(pNode);
+    unsigned int index = searchInnerNode(pInner, key, prefix);
+    SXSortedDictionaryNode* pChild = pInner->children[index];
+    if (!removeFromNode(pChild, key, prefix)) {
+        return false;
+    }
+    
+    // The child is empty: free it. Nodes are never merged, so the remaining children may stay underfull.
+    if (pChild->isLeaf) {
+        SXSortedDictionaryLeaf* pLeaf = static_cast<SXSortedDictionaryLeaf*>(pChild);
+        if (pLeaf->pPrevious) {
+            pLeaf->pPrevious->pNext = pLeaf->pNext;
+        } else {
+            m_pFirstLeaf = pLeaf->pNext;
+        }
+        if (pLeaf->pNext) {
+            pLeaf->pNext->pPrevious = pLeaf->pPrevious;
+        } else {
+            m_pLastLeaf = pLeaf->pPrevious;
+        }
+        delete pLeaf;
+    } else {
+        delete static_cast<SXSortedDictionaryInnerNode*>(pChild);
+    }
+    
+    if (pInner->count == 0) {
+        // That was the only child.
+        return true;
+    }
+    
+    // Drop the child and one of the separator keys around it.
+    unsigned int keyIndex = (index > 0) ? index - 1 : 0;
+    for (unsigned int i = keyIndex + 1; i < pInner->count; i++) {
+        pInner->keys[i - 1] = std::move(pInner->keys[i]);
+        pInner->prefixes[i - 1] = pInner->prefixes[i];
+    }
+    for (unsigned int i = index + 1; i <= pInner->count; i++) {
+        pInner->children[i - 1] = pInner->children[i];
+    }
+    pInner->count--;
+    std::string().swap(pInner->keys[pInner->count]);
+    return false;
+}
+
+void SXSortedDictionary::removeAllObjects()
+{
+    if (!checkMutable()) {
+        return;
+    }
+    
+    destroyNode(m_pRoot);
+    SXSortedDictionaryLeaf* pLeaf = new SXSortedDictionaryLeaf();
+    m_pRoot = pLeaf;
+    m_pFirstLeaf = pLeaf;
+    m_pLastLeaf = pLeaf;
+    m_count = 0;
+}
+
+void SXSortedDictionary::destroyNode(SXSortedDictionaryNode* pNode)
+{
+    if (pNode->isLeaf) {
+        SXSortedDictionaryLeaf* pLeaf = static_cast<SXSortedDictionaryLeaf*>(pNode);
+        for (unsigned int i = 0; i < pLeaf->count; i++) {
+            pLeaf->entries[i].second->release();
+        }
+        delete pLeaf;
+    } else {
+        SXSortedDictionaryInnerNode* pInner = static_cast<SXSortedDictionaryInnerNode*>(pNode);
+        for (unsigned int i = 0; i <= pInner->count; i++) {
+            destroyNode(pInner->children[i]);
+        }
+        delete pInner;
+    }
+}
+
+SXSortedDictionaryIterator SXSortedDictionary::begin() const
+{
+    return m_count ? SXSortedDictionaryIterator(m_pFirstLeaf, 0) : end();
+}
+
+SXSortedDictionaryIterator SXSortedDictionary::end() const
+{
+    return SXSortedDictionaryIterator(nullptr, 0);
+}
+
+SXSortedDictionaryIterator SXSortedDictionary::last() const
+{
+    return m_count ? SXSortedDictionaryIterator(m_pLastLeaf, m_pLastLeaf->count - 1) : end();
+}
+
+SXSortedDictionaryIterator SXSortedDictionary::lowerBound(std::string_view key) const
+{
+    uint64_t prefix = keyPrefix(key);
+    SXSortedDictionaryLeaf* pLeaf = findLeaf(key, prefix);
+    unsigned int index = searchLeaf(pLeaf, key, prefix, false);
+    if (index < pLeaf->count) {
+        return SXSortedDictionaryIterator(pLeaf, index);
+    }
+    // Every key of the next leaf is greater.
+    return SXSortedDictionaryIterator(pLeaf->pNext, 0);
+}
+
+SXSortedDictionaryIterator SXSortedDictionary::upperBound(std::string_view key) const
+{
+    uint64_t prefix = keyPrefix(key);
+    SXSortedDictionaryLeaf* pLeaf = findLeaf(key, prefix);
+    unsigned int index = searchLeaf(pLeaf, key, prefix, true);
+    if (index < pLeaf->count) {
+        return SXSortedDictionaryIterator(pLeaf, index);
+    }
+    return SXSortedDictionaryIterator(pLeaf->pNext, 0);
+}
+
+SXArray* SXSortedDictionary::objectsInRange(std::string_view lowKey, std::string_view highKey) const
+{
+    SXArray* pObjects = SXArray::create();
+    enumerateKeysAndObjectsInRange(lowKey, highKey, [pObjects](std::string_view, SXObject* pObject, bool&) {
+        pObjects->addObject(pObject);
+    });
+    return pObjects;
+}
+
+void SXSortedDictionary::bulkLoad(const std::pair<std::string_view, SXObject*>* pEntries, unsigned int count)
+{
+    if (count == 0) {
+        return;
+    }
+    
+    delete static_cast<SXSortedDictionaryLeaf*>(m_pRoot);
+    
+    // Each node of a level is paired with the smallest key below it, which becomes its separator in the parent.
+    std::vector<std::pair<SXSortedDictionaryNode*, std::string_view>> level;
+    
+    // Fill the fewest possible leaves, spreading the entries evenly.
+    unsigned int leafCount = (count + SX_SORTED_DICTIONARY_NODE_CAPACITY - 1) / SX_SORTED_DICTIONARY_NODE_CAPACITY;
+    level.reserve(leafCount);
+    SXSortedDictionaryLeaf* pPrevious = nullptr;
+    unsigned int position = 0;
+    for (unsigned int i = 0; i < leafCount; i++) {
+        unsigned int size = (count - position) / (leafCount - i);
+        SXSortedDictionaryLeaf* pLeaf = new SXSortedDictionaryLeaf();
+        for (unsigned int j = 0; j < size; j++) {
+            const auto& [key, value] = pEntries[position + j];
+            value->retain();
+            pLeaf->entries[j].first.assign(key);
+            pLeaf->entries[j].second = value;
+            pLeaf->prefixes[j] = keyPrefix(key);
+        }
+        pLeaf->count = size;
+        
+        pLeaf->pPrevious = pPrevious;
+        if (pPrevious) {
+            pPrevious->pNext = pLeaf;
+        } else {
+            m_pFirstLeaf = pLeaf;
+        }
+        pPrevious = pLeaf;
+        
+        level.emplace_back(pLeaf, pEntries[position].first);
+        position += size;
+    }
+    m_pLastLeaf = pPrevious;
+    
+    // Build the inner levels bottom-up.
+    while (level.size() > 1) {
+        size_t nodeCount = (level.size() + SX_SORTED_DICTIONARY_NODE_CAPACITY) / (SX_SORTED_DICTIONARY_NODE_CAPACITY + 1);
+        std::vector<std::pair<SXSortedDictionaryNode*, std::string_view>> parents;
+        parents.reserve(nodeCount);
+        size_t childPosition = 0;
+        for (size_t i = 0; i < nodeCount; i++) {
+            size_t size = (level.size() - childPosition) / (nodeCount - i);
+            SXSortedDictionaryInnerNode* pInner = new SXSortedDictionaryInnerNode();
+            pInner->isLeaf = false;
+            pInner->children[0] = level[childPosition].first;
+            for (size_t j = 1; j < size; j++) {
+                pInner->children[j] = level[childPosition + j].first;
+                pInner->keys[j - 1].assign(level[childPosition + j].second);
+                pInner->prefixes[j - 1] = keyPrefix(level[childPosition + j].second);
+            }
+            pInner->count = static_cast<unsigned int>(size - 1);
+            
+            parents.emplace_back(pInner, level[childPosition].second);
+            childPosition += size;
+        }
+        level.swap(parents);
+    }
+    
+    m_pRoot = level[0].first;
+    m_count = count;
+}
+
+bool SXSortedDictionary::isEqual(const SXObject* pObject) const
+{
+    if (pObject == this) {
+        return true;
+    }
+    
+    const SXSortedDictionary* pOtherDictionary = dynamic_cast<const SXSortedDictionary*>(pObject);
+    if (!pOtherDictionary || pOtherDictionary->m_count != m_count) {
+        return false;
+    }
+    
+    // Cached hashes of immutable dictionaries reject most unequal dictionaries without visiting the entries.
+    if (m_immutable && pOtherDictionary->m_immutable && m_hash != pOtherDictionary->m_hash) {
+        return false;
+    }
+    
+    // Both trees hold their keys in ascending order, so they are walked side by side.
+    SXSortedDictionaryIterator otherIt = pOtherDictionary->begin();
+    for (const auto& [key, value]: *this) {
+        if (key != otherIt->first) {
+            return false;
+        }
+        if (otherIt->second != value && !value->isEqual(otherIt->second)) {
+            return false;
+        }
+        ++otherIt;
+    }
+    
+    return true;
+}
+
+size_t SXSortedDictionary::hash() const
+{
+    if (m_immutable) {
+        return m_hash;
+    }
+    
+    size_t hash = m_count;
+    for (const auto& [key, value]: *this) {
+        hash = hash * 31 + SXHashMix(SXHashString(key) * 31 + value->hash());
+    }
+    return hash;
+}
+
+void SXSortedDictionary::makeImmutable()
+{
+    if (m_immutable) {
+        return;
+    }
+    
+    for (const auto& [key, value]: *this) {
+        value->makeImmutable();
+    }
+    m_hash = hash();
+    m_immutable = true;
+}
+
+SXObject* SXSortedDictionary::copy() const
+{
+    std::vector<std::pair<std::string_view, SXObject*>> entries;
+    entries.reserve(m_count);
+    for (const auto& [key, value]: *this) {
+        SXObject* pTmpObject = value->copy();
+        if (pTmpObject) {
+            entries.emplace_back(key, pTmpObject);
+        }
+    }
+    
+    // Keys are already sorted, so the copy is bulk loaded.
+    SXSortedDictionary* pDictionary = new SXSortedDictionary();
+    pDictionary->bulkLoad(entries.data(), static_cast<unsigned int>(entries.size()));
+    for (const auto& [key, value]: entries) {
+        value->release();
+    }
+    return pDictionary;
+}
+
+}
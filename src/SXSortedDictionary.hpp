@@ -0,0 +1,371 @@
+/**
+ * @file SXSortedDictionary.hpp
+ * @brief Declaration of the SXSortedDictionary class.
+ *
+ * @copyright (c) 2024 Artavazd Barseghyan
+ * @details This software is released under the MIT License.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SXSortedDictionary_hpp
+#define SXSortedDictionary_hpp
+
+#include "SXObject.hpp"
+#include "SXArray.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace spalx {
+
+// Maximum number of keys in a tree node.
+#define SX_SORTED_DICTIONARY_NODE_CAPACITY 32
+
+typedef std::pair<std::string, SXObject*> SXSortedDictionaryEntry;
+// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+// Type definition for a key-value pair stored in a leaf of the tree.
+
+/**
+ * @brief Common part of the tree nodes.
+ * @details Besides the keys, each node keeps the first 8 bytes of every key packed into an integer (big-endian, zero padded). Searching a node compares these integers, which sit next to each other in memory, and only reads the key strings when two prefixes are equal.
+ */
+struct SXSortedDictionaryNode
+{
+    bool isLeaf{true}; /**< Whether the node is a leaf. */
+    unsigned int count{0}; /**< Number of keys in the node. */
+    uint64_t prefixes[SX_SORTED_DICTIONARY_NODE_CAPACITY]; /**< Packed prefix of each key. */
+};
+
+/**
+ * @brief Leaf node: holds the entries, linked to its neighbours for range scans.
+ */
+struct SXSortedDictionaryLeaf : SXSortedDictionaryNode
+{
+    SXSortedDictionaryEntry entries[SX_SORTED_DICTIONARY_NODE_CAPACITY]; /**< Entries in ascending key order. */
+    SXSortedDictionaryLeaf* pPrevious{nullptr}; /**< Leaf with the preceding keys. */
+    SXSortedDictionaryLeaf* pNext{nullptr}; /**< Leaf with the following keys. */
+};
+
+/**
+ * @brief Inner node: keys[i] is a lower bound of all keys under children[i + 1].
+ */
+struct SXSortedDictionaryInnerNode : SXSortedDictionaryNode
+{
+    std::string keys[SX_SORTED_DICTIONARY_NODE_CAPACITY]; /**< Separator keys. */
+    SXSortedDictionaryNode* children[SX_SORTED_DICTIONARY_NODE_CAPACITY + 1]; /**< Child nodes (count + 1 of them). */
+};
+
+/**
+ * @class SXSortedDictionaryIterator
+ * @brief Cursor over the entries of a sorted dictionary, in ascending key order.
+ * @details Iterators are invalidated by any insertion or removal. Keys must not be modified through an iterator.
+ */
+class SXSortedDictionaryIterator
+{
+public:
+    SXSortedDictionaryIterator(SXSortedDictionaryLeaf* pLeaf, unsigned int index)
+    :m_pLeaf(pLeaf), m_index(index)
+    {
+    }
+    
+    SXSortedDictionaryEntry& operator*() const { return m_pLeaf->entries[m_index]; }
+    SXSortedDictionaryEntry* operator->() const { return &m_pLeaf->entries[m_index]; }
+    
+    /**
+     * @brief Move to the entry with the next greater key.
+     */
+    SXSortedDictionaryIterator& operator++()
+    {
+        if (++m_index >= m_pLeaf->count) {
+            m_pLeaf = m_pLeaf->pNext;
+            m_index = 0;
+        }
+        return *this;
+    }
+    
+    /**
+     * @brief Move to the entry with the next smaller key.
+     * @details Moving back from the first entry gives end().
+     */
+    SXSortedDictionaryIterator& operator--()
+    {
+        if (m_index > 0) {
+            m_index--;
+        } else {
+            m_pLeaf = m_pLeaf->pPrevious;
+            m_index = m_pLeaf ? m_pLeaf->count - 1 : 0;
+        }
+        return *this;
+    }
+    
+    bool operator==(const SXSortedDictionaryIterator& rOther) const { return m_pLeaf == rOther.m_pLeaf && m_index == rOther.m_index; }
+    bool operator!=(const SXSortedDictionaryIterator& rOther) const { return !(*this == rOther); }
+
+private:
+    SXSortedDictionaryLeaf* m_pLeaf; /**< Current leaf. nullptr for the end iterator. */
+    unsigned int m_index; /**< Index of the current entry in the leaf. */
+};
+
+/**
+ * @class SXSortedDictionary
+ * @brief Dynamic collection of key-value pairs kept sorted by key.
+ * @details Backed by a B+tree: entries live in linked leaves, so ordered iteration and range scans walk leaves sequentially. Keys are compared byte by byte. Lookups, insertions and removals are O(log n). Removing entries never merges nodes, it only frees nodes that become empty.
+ */
+class SXSortedDictionary : public SXObject
+{
+public:
+    /**
+     * @brief Default constructor.
+     * @details Initializes an empty tree.
+     */
+    SXSortedDictionary();
+    
+    /**
+     * @brief Destructor.
+     * @details Before deletion, removes all objects from the dictionary so their reference count gets decreased by 1.
+     */
+    ~SXSortedDictionary();
+    
+    /**
+     * @brief Create a new sorted dictionary.
+     * @return The new dictionary object. nullptr if initialization fails.
+     */
+    static SXSortedDictionary* create();
+    
+    /**
+     * @brief Create a new sorted dictionary from parallel arrays of objects and keys.
+     * @details When the keys are already in strictly ascending order the tree is bulk loaded bottom-up with full nodes, which is much faster than inserting each entry. Otherwise the entries are inserted one by one.
+     * @param pObjects The objects.
+     * @param pKeys The keys (SXString objects), at the same indices as their objects.
+     * @return The new dictionary object. nullptr if the arrays have different sizes.
+     */
+    static SXSortedDictionary* createWithObjectsForKeys(SXArray* pObjects, SXArray* pKeys);
+    
+    /**
+     * @brief Overloaded subscript operator to access elements by key.
+     * @details Provides read-only access to the element for the specified key.
+     * @param key The key of the element to access.
+     * @return The object for the specified key. nullptr if the key is not in the dictionary.
+     */
+    SXObject* operator[](std::string_view key) const;
+    
+    /**
+     * @brief Get the number of elements in the dictionary.
+     * @return The number of elements.
+     */
+    unsigned int count() const;
+    
+    /**
+     * @brief Get all the keys from the dictionary.
+     * @details The array is allocated once with the right capacity. The strings are owned by the array only, they are not added to the autorelease pool.
+     * @return Array of strings (the keys), in ascending order.
+     */
+    SXArray* allKeys() const;
+    
+    /**
+     * @brief Get the object with the specific key.
+     * @param key The key of the object to retrieve.
+     * @return The object. nullptr if the key is not in the dictionary.
+     */
+    SXObject* objectForKey(std::string_view key) const;
+    
+    /**
+     * @brief Add object to the dictionary.
+     * @details The reference count of the object is increased by 1.
+     * @param pObject The object to add.
+     * @param key The key to assign to the object.
+     */
+    void setObject(SXObject* pObject, std::string_view key);
+    
+    /**
+     * @brief Remove the object with the specific key.
+     * @details The reference count of the object is decreased by 1.
+     * @param key The key of the object to remove.
+     */
+    void removeObjectForKey(std::string_view key);
+    
+    /**
+     * @brief Remove all objects.
+     * @details The reference count of each object is decreased by 1.
+     */
+    void removeAllObjects();
+    
+    /**
+     * @brief Get the entry with the smallest key.
+     * @return An iterator over the first entry.
+     */
+    SXSortedDictionaryIterator begin() const;
+    
+    /**
+     * @brief Get the end of the entries.
+     * @return An iterator past the entry with the greatest key.
+     */
+    SXSortedDictionaryIterator end() const;
+    
+    /**
+     * @brief Get the entry with the greatest key.
+     * @return An iterator over the last entry. end() if the dictionary is empty.
+     */
+    SXSortedDictionaryIterator last() const;
+    
+    /**
+     * @brief Get the first entry whose key is not less than a key.
+     * @param key The key to search for.
+     * @return The iterator. end() if all keys are less than key.
+     */
+    SXSortedDictionaryIterator lowerBound(std::string_view key) const;
+    
+    /**
+     * @brief Get the first entry whose key is greater than a key.
+     * @param key The key to search for.
+     * @return The iterator. end() if no key is greater than key.
+     */
+    SXSortedDictionaryIterator upperBound(std::string_view key) const;
+    
+    /**
+     * @brief Call a function for each entry of the dictionary, in ascending key order.
+     * @details Nothing is allocated or copied: the key is a view of the stored characters, valid until the entry is removed.
+     * @param function Callable invoked as function(std::string_view key, SXObject* pObject, bool& rStop). Set rStop to true to stop the enumeration.
+     */
+    template <typename Function>
+    void enumerateKeysAndObjects(Function&& function) const
+    {
+        bool stop = false;
+        for (SXSortedDictionaryIterator it = begin(); it != end(); ++it) {
+            function(std::string_view(it->first), it->second, stop);
+            if (stop) {
+                return;
+            }
+        }
+    }
+    
+    /**
+     * @brief Call a function for each entry whose key is in a range, in ascending key order.
+     * @param lowKey The smallest key of the range (inclusive).
+     * @param highKey The greatest key of the range (inclusive).
+     * @param function Callable invoked as function(std::string_view key, SXObject* pObject, bool& rStop). Set rStop to true to stop the enumeration.
+     */
+    template <typename Function>
+    void enumerateKeysAndObjectsInRange(std::string_view lowKey, std::string_view highKey, Function&& function) const
+    {
+        bool stop = false;
+        for (SXSortedDictionaryIterator it = lowerBound(lowKey); it != end() && std::string_view(it->first) <= highKey; ++it) {
+            function(std::string_view(it->first), it->second, stop);
+            if (stop) {
+                return;
+            }
+        }
+    }
+    
+    /**
+     * @brief Call a function for each entry whose key starts with a prefix, in ascending key order.
+     * @param prefix The key prefix.
+     * @param function Callable invoked as function(std::string_view key, SXObject* pObject, bool& rStop). Set rStop to true to stop the enumeration.
+     */
+    template <typename Function>
+    void enumerateKeysAndObjectsWithPrefix(std::string_view prefix, Function&& function) const
+    {
+        bool stop = false;
+        for (SXSortedDictionaryIterator it = lowerBound(prefix); it != end() && std::string_view(it->first).substr(0, prefix.length()) == prefix; ++it) {
+            function(std::string_view(it->first), it->second, stop);
+            if (stop) {
+                return;
+            }
+        }
+    }
+    
+    /**
+     * @brief Get the objects whose keys are in a range.
+     * @param lowKey The smallest key of the range (inclusive).
+     * @param highKey The greatest key of the range (inclusive).
+     * @return Array of the objects, in ascending key order.
+     */
+    SXArray* objectsInRange(std::string_view lowKey, std::string_view highKey) const;
+    
+    /**
+     * @brief Compare dictionary with another sorted dictionary.
+     * @details Both dictionaries must have the same keys, and the objects for each key must be equal (isEqual() is called). When both dictionaries are immutable, dictionaries with different hashes are rejected without comparing any entry.
+     * @return Whether both dictionaries have equal entries.
+     */
+    virtual bool isEqual(const SXObject* pObject) const override;
+    
+    /**
+     * @brief Get a hash value for the dictionary.
+     * @details Combines the hash of each key and object in key order, so dictionaries that are equal according to isEqual() have the same hash. The hash of an immutable dictionary is computed once.
+     * @return The hash value.
+     */
+    virtual size_t hash() const override;
+    
+    /**
+     * @brief Make the dictionary and all its objects immutable.
+     * @details Afterwards the methods that add or remove objects do nothing.
+     */
+    virtual void makeImmutable() override;
+    
+    /**
+     * @brief Perform a deep copy of the dictionary.
+     * @details Create a new dictionary by copying (copy() is called) each element inside the dictionary. The copy is bulk loaded.
+     * @return The new copied dictionary.
+     */
+    virtual SXObject* copy() const override;
+
+private:
+    SXSortedDictionaryNode* m_pRoot{nullptr}; /**< Root node. A leaf while the tree has a single level. */
+    SXSortedDictionaryLeaf* m_pFirstLeaf{nullptr}; /**< Leaf with the smallest keys. */
+    SXSortedDictionaryLeaf* m_pLastLeaf{nullptr}; /**< Leaf with the greatest keys. */
+    unsigned int m_count{0}; /**< Number of entries. */
+    size_t m_hash{0}; /**< Hash cached by makeImmutable(). */
+    
+    /**
+     * @brief Find the leaf that holds or would hold a key.
+     */
+    SXSortedDictionaryLeaf* findLeaf(std::string_view key, uint64_t prefix) const;
+    
+    /**
+     * @brief Split a full child of an inner node that is not full.
+     * @param pParent The parent node.
+     * @param index The index of the child in the parent.
+     */
+    void splitChild(SXSortedDictionaryInnerNode* pParent, unsigned int index);
+    
+    /**
+     * @brief Remove a key from a subtree.
+     * @details Children that become empty are freed. The node itself is not freed.
+     * @return true if the node became empty.
+     */
+    bool removeFromNode(SXSortedDictionaryNode* pNode, std::string_view key, uint64_t prefix);
+    
+    /**
+     * @brief Build the tree from entries sorted by strictly ascending key.
+     * @details The tree must be empty. Each object is retained.
+     * @param pEntries The entries.
+     * @param count The number of entries.
+     */
+    void bulkLoad(const std::pair<std::string_view, SXObject*>* pEntries, unsigned int count);
+    
+    /**
+     * @brief Free a subtree, releasing its objects.
+     */
+    static void destroyNode(SXSortedDictionaryNode* pNode);
+};
+
+} // namespace spalx
+
+#endif // SXSortedDictionary_hpp
@@ -24,34 +24,604 @@
  */
 
 #include "SXString.hpp"
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SX_STRING_USE_SSE2 1
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SX_STRING_USE_AVX2 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace spalx {
 
+/**
+ * @brief Get the index of the lowest set bit of a non-zero mask.
+ */
+static inline unsigned int trailingZeros(uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned int>(index);
+#else
+    return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+}
+
+/**
+ * @brief Find a short needle by comparing its first and last characters with many positions at once, then the candidates in full.
+ * @details Needles of at least 2 characters. Candidates are rare unless the first and last characters are frequent together, and each costs at most SX_STRING_SIMD_SEARCH_MAX_LENGTH comparisons.
+ * @return The index of the first occurrence, or SX_STRING_NOT_FOUND.
+ */
+static size_t findShortString(const char* pHaystack, size_t haystackLength, const char* pNeedle, size_t needleLength)
+{
+    size_t last = needleLength - 1;
+    size_t position = 0;
+#ifdef SX_STRING_USE_AVX2
+    const __m256i first32 = _mm256_set1_epi8(pNeedle[0]);
+    const __m256i last32 = _mm256_set1_epi8(pNeedle[last]);
+    while (position + last + 32 <= haystackLength) {
+        __m256i firstChunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pHaystack + position));
+        __m256i lastChunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pHaystack + position + last));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(firstChunk, first32), _mm256_cmpeq_epi8(lastChunk, last32))));
+        while (mask) {
+            size_t candidate = position + trailingZeros(mask);
+            if (memcmp(pHaystack + candidate + 1, pNeedle + 1, needleLength - 2) == 0) {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+        position += 32;
+    }
+#endif
+#ifdef SX_STRING_USE_SSE2
+    const __m128i first16 = _mm_set1_epi8(pNeedle[0]);
+    const __m128i last16 = _mm_set1_epi8(pNeedle[last]);
+    while (position + last + 16 <= haystackLength) {
+        __m128i firstChunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pHaystack + position));
+        __m128i lastChunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pHaystack + position + last));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(firstChunk, first16), _mm_cmpeq_epi8(lastChunk, last16))));
+        while (mask) {
+            size_t candidate = position + trailingZeros(mask);
+            if (memcmp(pHaystack + candidate + 1, pNeedle + 1, needleLength - 2) == 0) {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+        position += 16;
+    }
+#endif
+    for (; position + last < haystackLength; position++) {
+        if (pHaystack[position] == pNeedle[0] && pHaystack[position + last] == pNeedle[last] && memcmp(pHaystack + position + 1, pNeedle + 1, needleLength - 2) == 0) {
+            return position;
+        }
+    }
+    return SX_STRING_NOT_FOUND;
+}
+
+/**
+ * @brief Split a needle into a left and a right part for the Two-Way algorithm.
+ * @details The split is the later of the maximal suffixes for the two opposite orders of the characters, which is a critical factorization (Crochemore and Perrin).
+ * @param pPeriod Set to the period of the right part.
+ * @return The length of the left part.
+ */
+static size_t criticalFactorization(const unsigned char* pNeedle, size_t needleLength, size_t* pPeriod)
+{
+    // Maximal suffix for the usual order. maxSuffix starts at -1: maxSuffix + k wraps around to k - 1.
+    size_t maxSuffix = SIZE_MAX;
+    size_t j = 0;
+    size_t k = 1;
+    size_t period = 1;
+    while (j + k < needleLength) {
+        unsigned char a = pNeedle[j + k];
+        unsigned char b = pNeedle[maxSuffix + k];
+        if (a < b) {
+            j += k;
+            k = 1;
+            period = j - maxSuffix;
+        } else if (a == b) {
+            if (k != period) {
+                k++;
+            } else {
+                j += period;
+                k = 1;
+            }
+        } else {
+            maxSuffix = j++;
+            k = period = 1;
+        }
+    }
+    *pPeriod = period;
+    
+    // Maximal suffix for the reverse order.
+    size_t maxSuffixReverse = SIZE_MAX;
+    j = 0;
+    k = 1;
+    period = 1;
+    while (j + k < needleLength) {
+        unsigned char a = pNeedle[j + k];
+        unsigned char b = pNeedle[maxSuffixReverse + k];
+        if (b < a) {
+            j += k;
+            k = 1;
+            period = j - maxSuffixReverse;
+        } else if (a == b) {
+            if (k != period) {
+                k++;
+            } else {
+                j += period;
+                k = 1;
+            }
+        } else {
+            maxSuffixReverse = j++;
+            k = period = 1;
+        }
+    }
+    
+    if (maxSuffixReverse + 1 < maxSuffix + 1) {
+        return maxSuffix + 1;
+    }
+    *pPeriod = period;
+    return maxSuffixReverse + 1;
+}
+
+/**
+ * @brief Find a needle with the Two-Way algorithm.
+ * @details Compares the right part of the needle left to right, then the left part right to left, and shifts by the period of the needle on a match of the right part, or past the mismatch otherwise. Runs in O(haystack + needle) time and O(1) space.
+ * @return The index of the first occurrence, or SX_STRING_NOT_FOUND.
+ */
+static size_t findStringTwoWay(const unsigned char* pHaystack, size_t haystackLength, const unsigned char* pNeedle, size_t needleLength)
+{
+    size_t period;
+    size_t suffix = criticalFactorization(pNeedle, needleLength, &period);
+    size_t j = 0;
+    
+    if (memcmp(pNeedle, pNeedle + period, suffix) == 0) {
+        // The needle is periodic: after a shift by the period, the characters already matched in the right part are known to match again.
+        size_t memory = 0;
+        while (j <= haystackLength - needleLength) {
+            size_t i = std::max(suffix, memory);
+            while (i < needleLength && pNeedle[i] == pHaystack[i + j]) {
+                i++;
+            }
+            if (i < needleLength) {
+                j += i - suffix + 1;
+                memory = 0;
+                continue;
+            }
+            i = suffix - 1;
+            while (memory < i + 1 && pNeedle[i] == pHaystack[i + j]) {
+                i--;
+            }
+            if (i + 1 < memory + 1) {
+                return j;
+            }
+            j += period;
+            memory = needleLength - period;
+        }
+    } else {
+        // Without a period, a match of the right part followed by a mismatch allows a shift by more than the longer part.
+        period = std::max(suffix, needleLength - suffix) + 1;
+        while (j <= haystackLength - needleLength) {
+            size_t i = suffix;
+            while (i < needleLength && pNeedle[i] == pHaystack[i + j]) {
+                i++;
+            }
+            if (i < needleLength) {
+                j += i - suffix + 1;
+                continue;
+            }
+            i = suffix - 1;
+            while (i != SIZE_MAX && pNeedle[i] == pHaystack[i + j]) {
+                i--;
+            }
+            if (i == SIZE_MAX) {
+                return j;
+            }
+            j += period;
+        }
+    }
+    return SX_STRING_NOT_FOUND;
+}
+
+/**
+ * @brief Find the first occurrence of a needle in a haystack, with the algorithm suited to the needle length.
+ * @return The index of the occurrence, or SX_STRING_NOT_FOUND. An empty needle is found at 0.
+ */
+static size_t findString(const char* pHaystack, size_t haystackLength, const char* pNeedle, size_t needleLength)
+{
+    if (needleLength > haystackLength) {
+        return SX_STRING_NOT_FOUND;
+    }
+    if (needleLength == 0) {
+        return 0;
+    }
+    if (needleLength == 1) {
+        const void* pFound = memchr(pHaystack, pNeedle[0], haystackLength);
+        return pFound ? static_cast<size_t>(static_cast<const char*>(pFound) - pHaystack) : SX_STRING_NOT_FOUND;
+    }
+    if (needleLength <= SX_STRING_SIMD_SEARCH_MAX_LENGTH) {
+        return findShortString(pHaystack, haystackLength, pNeedle, needleLength);
+    }
+    return findStringTwoWay(reinterpret_cast<const unsigned char*>(pHaystack), haystackLength, reinterpret_cast<const unsigned char*>(pNeedle), needleLength);
+}
+
+/**
+ * @brief Set of bytes searched for by componentsSeparatedByCharactersInString().
+ */
+struct SXCharacterSet
+{
+    bool table[256]; /**< Whether each byte belongs to the set. */
+    unsigned char characters[SX_STRING_SIMD_CHARACTER_SET_MAX_LENGTH]; /**< The distinct bytes of the set, if there are few enough to compare with SIMD. */
+    size_t count; /**< Number of distinct bytes, or 0 if the set is searched with the table only. */
+    
+    /**
+     * @brief Constructor.
+     * @param string The bytes of the set, in any order, possibly repeated.
+     */
+    explicit SXCharacterSet(std::string_view string)
+    :table(), count(0)
+    {
+        size_t distinctCount = 0;
+        for (char c : string) {
+            unsigned char byte = static_cast<unsigned char>(c);
+            if (!table[byte]) {
+                table[byte] = true;
+                if (distinctCount < SX_STRING_SIMD_CHARACTER_SET_MAX_LENGTH) {
+                    characters[distinctCount] = byte;
+                }
+                distinctCount++;
+            }
+        }
+        count = (distinctCount <= SX_STRING_SIMD_CHARACTER_SET_MAX_LENGTH) ? distinctCount : 0;
+    }
+    
+    /**
+     * @brief Find the first byte of the set.
+     * @return A pointer to the byte, or pEnd if there is none.
+     */
+    const char* find(const char* p, const char* pEnd) const
+    {
+#ifdef SX_STRING_USE_AVX2
+        if (count > 0) {
+            __m256i set[SX_STRING_SIMD_CHARACTER_SET_MAX_LENGTH];
+            for (size_t i = 0; i < count; i++) {
+                set[i] = _mm256_set1_epi8(static_cast<char>(characters[i]));
+            }
+            while (pEnd - p >= 32) {
+                __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                __m256i matches = _mm256_cmpeq_epi8(chunk, set[0]);
+                for (size_t i = 1; i < count; i++) {
+                    matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(chunk, set[i]));
+                }
+                uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(matches));
+                if (mask) {
+                    return p + trailingZeros(mask);
+                }
+                p += 32;
+            }
+        }
+#endif
+#ifdef SX_STRING_USE_SSE2
+        if (count > 0) {
+            __m128i set[SX_STRING_SIMD_CHARACTER_SET_MAX_LENGTH];
+            for (size_t i = 0; i < count; i++) {
+                set[i] = _mm_set1_epi8(static_cast<char>(characters[i]));
+            }
+            while (pEnd - p >= 16) {
+                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                __m128i matches = _mm_cmpeq_epi8(chunk, set[0]);
+                for (size_t i = 1; i < count; i++) {
+                    matches = _mm_or_si128(matches, _mm_cmpeq_epi8(chunk, set[i]));
+                }
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(matches));
+                if (mask) {
+                    return p + trailingZeros(mask);
+                }
+                p += 16;
+            }
+        }
+#endif
+        while (p < pEnd && !table[static_cast<unsigned char>(*p)]) {
+            p++;
+        }
+        return p;
+    }
+};
+
+// Flags of SXStringSideTable::parseState. Each parse outcome takes 2 bits.
+static const uint8_t kParseStateInteger = 0x01; /**< parsedInteger is set. */
+static const uint8_t kParseStateIntegerNegative = 0x02; /**< The integer has a '-' sign. */
+static const unsigned int kParseStateIntegerErrorShift = 2; /**< Position of the outcome of the integer parse. */
+static const uint8_t kParseStateReal = 0x10; /**< parsedReal is set. */
+static const unsigned int kParseStateRealErrorShift = 5; /**< Position of the outcome of the double parse. */
+static const uint8_t kParseStateErrorMask = 0x03; /**< Mask of an outcome, once shifted. */
+
+/**
+ * @brief Check whether a character is whitespace in the C locale.
+ */
+static inline bool isWhitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+/**
+ * @brief Get the characters without the whitespace around them.
+ */
+static std::string_view trimWhitespace(std::string_view string)
+{
+    size_t begin = 0;
+    size_t end = string.length();
+    while (begin < end && isWhitespace(string[begin])) {
+        begin++;
+    }
+    while (end > begin && isWhitespace(string[end - 1])) {
+        end--;
+    }
+    return string.substr(begin, end - begin);
+}
+
+/**
+ * @brief Get the outcome of a parse that stopped at p: only whitespace may follow the number.
+ */
+static inline SXStringParseError errorAfterNumber(const char* p, const char* pEnd)
+{
+    while (p < pEnd && isWhitespace(*p)) {
+        p++;
+    }
+    return (p == pEnd) ? SXStringParseErrorNone : SXStringParseErrorTrailingCharacters;
+}
+
+/**
+ * @brief Parse a decimal integer with an optional sign, after optional whitespace.
+ * @details The magnitude is parsed as an unsigned long long, so that every integer type can be checked against it.
+ */
+static SXStringParseError parseInteger(const char* p, const char* pEnd, bool& rNegative, unsigned long long& rMagnitude)
+{
+    rNegative = false;
+    rMagnitude = 0;
+    while (p < pEnd && isWhitespace(*p)) {
+        p++;
+    }
+    if (p < pEnd && (*p == '-' || *p == '+')) {
+        rNegative = *p == '-';
+        p++;
+    }
+    
+    std::from_chars_result result = std::from_chars(p, pEnd, rMagnitude);
+    if (result.ec == std::errc::invalid_argument) {
+        return SXStringParseErrorInvalid;
+    }
+    if (result.ec == std::errc::result_out_of_range) {
+        rMagnitude = 0;
+        return SXStringParseErrorOutOfRange;
+    }
+    return errorAfterNumber(result.ptr, pEnd);
+}
+
+/**
+ * @brief Parse a floating point number, after optional whitespace.
+ */
+static SXStringParseError parseReal(const char* p, const char* pEnd, double& rValue)
+{
+    rValue = 0.0;
+    while (p < pEnd && isWhitespace(*p)) {
+        p++;
+    }
+    if (p < pEnd && *p == '+' && (pEnd - p < 2 || p[1] != '-')) {
+        p++; // std::from_chars only accepts a '-' sign.
+    }
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    std::from_chars_result result = std::from_chars(p, pEnd, rValue);
+    if (result.ec == std::errc::invalid_argument) {
+        return SXStringParseErrorInvalid;
+    }
+    if (result.ec == std::errc::result_out_of_range) {
+        rValue = 0.0;
+        return SXStringParseErrorOutOfRange;
+    }
+    return errorAfterNumber(result.ptr, pEnd);
+#else
+    // Standard libraries without std::from_chars for floating point: strtod() on a NUL-terminated copy, which depends on the C locale.
+    std::string string(p, pEnd);
+    char* pParsedEnd;
+    errno = 0;
+    rValue = strtod(string.c_str(), &pParsedEnd);
+    if (pParsedEnd == string.c_str() || isWhitespace(string[0])) {
+        rValue = 0.0;
+        return SXStringParseErrorInvalid;
+    }
+    if (errno == ERANGE) {
+        rValue = 0.0;
+        return SXStringParseErrorOutOfRange;
+    }
+    return errorAfterNumber(p + (pParsedEnd - string.c_str()), pEnd);
+#endif
+}
+
+/**
+ * @brief Convert a parsed integer to an integer type, checking its range.
+ */
+template <typename T>
+static SXStringParseError convertNumber(SXStringParseError error, bool negative, unsigned long long magnitude, T& rValue)
+{
+    rValue = 0;
+    if (error != SXStringParseErrorNone && error != SXStringParseErrorTrailingCharacters) {
+        return error;
+    }
+    
+    if (!negative) {
+        if (magnitude > static_cast<unsigned long long>(std::numeric_limits<T>::max())) {
+            return SXStringParseErrorOutOfRange;
+        }
+        rValue = static_cast<T>(magnitude);
+    } else if (magnitude != 0) {
+        // The magnitude of the smallest value is max() + 1, which only fits in the unsigned type.
+        if (!std::is_signed<T>::value || magnitude - 1 > static_cast<unsigned long long>(std::numeric_limits<T>::max())) {
+            return SXStringParseErrorOutOfRange;
+        }
+        rValue = static_cast<T>(-static_cast<T>(magnitude - 1) - 1);
+    }
+    return error;
+}
+
+/**
+ * @brief Convert a parsed double to a floating point type, checking its range.
+ */
+template <typename T>
+static SXStringParseError convertNumber(SXStringParseError error, double value, T& rValue)
+{
+    rValue = 0;
+    if (error != SXStringParseErrorNone && error != SXStringParseErrorTrailingCharacters) {
+        return error;
+    }
+    
+    if (value > std::numeric_limits<T>::max() || value < -std::numeric_limits<T>::max()) {
+        if (value != std::numeric_limits<double>::infinity() && value != -std::numeric_limits<double>::infinity()) {
+            return SXStringParseErrorOutOfRange;
+        }
+    }
+    rValue = static_cast<T>(value);
+    return error;
+}
+
+/**
+ * @brief Parse characters as a number of any type.
+ */
+template <typename T>
+static SXStringParseError parseNumber(const char* p, const char* pEnd, T& rValue)
+{
+    if constexpr (std::is_integral<T>::value) {
+        bool negative;
+        unsigned long long magnitude;
+        SXStringParseError error = parseInteger(p, pEnd, negative, magnitude);
+        return convertNumber(error, negative, magnitude, rValue);
+    } else {
+        double value;
+        SXStringParseError error = parseReal(p, pEnd, value);
+        return convertNumber(error, value, rValue);
+    }
+}
+
+/**
+ * @brief Check whether the characters of a file mapping of this length are followed by a NUL character.
+ * @details The end of the last page of a mapping is filled with zeros, but a file filling its last page is directly followed by unmapped memory.
+ */
+static bool isMappingTerminated(size_t length)
+{
+#if !defined(_WIN32)
+    static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return length % pageSize != 0;
+#else
+    (void)length;
+    return false; // No mappings.
+#endif
+}
+
+/**
+ * @brief Fields only views, ropes and strings with a flat copy of their characters use, so that other strings do not carry them.
+ */
+struct SXStringSideTable
+{
+    std::atomic<char*> pFlatChars{nullptr}; /**< NUL-terminated copy of the characters of a rope, of a view that does not end its parent, or of a mapping that ends on a page boundary, built on first use. */
+    SXString* pParent{nullptr}; /**< Immutable string a view shares the characters of, retained. */
+    SXString* pLeft{nullptr}; /**< First half of a rope, immutable and retained. */
+    SXString* pRight{nullptr}; /**< Second half of a rope, immutable and retained. */
+    std::atomic<uint64_t> parsedInteger{0}; /**< Magnitude of the integer value, once parsed. */
+    std::atomic<uint64_t> parsedReal{0}; /**< Bits of the double value, once parsed. */
+    std::atomic<uint8_t> parseState{0}; /**< Which values are parsed, the sign of the integer and the outcome of each parse. 0 until a value is parsed. */
+};
+
 SXString::SXString()
-:m_string("")
 {
+    m_inlineChars[0] = '\0';
 }
 
 SXString::SXString(const char* pString)
-:m_string(pString)
+:SXString(pString, strlen(pString))
+{
+}
+
+SXString::SXString(const char* pString, size_t length)
 {
+    m_inlineChars[0] = '\0';
+    assign(pString, length);
 }
 
 SXString::SXString(const SXString& rString)
-:m_string(rString.getCString())
+:SXObject(rString), m_atom(rString.m_atom)
 {
+    m_inlineChars[0] = '\0';
+    assign(rString.characters(), rString.m_length);
+    m_hash.store(rString.m_hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+SXString::SXString(SXString&& rString)
+:SXObject(rString)
+{
+    m_inlineChars[0] = '\0';
+    takeCharacters(rString);
+}
+
+SXString::SXString(std::unique_ptr<char[]> pBuffer, size_t length)
+:m_storage(SXStringStorageHeap), m_length(length)
+{
+    m_buffer.pChars = pBuffer.release();
+    m_buffer.capacity = length;
+    m_buffer.pChars[length] = '\0';
+}
+
+SXString::SXString(const char* pChars, size_t length, char* pTrailingChars)
+:m_storage(SXStringStorageTrailing), m_length(length)
+{
+    m_buffer.pChars = pTrailingChars;
+    m_buffer.capacity = length;
+    if (pChars) {
+        memcpy(m_buffer.pChars, pChars, length);
+    }
+    m_buffer.pChars[length] = '\0';
 }
 
 SXString::~SXString()
 {
-    m_string.clear();
+    releaseStorage();
 }
 
 SXString* SXString::create(const char* pString)
 {
-    SXString* pNewString = new SXString(pString);
+    return createWithCharacters(pString, strlen(pString));
+}
+
+SXString* SXString::createWithCharacters(const char* pChars, size_t length)
+{
+    SXString* pNewString = newWithCharacters(pChars, length);
     
     if (pNewString) {
         pNewString->autorelease();
@@ -60,102 +630,926 @@ SXString* SXString::create(const char* pString)
     return pNewString;
 }
 
+SXString* SXString::newWithCharacters(const char* pChars, size_t length)
+{
+    SXString* pString = newWithLength(length);
+    if (length > 0) {
+        memcpy(pString->storedCharacters(), pChars, length); // pChars may be null when empty, e.g. a default std::string_view.
+    }
+    return pString;
+}
+
+void* SXString::operator new(size_t size)
+{
+    return ::operator new(size);
+}
+
+void SXString::operator delete(void* pMemory)
+{
+    ::operator delete(pMemory);
+}
+
 SXString* SXString::createWithContentsOfFile(const char* pFilePath)
 {
-    std::ifstream file(pFilePath);
-    if (!file.is_open()) {
+    SXString* pString = nullptr;
+
+#if !defined(_WIN32)
+    int fileDescriptor = open(pFilePath, O_RDONLY);
+    if (fileDescriptor < 0) {
+        return nullptr;
+    }
+    
+    struct stat status;
+    if (fstat(fileDescriptor, &status) != 0) {
+        close(fileDescriptor);
         return nullptr;
     }
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    file.close();
+    size_t length = static_cast<size_t>(status.st_size);
+    
+    // Only files that should not change are mapped: a mapping sees later writes, and faults once the file is truncated below it.
+    bool mayChange = !S_ISREG(status.st_mode) || (status.st_mode & (S_IWUSR | S_IWGRP | S_IWOTH)) != 0;
+    if (length >= SX_STRING_MAP_MIN_LENGTH && !mayChange) {
+        void* pMapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+        if (pMapping != MAP_FAILED) {
+            pString = new SXString();
+            pString->setBuffer(SXStringStorageMapped, static_cast<char*>(pMapping), 0);
+            pString->m_length = length;
+        }
+    }
     
-    return create(buffer.str().c_str());
+    if (!pString) {
+        // The file is small, may change or cannot be mapped: one read into the string's own allocation. Files reporting a size of 0, such as those of /proc, are read to their end.
+        if (length > 0) {
+            pString = newWithLength(length);
+            size_t readLength = 0;
+            while (readLength < length) {
+                ssize_t result = read(fileDescriptor, pString->storedCharacters() + readLength, length - readLength);
+                if (result < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (result <= 0) {
+                    break;
+                }
+                readLength += static_cast<size_t>(result);
+            }
+            if (readLength < length) {
+                pString->release();
+                pString = nullptr;
+            }
+        } else {
+            std::string contents;
+            char buffer[4096];
+            ssize_t result;
+            while ((result = read(fileDescriptor, buffer, sizeof(buffer))) != 0) {
+                if (result < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    close(fileDescriptor);
+                    return nullptr;
+                }
+                contents.append(buffer, static_cast<size_t>(result));
+            }
+            pString = newWithCharacters(contents.data(), contents.length());
+        }
+    }
+    close(fileDescriptor);
+#else
+    std::FILE* pFile = std::fopen(pFilePath, "rb");
+    if (!pFile) {
+        return nullptr;
+    }
+    if (std::fseek(pFile, 0, SEEK_END) == 0) {
+        long length = std::ftell(pFile);
+        if (length >= 0 && std::fseek(pFile, 0, SEEK_SET) == 0) {
+            pString = newWithLength(static_cast<size_t>(length));
+            if (std::fread(pString->storedCharacters(), 1, pString->m_length, pFile) != pString->m_length) {
+                pString->release();
+                pString = nullptr;
+            }
+        }
+    }
+    std::fclose(pFile);
+#endif
+
+    if (pString) {
+        pString->autorelease();
+    }
+    
+    return pString;
 }
 
 SXString& SXString::operator=(const SXString& rOtherString)
 {
-    setValue(rOtherString.getCString());
+    if (&rOtherString == this || !checkMutable()) {
+        return *this;
+    }
+    
+    setValue(rOtherString.characters(), rOtherString.m_length);
+    m_hash.store(rOtherString.m_hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    m_atom = rOtherString.m_atom;
+    return *this;
+}
+
+SXString& SXString::operator=(SXString&& rOtherString)
+{
+    if (&rOtherString == this || !checkMutable()) {
+        return *this;
+    }
+    
+    releaseStorage();
+    takeCharacters(rOtherString);
     return *this;
 }
 
 char SXString::operator[](unsigned int index) const
 {
-    if (index < length()) {
-        return m_string[index];
+    if (index < m_length) {
+        return characters()[index];
     }
     return '\0'; // Out-of-bounds access.
 }
 
 void SXString::setValue(const char* pString)
 {
-    m_string = pString;
+    setValue(pString, strlen(pString));
 }
 
-int SXString::intValue() const
+void SXString::setValue(const char* pChars, size_t length)
 {
-    if (m_string.empty()) {
-        return 0;
+    if (!checkMutable()) {
+        return;
     }
-    return std::stoi(m_string);
+    
+    assign(pChars, length);
+    resetCachedValues();
+    m_atom = SXAtom();
 }
 
-unsigned long SXString::ulValue() const
+int SXString::intValue(SXStringParseError* pError) const
 {
-    if (m_string.empty()) {
-        return 0;
+    int value;
+    SXStringParseError error = numberValue(value);
+    if (pError) {
+        *pError = error;
     }
-    return std::stoul(m_string);
+    return value;
 }
 
-float SXString::floatValue() const
+long long SXString::longLongValue(SXStringParseError* pError) const
 {
-    if (m_string.empty()) {
-        return 0.0f;
+    long long value;
+    SXStringParseError error = numberValue(value);
+    if (pError) {
+        *pError = error;
     }
-    return std::stof(m_string);
+    return value;
 }
 
-double SXString::doubleValue() const
+unsigned long SXString::ulValue(SXStringParseError* pError) const
 {
-    if (m_string.empty()) {
-        return 0.0;
+    unsigned long value;
+    SXStringParseError error = numberValue(value);
+    if (pError) {
+        *pError = error;
     }
-    return std::stod(m_string);
+    return value;
 }
 
-bool SXString::boolValue() const
+float SXString::floatValue(SXStringParseError* pError) const
 {
-    if (m_string.empty()) {
-        return false;
+    float value;
+    SXStringParseError error = numberValue(value);
+    if (pError) {
+        *pError = error;
     }
-    return (intValue() != 0) || (m_string == "true");
+    return value;
 }
 
+double SXString::doubleValue(SXStringParseError* pError) const
+{
+    double value;
+    SXStringParseError error = numberValue(value);
+    if (pError) {
+        *pError = error;
+    }
+    return value;
+}
+
+bool SXString::boolValue(SXStringParseError* pError) const
+{
+    std::string_view string = trimWhitespace(view());
+    if (string == "true" || string == "false") {
+        if (pError) {
+            *pError = SXStringParseErrorNone;
+        }
+        return string == "true";
+    }
+    
+    bool negative;
+    unsigned long long magnitude;
+    SXStringParseError error = parsedInteger(negative, magnitude, true);
+    if (pError) {
+        *pError = error;
+    }
+    return (error == SXStringParseErrorNone || error == SXStringParseErrorTrailingCharacters) && magnitude != 0;
+}
+
+template <typename T>
+bool SXString::parseNumbersFromArray(const SXArray* pStrings, std::vector<T>& rValues, size_t* pErrorIndex)
+{
+    unsigned int count = pStrings->count();
+    rValues.assign(count, T());
+    std::vector<size_t> errorIndexes;
+    
+    // Each range records its first failure, so the first failure overall is the smallest of them.
+    auto parseRange = [pStrings, &rValues](unsigned int begin, unsigned int end, size_t* pRangeErrorIndex) {
+        *pRangeErrorIndex = SX_STRING_NOT_FOUND;
+        for (unsigned int i = begin; i < end; i++) {
+            const SXString* pString = dynamic_cast<const SXString*>((*pStrings)[i]);
+            SXStringParseError error = pString ? pString->numberValue(rValues[i], false) : SXStringParseErrorInvalid;
+            if (error != SXStringParseErrorNone) {
+                rValues[i] = T();
+                if (*pRangeErrorIndex == SX_STRING_NOT_FOUND) {
+                    *pRangeErrorIndex = i;
+                }
+            }
+        }
+    };
+    
+    unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    if (count < SX_STRING_PARALLEL_PARSE_COUNT || threadCount == 1) {
+        errorIndexes.resize(1);
+        parseRange(0, count, &errorIndexes[0]);
+    } else {
+        unsigned int chunk = (count + threadCount - 1) / threadCount;
+        errorIndexes.resize((count + chunk - 1) / chunk);
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount - 1);
+        for (unsigned int begin = chunk; begin < count; begin += chunk) {
+            threads.emplace_back(parseRange, begin, std::min(begin + chunk, count), &errorIndexes[begin / chunk]);
+        }
+        parseRange(0, std::min(chunk, count), &errorIndexes[0]);
+        for (std::thread& rThread: threads) {
+            rThread.join();
+        }
+    }
+    
+    size_t errorIndex = *std::min_element(errorIndexes.begin(), errorIndexes.end());
+    if (pErrorIndex) {
+        *pErrorIndex = errorIndex;
+    }
+    return errorIndex == SX_STRING_NOT_FOUND;
+}
+
+template <typename T>
+bool SXString::parseNumbersFromBuffer(std::string_view buffer, std::string_view delimiters, std::vector<T>& rValues, size_t* pErrorIndex)
+{
+    if (buffer.empty()) {
+        rValues.clear();
+        if (pErrorIndex) {
+            *pErrorIndex = SX_STRING_NOT_FOUND;
+        }
+        return true;
+    }
+    
+    SXCharacterSet delimiterSet(delimiters);
+    const char* pBegin = buffer.data();
+    const char* pEnd = pBegin + buffer.length();
+    if (delimiterSet.table[static_cast<unsigned char>(pEnd[-1])]) {
+        pEnd--; // A final delimiter, such as the last newline, ends the last field.
+    }
+    
+    // Chunks start right after a delimiter, so that each field is in one chunk.
+    unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    if (buffer.length() < SX_STRING_PARALLEL_PARSE_LENGTH) {
+        threadCount = 1;
+    }
+    std::vector<const char*> chunkBegins(1, pBegin);
+    size_t chunkLength = static_cast<size_t>(pEnd - pBegin) / threadCount;
+    for (unsigned int i = 1; i < threadCount; i++) {
+        const char* pChunkBegin = std::max(pBegin + chunkLength * i, chunkBegins.back());
+        const char* pDelimiter = delimiterSet.find(pChunkBegin, pEnd);
+        if (pDelimiter == pEnd) {
+            break;
+        }
+        chunkBegins.push_back(pDelimiter + 1);
+    }
+    size_t chunkCount = chunkBegins.size();
+    chunkBegins.push_back(pEnd + 1); // As if the buffer was followed by a delimiter.
+    
+    // First count the fields of each chunk, so that each chunk knows where its values go, then parse.
+    std::vector<size_t> fieldCounts(chunkCount + 1, 0);
+    std::vector<size_t> errorIndexes(chunkCount, SX_STRING_NOT_FOUND);
+    auto countFields = [&](size_t chunk) {
+        const char* p = chunkBegins[chunk];
+        const char* pChunkEnd = chunkBegins[chunk + 1] - 1;
+        size_t fieldCount = 1;
+        while ((p = delimiterSet.find(p, pChunkEnd)) != pChunkEnd) {
+            fieldCount++;
+            p++;
+        }
+        fieldCounts[chunk + 1] = fieldCount;
+    };
+    auto parseFields = [&](size_t chunk) {
+        const char* p = chunkBegins[chunk];
+        const char* pChunkEnd = chunkBegins[chunk + 1] - 1;
+        size_t index = fieldCounts[chunk];
+        for (;;) {
+            const char* pFieldEnd = delimiterSet.find(p, pChunkEnd);
+            if (parseNumber(p, pFieldEnd, rValues[index]) != SXStringParseErrorNone) {
+                rValues[index] = T();
+                if (errorIndexes[chunk] == SX_STRING_NOT_FOUND) {
+                    errorIndexes[chunk] = index;
+                }
+            }
+            index++;
+            if (pFieldEnd == pChunkEnd) {
+                break;
+            }
+            p = pFieldEnd + 1;
+        }
+    };
+    auto forEachChunk = [chunkCount](const std::function<void(size_t)>& rFunction) {
+        std::vector<std::thread> threads;
+        threads.reserve(chunkCount - 1);
+        for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+            threads.emplace_back(rFunction, chunk);
+        }
+        rFunction(0);
+        for (std::thread& rThread: threads) {
+            rThread.join();
+        }
+    };
+    
+    forEachChunk(countFields);
+    for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+        fieldCounts[chunk + 1] += fieldCounts[chunk];
+    }
+    rValues.resize(fieldCounts[chunkCount]);
+    forEachChunk(parseFields);
+    
+    size_t errorIndex = *std::min_element(errorIndexes.begin(), errorIndexes.end());
+    if (pErrorIndex) {
+        *pErrorIndex = errorIndex;
+    }
+    return errorIndex == SX_STRING_NOT_FOUND;
+}
+
+template bool SXString::parseNumbersFromArray<int>(const SXArray*, std::vector<int>&, size_t*);
+template bool SXString::parseNumbersFromArray<unsigned int>(const SXArray*, std::vector<unsigned int>&, size_t*);
+template bool SXString::parseNumbersFromArray<long>(const SXArray*, std::vector<long>&, size_t*);
+template bool SXString::parseNumbersFromArray<unsigned long>(const SXArray*, std::vector<unsigned long>&, size_t*);
+template bool SXString::parseNumbersFromArray<long long>(const SXArray*, std::vector<long long>&, size_t*);
+template bool SXString::parseNumbersFromArray<unsigned long long>(const SXArray*, std::vector<unsigned long long>&, size_t*);
+template bool SXString::parseNumbersFromArray<float>(const SXArray*, std::vector<float>&, size_t*);
+template bool SXString::parseNumbersFromArray<double>(const SXArray*, std::vector<double>&, size_t*);
+
+template bool SXString::parseNumbersFromBuffer<int>(std::string_view, std::string_view, std::vector<int>&, size_t*);
+template bool SXString::parseNumbersFromBuffer<unsigned int>(std::string_view, std::string_view, std::vector<unsigned int>&, size_t*);
+template bool SXString::parseNumbersFromBuffer<long>(std::string_view, std::string_view, std::vector<long>&, size_t*);
+template bool SXString::parseNumbersFromBuffer<unsigned long>(std::string_view, std::string_view, std::vector<unsigned long>&, size_t*);
+template bool SXString::parseNumbersFromBuffer<long long>(std::string_view, std::string_view, std::vector<long long>&, size_t*);
+template bool SXString::parseNumbersFromBuffer<unsigned long long>(std::string_view, std::string_view, std::vector<unsigned long long>&, size_t*);
+template bool SXString::parseNumbersFromBuffer<float>(std::string_view, std::string_view, std::vector<float>&, size_t*);
+template bool SXString::parseNumbersFromBuffer<double>(std::string_view, std::string_view, std::vector<double>&, size_t*);
+
 const char* SXString::getCString() const
 {
-    return m_string.c_str();
+    if (m_storage == SXStringStorageView) {
+        const SXString* pParent = m_pSideTable.load(std::memory_order_relaxed)->pParent;
+        if (m_buffer.pChars + m_length == pParent->characters() + pParent->m_length && (pParent->m_storage != SXStringStorageMapped || isMappingTerminated(pParent->m_length))) {
+            return m_buffer.pChars; // The view ends where its parent does, before its NUL character.
+        }
+    }
+    if (m_storage == SXStringStorageView || m_storage == SXStringStorageRope || (m_storage == SXStringStorageMapped && !isMappingTerminated(m_length))) {
+        return flatCharacters();
+    }
+    return storedCharacters();
 }
 
 unsigned long SXString::length() const
 {
-    return m_string.length();
+    return m_length;
+}
+
+std::string_view SXString::view() const
+{
+    return std::string_view(characters(), m_length);
 }
 
 int SXString::compare(const char* pString) const
 {
-    return m_string.compare(pString);
+    return view().compare(pString);
+}
+
+SXString* SXString::substringWithRange(size_t location, size_t length) const
+{
+    location = std::min<size_t>(location, m_length);
+    SXString* pSubstring = newSubstring(location, std::min(length, m_length - location));
+    pSubstring->autorelease();
+    return pSubstring;
+}
+
+SXStringRange SXString::rangeOfString(std::string_view string, size_t fromIndex) const
+{
+    if (fromIndex > m_length) {
+        return SXStringRange{SX_STRING_NOT_FOUND, 0};
+    }
+    
+    size_t index = findString(characters() + fromIndex, m_length - fromIndex, string.data(), string.length());
+    if (index == SX_STRING_NOT_FOUND) {
+        return SXStringRange{SX_STRING_NOT_FOUND, 0};
+    }
+    return SXStringRange{fromIndex + index, string.length()};
+}
+
+bool SXString::hasPrefix(std::string_view prefix) const
+{
+    return prefix.length() <= m_length && memcmp(characters(), prefix.data(), prefix.length()) == 0;
+}
+
+bool SXString::hasSuffix(std::string_view suffix) const
+{
+    return suffix.length() <= m_length && memcmp(characters() + m_length - suffix.length(), suffix.data(), suffix.length()) == 0;
+}
+
+SXArray* SXString::componentsSeparatedByString(std::string_view separator, bool omitEmptyComponents) const
+{
+    std::vector<SXStringRange> ranges;
+    const char* pChars = characters();
+    size_t location = 0;
+    if (!separator.empty()) {
+        size_t index;
+        while ((index = findString(pChars + location, m_length - location, separator.data(), separator.length())) != SX_STRING_NOT_FOUND) {
+            ranges.push_back(SXStringRange{location, index});
+            location += index + separator.length();
+        }
+    }
+    ranges.push_back(SXStringRange{location, m_length - location});
+    return componentsInRanges(ranges, omitEmptyComponents);
+}
+
+SXArray* SXString::componentsSeparatedByCharactersInString(std::string_view characters, bool omitEmptyComponents) const
+{
+    SXCharacterSet characterSet(characters);
+    std::vector<SXStringRange> ranges;
+    const char* pChars = this->characters();
+    const char* pEnd = pChars + m_length;
+    const char* p = pChars;
+    const char* pSeparator;
+    while ((pSeparator = characterSet.find(p, pEnd)) != pEnd) {
+        ranges.push_back(SXStringRange{static_cast<size_t>(p - pChars), static_cast<size_t>(pSeparator - p)});
+        p = pSeparator + 1;
+    }
+    ranges.push_back(SXStringRange{static_cast<size_t>(p - pChars), static_cast<size_t>(pEnd - p)});
+    return componentsInRanges(ranges, omitEmptyComponents);
+}
+
+SXString* SXString::stringByAppendingString(const SXString* pString) const
+{
+    if (!pString || pString->m_length == 0 || m_length == 0) {
+        SXString* pSharedString = newSharedString((m_length == 0 && pString) ? pString : this);
+        pSharedString->autorelease();
+        return pSharedString;
+    }
+    
+    size_t length = m_length + pString->m_length;
+    if (length < SX_STRING_ROPE_MIN_LENGTH) {
+        SXString* pFlatString = newWithLength(length);
+        copyCharactersTo(pFlatString->storedCharacters());
+        pString->copyCharactersTo(pFlatString->storedCharacters() + m_length);
+        pFlatString->makeImmutable();
+        pFlatString->autorelease();
+        return pFlatString;
+    }
+    
+    SXString* pRope = new SXString();
+    pRope->setBuffer(SXStringStorageRope, nullptr, 0);
+    pRope->m_length = length;
+    SXStringSideTable* pSideTable = pRope->sideTable();
+    pSideTable->pLeft = newSharedString(this);
+    pSideTable->pRight = newSharedString(pString);
+    pRope->makeImmutable();
+    pRope->autorelease();
+    return pRope;
+}
+
+void SXString::appendString(const SXString* pString)
+{
+    if (!checkMutable() || !pString || pString->m_length == 0) {
+        return;
+    }
+    
+    collapseRope();
+    size_t length = m_length + pString->m_length;
+    if (m_storage != SXStringStorageRope && (length <= capacity() || length < SX_STRING_ROPE_MIN_LENGTH)) {
+        // pString may be this string: its characters are read before the buffer changes.
+        if (length <= capacity()) {
+            pString->copyCharactersTo(storedCharacters() + m_length);
+            storedCharacters()[length] = '\0';
+            m_length = length;
+        } else {
+            char* pBuffer = new char[length + 1];
+            memcpy(pBuffer, storedCharacters(), m_length);
+            pString->copyCharactersTo(pBuffer + m_length);
+            pBuffer[length] = '\0';
+            releaseStorage();
+            setBuffer(SXStringStorageHeap, pBuffer, length);
+            m_length = length;
+        }
+    } else {
+        // The previous value moves to the immutable first half of the rope, in O(1) unless it is stored in or after the object.
+        SXString* pRight = newSharedString(pString);
+        SXString* pLeft = new SXString(std::move(*this));
+        pLeft->makeImmutable();
+        releaseStorage();
+        setBuffer(SXStringStorageRope, nullptr, 0);
+        m_length = length;
+        SXStringSideTable* pSideTable = sideTable();
+        pSideTable->pLeft = pLeft;
+        pSideTable->pRight = pRight;
+    }
+    resetCachedValues();
+    m_atom = SXAtom();
+}
+
+SXAtom SXString::intern()
+{
+    if (m_atom.isNull()) {
+        m_atom = SXAtom::intern(view());
+    }
+    return m_atom;
+}
+
+SXAtom SXString::getAtom() const
+{
+    return m_atom;
 }
 
 bool SXString::isEqual(const SXObject* pObject) const
 {
+    if (pObject == this) {
+        return true;
+    }
+    
     const SXString* pString = dynamic_cast<const SXString*>(pObject);
-    return (pString != nullptr) && (m_string == pString->getCString());
+    if (!pString || pString->m_length != m_length) {
+        return false;
+    }
+    
+    size_t hash = m_hash.load(std::memory_order_relaxed);
+    size_t otherHash = pString->m_hash.load(std::memory_order_relaxed);
+    if (hash != 0 && otherHash != 0 && hash != otherHash) {
+        return false;
+    }
+    
+    return memcmp(characters(), pString->characters(), m_length) == 0;
+}
+
+size_t SXString::hash() const
+{
+    if (!m_atom.isNull()) {
+        return m_atom.hash();
+    }
+    
+    // Strings can be shared between threads: racing threads compute and store the same value.
+    size_t hash = m_hash.load(std::memory_order_relaxed);
+    if (hash == 0) {
+        hash = SXHashString(view());
+        m_hash.store(hash, std::memory_order_relaxed);
+    }
+    return hash;
 }
 
 SXObject* SXString::copy() const
 {
-    return new SXString(m_string.c_str());
+    SXString* pString = newWithLength(m_length);
+    copyCharactersTo(pString->storedCharacters());
+    pString->m_hash.store(m_hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    pString->m_atom = m_atom;
+    return pString;
+}
+
+SXString* SXString::newWithLength(size_t length)
+{
+    if (length <= SX_STRING_INLINE_CAPACITY) {
+        SXString* pString = new SXString();
+        pString->m_length = length;
+        pString->m_inlineChars[length] = '\0';
+        return pString;
+    }
+    
+    // One allocation for the object and its characters. operator delete() frees both, whatever the size.
+    void* pMemory = ::operator new(sizeof(SXString) + length + 1);
+    return ::new (pMemory) SXString(nullptr, length, static_cast<char*>(pMemory) + sizeof(SXString));
+}
+
+SXString* SXString::newSharedString(const SXString* pString)
+{
+    if (pString->m_immutable) {
+        SXString* pSharedString = const_cast<SXString*>(pString);
+        pSharedString->retain();
+        return pSharedString;
+    }
+    
+    SXString* pSharedString = newWithLength(pString->m_length);
+    pString->copyCharactersTo(pSharedString->storedCharacters());
+    pSharedString->makeImmutable();
+    return pSharedString;
+}
+
+SXStringParseError SXString::parsedInteger(bool& rNegative, unsigned long long& rMagnitude, bool keep) const
+{
+    SXStringSideTable* pSideTable = m_pSideTable.load(std::memory_order_acquire);
+    uint8_t state = pSideTable ? pSideTable->parseState.load(std::memory_order_acquire) : 0;
+    if (!(state & kParseStateInteger)) {
+        SXStringParseError error = parseInteger(characters(), characters() + m_length, rNegative, rMagnitude);
+        if (!keep) {
+            return error;
+        }
+        // Threads racing to parse store the same value and flags.
+        pSideTable = sideTable();
+        pSideTable->parsedInteger.store(rMagnitude, std::memory_order_relaxed);
+        state = static_cast<uint8_t>(kParseStateInteger | (rNegative ? kParseStateIntegerNegative : 0) | (error << kParseStateIntegerErrorShift));
+        state = pSideTable->parseState.fetch_or(state, std::memory_order_acq_rel) | state;
+    }
+    rNegative = (state & kParseStateIntegerNegative) != 0;
+    rMagnitude = pSideTable->parsedInteger.load(std::memory_order_relaxed);
+    return static_cast<SXStringParseError>((state >> kParseStateIntegerErrorShift) & kParseStateErrorMask);
+}
+
+SXStringParseError SXString::parsedReal(double& rValue, bool keep) const
+{
+    SXStringSideTable* pSideTable = m_pSideTable.load(std::memory_order_acquire);
+    uint8_t state = pSideTable ? pSideTable->parseState.load(std::memory_order_acquire) : 0;
+    if (!(state & kParseStateReal)) {
+        SXStringParseError error = parseReal(characters(), characters() + m_length, rValue);
+        if (!keep) {
+            return error;
+        }
+        uint64_t bits;
+        memcpy(&bits, &rValue, sizeof(bits));
+        pSideTable = sideTable();
+        pSideTable->parsedReal.store(bits, std::memory_order_relaxed);
+        state = static_cast<uint8_t>(kParseStateReal | (error << kParseStateRealErrorShift));
+        state = pSideTable->parseState.fetch_or(state, std::memory_order_acq_rel) | state;
+    }
+    uint64_t bits = pSideTable->parsedReal.load(std::memory_order_relaxed);
+    memcpy(&rValue, &bits, sizeof(rValue));
+    return static_cast<SXStringParseError>((state >> kParseStateRealErrorShift) & kParseStateErrorMask);
+}
+
+template <typename T>
+SXStringParseError SXString::numberValue(T& rValue, bool keep) const
+{
+    if constexpr (std::is_integral<T>::value) {
+        bool negative;
+        unsigned long long magnitude;
+        SXStringParseError error = parsedInteger(negative, magnitude, keep);
+        return convertNumber(error, negative, magnitude, rValue);
+    } else {
+        double value;
+        SXStringParseError error = parsedReal(value, keep);
+        return convertNumber(error, value, rValue);
+    }
+}
+
+void SXString::resetCachedValues()
+{
+    m_hash.store(0, std::memory_order_relaxed);
+    SXStringSideTable* pSideTable = m_pSideTable.load(std::memory_order_relaxed);
+    if (pSideTable) {
+        pSideTable->parseState.store(0, std::memory_order_relaxed);
+    }
+}
+
+SXString* SXString::newSubstring(size_t location, size_t length) const
+{
+    const char* pChars = characters() + location;
+    
+    // Views share the characters of the string that owns them, which must not change while they exist.
+    const SXString* pOwner = (m_storage == SXStringStorageView) ? m_pSideTable.load(std::memory_order_relaxed)->pParent : this;
+    if (length <= SX_STRING_INLINE_CAPACITY || !pOwner->m_immutable) {
+        return newWithCharacters(pChars, length);
+    }
+    
+    SXString* pView = new SXString();
+    pView->setBuffer(SXStringStorageView, const_cast<char*>(pChars), 0);
+    pView->m_length = length;
+    pView->sideTable()->pParent = const_cast<SXString*>(pOwner);
+    pView->sideTable()->pParent->retain();
+    return pView;
+}
+
+SXArray* SXString::componentsInRanges(const std::vector<SXStringRange>& ranges, bool omitEmptyComponents) const
+{
+    // Components of a mutable string share one immutable copy of it, when some of them are long enough to be views.
+    const SXString* pSource = this;
+    SXString* pSharedString = nullptr;
+    bool shareable = m_immutable || m_storage == SXStringStorageView;
+    if (!shareable && std::any_of(ranges.begin(), ranges.end(), [](const SXStringRange& rRange) { return rRange.length > SX_STRING_INLINE_CAPACITY; })) {
+        pSharedString = newSharedString(this);
+        pSource = pSharedString;
+    }
+    
+    SXArray* pComponents = SXArray::createWithCapacity(static_cast<unsigned int>(ranges.size()));
+    for (const SXStringRange& rRange : ranges) {
+        if (rRange.length == 0 && omitEmptyComponents) {
+            continue;
+        }
+        SXString* pComponent = pSource->newSubstring(rRange.location, rRange.length);
+        pComponents->addObject(pComponent);
+        pComponent->release();
+    }
+    
+    if (pSharedString) {
+        pSharedString->release();
+    }
+    return pComponents;
+}
+
+const char* SXString::characters() const
+{
+    return (m_storage == SXStringStorageRope) ? flatCharacters() : storedCharacters();
+}
+
+char* SXString::storedCharacters()
+{
+    return (m_storage == SXStringStorageInline) ? m_inlineChars : m_buffer.pChars;
+}
+
+const char* SXString::storedCharacters() const
+{
+    return (m_storage == SXStringStorageInline) ? m_inlineChars : m_buffer.pChars;
+}
+
+size_t SXString::capacity() const
+{
+    return (m_storage == SXStringStorageInline) ? SX_STRING_INLINE_CAPACITY : m_buffer.capacity;
+}
+
+void SXString::setBuffer(SXStringStorage storage, char* pChars, size_t capacity)
+{
+    m_storage = storage;
+    m_buffer.pChars = pChars;
+    m_buffer.capacity = capacity;
+}
+
+SXStringSideTable* SXString::sideTable() const
+{
+    SXStringSideTable* pSideTable = m_pSideTable.load(std::memory_order_acquire);
+    if (pSideTable) {
+        return pSideTable;
+    }
+    
+    SXStringSideTable* pNewSideTable = new SXStringSideTable();
+    if (m_pSideTable.compare_exchange_strong(pSideTable, pNewSideTable, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        return pNewSideTable;
+    }
+    delete pNewSideTable; // Another thread allocated it first.
+    return pSideTable;
+}
+
+const char* SXString::flatCharacters() const
+{
+    SXStringSideTable* pSideTable = sideTable();
+    char* pFlatChars = pSideTable->pFlatChars.load(std::memory_order_acquire);
+    if (pFlatChars) {
+        return pFlatChars;
+    }
+    
+    char* pBuffer = new char[m_length + 1];
+    copyCharactersTo(pBuffer);
+    pBuffer[m_length] = '\0';
+    if (pSideTable->pFlatChars.compare_exchange_strong(pFlatChars, pBuffer, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        return pBuffer;
+    }
+    delete[] pBuffer; // Another thread built it first.
+    return pFlatChars;
+}
+
+void SXString::copyCharactersTo(char* pBuffer) const
+{
+    // Ropes are walked in order with a stack of pending second halves, since long chains of appends make deep trees.
+    std::vector<const SXString*> strings(1, this);
+    while (!strings.empty()) {
+        const SXString* pString = strings.back();
+        strings.pop_back();
+        
+        const char* pChars = pString->storedCharacters();
+        if (pString->m_storage == SXStringStorageRope) {
+            const SXStringSideTable* pSideTable = pString->m_pSideTable.load(std::memory_order_acquire);
+            pChars = pSideTable->pFlatChars.load(std::memory_order_acquire);
+            if (!pChars) {
+                strings.push_back(pSideTable->pRight);
+                strings.push_back(pSideTable->pLeft);
+                continue;
+            }
+        }
+        memcpy(pBuffer, pChars, pString->m_length);
+        pBuffer += pString->m_length;
+    }
+}
+
+void SXString::collapseRope()
+{
+    char* pFlatChars = (m_storage == SXStringStorageRope) ? m_pSideTable.load(std::memory_order_acquire)->pFlatChars.exchange(nullptr, std::memory_order_acq_rel) : nullptr;
+    if (!pFlatChars) {
+        return;
+    }
+    
+    size_t length = m_length;
+    releaseStorage();
+    setBuffer(SXStringStorageHeap, pFlatChars, length);
+    m_length = length;
+}
+
+void SXString::assign(const char* pChars, size_t length)
+{
+    // The characters of views, ropes and mappings are not owned or not writable, and may even be the ones being assigned.
+    if (length > capacity() || m_storage == SXStringStorageView || m_storage == SXStringStorageRope || m_storage == SXStringStorageMapped) {
+        char* pBuffer = new char[length + 1];
+        memcpy(pBuffer, pChars, length);
+        releaseStorage();
+        setBuffer(SXStringStorageHeap, pBuffer, length);
+    } else {
+        memmove(storedCharacters(), pChars, length); // The characters may come from this string.
+    }
+    m_length = length;
+    storedCharacters()[length] = '\0';
+}
+
+void SXString::takeCharacters(SXString& rString)
+{
+    // An immutable string may be a key, a set member or the parent of views: it is copied and left unchanged.
+    if (rString.m_immutable) {
+        assign(rString.characters(), rString.m_length);
+        resetCachedValues();
+        m_hash.store(rString.m_hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_atom = rString.m_atom;
+        return;
+    }
+    
+    if (rString.m_storage == SXStringStorageInline || rString.m_storage == SXStringStorageTrailing) {
+        assign(rString.storedCharacters(), rString.m_length);
+    } else {
+        setBuffer(rString.m_storage, rString.m_buffer.pChars, rString.m_buffer.capacity);
+        m_length = rString.m_length;
+        m_pSideTable.store(rString.m_pSideTable.exchange(nullptr, std::memory_order_acq_rel), std::memory_order_release);
+        rString.m_storage = SXStringStorageInline;
+    }
+    resetCachedValues();
+    m_hash.store(rString.m_hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    m_atom = rString.m_atom;
+    
+    rString.m_length = 0;
+    rString.storedCharacters()[0] = '\0';
+    rString.resetCachedValues();
+    rString.m_atom = SXAtom();
+}
+
+void SXString::releaseStorage()
+{
+    if (m_storage == SXStringStorageHeap) {
+        delete[] m_buffer.pChars;
+    }
+#if !defined(_WIN32)
+    if (m_storage == SXStringStorageMapped) {
+        munmap(m_buffer.pChars, m_length);
+    }
+#endif
+
+    SXStringSideTable* pSideTable = m_pSideTable.exchange(nullptr, std::memory_order_acq_rel);
+    if (pSideTable) {
+        delete[] pSideTable->pFlatChars.load(std::memory_order_relaxed);
+        if (pSideTable->pParent) {
+            pSideTable->pParent->release();
+        }
+        
+        // Releasing a rope recursively could overflow the stack: the halves only referenced by this rope give up their own halves first, so the whole tree is released in this loop.
+        std::vector<SXString*> strings;
+        if (pSideTable->pLeft) {
+            strings.push_back(pSideTable->pLeft);
+            strings.push_back(pSideTable->pRight);
+        }
+        delete pSideTable;
+        while (!strings.empty()) {
+            SXString* pString = strings.back();
+            strings.pop_back();
+            SXStringSideTable* pHalfSideTable = pString->m_pSideTable.load(std::memory_order_relaxed);
+            if (pHalfSideTable && pHalfSideTable->pLeft && pString->retainCount() == 1) {
+                strings.push_back(pHalfSideTable->pLeft);
+                strings.push_back(pHalfSideTable->pRight);
+                pHalfSideTable->pLeft = nullptr;
+                pHalfSideTable->pRight = nullptr;
+            }
+            pString->release();
+        }
+    }
+    m_storage = SXStringStorageInline;
+    m_inlineChars[0] = '\0';
+    m_length = 0;
 }
 
 }
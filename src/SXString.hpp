@@ -27,13 +27,95 @@
 #define SXString_hpp
 
 #include "SXObject.hpp"
+#include "SXAtom.hpp"
+#include "SXArray.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace spalx {
 
+// Number of characters an SXString stores inside the object, without allocating a buffer.
+#define SX_STRING_INLINE_CAPACITY 23
+
+// Longest needle rangeOfString() searches by comparing candidates in full. Longer needles use the Two-Way algorithm.
+#define SX_STRING_SIMD_SEARCH_MAX_LENGTH 32
+
+// Largest set of characters componentsSeparatedByCharactersInString() compares with SIMD. Larger sets use a lookup table.
+#define SX_STRING_SIMD_CHARACTER_SET_MAX_LENGTH 8
+
+// Number of strings from which SXString::parseNumbersFromArray() parses in parallel.
+#define SX_STRING_PARALLEL_PARSE_COUNT 16384
+
+// Number of characters from which SXString::parseNumbersFromBuffer() parses in parallel.
+#define SX_STRING_PARALLEL_PARSE_LENGTH 262144
+
+// Size from which SXString::createWithContentsOfFile() may map a read-only file instead of reading it. Below it, copying costs little next to the risk of depending on the file.
+#define SX_STRING_MAP_MIN_LENGTH 1048576
+
+// Concatenations shorter than this are copied into a flat string instead of building a rope.
+#define SX_STRING_ROPE_MIN_LENGTH 256
+
+// Location of a range that was not found.
+#define SX_STRING_NOT_FOUND SIZE_MAX
+
+/**
+ * @brief Range of characters in a string.
+ */
+struct SXStringRange
+{
+    size_t location; /**< Index of the first character. SX_STRING_NOT_FOUND if there is no such range. */
+    size_t length; /**< Number of characters. */
+};
+
+/**
+ * @brief Outcome of parsing a string as a number.
+ */
+enum SXStringParseError
+{
+    SXStringParseErrorNone, /**< The whole string is a number, possibly surrounded by whitespace. */
+    SXStringParseErrorTrailingCharacters, /**< The string starts with a number, followed by other characters. The number is returned. */
+    SXStringParseErrorInvalid, /**< The string does not start with a number. 0 is returned. */
+    SXStringParseErrorOutOfRange /**< The number does not fit in the requested type. 0 is returned. */
+};
+
+/**
+ * @brief Where the characters of an SXString are stored.
+ */
+enum SXStringStorage : uint8_t
+{
+    SXStringStorageInline, /**< In the buffer inside the object, for short strings. */
+    SXStringStorageTrailing, /**< Right after the object, in the same allocation (see newWithCharacters()). */
+    SXStringStorageHeap, /**< In a separate buffer owned by the string. */
+    SXStringStorageView, /**< In the buffer of an immutable string the substring was taken from. */
+    SXStringStorageRope, /**< In the two strings it concatenates, copied to a flat buffer on first use. */
+    SXStringStorageMapped /**< In a read-only memory mapping of a file, unmapped with the string (see createWithContentsOfFile()). */
+};
+
+/**
+ * @brief Characters of an SXString that are not stored inside the object.
+ */
+struct SXStringBuffer
+{
+    char* pChars; /**< The characters. nullptr for ropes. */
+    size_t capacity; /**< Number of characters pChars has room for, without the NUL character. 0 when they are not owned or not writable. */
+};
+
+/**
+ * @brief Fields of an SXString that only some strings use, allocated separately (see SXString.cpp).
+ */
+struct SXStringSideTable;
+
 /**
  * @class SXString
  * @brief Wrapper class for strings.
+ * @details The characters are always followed by a NUL character and may contain NUL characters themselves. Strings of up to SX_STRING_INLINE_CAPACITY characters are stored inside the object, and the factories store longer strings right after the object, so a string takes a single allocation. The length is stored and the hash is computed once, on first use, until the value changes.
+ *
+ * Substrings of immutable strings are views sharing the characters of their parent, and concatenations are ropes referencing both halves, so slicing and joining do not copy characters. A rope copies its characters into a single buffer the first time they are needed contiguously, by getCString(), view(), hash() or a comparison: building a long text from n fragments costs O(n), whatever the number of concatenations.
  */
 class SXString : public SXObject
 {
@@ -50,12 +132,32 @@ public:
      */
     SXString(const char* pString);
     
+    /**
+     * @brief Parameterized constructor.
+     * @details Create from a character buffer of known length. The characters are copied once and may include NUL characters.
+     */
+    SXString(const char* pString, size_t length);
+    
     /**
      * @brief Copy constructor.
-     * @details Get string value from another SXString object.
+     * @details Get string value from another SXString object. The length and hash of the other string are reused.
      */
     SXString(const SXString& rString);
     
+    /**
+     * @brief Move constructor.
+     * @details Takes the buffer, view or rope of the other string, leaving it empty. Short strings and strings stored after their object are copied, and so are immutable strings, which are left unchanged since containers and views may depend on them.
+     */
+    SXString(SXString&& rString);
+    
+    /**
+     * @brief Parameterized constructor.
+     * @details Adopts a buffer without copying the characters. The string writes the terminating NUL character at pBuffer[length] and deletes the buffer with delete[].
+     * @param pBuffer Buffer allocated with new char[], with room for at least length + 1 characters.
+     * @param length The number of characters.
+     */
+    SXString(std::unique_ptr<char[]> pBuffer, size_t length);
+    
     /**
      * @brief Destructor.
      */
@@ -67,8 +169,37 @@ public:
      */
     static SXString* create(const char* pString);
     
+    /**
+     * @brief Create a new string from a character buffer of known length.
+     * @details The string is allocated together with its characters.
+     * @param pChars The characters to copy. May include NUL characters.
+     * @param length The number of characters.
+     * @return The new string object, autoreleased.
+     */
+    static SXString* createWithCharacters(const char* pChars, size_t length);
+    
+    /**
+     * @brief Allocate a new string from a character buffer of known length.
+     * @details Like createWithCharacters(), but not autoreleased: the caller owns the returned reference, as with new. Strings longer than SX_STRING_INLINE_CAPACITY characters are stored right after the object, in the same allocation.
+     * @param pChars The characters to copy. May include NUL characters.
+     * @param length The number of characters.
+     * @return The new string object, with a reference count of 1.
+     */
+    static SXString* newWithCharacters(const char* pChars, size_t length);
+    
+    /**
+     * @brief Allocate memory for a string object.
+     */
+    static void* operator new(size_t size);
+    
+    /**
+     * @brief Free the memory of a string object, including the characters stored after it.
+     */
+    static void operator delete(void* pMemory);
+    
     /**
      * @brief Create a new string with the contents of a file.
+     * @details The length is the size of the file, and the bytes are taken as they are, NUL characters included. Regular files of at least SX_STRING_MAP_MIN_LENGTH bytes that nobody has write permission on are memory mapped, and the string uses the mapping as its characters without copying them. Changing the string copies them first. Such a file must not be modified or truncated while the string exists: the string would see the changes, and reading past the new end of the file raises SIGBUS. Other files, which may change, are read with a single read into the string's own allocation.
      * @param pFilePath The path of the file to read from.
      * @return The new string object. nullptr if initialization or any file operation fails.
      */
@@ -81,6 +212,14 @@ public:
      */
     SXString& operator=(const SXString& rOtherString);
     
+    /**
+     * @brief Move assignment operator overload.
+     * @details Takes the buffer, view or rope of the other string, or copies it if it is immutable, as the move constructor does. Does nothing if this string is immutable.
+     * @param rOtherString The string to be moved from.
+     * @return Reference to the string assigned.
+     */
+    SXString& operator=(SXString&& rOtherString);
+    
     /**
      * @brief Overloaded subscript operator to access chars by index.
      * @details Provides read-only access to the character at the specified index.
@@ -91,39 +230,87 @@ public:
     
     /**
      * @brief Change the string value.
+     * @details Does nothing if the string is immutable.
      * @param pString The C string to set.
      */
     void setValue(const char* pString);
     
+    /**
+     * @brief Change the string value to a character buffer of known length.
+     * @details Reuses the current storage when the characters fit. Does nothing if the string is immutable.
+     * @param pChars The characters to copy. May include NUL characters.
+     * @param length The number of characters.
+     */
+    void setValue(const char* pChars, size_t length);
+    
     /**
      * @brief Convert string to int and get it.
-     * @return The integer value.
+     * @details Numbers are parsed with std::from_chars: no exception is thrown, and the result does not depend on the locale. Leading whitespace and a '+' or '-' sign are accepted. The integer is parsed once and kept until the value changes, so intValue(), longLongValue(), ulValue() and boolValue() share one parse.
+     * @param pError Set to the outcome of the parse, if not nullptr.
+     * @return The integer value. 0 if the string is not an integer that fits in an int.
+     */
+    int intValue(SXStringParseError* pError = nullptr) const;
+    
+    /**
+     * @brief Convert string to long long and get it.
+     * @param pError Set to the outcome of the parse, if not nullptr.
+     * @return The integer value. 0 if the string is not an integer that fits in a long long.
      */
-    int intValue() const;
+    long long longLongValue(SXStringParseError* pError = nullptr) const;
     
     /**
      * @brief Convert string to unsigned long and get it.
-     * @return The unsigned long value.
+     * @param pError Set to the outcome of the parse, if not nullptr.
+     * @return The unsigned long value. 0 if the string is not an integer that fits in an unsigned long, including negative integers.
      */
-    unsigned long ulValue() const;
+    unsigned long ulValue(SXStringParseError* pError = nullptr) const;
     
     /**
      * @brief Convert string to float and get it.
-     * @return The float value.
+     * @details The double value, rounded to a float.
+     * @param pError Set to the outcome of the parse, if not nullptr.
+     * @return The float value. 0 if the string is not a number that fits in a float.
      */
-    float floatValue() const;
+    float floatValue(SXStringParseError* pError = nullptr) const;
     
     /**
      * @brief Convert string to doule and get it.
-     * @return The double value.
+     * @details Decimal and scientific notations, "inf" and "nan" are accepted, with '.' as decimal separator whatever the locale. The value is parsed once and kept until the string changes.
+     * @param pError Set to the outcome of the parse, if not nullptr.
+     * @return The double value. 0 if the string is not a number that fits in a double.
      */
-    double doubleValue() const;
+    double doubleValue(SXStringParseError* pError = nullptr) const;
     
     /**
      * @brief Convert string to bool and get it.
+     * @details "true" and "false" are accepted, as well as integers, which are true when not 0.
+     * @param pError Set to the outcome of the parse, if not nullptr.
      * @return The boolean value.
      */
-    bool boolValue() const;
+    bool boolValue(SXStringParseError* pError = nullptr) const;
+    
+    /**
+     * @brief Parse an array of strings into numbers.
+     * @details Each element is parsed like intValue() or doubleValue(), in parallel for arrays of at least SX_STRING_PARALLEL_PARSE_COUNT elements. Values already parsed by the strings are reused, and new parses are not kept, so that nothing is allocated per string. Instantiated for int, unsigned int, long, unsigned long, long long, unsigned long long, float and double.
+     * @param pStrings Array of SXString objects. Other objects fail to parse.
+     * @param rValues Replaced by one value per element, 0 for elements that fail to parse.
+     * @param pErrorIndex Set to the index of the first element that is not exactly a number of type T, possibly surrounded by whitespace, or to SX_STRING_NOT_FOUND, if not nullptr.
+     * @return Whether all elements were parsed.
+     */
+    template <typename T>
+    static bool parseNumbersFromArray(const SXArray* pStrings, std::vector<T>& rValues, size_t* pErrorIndex = nullptr);
+    
+    /**
+     * @brief Parse a buffer of delimited numbers, such as a column or a table of CSV, into numbers.
+     * @details Fields are found and parsed in parallel for buffers of at least SX_STRING_PARALLEL_PARSE_LENGTH characters, without creating any string. A delimiter at the very end of the buffer does not start an empty field, so a final newline is ignored. Instantiated for the same types as parseNumbersFromArray().
+     * @param buffer The characters to parse.
+     * @param delimiters The characters separating fields, for example ",\n" for a table. Whitespace around fields is ignored.
+     * @param rValues Replaced by one value per field, 0 for fields that fail to parse.
+     * @param pErrorIndex Set to the index of the first field that is not exactly a number of type T, or to SX_STRING_NOT_FOUND, if not nullptr.
+     * @return Whether all fields were parsed.
+     */
+    template <typename T>
+    static bool parseNumbersFromBuffer(std::string_view buffer, std::string_view delimiters, std::vector<T>& rValues, size_t* pErrorIndex = nullptr);
     
     /**
      * @brief Get the C-style string value.
@@ -133,31 +320,259 @@ public:
     
     /**
      * @brief Get length of the string.
+     * @details The length is stored, not computed.
      * @return The length.
      */
     unsigned long length() const;
     
+    /**
+     * @brief Get the characters of the string.
+     * @return A view of the characters, valid until the value changes.
+     */
+    std::string_view view() const;
+    
     /**
      * @brief Compare string value with a C string.
      * @return 0 if strings are equal, >0 if the first non-matching character in the string is greater (in ASCII) than that of pString, <0 if the first non-matching character in the string is lower (in ASCII) than that of pString.
      */
     int compare(const char* pString) const;
     
+    /**
+     * @brief Get a part of the string.
+     * @details Substrings of immutable strings longer than SX_STRING_INLINE_CAPACITY characters share the characters of this string, which they retain. Other substrings are copied.
+     * @param location The index of the first character. Clamped to the length.
+     * @param length The number of characters. Clamped to the characters available after location.
+     * @return The substring, autoreleased.
+     */
+    SXString* substringWithRange(size_t location, size_t length) const;
+    
+    /**
+     * @brief Find the first occurrence of a string.
+     * @details Needles of up to SX_STRING_SIMD_SEARCH_MAX_LENGTH characters are found by comparing their first and last characters with 16 or 32 positions at a time (SSE2 or AVX2 when available), and only the candidates are compared in full. Longer needles use the Two-Way algorithm, which never compares a character of the string more than twice, whatever the needle.
+     * @param string The characters to look for.
+     * @param fromIndex The index to start searching at.
+     * @return The range of the occurrence. Its location is SX_STRING_NOT_FOUND if there is none. An empty string is found at fromIndex.
+     */
+    SXStringRange rangeOfString(std::string_view string, size_t fromIndex = 0) const;
+    
+    /**
+     * @brief Check whether the string starts with some characters.
+     * @param prefix The characters to compare with.
+     * @return Whether the first characters of the string are prefix.
+     */
+    bool hasPrefix(std::string_view prefix) const;
+    
+    /**
+     * @brief Check whether the string ends with some characters.
+     * @param suffix The characters to compare with.
+     * @return Whether the last characters of the string are suffix.
+     */
+    bool hasSuffix(std::string_view suffix) const;
+    
+    /**
+     * @brief Split the string at each occurrence of a separator.
+     * @details Occurrences are found with rangeOfString(). Components are substrings: those longer than SX_STRING_INLINE_CAPACITY characters share the characters of this string, or of a single immutable copy if this string is mutable.
+     * @param separator The characters separating components. An empty separator returns the whole string as the only component.
+     * @param omitEmptyComponents Whether to skip empty components, found between consecutive separators or at the ends.
+     * @return Array of the components, autoreleased.
+     */
+    SXArray* componentsSeparatedByString(std::string_view separator, bool omitEmptyComponents = false) const;
+    
+    /**
+     * @brief Split the string at each character belonging to a set.
+     * @details The string is scanned 16 or 32 characters at a time (SSE2 or AVX2 when available) for sets of up to SX_STRING_SIMD_CHARACTER_SET_MAX_LENGTH characters, one character at a time with a lookup table otherwise. Components are substrings, as with componentsSeparatedByString().
+     * @param characters The set of separating characters, as bytes: a multibyte UTF-8 character adds each of its bytes.
+     * @param omitEmptyComponents Whether to skip empty components, such as those between two consecutive spaces when splitting on whitespace.
+     * @return Array of the components, autoreleased.
+     */
+    SXArray* componentsSeparatedByCharactersInString(std::string_view characters, bool omitEmptyComponents = false) const;
+    
+    /**
+     * @brief Concatenate this string and another string.
+     * @details Builds a rope referencing both strings instead of copying their characters. Mutable strings are copied first, so later changes do not affect the result, and short results are copied into a flat string.
+     * @param pString The string to append.
+     * @return The concatenation, immutable and autoreleased. One of the two strings itself if the other is empty and it is immutable.
+     */
+    SXString* stringByAppendingString(const SXString* pString) const;
+    
+    /**
+     * @brief Append another string to this string.
+     * @details The characters are copied in place if they fit in the current storage. Otherwise the string becomes a rope of its previous value and pString, so appending costs O(1) and the characters are copied once, when they are first needed contiguously. Does nothing if the string is immutable.
+     * @param pString The string to append.
+     */
+    void appendString(const SXString* pString);
+    
+    /**
+     * @brief Intern the string value.
+     * @details The atom is kept by the string and reused until the value changes, so interning a string repeatedly only hashes it once.
+     * @return The atom for the current value.
+     */
+    SXAtom intern();
+    
+    /**
+     * @brief Get the atom of the string, if it was interned.
+     * @return The atom. A null atom if intern() was not called since the value last changed.
+     */
+    SXAtom getAtom() const;
+    
     /**
      * @brief Compare string with another string.
-     * @details Actually their C style string values are compared.
+     * @details The lengths are compared first, then the hashes if both are known, then the characters.
      * @return Whether the strings are equal or not.
      */
     virtual bool isEqual(const SXObject* pObject) const override;
     
+    /**
+     * @brief Get a hash value for the string.
+     * @details Same value as SXHashString() for the characters, so it matches the hash of an SXAtom or dictionary key with the same value. Computed on first call and kept until the value changes.
+     * @return The hash value.
+     */
+    virtual size_t hash() const override;
+    
     /**
      * @brief Create a new string with current string's value.
      * @return The new copied string.
      */
     virtual SXObject* copy() const override;
-    
+
 private:
-    std::string m_string; /**< C-style container string. */
+    SXStringStorage m_storage{SXStringStorageInline}; /**< Where the characters are. Declared first, so that it fits in the padding at the end of SXObject. */
+    size_t m_length{0}; /**< Number of characters. */
+    mutable std::atomic<size_t> m_hash{0}; /**< Hash of the characters. 0 until computed. */
+    mutable std::atomic<SXStringSideTable*> m_pSideTable{nullptr}; /**< State of views, ropes, flat copies and parsed numbers, allocated only for the strings that use it. */
+    SXAtom m_atom; /**< Atom of the current value, once interned. */
+    union
+    {
+        char m_inlineChars[SX_STRING_INLINE_CAPACITY + 1]; /**< Characters of short strings, with SXStringStorageInline, followed by a NUL character. */
+        SXStringBuffer m_buffer; /**< Characters stored elsewhere, with the other kinds of storage. */
+    };
+    
+    /**
+     * @brief Constructor of a string whose characters are stored after the object.
+     * @param pTrailingChars The memory after the object, with room for length + 1 characters.
+     */
+    SXString(const char* pChars, size_t length, char* pTrailingChars);
+    
+    /**
+     * @brief Allocate a string of a given length without initializing its characters.
+     * @return The new string object, with a reference count of 1.
+     */
+    static SXString* newWithLength(size_t length);
+    
+    /**
+     * @brief Get an immutable string with the value of another string: the string itself if it is immutable, an immutable copy otherwise.
+     * @return The string, retained.
+     */
+    static SXString* newSharedString(const SXString* pString);
+    
+    /**
+     * @brief Parse the integer value, or get it from the previous parse.
+     * @param rNegative Set to whether the integer has a '-' sign.
+     * @param rMagnitude Set to the absolute value.
+     * @param keep Whether to keep the result in the side table, allocating it if needed.
+     * @return The outcome of the parse.
+     */
+    SXStringParseError parsedInteger(bool& rNegative, unsigned long long& rMagnitude, bool keep) const;
+    
+    /**
+     * @brief Parse the double value, or get it from the previous parse.
+     * @param keep Whether to keep the result in the side table, allocating it if needed.
+     * @return The outcome of the parse.
+     */
+    SXStringParseError parsedReal(double& rValue, bool keep) const;
+    
+    /**
+     * @brief Get the value of the string as a number of any type, from the cached parses.
+     * @param keep Whether to keep a new parse for the next calls. Batch parsing does not, so that it allocates nothing per string.
+     * @return The outcome of the parse.
+     */
+    template <typename T>
+    SXStringParseError numberValue(T& rValue, bool keep = true) const;
+    
+    /**
+     * @brief Forget the hash and the parsed values, after the characters changed.
+     */
+    void resetCachedValues();
+    
+    /**
+     * @brief Get the characters stored in the object or in its buffer, without flattening ropes.
+     * @return The inline characters, or the buffer's. nullptr for ropes.
+     */
+    char* storedCharacters();
+    
+    /**
+     * @brief Get the characters stored in the object or in its buffer, without flattening ropes.
+     * @return The inline characters, or the buffer's. nullptr for ropes.
+     */
+    const char* storedCharacters() const;
+    
+    /**
+     * @brief Get the number of characters that fit in the current storage without reallocating it.
+     * @return The capacity, without the NUL character. 0 when the characters are not owned or not writable.
+     */
+    size_t capacity() const;
+    
+    /**
+     * @brief Switch to characters stored outside the object.
+     * @details The previous storage must already be released.
+     * @param storage The new kind of storage. Not SXStringStorageInline.
+     * @param pChars The characters.
+     * @param capacity Number of characters pChars has room for, without the NUL character.
+     */
+    void setBuffer(SXStringStorage storage, char* pChars, size_t capacity);
+    
+    /**
+     * @brief Get the side table, allocating it on first use.
+     * @details Threads racing to allocate it each allocate one, and all but one discard theirs.
+     */
+    SXStringSideTable* sideTable() const;
+    
+    /**
+     * @brief Get a substring, retained: a view if this string or the one it is a view of is immutable and the substring is long enough, a copy otherwise.
+     */
+    SXString* newSubstring(size_t location, size_t length) const;
+    
+    /**
+     * @brief Build the array of the substrings in a list of ranges, sharing a single immutable copy of the characters if this string is mutable.
+     */
+    SXArray* componentsInRanges(const std::vector<SXStringRange>& ranges, bool omitEmptyComponents) const;
+    
+    /**
+     * @brief Get the characters, contiguous but not always followed by a NUL character. Flattens ropes.
+     */
+    const char* characters() const;
+    
+    /**
+     * @brief Get the NUL-terminated copy of a rope or view, building it if needed.
+     * @details Threads racing to build it each build a copy, and all but one discard theirs.
+     */
+    const char* flatCharacters() const;
+    
+    /**
+     * @brief Copy the characters of the string, walking ropes without recursion, to a buffer of at least length() characters.
+     */
+    void copyCharactersTo(char* pBuffer) const;
+    
+    /**
+     * @brief Make a flattened rope a flat string that owns the buffer, releasing its halves.
+     */
+    void collapseRope();
+    
+    /**
+     * @brief Copy characters into the current storage, replacing it with a larger heap buffer if they do not fit.
+     */
+    void assign(const char* pChars, size_t length);
+    
+    /**
+     * @brief Take the storage of another string, or copy its characters if they are stored in or after the object, and leave it empty.
+     * @details Immutable strings are copied and left unchanged.
+     */
+    void takeCharacters(SXString& rString);
+    
+    /**
+     * @brief Free the heap buffer, if any, release the strings a view or rope references, and go back to the inline storage.
+     */
+    void releaseStorage();
 };
 
 } // namespace spalx